@@ -19,9 +19,18 @@ class AudioEngine {
 public:
     AudioEngine() = delete;
     static void init(IAudioOutput* output);
-    static void play(const ToneSequence* seq);
+    /// gain 0-255 scales the envelope's duty (255 = as designed)
+    static void play(const ToneSequence* seq, uint8_t gain = 255);
+    /// Start seq when esp_timer_get_time() reaches start_us (one-shot
+    /// esp_timer; at once if that is already past). A newer play() or
+    /// playAt() replaces a start still pending.
+    static void playAt(const ToneSequence* seq, int64_t start_us, uint8_t gain = 255);
+    /// Re-level the sounding tone without restarting it (crossfades)
+    static void setGain(uint8_t gain);
     static void stop();
     static bool isPlaying();
+    /// How late the last playAt() start fired, µs (timer dispatch latency)
+    static int32_t lastStartErrorUs();
 };
 
 #endif // AUDIO_ENGINE_H
@@ -57,6 +57,7 @@ constexpr gpio_num_t PIEZO_PIN_B = GPIO_NUM_23;  // push-pull complement
 #define NVS_DEFAULT_ELECT_W_ADJACENCY   5.0f
 #define NVS_DEFAULT_ELECT_W_TENURE      8.0f
 #define NVS_DEFAULT_ELECT_W_LOWBAT_PEN  0.1f
+#define NVS_DEFAULT_ELECT_W_HOPS        100.0f   // per extra hop a command travels on average
 #define NVS_DEFAULT_CLR_INIT            0x00140600   // orange (20,6,0)
 #define NVS_DEFAULT_CLR_READY           0x00140F00   // yellow  (20,15,0)
 #define NVS_DEFAULT_CLR_GATEWAY         0x00000008   // dim blue   (0,10,15)
@@ -66,6 +67,7 @@ constexpr gpio_num_t PIEZO_PIN_B = GPIO_NUM_23;  // push-pull complement
 // Phase 2: Heartbeat
 #define NVS_DEFAULT_HB_INTERVAL_S      30
 #define NVS_DEFAULT_HB_STALE_MULT      3
+#define NVS_DEFAULT_HB_ACTIVE_S        5       // heartbeat while the orchestrator is playing
 #define NVS_DEFAULT_REELECT_DELTA_MV   200
 #define NVS_DEFAULT_REELECT_COOLDOWN_S 60
 #define NVS_DEFAULT_REELECT_DETHRONE_MV 300
@@ -86,16 +88,104 @@ constexpr gpio_num_t PIEZO_PIN_B = GPIO_NUM_23;  // push-pull complement
 #define NVS_DEFAULT_ORCH_RANDOM_MAX    15000
 #define NVS_DEFAULT_ORCH_TONE_INDEX    0
 #define NVS_DEFAULT_CSYNC_INTERVAL_S   10
+#define CSYNC_WINDOW                   6       // clock-sync samples; the least-delayed one sets the offset
+#define CSYNC_DRIFT_MAX_PPM            50      // crystal drift between node and gateway is clamped to this (±20 ppm each, margin)
+#define CSYNC_DRIFT_RESID_PPM          2       // drift error assumed once estimated: older samples lose this much per µs of age
+#define CSYNC_DRIFT_BASE_S             50      // a drift estimate spans at least this long between window minima
+#define CSYNC_PROBES_PER_SYNC          4       // gateway: start-skew probes sent per sync broadcast, round-robin over nodes
+#define CSYNC_PROBE_MAX_RTT_US         20000   // a slower probe round trip bounds the skew too loosely to count
+#define ORCH_PLAY_LEAD_MS              150     // PLAY_CMD start time this far ahead (hops + queueing)
+#define ORCH_SCRIPT_LEAD_MS            1000    // GO this far ahead: parts and GOs paced through the reliable pool
+#define ORCH_SCRIPT_SEND_MS            5000    // distribution waits this long for every node's ACKs
+#define ORCH_SCRIPT_SEND_TRIES         2       // sends of a part / GO before the node counts as unreached
+#define ORCH_SCRIPT_REL_SPARE          2       // reliable slots a distribution leaves to other traffic
+#define ORCH_SCRIPT_MAX_EVENTS         192     // events in one compiled script (gateway, ≤ 255)
+#define ORCH_SCRIPT_NODE_EVENTS        48      // events in one node's part of it (one frame)
+#define ORCH_SCRIPT_MIN_PERIOD_MS      50      // a script loops no faster than this
+#define ORCH_SCRIPT_RANDOM_SPAN_MS     60000   // random mode compiles this much ahead per script
+#define ORCH_SCRIPT_LATE_MS            50      // an event later than this is skipped, not played
+#define TRAVEL_PATH_BUDGET             200000  // 2-opt/Or-opt move evaluations per path build
+#define ORCH_PAN_NODES                 3       // nodes sharing the phantom source
+#define ORCH_PAN_GRAIN_MS              100     // gain update step along the trajectory
+#define ORCH_PAN_BLUR_CM               50      // keeps the gain finite on top of a node
+#define ORCH_PAN_MIN_GAIN              16      // weaker shares are dropped (2 nodes play)
+#define SPEED_OF_SOUND_CM_S            34300   // air at ~20 °C: 29 us per cm
+#define ORCH_ALIGN_RESEND_US           250     // alignment drift that warrants resending a script
 
 // Phase 5: Web UI
 #define NVS_DEFAULT_WEB_ENABLED         true
 #define SOFTAP_MAX_CONNECTIONS          4
 
 // Mesh config
-#define MESH_MAX_NODES       16
+#ifndef MESH_MAX_NODES
+#define MESH_MAX_NODES       64      // PeerTable/solver/scheduler slots (override with -D)
+#endif
 #define MESH_CHANNEL         1
 #define MESH_MAX_LAYER       4
 
+// Mesh fragmentation (messages larger than one mesh frame)
+#define MESH_FRAG_MTU          512     // max bytes per mesh frame (meshRx receive buffer)
+#define MESH_FRAG_MAX_PAYLOAD  2048    // largest message that can be reassembled
+#define MESH_FRAG_POOL_SLOTS   3       // concurrent reassemblies (static pool)
+#define MESH_FRAG_TIMEOUT_MS   2000    // drop a partial message after this
+
+// Reliable channel (ACK + retransmit for critical control messages)
+#define MESH_REL_SLOTS         12      // outstanding unACKed messages (static pool)
+#define MESH_REL_TICK_MS       50      // retransmit scan period
+#define MESH_REL_RTO_INIT_MS   500     // RTO before the first RTT sample
+#define MESH_REL_RTO_MIN_MS    100
+#define MESH_REL_RTO_MAX_MS    4000
+#define MESH_REL_MAX_RETRIES   5       // give up after this many retransmissions
+
+// Loopback queue for self-addressed messages (holds a reassembled max)
+#define MESH_LOOPBACK_RING_BYTES 4096
+
+// Remote config fan-out
+#define MESH_CONFIG_TIMEOUT_MS  5000    // per-peer reply timeout
+#define MESH_CONFIG_RING_BYTES  8192    // queued replies awaiting the caller
+
+// Link telemetry (LinkStats): quality score 0-100 from loss, RTT and RSSI
+#define LINK_POOR_QUALITY      40      // below this, playback/FTM steer around the peer
+#define LINK_RTT_GOOD_MS       50      // smoothed RTT above this costs 1 point per 5 ms
+#define LINK_RSSI_GOOD_DBM     -70     // parent RSSI below this costs 3 points per dB
+#define LINK_RSSI_REPORT_DB    3       // heartbeat re-sends RSSI after this much change
+#define LINK_STALE_MS          120000  // stats older than this no longer count
+
+// Hot-standby gateway (continuous replication, in-place failover)
+#define MESH_STANDBY_REPL_MS      1000    // gateway → standby replication / keepalive period
+#define MESH_STANDBY_MISSED       3       // standby takes over after this many silent periods
+#define MESH_STANDBY_BATCH        4       // max replication frames per period
+#define MESH_STANDBY_FAILOVER_MS  20000   // node gives up waiting for a new gateway → reboot
+
+// Split-mesh merge: the lower-scored gateway ships its PeerTable and edges
+// to the survivor, then steps down (no reboot, no re-sweep)
+#define MESH_MERGE_TICK_MS        250     // transfer pacing / HELLO retry period
+#define MESH_MERGE_BATCH          3       // reliable frames per tick (leaves slots for control traffic)
+#define MESH_MERGE_HELLO_TRIES    8       // HELLOs sent before giving up on finding a peer gateway
+#define MESH_MERGE_TIMEOUT_MS     15000   // survivor applies what it has if DONE never arrives
+
+// Geometry cache (LittleFS): changes within this window share one file write
+#define GEO_CACHE_BATCH_MS        60000
+// time() at or past this (2023-01-01) was set by SNTP, not counted from boot
+#define GEO_CACHE_EPOCH_VALID     1672531200u
+
+// Peer liveness: per-peer deadlines (heartbeat interval × stale multiplier)
+// expire through a min-heap; the periodic tick handles re-election and
+// flushes battery/flag changes as one PEER_SYNC delta
+#define PEER_REELECT_CHECK_MS     60000
+
+// A full PeerTable recycles a slot once its peer has been silent this long
+#define PEER_RECLAIM_GRACE_MS     600000
+
+// Heartbeat aggregation: every Nth flush resends all fields (heals lost frames)
+#define MESH_HB_AGG_FULL_EVERY    10
+
+// Peer sync: a node that sees an epoch gap asks for a FULL at most this often
+#define MESH_SYNC_REQ_HOLDOFF_MS  2000
+
+// Position broadcast: full snapshot every N broadcasts, deltas in between
+#define MESH_POS_FULL_EVERY    10
+
 // Election
 #define ELECT_BATTERY_FLOOR_MV  2900    // below this: heavy score penalty (not disqualifying)
 
@@ -112,6 +202,10 @@ constexpr gpio_num_t PIEZO_PIN_B = GPIO_NUM_23;  // push-pull complement
 #define MESH_PROMOTE_BASE_MS   10000   // minimum wait before self-promoting to root
 #define MESH_PROMOTE_JITTER_MS 10000   // MAC-based jitter added on top (total: 10-20s)
 
+// Warm rejoin from RtcMap (settled mesh cached across deep sleep)
+#define MESH_WARM_PARENT_MS    4000    // cached parent must take us within this, else scan
+#define MESH_WARM_CONFIRM_MS   8000    // cached gateway must accept a heartbeat, else elect
+
 // BOOT button — GPIO0 on all ESP32 boards, press to force gateway promotion
 #define BOOT_BUTTON_PIN        GPIO_NUM_0
 #define BOOT_BUTTON_DEBOUNCE_MS 50
@@ -3,6 +3,15 @@
 
 #include <stdint.h>
 
+class Print;
+struct ClockProbeMsg;
+
+// Mesh time = the gateway's millis(). Nodes track it from CLOCK_SYNC
+// broadcasts; each sample is late by its delivery delay, so the offset is
+// taken from the least-delayed of the last CSYNC_WINDOW samples, projected
+// along a drift rate fitted between successive windows' best samples.
+// The gateway also probes nodes round-robin to measure the cross-node
+// start skew the sync actually achieves.
 class ClockSync {
 public:
     ClockSync() = delete;
@@ -11,6 +20,14 @@ public:
     static void onSyncReceived(uint32_t gateway_ms);
     static uint32_t meshTime();
     static bool isSynced();
+
+    /// esp_timer_get_time() at which the mesh clock reads mesh_ms.
+    static int64_t localUs(uint32_t mesh_ms);
+
+    static void onProbe(const uint8_t* from, const ClockProbeMsg* probe);
+    static void onProbeReply(const ClockProbeMsg* reply);
+
+    static void printStatus(Print& out);
 };
 
 #endif // CLOCK_SYNC_H
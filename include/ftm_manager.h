@@ -25,7 +25,8 @@ public:
     static void onFtmWake(const uint8_t* initiator_mac, const uint8_t* responder_mac,
                           const uint8_t* responder_ap_mac);
 
-    /// Handle FTM_GO message — start ranging to the given target
+    /// Handle FTM_GO message — queue ranging to the given target. The
+    /// session and its FTM_RESULT run on FtmManager's own task.
     static void onFtmGo(const uint8_t* target_ap_mac, uint8_t samples);
 
     /// Check if an FTM session is currently in progress
@@ -0,0 +1,83 @@
+#ifndef FTM_QUEUE_H
+#define FTM_QUEUE_H
+
+#include <stdint.h>
+#ifndef MESH_MAX_NODES
+#include "bsp.hpp"
+#endif
+
+// FTM pair priority levels
+enum FtmPriority : uint8_t {
+    FTM_PRIO_NEW_NODE    = 0,  // P0: no position yet
+    FTM_PRIO_RESIDUAL    = 1,  // P1: high solver residual
+    FTM_PRIO_MOVEMENT    = 2,  // P2: RSSI/Kalman detected movement
+    FTM_PRIO_STALE       = 3,  // P3: staleness timeout
+    FTM_PRIO_SWEEP       = 4,  // P4: periodic full sweep
+    FTM_PRIO_COUNT
+};
+
+#define FTM_ITEM_SWAPPED  0x01   // the edge's higher slot is the initiator
+
+// The pair itself is the edge the item is queued under
+// (PeerTable::edgeNodes()); gens and flags are relative to its lower slot.
+struct FtmQueueItem {
+    uint32_t queued_ms;      // millis() when queued
+    uint8_t  genLo, genHi;   // PeerTable::generation() of the lower/higher slot when queued
+    uint8_t  priority;       // FtmPriority
+    uint8_t  flags;          // FTM_ITEM_*
+};
+
+// Pending FTM pairs: one FIFO per priority, at most one entry per edge.
+//
+// Each edge (PeerTable::edgeIndex) owns a fixed slot; a "queued" bit per
+// edge answers the duplicate test, and queued slots are linked into their
+// priority's list. Push, pop, lookup and re-prioritising are O(1), so a
+// staleness sweep over every edge stays linear. No locking: the owner
+// serializes access (FtmScheduler runs it on the timer-service task).
+// Pure data structure, no Arduino dependency: built on the host by
+// test/test_native_ftm_queue.
+class FtmQueue {
+public:
+    static constexpr uint16_t CAPACITY = (MESH_MAX_NODES * (MESH_MAX_NODES - 1)) / 2;
+
+    FtmQueue() { clear(); }
+
+    void     clear();
+    uint16_t size() const { return _count; }
+
+    /// Queued item for edge, nullptr if the edge is not queued
+    const FtmQueueItem* find(uint16_t edge) const;
+
+    /// Queue item under edge, at the tail of item.priority. An entry the
+    /// edge already had is replaced (and moves to the new tail).
+    bool push(uint16_t edge, const FtmQueueItem& item);
+
+    /// Most urgent item and its edge, oldest first within a priority
+    bool pop(FtmQueueItem* out, uint16_t* edge);
+
+    /// Visit queued (edge, item) in pop order (debug print)
+    template <typename F>
+    void forEach(F f) const {
+        for (uint8_t p = 0; p < FTM_PRIO_COUNT; p++)
+            for (uint16_t e = _head[p]; e != NONE; e = _next[e])
+                f(e, _items[e]);
+    }
+
+private:
+    static constexpr uint16_t NONE = 0xFFFF;
+
+    bool queued(uint16_t edge) const {
+        return (_queued[edge >> 3] >> (edge & 7)) & 1u;
+    }
+    void unlink(uint16_t edge);
+
+    FtmQueueItem _items[CAPACITY];
+    uint16_t     _prev[CAPACITY];
+    uint16_t     _next[CAPACITY];
+    uint8_t      _queued[(CAPACITY + 7) / 8];
+    uint16_t     _head[FTM_PRIO_COUNT];
+    uint16_t     _tail[FTM_PRIO_COUNT];
+    uint16_t     _count;
+};
+
+#endif // FTM_QUEUE_H
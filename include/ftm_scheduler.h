@@ -2,23 +2,10 @@
 #define FTM_SCHEDULER_H
 
 #include "bsp.hpp"
+#include "ftm_queue.h"
 #include <stdint.h>
 
-// FTM pair priority levels
-enum FtmPriority : uint8_t {
-    FTM_PRIO_NEW_NODE    = 0,  // P0: no position yet
-    FTM_PRIO_RESIDUAL    = 1,  // P1: high solver residual
-    FTM_PRIO_MOVEMENT    = 2,  // P2: RSSI/Kalman detected movement
-    FTM_PRIO_STALE       = 3,  // P3: staleness timeout
-    FTM_PRIO_SWEEP       = 4,  // P4: periodic full sweep
-};
-
-struct FtmQueueItem {
-    uint8_t     nodeA_idx;
-    uint8_t     nodeB_idx;
-    FtmPriority priority;
-    uint32_t    queued_ms;   // millis() when queued
-};
+#define FTM_EDGE_AGE_UNKNOWN  0xFFFF   // edgeAge_s(): no measurement timestamp
 
 // Pair execution state machine
 enum FtmPairState : uint8_t {
@@ -59,6 +46,19 @@ public:
     /// Check if scheduler is actively running measurements
     static bool isActive();
 
+    /// Seconds since the edge (PeerTable::edgeIndex) was last measured,
+    /// FTM_EDGE_AGE_UNKNOWN if never measured here
+    static uint16_t edgeAge_s(uint16_t edge);
+
+    /// Backdate an edge imported from elsewhere (split-mesh merge)
+    static void setEdgeAge(uint16_t edge, uint16_t age_s);
+
+    /// PeerTable handed slot idx to a new peer: forget its edge ages, abort
+    /// a pair in progress on it and resend positions in full. Safe from
+    /// any task (the work is pended to the timer task). Queued pairs are
+    /// dropped by generation when popped.
+    static void onSlotRecycled(uint8_t idx);
+
     /// Debug: print queue state
     static void print();
 
@@ -0,0 +1,45 @@
+#ifndef GEO_CACHE_H
+#define GEO_CACHE_H
+
+#include <stdint.h>
+
+class Print;
+
+// Persistent geometry cache (gateway only).
+//
+// The measured edge set (distance, quality, age) and the filtered positions
+// are written to LittleFS keyed by MAC, not by PeerTable slot, so they stay
+// valid across reboots and re-elections that renumber the table. A gateway
+// that starts loads the cache into PeerTable: cached peers get slots marked
+// DEAD until they heartbeat, their edges keep their age, and the FTM sweep
+// re-queues only the edges that are stale. Travel mode has geometry from
+// the first second instead of after a full re-sweep. When the time since
+// the save cannot be known (power cycle, no SNTP), edges load as stale:
+// their distances seed the solver but every one is re-measured.
+//
+// Writes are batched: markDirty() only wakes a low-priority task, which
+// coalesces changes for GEO_CACHE_BATCH_MS before one rewrite of the file.
+class GeoCache {
+public:
+    GeoCache() = delete;
+
+    /// Gateway::begin(), after PeerTable/FtmScheduler init: load the cache
+    /// into PeerTable and start accepting writes.
+    static void begin();
+
+    /// Gateway::end(): write pending changes now, then stop.
+    static void end();
+
+    /// Edges or positions changed: schedule a batched write.
+    static void markDirty();
+
+    /// Write the cache immediately (CLI).
+    static bool flush();
+
+    /// Delete the cache file.
+    static void clear();
+
+    static void printStatus(Print& out);
+};
+
+#endif // GEO_CACHE_H
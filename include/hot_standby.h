@@ -0,0 +1,44 @@
+#ifndef HOT_STANDBY_H
+#define HOT_STANDBY_H
+
+#include <stdint.h>
+
+class Print;
+
+// Hot-standby gateway.
+//
+// The gateway designates one peer (best-ranked in the last election) as
+// standby and streams it incremental state every MESH_STANDBY_REPL_MS:
+// changed distance edges and the orchestrator mode/travel order/sequence.
+// Peer identities and positions already reach every node via PEER_SYNC and
+// POS_UPDATE. The stream doubles as the gateway's liveness signal: after
+// MESH_STANDBY_MISSED silent periods the standby becomes gateway in place
+// and announces itself with ROLE_CHANGE — no reboot, no re-election.
+class HotStandby {
+public:
+    HotStandby() = delete;
+
+    // Gateway side (Gateway::begin / end)
+    static void beginPrimary();
+    static void endPrimary();
+
+    // Mesh dispatch hooks (all nodes)
+    static void onAssign(const uint8_t* from, const uint8_t* standby_mac);
+    static void onRepl(const uint8_t* from, const uint8_t* buf, uint16_t len);
+    static void onGatewayHeard();
+    static void onGatewayChanged(const uint8_t* new_gw);
+
+    /// Node lost its path to the gateway. Returns true if a standby will take
+    /// over (caller must not reboot); a fallback reboot is armed internally.
+    static bool onGatewayLost();
+
+    /// Called by MeshConductor once this node has assumed the gateway role:
+    /// loads the replica into PeerTable/Orchestrator (slot numbers remapped).
+    static void applyReplica();
+
+    static bool isStandby();
+    static const uint8_t* standbyMac();   // nullptr if none designated
+    static void printStatus(Print& out);
+};
+
+#endif // HOT_STANDBY_H
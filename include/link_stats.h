@@ -0,0 +1,74 @@
+#ifndef LINK_STATS_H
+#define LINK_STATS_H
+
+#include <stdint.h>
+
+class Print;
+
+#define LINK_HIST_BUCKETS  6
+
+// Per-peer mesh link telemetry, keyed by STA MAC.
+//
+// MeshConductor feeds it from the send path (esp_mesh_send latency and
+// failures), the reliable channel (ACK RTT samples, retransmits, give-ups)
+// and LINK_PING/PONG probes. Each peer reports its own mesh layer and
+// parent RSSI in its heartbeat record. quality() folds loss, RTT and RSSI
+// into a 0-100 score the orchestrator and FTM scheduler use to steer
+// time-critical traffic away from bad links.
+struct LinkStatsEntry {
+    uint8_t  mac[6];
+    uint32_t tx_frames;                       // esp_mesh_send calls
+    uint32_t tx_fail;                         // esp_mesh_send != ESP_OK
+    uint32_t rel_sent;                        // reliable messages (first transmission)
+    uint32_t rel_retx;
+    uint32_t rel_giveup;
+    uint32_t pings;                           // LINK_PING sent
+    uint32_t pongs;                           // LINK_PONG received
+    uint32_t send_hist[LINK_HIST_BUCKETS];    // esp_mesh_send duration, µs
+    uint32_t rtt_hist[LINK_HIST_BUCKETS];     // ACK / ping round trip, ms
+    uint32_t rssi_hist[LINK_HIST_BUCKETS];    // reported parent RSSI, dBm
+    uint32_t send_max_us;
+    uint32_t srtt_us;                         // smoothed RTT, 0 = no sample yet
+    uint32_t rtt_min_us;
+    uint32_t rtt_max_us;
+    uint16_t loss_x1000;                      // EWMA of lost transmissions, ‰
+    uint8_t  layer;                           // 0 = not reported yet
+    int8_t   rssi;                            // 0 = not reported yet
+    uint32_t last_ms;                         // last update of any kind
+};
+
+class LinkStats {
+public:
+    LinkStats() = delete;
+
+    static void init();
+    static void reset();
+
+    // MeshConductor hooks (any task; never block on the network)
+    static void onSend(const uint8_t* mac, uint32_t us, bool ok);
+    static void onReliableSent(const uint8_t* mac);
+    static void onRetransmit(const uint8_t* mac);
+    static void onGiveUp(const uint8_t* mac);
+    static void onRtt(const uint8_t* mac, uint32_t us);
+    static void onLinkReport(const uint8_t* mac, uint8_t layer, int8_t rssi);
+    static void onPing(const uint8_t* from, const uint8_t* buf, uint16_t len);
+    static void onPong(const uint8_t* from, const uint8_t* buf, uint16_t len);
+
+    /// Send one LINK_PING; the PONG lands in the RTT histogram.
+    static void ping(const uint8_t* mac);
+
+    /// This node's own mesh layer and parent RSSI (0, 0 when unknown).
+    static void sampleOwnLink(uint8_t* layer, int8_t* rssi);
+
+    /// 0-100; 100 when nothing bad is known about the link.
+    static uint8_t quality(const uint8_t* mac);
+    static bool isPoor(const uint8_t* mac);   // quality < LINK_POOR_QUALITY
+
+    /// Copy one peer's entry. Returns false if the peer is not tracked.
+    static bool get(const uint8_t* mac, LinkStatsEntry* out);
+
+    static void printStatus(Print& out);
+    static void printJson(Print& out);
+};
+
+#endif // LINK_STATS_H
@@ -0,0 +1,82 @@
+#ifndef MAC_INDEX_H
+#define MAC_INDEX_H
+
+#include <stdint.h>
+#include <string.h>
+
+// MAC → slot index over an external slot array (PeerTable::s_entries):
+// open addressing, linear probing, at most half full for NODES slots.
+// Holds slot + 1 (0 = empty), so NODES may go up to 255. Entry is any type
+// with a uint8_t mac[6] member; a probe hit is confirmed against it.
+//
+// No locking. Lookups are safe against a single concurrent writer as long
+// as a slot's MAC is written before add() publishes it and remove() runs
+// while the slot still holds the MAC it was indexed under. Header-only and
+// Arduino-free: test/test_native_mac_index benchmarks it on the host,
+// including past PeerTable's 127-slot limit.
+template <uint16_t NODES>
+class MacIndex {
+public:
+    static_assert(NODES >= 1 && NODES <= 255, "index holds slot + 1 in a byte");
+
+    static constexpr uint16_t SIZE = []() {
+        uint16_t n = 1;
+        while (n < 2u * NODES) n <<= 1;
+        return n;
+    }();
+    static constexpr uint16_t MASK = SIZE - 1;
+
+    void clear() { memset(_index, 0, sizeof(_index)); }
+
+    // Espressif OUIs repeat across the flotilla: hash the NIC-specific low bytes
+    static uint16_t hash(const uint8_t* mac) {
+        uint32_t k = ((uint32_t)mac[3] << 16) | ((uint32_t)mac[4] << 8) | mac[5];
+        return (uint16_t)((k * 2654435761u) >> 16) & MASK;
+    }
+
+    /// Slot holding mac among the first count entries, -1 if none
+    template <typename Entry>
+    int16_t find(const Entry* entries, uint16_t count, const uint8_t* mac) const {
+        for (uint16_t h = hash(mac);; h = (h + 1) & MASK) {
+            uint8_t v = _index[h];
+            if (v == 0) return -1;
+            uint8_t i = v - 1;
+            if (i < count && memcmp(entries[i].mac, mac, 6) == 0)
+                return i;
+        }
+    }
+
+    /// Publish slot idx under entries[idx].mac (not already indexed)
+    template <typename Entry>
+    void add(const Entry* entries, uint8_t idx) {
+        uint16_t h = hash(entries[idx].mac);
+        while (_index[h] != 0) h = (h + 1) & MASK;
+        _index[h] = idx + 1;
+    }
+
+    // Backward-shift deletion (no tombstones). An entry is copied into the
+    // hole before its old position is cleared, so concurrent readers never
+    // miss it.
+    template <typename Entry>
+    void remove(const Entry* entries, uint8_t idx) {
+        uint16_t h = hash(entries[idx].mac);
+        while (_index[h] != idx + 1) {
+            if (_index[h] == 0) return;
+            h = (h + 1) & MASK;
+        }
+        for (uint16_t j = (h + 1) & MASK; _index[j] != 0; j = (j + 1) & MASK) {
+            uint16_t home = hash(entries[_index[j] - 1].mac);
+            // Move j into the hole unless its home lies cyclically in (h, j]
+            bool stays = (h < j) ? (home > h && home <= j) : (home > h || home <= j);
+            if (stays) continue;
+            _index[h] = _index[j];
+            h = j;
+        }
+        _index[h] = 0;
+    }
+
+private:
+    uint8_t _index[SIZE] = {};
+};
+
+#endif // MAC_INDEX_H
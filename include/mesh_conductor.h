@@ -9,7 +9,15 @@
 
 enum MeshMsgType : uint8_t {
     MSG_TYPE_ELECTION    = 0x01,
-    MSG_TYPE_HEARTBEAT   = 0x10,   // peer → gateway
+    MSG_TYPE_FRAGMENT    = 0x02,   // any → any: piece of a message > MESH_FRAG_MTU
+    MSG_TYPE_RELIABLE    = 0x03,   // any → any: sequenced payload, must be ACKed
+    MSG_TYPE_RELIABLE_ACK = 0x04,  // receiver → sender: cumulative + selective ACK
+    MSG_TYPE_ELECTION_RESULT = 0x05, // root → all: ranked scores + winner
+    MSG_TYPE_LINK_PING   = 0x06,   // any → any: link RTT probe
+    MSG_TYPE_LINK_PONG   = 0x07,   // probe echo
+    MSG_TYPE_HEARTBEAT   = 0x10,   // peer → parent (or gateway)
+    MSG_TYPE_HB_AGG      = 0x11,   // parent → its parent / gateway: subtree heartbeats
+    MSG_TYPE_HB_PARENT   = 0x12,   // parent → new child: send heartbeats to me
     MSG_TYPE_FTM_WAKE    = 0x20,   // gateway → pair
     MSG_TYPE_FTM_READY   = 0x21,   // node → gateway
     MSG_TYPE_FTM_GO      = 0x22,   // gateway → initiator
@@ -17,18 +25,64 @@ enum MeshMsgType : uint8_t {
     MSG_TYPE_FTM_CANCEL  = 0x24,   // gateway → pair (abort)
     MSG_TYPE_POS_UPDATE  = 0x30,   // gateway → all
     MSG_TYPE_PEER_SYNC   = 0x31,   // gateway → all (peer table broadcast)
+    MSG_TYPE_PEER_SYNC_REQ = 0x32, // node → gateway: missed a delta, send FULL
     MSG_TYPE_NOMINATE    = 0x40,   // peer → gateway (request gateway role)
     MSG_TYPE_CONFIG_REQ  = 0x50,   // any node → target node
     MSG_TYPE_CONFIG_RESP = 0x51,   // target node → requester
     MSG_TYPE_ROLE_CHANGE = 0x60,   // gateway → all (new gateway MAC)
+    MSG_TYPE_STANDBY_ASSIGN = 0x61, // gateway → all: hot-standby designation
+    MSG_TYPE_STANDBY_REPL   = 0x62, // gateway → standby: state replication / keepalive
     MSG_TYPE_PLAY_CMD    = 0x70,   // gateway → node: play tone
     MSG_TYPE_ORCH_MODE   = 0x71,   // gateway → all: mode changed
     MSG_TYPE_CLOCK_SYNC  = 0x72,   // gateway → all: time sync
+    MSG_TYPE_ORCH_SCRIPT = 0x73,   // gateway → node: its part of a script
+    MSG_TYPE_ORCH_GO     = 0x74,   // gateway → all: start a script at a mesh time
+    MSG_TYPE_CLOCK_PROBE = 0x75,   // gateway → node: read back its mesh clock
+    MSG_TYPE_CLOCK_PROBE_REPLY = 0x76, // node → gateway: mesh clock and last start error
     // Phase 5: Setup Delegate
     MSG_TYPE_WIFI_CREDS      = 0x80,  // delegate → gateway, gateway → peers
     MSG_TYPE_WIFI_CREDS_ACK  = 0x81,  // receiver → sender
     MSG_TYPE_MERGE_CHECK     = 0x82,  // delegate → broadcast: split-mesh healing
     MSG_TYPE_SETUP_DELEGATE  = 0x83,  // gateway → peer: designate as delegate
+    MSG_TYPE_MERGE_HELLO     = 0x84,  // gateway ↔ gateway: two gateways in one mesh
+    MSG_TYPE_MERGE_STATE     = 0x85,  // merge loser → survivor: PeerTable + edges
+};
+
+// --- Fragment frame (transport-level, handled inside MeshConductor) ---
+
+struct __attribute__((packed)) FragmentHeader {
+    uint8_t  type;           // MSG_TYPE_FRAGMENT
+    uint16_t msg_id;         // per-sender message ID (same for all fragments)
+    uint8_t  frag_idx;       // 0 .. frag_count-1
+    uint8_t  frag_count;     // total fragments in this message
+    uint16_t total_len;      // length of the reassembled message
+    // followed by up to MESH_FRAG_MTU - 7 payload bytes
+};
+
+// --- Reliable channel frames (transport-level, handled inside MeshConductor) ---
+
+struct __attribute__((packed)) ReliableHeader {
+    uint8_t  type;           // MSG_TYPE_RELIABLE
+    uint16_t session;        // sender boot nonce (resets receiver window on reboot)
+    uint16_t seq;            // per-destination sequence number
+    // followed by the wrapped message (up to MESH_REL_MAX_PAYLOAD bytes)
+};
+
+struct __attribute__((packed)) ReliableAckMsg {
+    uint8_t  type;           // MSG_TYPE_RELIABLE_ACK
+    uint16_t session;        // echoed from ReliableHeader
+    uint16_t cum_seq;        // next expected seq (everything below received)
+    uint32_t sack_mask;      // bit i = seq cum_seq+1+i received
+};
+
+#define MESH_REL_MAX_PAYLOAD  (MESH_FRAG_MTU - sizeof(ReliableHeader))
+
+// --- Link probe (transport-level, see LinkStats) ---
+
+struct __attribute__((packed)) LinkPingMsg {
+    uint8_t  type;           // MSG_TYPE_LINK_PING / MSG_TYPE_LINK_PONG
+    uint16_t seq;
+    uint32_t t_us;           // sender's micros() at send, echoed in the PONG
 };
 
 // --- Election score broadcast packet ---
@@ -37,11 +91,28 @@ struct __attribute__((packed)) ElectionScore {
     uint8_t  type;              // MSG_TYPE_ELECTION
     uint8_t  mac[6];
     uint16_t battery_mv;
-    uint8_t  peer_count;        // number of peers this node can see
+    uint8_t  peer_count;        // nodes below this one (routing table = subtree)
     uint16_t gateway_tenure;    // times this node has been gateway (from NVS)
+    uint8_t  layer;             // mesh layer (1 = root)
+    int16_t  extra_hops_x100;   // mean extra hops per command vs a root gateway, x100
     double   score;             // pre-computed score (double for overflow safety)
 };
 
+// --- Election result (root → all, one message per election) ---
+
+struct __attribute__((packed)) ElectionResultEntry {
+    uint8_t  mac[6];
+    float    score;
+};
+
+struct __attribute__((packed)) ElectionResultMsg {
+    uint8_t  type;              // MSG_TYPE_ELECTION_RESULT
+    uint16_t epoch;             // bumped by the deciding root every election
+    uint8_t  winner[6];
+    uint8_t  count;
+    // followed by count × ElectionResultEntry, best score first
+};
+
 // --- Heartbeat message (peer → gateway) ---
 
 struct __attribute__((packed)) HeartbeatMsg {
@@ -50,6 +121,51 @@ struct __attribute__((packed)) HeartbeatMsg {
     uint16_t battery_mv;
     uint8_t  flags;          // awake/sleeping/low-battery
     uint8_t  softap_mac[6];  // SoftAP MAC (for FTM targeting)
+    uint8_t  interval_s;     // sender's current heartbeat period (sets its deadline)
+};
+
+// --- Aggregated heartbeats (one frame per subtree per interval) ---
+//
+// Records are either FULL (first report, or the peer has no short ID yet)
+// or COMPACT: short ID (= gateway PeerTable slot) + a mask of the fields
+// that changed since the aggregator last forwarded them. A compact record
+// with mask 0 just means "alive".
+// Relayed records carry their age (seconds since the peer itself last
+// reported, summed over hops) so the gateway dates the beat from the
+// source rather than from the last relay.
+// Short IDs are only meaningful under the numbering the sender's PEER_SYNC
+// shadow was bound by: the header carries that shadow's epoch, and a
+// receiver drops compact records whose epoch predates its own last FULL
+// (FULL records name the MAC and always apply).
+
+struct __attribute__((packed)) HeartbeatAggMsg {
+    uint8_t  type;           // MSG_TYPE_HB_AGG
+    uint8_t  count;          // records that follow
+    uint16_t epoch;          // sender's PEER_SYNC shadow epoch
+};
+
+#define HB_AGG_FULL         0xFF   // first byte of a full record (never a short ID)
+#define HB_AGG_F_BATTERY    0x01   // compact: battery_mv (2 B) follows
+#define HB_AGG_F_FLAGS      0x02   // compact: flags (1 B) follows
+#define HB_AGG_F_INTERVAL   0x04   // compact: interval_s (1 B) follows
+#define HB_AGG_F_LINK       0x08   // compact: layer (1 B) + parent RSSI (1 B) follow
+#define HB_AGG_F_AGE        0x10   // compact: age_s (1 B) follows (absent = fresh)
+
+struct __attribute__((packed)) HbAggFull {
+    uint8_t  marker;         // HB_AGG_FULL
+    uint8_t  mac[6];
+    uint8_t  softap_mac[6];
+    uint16_t battery_mv;
+    uint8_t  flags;
+    uint8_t  interval_s;
+    uint8_t  layer;          // mesh layer (0 = unknown)
+    int8_t   rssi;           // parent RSSI, dBm (0 = unknown / root)
+    uint8_t  age_s;          // seconds since the peer's own report (0 = fresh)
+};
+
+struct __attribute__((packed)) HbParentMsg {
+    uint8_t type;            // MSG_TYPE_HB_PARENT
+    uint8_t parent[6];       // parent's STA MAC
 };
 
 // --- FTM protocol messages ---
@@ -84,17 +200,31 @@ struct __attribute__((packed)) FtmCancelMsg {
     uint8_t  type;           // MSG_TYPE_FTM_CANCEL
 };
 
+// --- Wire format v2: compact position / peer sync ---
+//
+// Peers are addressed by 1-byte short IDs (the gateway's PeerTable slot).
+// A FULL sync carries the MAC for every slot and so binds short IDs on the
+// receiver; later deltas only name the slots that changed.
+// PEER_SYNC also carries the gateway's table epoch, bumped by every
+// broadcast: a delta applies only on top of the epoch just before it.
+
+#define MESH_WIRE_VERSION   4
+#define SYNC_FLAG_FULL      0x01    // snapshot: replace receiver state (binds short IDs)
+
 struct __attribute__((packed)) PosUpdateEntry {
-    uint8_t  mac[6];
-    float    x, y, z;        // position in cm
-    float    confidence;
+    uint8_t  short_id;       // PeerTable slot on the gateway
+    int16_t  x, y, z;        // position in cm (clamped to ±327 m)
+    uint8_t  confidence;     // 0..255 = 0.0..1.0
 };
+// 8 bytes per entry
 
 struct __attribute__((packed)) PosUpdateMsg {
     uint8_t  type;           // MSG_TYPE_POS_UPDATE
+    uint8_t  version;        // MESH_WIRE_VERSION
     uint8_t  dimension;      // 1=distance, 2=2D, 3=3D
+    uint8_t  sync_flags;     // SYNC_FLAG_*
     uint8_t  count;          // number of entries following
-    // followed by count × PosUpdateEntry
+    // followed by count × PosUpdateEntry (fragmented above MESH_FRAG_MTU)
 };
 
 // --- Peer sync message (gateway → all) ---
@@ -105,14 +235,30 @@ struct __attribute__((packed)) PeerSyncEntry {
     uint16_t battery_mv;
     uint8_t  flags;
 };
-// 15 bytes per entry
+// 15 bytes per entry (FULL sync; entry i = short ID i)
+
+struct __attribute__((packed)) PeerSyncDelta {
+    uint8_t  short_id;
+    uint16_t battery_mv;
+    uint8_t  flags;
+};
+// 4 bytes per entry (delta sync)
 
 struct __attribute__((packed)) PeerSyncMsg {
-    uint8_t type;    // MSG_TYPE_PEER_SYNC
-    uint8_t count;
-    // followed by count × PeerSyncEntry
+    uint8_t  type;       // MSG_TYPE_PEER_SYNC
+    uint8_t  version;    // MESH_WIRE_VERSION
+    uint8_t  sync_flags; // SYNC_FLAG_*
+    uint16_t epoch;      // table epoch after this sync
+    uint8_t  count;
+    // FULL: followed by count × PeerSyncEntry
+    // else: followed by count × PeerSyncDelta (valid on top of epoch - 1)
+};
+// MeshConductor fragments it when it exceeds one frame
+
+struct __attribute__((packed)) PeerSyncReqMsg {
+    uint8_t  type;       // MSG_TYPE_PEER_SYNC_REQ
+    uint16_t have_epoch; // receiver's epoch (diagnostic)
 };
-// 2 + 16×15 = 242 bytes max (fits 256-byte rx_buf)
 
 // --- Nominate message (peer → gateway) ---
 
@@ -128,11 +274,43 @@ struct __attribute__((packed)) RoleChangeMsg {
     uint8_t new_gw[6];   // STA MAC of new gateway
 };
 
+// --- Hot-standby replication (gateway → standby) ---
+
+struct __attribute__((packed)) StandbyAssignMsg {
+    uint8_t type;        // MSG_TYPE_STANDBY_ASSIGN
+    uint8_t standby[6];  // STA MAC of the designated standby
+};
+
+#define REPL_FLAG_ORCH   0x01   // StandbyOrchState (+ steps) follows the header
+
+struct __attribute__((packed)) StandbyReplMsg {
+    uint8_t type;        // MSG_TYPE_STANDBY_REPL
+    uint8_t flags;       // REPL_FLAG_*
+    uint8_t edge_count;  // StandbyEdge records after the optional orch block
+    // [StandbyOrchState + seq_count × SeqStep] if REPL_FLAG_ORCH
+    // edge_count × StandbyEdge
+};
+
+struct __attribute__((packed)) StandbyOrchState {
+    uint8_t mode;          // OrchMode
+    uint8_t travel_order;  // TravelOrder
+    uint8_t seq_idx;       // next sequence step
+    uint8_t seq_count;
+};
+
+struct __attribute__((packed)) StandbyEdge {
+    uint16_t edge;         // PeerTable::edgeIndex in the gateway's slot numbering
+    uint16_t distance_cm;  // PEER_DIST_UNKNOWN = cleared
+    uint8_t  quality;
+};
+
 // --- Phase 4: Orchestrator messages ---
 
 struct __attribute__((packed)) PlayCmdMsg {
     uint8_t  type;           // MSG_TYPE_PLAY_CMD
     uint8_t  tone_index;     // ToneLibrary index
+    uint32_t start_ms;       // ClockSync::meshTime() to start at, 0 = on receipt
+    uint8_t  gain;           // 0-255 amplitude, 255 = full
 };
 
 struct __attribute__((packed)) OrchModeMsg {
@@ -145,6 +323,43 @@ struct __attribute__((packed)) ClockSyncMsg {
     uint32_t gateway_ms;     // gateway's millis()
 };
 
+// Start-skew probe: the gateway compares a node's mesh clock against the
+// midpoint of the round trip (see ClockSync::printStatus)
+struct __attribute__((packed)) ClockProbeMsg {
+    uint8_t  type;           // MSG_TYPE_CLOCK_PROBE / MSG_TYPE_CLOCK_PROBE_REPLY
+    uint8_t  sweep;          // gateway's probe sweep, echoed
+    uint32_t gateway_us;     // gateway esp_timer_get_time() at send (low 32 bits), echoed
+    uint32_t node_us;        // reply: node's mesh µs at receipt (low 32 bits)
+    int32_t  start_err_us;   // reply: node's AudioEngine::lastStartErrorUs()
+};
+
+// Pre-distributed scripts (see OrchScript): each node gets only its own
+// events, then one GO starts every part on the mesh clock.
+
+#define ORCH_TONE_HOLD   0xFF      // tone_index: only re-level the sounding tone
+
+struct __attribute__((packed)) OrchScriptEvent {
+    uint32_t at_ms;          // offset from the script start
+    uint8_t  tone_index;     // ToneLibrary index, or ORCH_TONE_HOLD
+    uint8_t  gain;           // 0-255 amplitude, 255 = full
+};
+// 6 bytes per event
+
+struct __attribute__((packed)) OrchScriptMsg {
+    uint8_t  type;           // MSG_TYPE_ORCH_SCRIPT
+    uint8_t  script_id;
+    uint8_t  count;          // events for this node, ≤ ORCH_SCRIPT_NODE_EVENTS
+    uint32_t period_ms;      // loop length, 0 = play once
+    uint32_t delay_us;       // every event this much later (acoustic alignment)
+    // followed by count × OrchScriptEvent (receiver sorts by at_ms)
+};
+
+struct __attribute__((packed)) OrchGoMsg {
+    uint8_t  type;           // MSG_TYPE_ORCH_GO
+    uint8_t  script_id;      // a node without this script stops its part
+    uint32_t start_ms;       // ClockSync::meshTime() of offset 0
+};
+
 // --- Phase 5: Setup Delegate messages ---
 
 struct __attribute__((packed)) WifiCredsMsg {
@@ -162,6 +377,37 @@ struct __attribute__((packed)) MergeCheckMsg {
     uint8_t root_table_size; // routing table size of the sender
 };
 
+// --- Split-mesh merge (see MeshMerge) ---
+
+#define MERGE_HELLO_REPLY   0x01   // answer to a HELLO (don't answer it back)
+
+struct __attribute__((packed)) MergeHelloMsg {
+    uint8_t  type;           // MSG_TYPE_MERGE_HELLO
+    uint8_t  flags;          // MERGE_HELLO_*
+    uint8_t  mac[6];         // sending gateway (the root may forward the HELLO)
+    float    score;          // MeshConductor::computeScore() of the sender
+    uint8_t  peer_count;     // sender's PeerTable size
+};
+
+#define MERGE_STATE_DONE    0x01   // last frame of the transfer
+
+struct __attribute__((packed)) MergeStateMsg {
+    uint8_t type;            // MSG_TYPE_MERGE_STATE
+    uint8_t flags;           // MERGE_STATE_*
+    uint8_t peer_total;      // loser's PeerTable size
+    uint8_t peer_base;       // loser slot of the first PeerSyncEntry
+    uint8_t peer_count;
+    uint8_t edge_count;
+    // followed by peer_count × PeerSyncEntry, then edge_count × MergeEdge
+};
+
+struct __attribute__((packed)) MergeEdge {
+    uint16_t edge;           // PeerTable::edgeIndex in the loser's slot numbering
+    uint16_t distance_cm;
+    uint8_t  quality;
+    uint16_t age_s;          // since measured, FTM_EDGE_AGE_UNKNOWN = no timestamp
+};
+
 struct __attribute__((packed)) SetupDelegateMsg {
     uint8_t type;            // MSG_TYPE_SETUP_DELEGATE
     uint8_t gateway_mac[6];  // gateway MAC — last 2 bytes used for SSID discriminator
@@ -205,6 +451,15 @@ public:
     bool isGateway() const override { return false; }
     void printStatus() override;
     void onGatewayLost();
+    static void updateCadence();   // re-pick heartbeat period from orchestrator mode
+
+    // Heartbeat aggregation (called from mesh dispatch)
+    static void onChildHeartbeat(const HeartbeatMsg* hb);
+    static void onChildAggregate(const uint8_t* buf, uint16_t len);
+    static void setHeartbeatParent(const uint8_t* sta_mac);   // nullptr = gateway
+    /// Short IDs were renumbered (ROLE_CHANGE, FULL or out-of-sequence
+    /// PEER_SYNC): send every subtree peer as a FULL record next beat
+    static void resetAggregation();
 private:
     bool m_gatewayAlive = true;
 };
@@ -225,27 +480,69 @@ public:
     static double computeScore();
     static void runElection();
 
-    // Messaging
+    // Messaging — payloads up to MESH_FRAG_MAX_PAYLOAD; anything larger than
+    // MESH_FRAG_MTU is fragmented and reassembled transparently
     static esp_err_t sendToRoot(const void* data, uint16_t len);
     static esp_err_t sendToNode(const uint8_t* sta_mac, const void* data, uint16_t len);
     static esp_err_t broadcastToAll(const void* data, uint16_t len);
 
+    // Reliable delivery — ACKed and retransmitted until MESH_REL_MAX_RETRIES,
+    // duplicates suppressed at the receiver. Payload ≤ MESH_REL_MAX_PAYLOAD.
+    // For control messages that must not be lost (PLAY_CMD, ORCH_MODE, ...).
+    // With all MESH_REL_SLOTS in flight, sendReliable() sends nothing and
+    // returns ESP_ERR_NO_MEM: retry once reliableFreeSlots() > 0, or fall
+    // back to sendToNode(). done (optional) is called once, from the RX or
+    // timer task, when the message is ACKed or given up on.
+    // broadcastReliable() sends copies that found no slot best-effort and
+    // then returns ESP_ERR_NO_MEM.
+    typedef void (*ReliableDoneCb)(const uint8_t* mac, bool acked, void* ctx);
+    static esp_err_t sendReliable(const uint8_t* sta_mac, const void* data, uint16_t len,
+                                  ReliableDoneCb done = nullptr, void* ctx = nullptr);
+    static esp_err_t broadcastReliable(const void* data, uint16_t len);
+    static uint8_t reliableFreeSlots();
+
     // Peer shadow (non-gateway nodes)
     static void printPeerShadow();
     static uint8_t peerShadowCount();
     static const PeerSyncEntry* peerShadowEntries();
+    static uint16_t peerShadowEpoch();
+    /// Short IDs stamped with epoch (HB_AGG header) use our shadow's
+    /// numbering: at or after the FULL that bound it, not past our epoch
+    static bool shadowNumberingMatches(uint16_t epoch);
 
     // Gateway MAC tracking (for heartbeat routing)
     static const uint8_t* gatewayMac();
+
+    // Own identity (cached at init). Sends addressed to ourselves — and
+    // sendToRoot() on the root — are looped back through the dispatcher.
+    static const uint8_t* staMac();
+    static const uint8_t* softapMac();
+    static bool isSelf(const uint8_t* sta_mac);
     static void setGatewayMac(const uint8_t* mac);
 
     // Role nomination
     static void nominateNode(const uint8_t* sta_mac);  // gateway only
     static void stepDown();                              // gateway only
 
-    // Remote config
-    static bool sendConfigReq(const uint8_t* sta_mac, const char* json, uint8_t reqId);
-    static bool waitConfigResp(char* outBuf, size_t bufSize, uint32_t timeout_ms);
+    // Hot standby
+    static const uint8_t* electionRanked(uint8_t rank);  // nullptr past the end
+    static void requestTakeover();                       // standby → gateway in place
+
+    // Split-mesh merge (MeshMerge)
+    static void holdElection();                          // merge replaces the re-election
+    static void requestMergeStep();                      // MeshMerge::runPending() on the election task
+    static void handOver(const uint8_t* new_gw);         // gateway → node, root waived to new_gw
+
+    // Remote config: send one CONFIG_REQ body (ConfigBinHeader + records,
+    // see nvs_config_registry.h) to every target at once and block until
+    // each has answered or the fanout's timeout_ms is up (one deadline for
+    // the whole call, however many targets). `cb` runs on the caller's
+    // task, once per target, in arrival order (body = nullptr on timeout or
+    // send failure). Returns the number of replies.
+    typedef void (*ConfigRespCb)(const uint8_t* mac, const uint8_t* body, uint16_t len, void* ctx);
+    static uint8_t configFanout(const uint8_t (*macs)[6], uint8_t count,
+                                const uint8_t* body, uint16_t len,
+                                uint32_t timeout_ms, ConfigRespCb cb, void* ctx);
 
     // Debug
     static void forceReelection();
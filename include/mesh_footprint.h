@@ -0,0 +1,42 @@
+#ifndef MESH_FOOTPRINT_H
+#define MESH_FOOTPRINT_H
+
+#include <stddef.h>
+#ifndef MESH_MAX_NODES
+#include "bsp.hpp"
+#endif
+
+// RAM taken by the statics that grow with MESH_MAX_NODES, in bytes.
+//
+// Each owning module static_asserts its arrays against these, so the
+// figures cannot drift from the code. test/test_native_ftm_queue reports
+// and bounds them at full flotilla size without building the
+// Arduino-side modules. N = nodes, E = edges (N(N-1)/2).
+#define FOOTPRINT_EDGES  ((size_t)MESH_MAX_NODES * (MESH_MAX_NODES - 1) / 2)
+
+// PeerTable s_edges: packed PeerEdge (3 B) per edge
+static constexpr size_t FOOTPRINT_EDGE_STORE = FOOTPRINT_EDGES * 3;
+
+// PeerSnapshot (one each in Orchestrator and GeoCache): header, then
+// PeerEntry (24 B) + pos (12 B) + confidence (4 B) per node
+static constexpr size_t FOOTPRINT_PEER_SNAPSHOT = 8 + (size_t)MESH_MAX_NODES * 40;
+
+// PositionSolver: Kalman state (28 B) and MDS scratch (8 floats) per node,
+// plus the packed symmetric B matrix
+static constexpr size_t FOOTPRINT_SOLVER = (size_t)MESH_MAX_NODES * (28 + 32)
+    + (size_t)MESH_MAX_NODES * (MESH_MAX_NODES + 1) / 2 * 4;
+
+// FtmScheduler s_lastMeasured: millis() per edge
+static constexpr size_t FOOTPRINT_EDGE_AGES = FOOTPRINT_EDGES * 4;
+
+// HotStandby s_replica: the primary's edge store
+static constexpr size_t FOOTPRINT_STANDBY_REPLICA = FOOTPRINT_EDGES * 3;
+
+// MeshMerge survivor buffers: PeerSyncEntry (15 B) + have flag per node,
+// PeerEdge + age (5 B) per edge
+static constexpr size_t FOOTPRINT_MERGE_BUFFERS = (size_t)MESH_MAX_NODES * 16 + FOOTPRINT_EDGES * 5;
+
+// TravelPath s_cost: N×N hop costs, uint16_t
+static constexpr size_t FOOTPRINT_TRAVEL_COST = (size_t)MESH_MAX_NODES * MESH_MAX_NODES * 2;
+
+#endif // MESH_FOOTPRINT_H
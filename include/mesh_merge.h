@@ -0,0 +1,43 @@
+#ifndef MESH_MERGE_H
+#define MESH_MERGE_H
+
+#include <stdint.h>
+
+class Print;
+struct MergeHelloMsg;
+
+// Split-mesh merge.
+//
+// After an RF partition heals, one root yields (ROOT_ASKED_YIELD or the
+// Setup Delegate's MERGE_CHECK) and joins the other mesh with its subtree,
+// so the mesh briefly holds two gateways with divergent PeerTables and
+// distance matrices. The gateway that finds itself under a foreign root
+// sends MERGE_HELLO; the two exchange election scores and the lower one
+// (ties: lower MAC) streams its PeerTable and known edges to the survivor,
+// then steps down. The survivor unions the peers, keeps whichever copy of
+// each edge was measured more recently, and announces itself with
+// ROLE_CHANGE — no reboot, no re-election, no FTM re-sweep.
+class MeshMerge {
+public:
+    MeshMerge() = delete;
+
+    /// Gateway connected to a parent, i.e. it now lives under another root:
+    /// look for a second gateway (HELLO to the root, retried).
+    static void announce();
+
+    // Mesh dispatch hooks
+    static void onHello(const uint8_t* from, const MergeHelloMsg* msg);
+    static void onState(const uint8_t* from, const uint8_t* buf, uint16_t len);
+
+    /// Election task context (MeshConductor::requestMergeStep): the loser
+    /// hands over, or the survivor folds the received state into PeerTable.
+    static void runPending();
+
+    /// Abort any merge in progress (gateway role ending).
+    static void cancel();
+
+    static bool active();
+    static void printStatus(Print& out);
+};
+
+#endif // MESH_MERGE_H
@@ -11,6 +11,7 @@ inline constexpr char NVS_KEY_EW_BAT[] = "ewBat";
 inline constexpr char NVS_KEY_EW_ADJ[] = "ewAdj";
 inline constexpr char NVS_KEY_EW_TEN[] = "ewTen";
 inline constexpr char NVS_KEY_EW_LBP[] = "ewLbp";
+inline constexpr char NVS_KEY_EW_HOP[] = "ewHop";
 inline constexpr char NVS_KEY_CLR_INIT[] = "clrInit";
 inline constexpr char NVS_KEY_CLR_RDY[]  = "clrRdy";
 inline constexpr char NVS_KEY_CLR_GW[]   = "clrGw";
@@ -20,6 +21,7 @@ inline constexpr char NVS_KEY_CLR_DISC[] = "clrDisc";
 // Phase 2: Heartbeat & re-election
 inline constexpr char NVS_KEY_HB_INT[]    = "hbInt";
 inline constexpr char NVS_KEY_HB_STALE[]  = "hbStale";
+inline constexpr char NVS_KEY_HB_ACT[]    = "hbAct";
 inline constexpr char NVS_KEY_REEL_DMV[]  = "reelDmv";
 inline constexpr char NVS_KEY_REEL_CD[]   = "reelCd";
 inline constexpr char NVS_KEY_REEL_DTH[]  = "reelDth";
@@ -51,6 +53,7 @@ inline constexpr float    DEFAULT_ELECT_W_BATTERY    = NVS_DEFAULT_ELECT_W_BATTE
 inline constexpr float    DEFAULT_ELECT_W_ADJACENCY  = NVS_DEFAULT_ELECT_W_ADJACENCY;
 inline constexpr float    DEFAULT_ELECT_W_TENURE     = NVS_DEFAULT_ELECT_W_TENURE;
 inline constexpr float    DEFAULT_ELECT_W_LOWBAT_PEN = NVS_DEFAULT_ELECT_W_LOWBAT_PEN;
+inline constexpr float    DEFAULT_ELECT_W_HOPS       = NVS_DEFAULT_ELECT_W_HOPS;
 inline constexpr uint32_t DEFAULT_CLR_INIT           = NVS_DEFAULT_CLR_INIT;
 inline constexpr uint32_t DEFAULT_CLR_READY          = NVS_DEFAULT_CLR_READY;
 inline constexpr uint32_t DEFAULT_CLR_GATEWAY        = NVS_DEFAULT_CLR_GATEWAY;
@@ -60,6 +63,7 @@ inline constexpr uint32_t DEFAULT_CLR_DISCONNECTED   = NVS_DEFAULT_CLR_DISCONNEC
 // Phase 2: Heartbeat & re-election defaults
 inline constexpr uint32_t DEFAULT_HB_INTERVAL_S      = NVS_DEFAULT_HB_INTERVAL_S;
 inline constexpr uint8_t  DEFAULT_HB_STALE_MULT      = NVS_DEFAULT_HB_STALE_MULT;
+inline constexpr uint32_t DEFAULT_HB_ACTIVE_S        = NVS_DEFAULT_HB_ACTIVE_S;
 inline constexpr uint16_t DEFAULT_REELECT_DELTA_MV   = NVS_DEFAULT_REELECT_DELTA_MV;
 inline constexpr uint16_t DEFAULT_REELECT_COOLDOWN_S = NVS_DEFAULT_REELECT_COOLDOWN_S;
 inline constexpr uint16_t DEFAULT_REELECT_DETHRONE_MV = NVS_DEFAULT_REELECT_DETHRONE_MV;
@@ -125,6 +129,7 @@ namespace nvs_detail {
         h = fnvFloat(h, DEFAULT_ELECT_W_ADJACENCY);
         h = fnvFloat(h, DEFAULT_ELECT_W_TENURE);
         h = fnvFloat(h, DEFAULT_ELECT_W_LOWBAT_PEN);
+        h = fnvFloat(h, DEFAULT_ELECT_W_HOPS);
         h = fnvU32(h, DEFAULT_CLR_INIT);
         h = fnvU32(h, DEFAULT_CLR_READY);
         h = fnvU32(h, DEFAULT_CLR_GATEWAY);
@@ -133,6 +138,7 @@ namespace nvs_detail {
         // Phase 2
         h = fnvU32(h, DEFAULT_HB_INTERVAL_S);
         h = fnvByte(h, DEFAULT_HB_STALE_MULT);
+        h = fnvU32(h, DEFAULT_HB_ACTIVE_S);
         h = fnvU32(h, (uint32_t)DEFAULT_REELECT_DELTA_MV);
         h = fnvU32(h, (uint32_t)DEFAULT_REELECT_COOLDOWN_S);
         h = fnvU32(h, (uint32_t)DEFAULT_REELECT_DETHRONE_MV);
@@ -184,6 +190,7 @@ public:
     static PropertyValue<NVS_KEY_EW_ADJ, float, NvsConfigManager>   electWAdjacency;
     static PropertyValue<NVS_KEY_EW_TEN, float, NvsConfigManager>   electWTenure;
     static PropertyValue<NVS_KEY_EW_LBP, float, NvsConfigManager>   electWLowbatPenalty;
+    static PropertyValue<NVS_KEY_EW_HOP, float, NvsConfigManager>   electWHops;
 
     // Mesh status LED colors (packed as 0x00RRGGBB)
     static PropertyValue<NVS_KEY_CLR_INIT, uint32_t, NvsConfigManager> colorInit;
@@ -195,6 +202,7 @@ public:
     // Phase 2: Heartbeat & re-election
     static PropertyValue<NVS_KEY_HB_INT,   uint32_t, NvsConfigManager> heartbeatInterval_s;
     static PropertyValue<NVS_KEY_HB_STALE, uint32_t, NvsConfigManager> heartbeatStaleMultiplier;
+    static PropertyValue<NVS_KEY_HB_ACT,   uint32_t, NvsConfigManager> heartbeatActive_s;
     static PropertyValue<NVS_KEY_REEL_DMV, uint32_t, NvsConfigManager> reelectionBatteryDelta_mv;
     static PropertyValue<NVS_KEY_REEL_CD,  uint16_t, NvsConfigManager> reelectionCooldown_s;
     static PropertyValue<NVS_KEY_REEL_DTH, uint16_t, NvsConfigManager> reelectionDethrone_mv;
@@ -12,6 +12,38 @@ struct ConfigField {
     const char* key;         // NVS key (e.g. "hbInt")
     const char* description; // human-readable (e.g. "Heartbeat interval (s)")
     ConfigType  type;
+    uint32_t  (*get)();         // current value, raw (bool 0/1, u32, float bits)
+    void      (*set)(uint32_t); // apply raw value (clamps, writes NVS)
+};
+
+#define CFG_FIELD_NONE  0xFF   // configFieldIndex(): unknown key
+
+// --- Binary config body (CONFIG_REQ / CONFIG_RESP after type + reqId) ---
+//
+// Fields are addressed by registry index; every value is 4 bytes raw, so
+// the type (and length) of each record is implied by the index. `schema`
+// hashes the registry keys/types: a node running a different registry
+// answers CFG_ST_SCHEMA instead of misapplying indices.
+//
+//   GET  request:  header{op=GET, count}  + count x u8 index (0 = all)
+//   SET  request:  header{op=SET, count}  + count x ConfigBinValue
+//   response:      header{status, count}  + count x ConfigBinValue
+
+#define CFG_OP_GET      0
+#define CFG_OP_SET      1
+#define CFG_ST_OK       0
+#define CFG_ST_SCHEMA   1   // registry differs (firmware mismatch)
+#define CFG_ST_BAD      2   // malformed request
+
+struct __attribute__((packed)) ConfigBinHeader {
+    uint16_t schema;         // configSchemaId() of the sender
+    uint8_t  code;           // request: CFG_OP_*, response: CFG_ST_*
+    uint8_t  count;          // records that follow
+};
+
+struct __attribute__((packed)) ConfigBinValue {
+    uint8_t  idx;            // registry index
+    uint32_t raw;
 };
 
 // Build JSON with requested fields (all if count==0)
@@ -32,4 +64,17 @@ uint8_t configFieldCount();
 // Get field by index
 const ConfigField* configFieldByIndex(uint8_t idx);
 
+// Registry index of a key, CFG_FIELD_NONE if unknown
+uint8_t configFieldIndex(const char* key);
+
+// Raw value conversions (JSON / CLI text at the edge)
+void     configRawToJson(JsonDocument& doc, uint8_t idx, uint32_t raw);
+uint32_t configJsonToRaw(uint8_t idx, JsonVariantConst val);
+bool     configParseRaw(uint8_t idx, const char* text, uint32_t* raw);
+
+// Binary body: schema id, and request → response (no heap). Returns the
+// response length written to `resp`.
+uint16_t configSchemaId();
+uint16_t configHandleBinary(const uint8_t* req, uint16_t len, uint8_t* resp, uint16_t respMax);
+
 #endif // NVS_CONFIG_REGISTRY_H
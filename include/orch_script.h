@@ -0,0 +1,60 @@
+#ifndef ORCH_SCRIPT_H
+#define ORCH_SCRIPT_H
+
+#include <stdint.h>
+
+class Print;
+
+// One event of a compiled script (gateway side)
+struct ScriptEvent {
+    uint8_t  node;         // PeerTable slot
+    uint8_t  tone_index;   // ToneLibrary index, or ORCH_TONE_HOLD
+    uint8_t  gain;         // 0-255, 255 = full
+    uint32_t at_ms;        // offset from the script start
+};
+
+// Pre-distributed orchestration scripts.
+//
+// The gateway compiles a mode into a list of (node, tone, offset) events
+// over one period and sends each node only its own events. A single GO
+// then names the script and the mesh time of offset 0. From there on,
+// every node plays its part from its own synced clock and loops it each
+// period until the next GO replaces it. Playback no longer needs the
+// gateway's task or a radio frame for every note.
+//
+// A node keeps one part staged and one playing, so the next script can
+// arrive while the current one is still looping. A GO that arrives before
+// its part is held until the part lands; a GO for a script the node has
+// no part in silences the node.
+class OrchScript {
+public:
+    OrchScript() = delete;
+
+    static void init();
+
+    /// Gateway: send every node its part of events[] (any order: a part
+    /// is sorted on arrival), then a GO for mesh time start_ms to every
+    /// live peer. delay_us (by PeerTable slot, optional) shifts a node's
+    /// whole part, finer than the millisecond event times.
+    ///
+    /// Sends are paced by free reliable slots and a part or GO the channel
+    /// gives up on is sent again, so this blocks the calling task until
+    /// every node ACKed or ORCH_SCRIPT_SEND_MS passed. Returns the script
+    /// ID; lastUndelivered() counts the nodes left without it.
+    static uint8_t distribute(const ScriptEvent* events, uint8_t count,
+                              uint32_t period_ms, uint32_t start_ms,
+                              const uint32_t* delay_us = nullptr);
+    static uint8_t lastUndelivered();
+
+    // Node side (called from mesh dispatch)
+    static void onScript(const uint8_t* buf, uint16_t len);
+    static void onGo(uint8_t script_id, uint32_t start_ms);
+
+    /// Silence this node's part and drop any staged one.
+    static void stop();
+    static bool isPlaying();
+
+    static void printStatus(Print& out);
+};
+
+#endif // ORCH_SCRIPT_H
@@ -2,6 +2,8 @@
 #define ORCHESTRATOR_H
 
 #include <stdint.h>
+#include <esp_err.h>
+#include "travel_path.h"
 
 enum OrchMode : uint8_t {
     ORCH_OFF       = 0,
@@ -9,12 +11,22 @@ enum OrchMode : uint8_t {
     ORCH_RANDOM    = 2,
     ORCH_SEQUENCE  = 3,
     ORCH_SCHEDULED = 4,
+    ORCH_PAN       = 5,    // phantom source moving through the node positions
 };
 
 enum TravelOrder : uint8_t {
     TRAVEL_NEAREST = 0,
     TRAVEL_AXIS    = 1,
     TRAVEL_RANDOM  = 2,
+    TRAVEL_SHORTEST = 3,   // optimised open path (TravelPath)
+    TRAVEL_LOOP    = 4,    // optimised closed tour: no jump back to the start
+};
+
+// Where acoustic alignment aims the wavefronts
+enum ListenerMode : uint8_t {
+    LISTENER_OFF      = 0,   // no compensation: nodes start on the script time
+    LISTENER_CENTROID = 1,   // centre of the positioned nodes
+    LISTENER_POINT    = 2,   // a fixed map point
 };
 
 struct SeqStep {
@@ -37,9 +49,21 @@ public:
     static OrchMode getMode();
     static void setTravelOrder(TravelOrder order);
     static TravelOrder getTravelOrder();
+    static void setTravelMetric(PathMetric metric);   // shortest/loop hop costs
+
+    // Acoustic alignment: start each node early by its sound travel time
+    // to the listener. percent 100 = wavefronts arrive together, 0 = none,
+    // other values stagger by distance (> 100 far nodes first, < 0 near).
+    static void setListener(ListenerMode mode, float x_cm = 0, float y_cm = 0, float z_cm = 0);
+    static void setAlignment(int16_t percent);
+
+    // One tone on one node (PLAY_CMD), ORCH_PLAY_LEAD_MS ahead on the mesh
+    // clock — test tones and one-off cues outside the script modes
+    static esp_err_t playOnNode(uint8_t peer_idx, uint8_t tone_index, uint8_t gain = 255);
 
     // Peer-side handlers (called from mesh dispatch)
-    static void onPlayCmd(uint8_t tone_index);
+    static void onPlayCmd(uint8_t tone_index, uint32_t start_ms,   // start_ms: mesh time, 0 = now
+                          uint8_t gain);
     static void onModeChange(uint8_t mode);
 
     // Sequence editing
@@ -49,6 +73,8 @@ public:
     static void saveSequence();
     static uint8_t sequenceCount();
     static const SeqStep* sequenceSteps();
+    static uint8_t sequenceIndex();            // next step to play
+    static void setSequenceIndex(uint8_t idx); // standby takeover resumes here
 
     // Scheduled triggers
     static void scheduleRelative(uint32_t delay_ms, OrchMode mode);
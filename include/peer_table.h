@@ -13,16 +13,40 @@ struct PeerSyncEntry;
 #define PEER_STATUS_DEAD      0x04
 #define PEER_STATUS_FTM_READY 0x08
 
+// Per-node identity/liveness record. Geometry (distances, positions) lives
+// in separate arrays inside PeerTable so it scales with the flotilla size
+// without bloating every entry.
 struct PeerEntry {
     uint8_t  mac[6];
     uint8_t  softap_mac[6];            // SoftAP MAC for FTM targeting
     uint16_t battery_mv;
     uint32_t last_seen_ms;              // millis() of last heartbeat
     uint8_t  flags;                     // PEER_STATUS_*
-    float    distances[MESH_MAX_NODES]; // distance to each peer by index (-1 = unknown)
-    float    position[3];               // x, y, z in cm
-    float    confidence;                // from Kalman covariance
-    uint8_t  ftm_epoch;                 // which sweep this data is from
+};
+
+// Pairwise distance, stored once per unordered pair in a packed
+// upper-triangular array (see PeerTable::edgeIndex).
+#define PEER_EDGE_COUNT      ((MESH_MAX_NODES * (MESH_MAX_NODES - 1)) / 2)
+#define PEER_DIST_UNKNOWN    0xFFFF     // distance_cm sentinel: never measured
+#define PEER_DIST_MAX_CM     0xFFFE     // longest storable distance (~655 m)
+#define PEER_QUALITY_FTM     255        // quality of a fresh FTM measurement
+
+struct __attribute__((packed)) PeerEdge {
+    uint16_t distance_cm;   // PEER_DIST_UNKNOWN = not measured
+    uint8_t  quality;       // 0 = none .. 255 = fresh measurement
+};
+
+static_assert(MESH_MAX_NODES <= 127, "PeerTable indices are int8_t");
+
+// Consistent copy of the identity/liveness slots and positions, taken
+// without blocking writers (see PeerTable::snapshot). ~2.6 KB at 64 nodes:
+// keep it static or on the heap, not on a task stack.
+struct PeerSnapshot {
+    uint32_t  version;                     // PeerTable::version() the copy matches
+    uint8_t   count;
+    PeerEntry entries[MESH_MAX_NODES];
+    float     pos[MESH_MAX_NODES][3];
+    float     confidence[MESH_MAX_NODES];
 };
 
 class PeerTable {
@@ -32,26 +56,73 @@ public:
 
     // Heartbeat handling
     static void updateFromHeartbeat(const uint8_t* mac, uint16_t battery_mv,
-                                    uint8_t flags, const uint8_t* softap_mac);
+                                    uint8_t flags, const uint8_t* softap_mac,
+                                    uint8_t interval_s = 0);   // 0 = configured idle period
+    /// Apply the records of one HB_AGG frame (mesh_conductor.h); one sync
+    /// and one timer re-arm per batch. Compact (short-ID) records are
+    /// skipped unless epoch (the sender's PEER_SYNC shadow) is at or after
+    /// our last FULL broadcast. Returns the number of peers updated.
+    static uint8_t applyHeartbeatBatch(const uint8_t* recs, uint16_t len, uint8_t count,
+                                       uint16_t epoch);
     static void updateSelf(uint16_t battery_mv);
 
-    // Staleness & re-election
-    static void scanStaleness();
+    // Liveness (deadline-driven) & re-election
+    static void scanStaleness();     // expire overdue peers and re-arm
     static void checkReelection();
 
-    // Lookup
-    static PeerEntry* getEntry(const uint8_t* mac);
-    static PeerEntry* getEntryByIndex(uint8_t idx);
+    // Lookup. Entries are read as copies (readEntry()/snapshot() below),
+    // never through pointers into the live table.
     static int8_t     getIndex(const uint8_t* mac);
     static uint8_t    peerCount();
     static uint8_t    alivePeerCount();
-
-    // FTM distance update
-    static void setDistance(uint8_t idxA, uint8_t idxB, float distance_cm);
+    static void       markDead(const uint8_t* mac);   // mesh event: peer left
+
+    // Slot generations. A slot dead for PEER_RECLAIM_GRACE_MS may be handed
+    // to a new MAC when the table is full; its generation then advances, so
+    // anything holding (index, generation) can tell it no longer names the
+    // same node. Slots never move.
+    static uint8_t generation(uint8_t idx);
+    static bool    isCurrent(uint8_t idx, uint8_t gen);
+
+    // Seqlock readers: retry until no write overlapped the copy. Writers
+    // are serialized on the table's owner lock; readers never take it.
+    static uint32_t version();                          // even = no write in progress
+    static bool readEntry(uint8_t idx, PeerEntry* out); // false if idx is past the end
+    static bool readEntry(const uint8_t* mac, PeerEntry* out);   // false if unknown
+    static void snapshot(PeerSnapshot* out);
+
+    // FTM distance update (packed triangular store, -1 = unknown).
+    // getDistance/getPosition/getConfidence are seqlock readers too.
+    static void setDistance(uint8_t idxA, uint8_t idxB, float distance_cm,
+                            uint8_t quality = PEER_QUALITY_FTM);
     static float getDistance(uint8_t idxA, uint8_t idxB);
+    static uint8_t getDistanceQuality(uint8_t idxA, uint8_t idxB);
+
+    // Raw edge access + change tracking (standby replication)
+    static PeerEdge getEdge(uint16_t edge);
+    static uint16_t takeDirtyEdges(uint16_t* out, uint16_t max);  // returns and clears
+    static void markAllEdgesDirty();                               // every known edge
+    static void markEdgesDirty(const uint16_t* edges, uint16_t n); // put taken edges back
+
+    /// Slot in a PEER_EDGE_COUNT array for the unordered pair (a, b), a != b.
+    static inline uint16_t edgeIndex(uint8_t a, uint8_t b) {
+        if (a > b) { uint8_t t = a; a = b; b = t; }
+        return (uint16_t)(a * (2 * MESH_MAX_NODES - a - 1) / 2 + (b - a - 1));
+    }
+
+    /// Inverse of edgeIndex(): the pair owning edge, a < b
+    static inline void edgeNodes(uint16_t edge, uint8_t* a, uint8_t* b) {
+        uint8_t lo = 0;
+        uint16_t row = MESH_MAX_NODES - 1;   // edges whose lower slot is lo
+        while (edge >= row) { edge -= row; row--; lo++; }
+        *a = lo;
+        *b = (uint8_t)(lo + 1 + edge);
+    }
 
     // Position update
     static void setPosition(uint8_t idx, float x, float y, float z, float confidence);
+    static void getPosition(uint8_t idx, float out[3]);
+    static float getConfidence(uint8_t idx);
 
     // Dimension tracking
     static uint8_t getDimension();  // 1, 2, or 3
@@ -59,11 +130,22 @@ public:
     // Seed from peer shadow (used during role transfer)
     static void seedFromShadow(const PeerSyncEntry* entries, uint8_t count);
 
+    /// Slot for a peer known only from the geometry cache (GeoCache): kept
+    /// DEAD, with no liveness deadline, until it heartbeats. Returns the
+    /// slot (existing or new), -1 if the table is full.
+    static int8_t seedCached(const uint8_t* mac, const uint8_t* softap_mac);
+
     // Sync to peers
     static void broadcastSync();
+    /// Unicast a FULL sync at the current epoch (PEER_SYNC_REQ from a node
+    /// that missed a delta).
+    static void sendFullSync(const uint8_t* to);
 
     // Debug
     static void print();
+    // MAC lookup/update cost, hash index vs linear scan, on a private
+    // n-slot table (`peers bench`); prints to Serial
+    static void bench(uint8_t n, uint32_t iters);
 
 private:
     PeerTable() = delete;
@@ -13,6 +13,9 @@ public:
     /// Reset Kalman state (e.g. after topology change).
     static void reset();
 
+    /// Forget one node's filter state (PeerTable slot handed to a new peer).
+    static void resetNode(uint8_t idx);
+
 private:
     PositionSolver() = delete;
 };
@@ -5,7 +5,7 @@
 #include <stdbool.h>
 #include "bsp.hpp"
 
-#define RTC_MAP_MAGIC  0x53514B01  // "SQK" + version 1
+#define RTC_MAP_MAGIC  0x53514B02  // "SQK" + version 2
 
 // Peer flags
 #define PEER_FLAG_ALIVE    0x01
@@ -24,11 +24,17 @@ struct rtc_mesh_map_t {
     uint8_t  own_role;       // 0=peer, 1=gateway
     uint8_t  gateway_mac[6];
     uint8_t  mesh_channel;
+    uint8_t  own_layer;         // mesh layer when last connected (0 = never)
+    uint8_t  parent_bssid[6];   // mesh parent SoftAP, for a warm rejoin
+    uint8_t  parent_ssid[32];
+    uint8_t  parent_ssid_len;
     uint8_t  peer_count;
     rtc_peer_entry_t peers[MESH_MAX_NODES];
     float    own_position[3];   // placeholder for Phase 2
     uint32_t ftm_epoch;         // placeholder for Phase 2
-    uint32_t mesh_generation;
+    uint32_t mesh_generation;   // 0x10000 | election epoch that settled gateway_mac (0 = unsettled)
+    uint32_t join_cold_ms;      // wake → first heartbeat accepted, last cold start
+    uint32_t join_warm_ms;      // same, last warm rejoin
     uint32_t checksum;
 };
 
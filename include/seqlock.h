@@ -0,0 +1,49 @@
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#include <stdint.h>
+
+// Sequence counter for one-writer / many-reader data (PeerTable, ClockSync).
+//
+// The writer brackets every change with writeBegin()/writeEnd(); the count
+// is odd while a write is in progress. Readers copy what they need between
+// readBegin() and readRetry() and start over if the count moved, so they
+// never block the writer and never keep a torn copy. Writers must already
+// be serialized (PeerTable's owner lock; ClockSync writes from the RX task
+// only). Header-only, no RTOS or Arduino dependency:
+// test/test_native_peer_table hammers it from host threads.
+class SeqLock {
+public:
+    void writeBegin() {
+        _seq = _seq + 1;
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    }
+
+    void writeEnd() {
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        _seq = _seq + 1;
+    }
+
+    /// Wait out a write in progress (calling wait() between looks) and
+    /// return the sequence to hand to readRetry()
+    template <typename Wait>
+    uint32_t readBegin(Wait wait) const {
+        uint32_t seq;
+        while ((seq = _seq) & 1u) wait();
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        return seq;
+    }
+
+    /// True if a write overlapped the copy: discard it and read again
+    bool readRetry(uint32_t seq) const {
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        return _seq != seq;
+    }
+
+    uint32_t value() const { return _seq; }
+
+private:
+    volatile uint32_t _seq = 0;
+};
+
+#endif // SEQLOCK_H
@@ -0,0 +1,53 @@
+#ifndef TRAVEL_PATH_H
+#define TRAVEL_PATH_H
+
+#include <stdint.h>
+
+struct PeerSnapshot;
+
+#define PATH_COST_UNKNOWN  0xFFFF   // no distance known: the optimiser avoids the hop
+
+enum PathMetric : uint8_t {
+    PATH_METRIC_EDGES     = 0,   // measured FTM distances, positions fill the gaps
+    PATH_METRIC_POSITIONS = 1,   // solved positions, measured distances fill the gaps
+};
+
+// Short travel paths over the measured geometry.
+//
+// Costs are a dense n×n matrix of hop lengths in cm (symmetric, row-major).
+// A path is seeded greedily from every start node, then refined with 2-opt
+// (reverse a stretch) and Or-opt (move a run of 1-3 stops elsewhere, either
+// way round) until no move gains or TRAVEL_PATH_BUDGET move evaluations
+// are spent. An open path ends where it ends; a loop also pays the hop
+// from the last stop back to the first.
+class TravelPath {
+public:
+    TravelPath() = delete;
+
+    /// Alive slots of view, in the order to visit them. Cached: the path
+    /// is recomputed only when the alive set or a hop cost changed since the
+    /// last call. *fresh (optional) says whether it was.
+    static uint8_t build(const PeerSnapshot& view, bool loop, PathMetric metric,
+                         uint8_t* out, bool* fresh = nullptr);
+
+    // Building blocks (also used by `orch bench`)
+
+    /// Nearest-neighbour walk from start; order gets indices 0..n-1.
+    static uint32_t greedy(const uint16_t* cost, uint8_t n, uint8_t start, bool loop,
+                           uint8_t* order);
+
+    /// Best greedy seed, then 2-opt/Or-opt. Returns the path length in cm.
+    static uint32_t optimise(const uint16_t* cost, uint8_t n, bool loop, uint8_t* order,
+                             uint32_t budget);
+
+    static uint32_t length(const uint16_t* cost, uint8_t n, const uint8_t* order, bool loop);
+
+    /// Length (cm) of the path build() returned last
+    static uint32_t lastLength_cm();
+
+    /// Evaluations the last optimise() spent, and whether it stopped on budget
+    static uint32_t lastEvaluations();
+    static bool lastHitBudget();
+};
+
+#endif // TRAVEL_PATH_H
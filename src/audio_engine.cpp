@@ -1,6 +1,7 @@
 #include "audio_engine.h"
 #include <driver/gptimer.h>
 #include <esp_attr.h>
+#include <esp_timer.h>
 
 // --- File-scope playback state ---
 static IAudioOutput*        s_output       = nullptr;
@@ -10,8 +11,16 @@ static uint16_t             s_tick         = 0;
 static uint16_t             s_seg_ticks    = 0;
 static uint8_t              s_repeat_cnt   = 0;
 static volatile bool        s_playing      = false;
+static volatile uint8_t     s_gain         = 255;   // per-play amplitude, scales duty
 static gptimer_handle_t     s_timer        = nullptr;
 
+// Deferred start (playAt)
+static esp_timer_handle_t   s_startTimer   = nullptr;
+static const ToneSequence*  s_pending      = nullptr;
+static int64_t              s_pendingUs    = 0;
+static uint8_t              s_pendingGain  = 255;
+static int32_t              s_startErrUs   = 0;
+
 // ISR tick rate
 static constexpr uint32_t TICK_HZ = 200;
 
@@ -37,6 +46,9 @@ static bool IRAM_ATTR onTimerAlarm(gptimer_handle_t timer,
                        + (uint32_t)seg.duty_end   * s_tick)
                       / s_seg_ticks;
 
+        // Gain 255 leaves duty as is: (duty * 256) >> 8
+        duty = (duty * ((uint32_t)s_gain + 1)) >> 8;
+
         if (freq > 0) {
             s_output->setFrequency(freq);
             s_output->setDuty((uint8_t)duty);
@@ -100,8 +112,46 @@ void AudioEngine::init(IAudioOutput* output) {
     gptimer_enable(s_timer);
 }
 
-void AudioEngine::play(const ToneSequence* seq) {
+static void startTimerCb(void*) {
+    const ToneSequence* seq = s_pending;
+    s_pending = nullptr;
+    s_startErrUs = (int32_t)(esp_timer_get_time() - s_pendingUs);
+    AudioEngine::play(seq, s_pendingGain);
+}
+
+void AudioEngine::playAt(const ToneSequence* seq, int64_t start_us, uint8_t gain) {
     if (!seq || !s_output || seq->count == 0) return;
+    if (s_startTimer == nullptr) {
+        esp_timer_create_args_t args = {};
+        args.callback = startTimerCb;
+        args.dispatch_method = ESP_TIMER_TASK;
+        args.name = "playAt";
+        esp_timer_create(&args, &s_startTimer);
+    }
+    esp_timer_stop(s_startTimer);   // a pending start is superseded
+
+    int64_t wait_us = start_us - esp_timer_get_time();
+    if (wait_us <= 0 || !s_startTimer) {
+        s_startErrUs = (int32_t)(-wait_us);
+        play(seq, gain);
+        return;
+    }
+    s_pending = seq;
+    s_pendingUs = start_us;
+    s_pendingGain = gain;
+    esp_timer_start_once(s_startTimer, (uint64_t)wait_us);
+}
+
+int32_t AudioEngine::lastStartErrorUs() {
+    return s_startErrUs;
+}
+
+void AudioEngine::play(const ToneSequence* seq, uint8_t gain) {
+    if (!seq || !s_output || seq->count == 0) return;
+    if (s_pending && s_startTimer) {   // an immediate play wins over a deferred one
+        esp_timer_stop(s_startTimer);
+        s_pending = nullptr;
+    }
 
     // Stop any current playback
     s_playing = false;
@@ -111,6 +161,7 @@ void AudioEngine::play(const ToneSequence* seq) {
     s_seg_idx    = 0;
     s_tick       = 0;
     s_repeat_cnt = 0;
+    s_gain       = gain;
 
     // Precompute ticks for first segment
     s_seg_ticks = (uint16_t)(((uint32_t)seq->segments[0].duration_ms * TICK_HZ) / 1000);
@@ -121,11 +172,17 @@ void AudioEngine::play(const ToneSequence* seq) {
 }
 
 void AudioEngine::stop() {
+    if (s_startTimer) esp_timer_stop(s_startTimer);
+    s_pending = nullptr;
     s_playing = false;
     if (s_timer) gptimer_stop(s_timer);
     if (s_output) s_output->silence();
 }
 
+void AudioEngine::setGain(uint8_t gain) {
+    s_gain = gain;   // next ISR tick
+}
+
 bool AudioEngine::isPlaying() {
     return s_playing;
 }
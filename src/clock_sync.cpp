@@ -1,29 +1,127 @@
 #include "clock_sync.h"
 #include "mesh_conductor.h"
+#include "peer_table.h"
+#include "audio_engine.h"
 #include "nvs_config.h"
+#include "seqlock.h"
+#include "bsp.hpp"
 #include "sq_log.h"
 #include <Arduino.h>
+#include <esp_timer.h>
 #include <freertos/timers.h>
 
-static int32_t       s_offset    = 0;
+// mesh µs = local µs + offset, where offset(t) = s_offsetUs + drift ×
+// (t - s_refUs) and local µs is esp_timer_get_time(). 0 on the gateway,
+// whose millis() is esp_timer_get_time() / 1000. The RX task writes the
+// estimate under s_seq; meshTime()/localUs() read it from any task.
+static int64_t       s_offsetUs  = 0;
+static int64_t       s_refUs     = 0;
+static int32_t       s_driftPpb  = 0;     // node clock slow vs gateway: offset grows
+static bool          s_driftKnown = false;
+static SeqLock       s_seq;
 static bool          s_synced    = false;
 static TimerHandle_t s_syncTimer = nullptr;
 
+// Recent offset samples: delivery delay only ever makes a sample smaller,
+// so the largest (once projected to now along the drift) is the best
+// estimate; max - min bounds the jitter
+struct SyncSample {
+    int64_t localUs;
+    int64_t offsetUs;
+};
+static SyncSample    s_samples[CSYNC_WINDOW];
+static uint8_t       s_sampleCount = 0;
+static uint8_t       s_sampleNext  = 0;
+static uint32_t      s_syncCount   = 0;
+static int32_t       s_lastStepUs  = 0;   // estimate moved this much at the last sync
+
+// Drift: slope between the best samples of successive full windows
+static SyncSample    s_anchor;
+static bool          s_anchorValid = false;
+
+// Gateway: start-skew probes. The timer task sends them round-robin over
+// PeerTable; the RX task folds each reply into the current sweep and
+// publishes a sweep's spread when the next one starts.
+static uint8_t       s_probeCursor = 1;   // slot 0 is the gateway itself
+static uint8_t       s_probeSweep  = 0;
+static uint8_t       s_accSweep    = 0;
+static uint8_t       s_accNodes    = 0;
+static int32_t       s_accMinUs = 0, s_accMaxUs = 0;
+static uint32_t      s_accUncUs    = 0;
+static int32_t       s_accWorstClockUs = 0;
+static uint8_t       s_skewNodes   = 0;   // last complete sweep, gateway included
+static int32_t       s_skewUs      = 0;
+static uint32_t      s_skewUncUs   = 0;
+static int32_t       s_skewWorstClockUs = 0;
+static uint32_t      s_probeSlow   = 0;
+
+static int64_t offsetAt(int64_t localUs) {
+    int64_t off, ref;
+    int32_t ppb;
+    uint32_t seq;
+    do {
+        seq = s_seq.readBegin([] { vTaskDelay(1); });
+        off = s_offsetUs;
+        ref = s_refUs;
+        ppb = s_driftPpb;
+    } while (s_seq.readRetry(seq));
+    return off + (localUs - ref) * ppb / 1000000000;
+}
+
+static void sendProbes() {
+    uint8_t count = PeerTable::peerCount();
+    if (count < 2) return;
+    uint8_t sent = 0;
+    for (uint8_t tries = 0; tries < count && sent < CSYNC_PROBES_PER_SYNC; tries++) {
+        if (s_probeCursor >= count) {
+            s_probeCursor = 1;
+            s_probeSweep++;
+        }
+        PeerEntry pe;
+        uint8_t idx = s_probeCursor++;
+        if (!PeerTable::readEntry(idx, &pe) || !(pe.flags & PEER_STATUS_ALIVE)
+            || (pe.flags & PEER_STATUS_DEAD)) continue;
+        ClockProbeMsg msg = {};
+        msg.type       = MSG_TYPE_CLOCK_PROBE;
+        msg.sweep      = s_probeSweep;
+        msg.gateway_us = (uint32_t)esp_timer_get_time();
+        MeshConductor::sendToNode(pe.mac, &msg, sizeof(msg));
+        sent++;
+    }
+}
+
 static void syncTimerCb(TimerHandle_t) {
     ClockSyncMsg msg;
     msg.type       = MSG_TYPE_CLOCK_SYNC;
     msg.gateway_ms = millis();
     MeshConductor::broadcastToAll(&msg, sizeof(msg));
+    sendProbes();
+}
+
+static void resetSamples() {
+    s_sampleCount = 0;
+    s_sampleNext = 0;
+    s_anchorValid = false;
+    s_seq.writeBegin();
+    s_driftPpb = 0;
+    s_seq.writeEnd();
+    s_driftKnown = false;
 }
 
 void ClockSync::init() {
+    resetSamples();
     if (!MeshConductor::isGateway()) {
         s_synced = false;
         return;
     }
 
     s_synced = true;  // gateway is always synced
-    s_offset = 0;
+    s_seq.writeBegin();
+    s_offsetUs = 0;
+    s_refUs = 0;
+    s_seq.writeEnd();
+    s_skewNodes = 0;
+    s_accNodes = 0;
 
     uint32_t interval_s = (uint32_t)NvsConfigManager::clockSyncInterval_s;
     if (interval_s == 0) interval_s = 10;
@@ -47,19 +145,176 @@ void ClockSync::stop() {
         xTimerStop(s_syncTimer, 0);
     }
     s_synced = false;
+    resetSamples();
+}
+
+// Best sample of the window projected to nowUs. Once the drift is known a
+// sample is projected along it and only the residual drift bound ages it;
+// before that, the full crystal bound does, so a stale sample cannot win on
+// delay alone while the clocks walk apart.
+static int64_t bestOffset(int64_t nowUs) {
+    int64_t resid = s_driftKnown ? CSYNC_DRIFT_RESID_PPM : CSYNC_DRIFT_MAX_PPM;
+    int64_t best = 0, bestScore = 0;
+    for (uint8_t i = 0; i < s_sampleCount; i++) {
+        int64_t age = nowUs - s_samples[i].localUs;
+        int64_t projected = s_samples[i].offsetUs + age * s_driftPpb / 1000000000;
+        int64_t score = projected - age * resid / 1000000;
+        if (i == 0 || score > bestScore) {
+            bestScore = score;
+            best = projected;
+        }
+    }
+    return best;
+}
+
+// Called when the window has been refilled: its best sample is one point on
+// the offset line, the previous window's is the other
+static void updateDrift(int64_t nowUs, int64_t best) {
+    if (s_anchorValid && nowUs - s_anchor.localUs >= (int64_t)CSYNC_DRIFT_BASE_S * 1000000) {
+        int64_t meas = (best - s_anchor.offsetUs) * 1000000000 / (nowUs - s_anchor.localUs);
+        const int64_t lim = (int64_t)CSYNC_DRIFT_MAX_PPM * 1000;
+        if (meas > lim) meas = lim;
+        if (meas < -lim) meas = -lim;
+        // Window minima carry a few hundred µs of delay noise: smooth
+        int32_t ppb = s_driftKnown ? (int32_t)(s_driftPpb + (meas - s_driftPpb) / 4) : (int32_t)meas;
+        s_seq.writeBegin();
+        s_driftPpb = ppb;
+        s_seq.writeEnd();
+        s_driftKnown = true;
+    } else if (s_anchorValid) {
+        return;   // baseline too short (fast sync interval): keep the older anchor
+    }
+    s_anchor.localUs = nowUs;
+    s_anchor.offsetUs = best;
+    s_anchorValid = true;
 }
 
 void ClockSync::onSyncReceived(uint32_t gateway_ms) {
-    s_offset = (int32_t)(gateway_ms - millis());
+    if (MeshConductor::isGateway()) return;   // our own broadcast, looped back
+
+    // gateway_ms was truncated: its true value is half a millisecond later on average
+    int64_t nowUs = esp_timer_get_time();
+    int64_t sample = (int64_t)gateway_ms * 1000 + 500 - nowUs;
+    int64_t predicted = offsetAt(nowUs);
+
+    // A jump (gateway change, millis() wrap) invalidates the window
+    if (s_sampleCount > 0 && llabs(sample - predicted) > 1000000) resetSamples();
+
+    s_samples[s_sampleNext] = { nowUs, sample };
+    s_sampleNext = (uint8_t)((s_sampleNext + 1) % CSYNC_WINDOW);
+    if (s_sampleCount < CSYNC_WINDOW) s_sampleCount++;
+
+    int64_t best = bestOffset(nowUs);
+    if (s_sampleNext == 0) {
+        updateDrift(nowUs, best);
+        best = bestOffset(nowUs);   // re-project with the new slope
+    }
+
+    s_lastStepUs = s_sampleCount > 1 ? (int32_t)(best - predicted) : 0;
+    s_seq.writeBegin();
+    s_offsetUs = best;
+    s_refUs = nowUs;
+    s_seq.writeEnd();
     s_synced = true;
+    s_syncCount++;
 }
 
 uint32_t ClockSync::meshTime() {
     if (MeshConductor::isGateway()) return millis();
-    return millis() + s_offset;
+    int64_t nowUs = esp_timer_get_time();
+    return (uint32_t)((nowUs + offsetAt(nowUs)) / 1000);
 }
 
 bool ClockSync::isSynced() {
     if (MeshConductor::isGateway()) return true;
     return s_synced;
 }
+
+int64_t ClockSync::localUs(uint32_t mesh_ms) {
+    int64_t nowUs = esp_timer_get_time();
+    int64_t offsetUs = MeshConductor::isGateway() ? 0 : offsetAt(nowUs);
+    int64_t meshUs = nowUs + offsetUs;
+    // Difference in wrapping 32-bit milliseconds, then back to local µs
+    int32_t aheadMs = (int32_t)(mesh_ms - (uint32_t)(meshUs / 1000));
+    return nowUs + (int64_t)aheadMs * 1000 - meshUs % 1000;
+}
+
+void ClockSync::onProbe(const uint8_t* from, const ClockProbeMsg* probe) {
+    if (MeshConductor::isGateway()) return;
+    ClockProbeMsg reply = *probe;
+    int64_t nowUs = esp_timer_get_time();
+    reply.type         = MSG_TYPE_CLOCK_PROBE_REPLY;
+    reply.node_us      = (uint32_t)(nowUs + offsetAt(nowUs));
+    reply.start_err_us = AudioEngine::lastStartErrorUs();
+    MeshConductor::sendToNode(from, &reply, sizeof(reply));
+}
+
+// Gateway, RX task. The node read its clock somewhere inside the round
+// trip: against the midpoint it is off by clock error ± rtt/2. Adding its
+// start error gives where its last tone started relative to the gateway's
+// mesh clock; the spread of that across a sweep is the cross-node skew.
+void ClockSync::onProbeReply(const ClockProbeMsg* reply) {
+    if (!MeshConductor::isGateway()) return;
+    uint32_t rtt = (uint32_t)esp_timer_get_time() - reply->gateway_us;
+    if (rtt > CSYNC_PROBE_MAX_RTT_US) {
+        s_probeSlow++;
+        return;
+    }
+    int32_t clockUs = (int32_t)(reply->node_us - (reply->gateway_us + rtt / 2));
+    int32_t startUs = clockUs + reply->start_err_us;
+
+    if (s_accNodes == 0 || reply->sweep != s_accSweep) {
+        if (s_accNodes > 1) {
+            s_skewNodes = s_accNodes;
+            s_skewUs = s_accMaxUs - s_accMinUs;
+            s_skewUncUs = s_accUncUs;
+            s_skewWorstClockUs = s_accWorstClockUs;
+        }
+        // The gateway is the reference: clock error 0, its own start error
+        s_accSweep = reply->sweep;
+        s_accNodes = 1;
+        s_accMinUs = s_accMaxUs = AudioEngine::lastStartErrorUs();
+        s_accUncUs = 0;
+        s_accWorstClockUs = 0;
+    }
+    s_accNodes++;
+    if (startUs < s_accMinUs) s_accMinUs = startUs;
+    if (startUs > s_accMaxUs) s_accMaxUs = startUs;
+    if (rtt / 2 > s_accUncUs) s_accUncUs = rtt / 2;
+    if (abs(clockUs) > abs(s_accWorstClockUs)) s_accWorstClockUs = clockUs;
+}
+
+void ClockSync::printStatus(Print& out) {
+    if (MeshConductor::isGateway()) {
+        out.println("  Clock: gateway (mesh time source)");
+        if (s_skewNodes > 1) {
+            out.printf("  Start skew: %ld us across %u nodes (worst clock error %ld us, each ±%lu us)\n",
+                       (long)s_skewUs, s_skewNodes, (long)s_skewWorstClockUs,
+                       (unsigned long)s_skewUncUs);
+        } else {
+            out.println("  Start skew: no probe sweep yet");
+        }
+        if (s_probeSlow > 0)
+            out.printf("  Skew probes dropped (rtt > %u us): %lu\n",
+                       (unsigned)CSYNC_PROBE_MAX_RTT_US, (unsigned long)s_probeSlow);
+        return;
+    }
+    if (!s_synced) {
+        out.println("  Clock: not synced");
+        return;
+    }
+    int64_t nowUs = esp_timer_get_time();
+    int64_t hi = 0, lo = 0;
+    for (uint8_t i = 0; i < s_sampleCount; i++) {
+        int64_t p = s_samples[i].offsetUs + (nowUs - s_samples[i].localUs) * s_driftPpb / 1000000000;
+        if (i == 0 || p > hi) hi = p;
+        if (i == 0 || p < lo) lo = p;
+    }
+    out.printf("  Clock: offset %lld us, %lu syncs, delay jitter %lld us over last %u, last step %ld us\n",
+               (long long)offsetAt(nowUs), (unsigned long)s_syncCount,
+               (long long)(hi - lo), s_sampleCount, (long)s_lastStepUs);
+    if (s_driftKnown)
+        out.printf("  Clock drift: %+.2f ppm vs gateway\n", s_driftPpb / 1000.0);
+    else
+        out.println("  Clock drift: estimating");
+}
@@ -18,10 +18,13 @@
 #include "clock_sync.h"
 #include "web_server.h"
 #include "setup_delegate.h"
+#include "link_stats.h"
+#include "geo_cache.h"
+#include "travel_path.h"
 #include <Arduino.h>
 #include <ArduinoJson.h>
 #include <esp_system.h>
-#include <esp_mac.h>
+#include <esp_random.h>
 #include <WiFi.h>
 #include <string.h>
 
@@ -45,6 +48,8 @@ static void cmd_config(const char* args);
 static void cmd_mode(const char* args);
 static void cmd_status(const char* args);
 static void cmd_orch(const char* args);
+static void cmd_link(const char* args);
+static void cmd_geo(const char* args);
 static void cmd_reboot(const char* args);
 
 // --- Command table ---
@@ -63,7 +68,7 @@ static const CliCommand s_commands[] = {
     { "elect",     cmd_elect,     "Force gateway re-election" },
     { "rtc",       cmd_rtc,       "RTC memory write/readback test" },
     { "sleep",     cmd_sleep,     "Light sleep [seconds] (default 5)" },
-    { "peers",     cmd_peers,     "Show PeerTable (synced from gateway)" },
+    { "peers",     cmd_peers,     "Show PeerTable (synced from gateway) | bench [n] [iters]" },
     { "tone",      cmd_tone,      "Interactive tone player (numpad)" },
     { "config",    cmd_config,    "Get/set NVS config locally or on peers" },
     { "mode",      cmd_mode,      "Set role: 'mode gateway' or 'mode peer'" },
@@ -73,7 +78,9 @@ static const CliCommand s_commands[] = {
     { "broadcast", cmd_broadcast, "Broadcast positions to all nodes" },
     { "quiet",     cmd_quiet,     "Toggle background output suppression" },
     { "status",    cmd_status,    "Print mesh state, role, battery, peers" },
-    { "orch",      cmd_orch,      "Orchestrator: travel|random|seq|sched|stop|status" },
+    { "orch",      cmd_orch,      "Orchestrator: travel|random|pan|play|seq|sched|listener|align|stop|status|bench" },
+    { "link",      cmd_link,      "Link telemetry: [ping <slot|*> [n]|json|reset]" },
+    { "geo",       cmd_geo,       "Geometry cache: [save|clear]" },
     { "reboot",    cmd_reboot,    "Reboot (esp_restart)" },
 };
 static constexpr int CMD_COUNT = sizeof(s_commands) / sizeof(s_commands[0]);
@@ -189,8 +196,7 @@ static void cmd_wifi(const char* args) {
         if (SetupDelegate::isActive()) {
             Serial.println("Setup Delegate already active");
         } else {
-            uint8_t mac[6];
-            esp_read_mac(mac, ESP_MAC_WIFI_STA);
+            const uint8_t* mac = MeshConductor::staMac();
             Serial.println("Starting Setup Delegate mode...");
             SetupDelegate::begin(mac);
         }
@@ -287,7 +293,18 @@ static void cmd_sleep(const char* args) {
 }
 
 static void cmd_peers(const char* args) {
-    (void)args;
+    if (args && strncasecmp(args, "bench", 5) == 0) {
+        // peers bench [n] [iters]: 16 and 64 peers unless n is given
+        unsigned n = 0, iters = 0;
+        sscanf(args + 5, "%u %u", &n, &iters);
+        if (n) {
+            PeerTable::bench(n > MESH_MAX_NODES ? MESH_MAX_NODES : (uint8_t)n, iters);
+        } else {
+            PeerTable::bench(16, iters);
+            PeerTable::bench(MESH_MAX_NODES, iters);
+        }
+        return;
+    }
     if (!MeshConductor::isConnected()) {
         Serial.println("Mesh not connected. Run 'mesh' first.");
         return;
@@ -366,12 +383,126 @@ static void cmd_tone(const char* args) {
     }
 }
 
-static uint8_t s_configReqId = 0;
+// Render a binary CONFIG_RESP body as JSON (the gateway is the JSON edge)
+static void configPrintResp(const uint8_t* mac, const uint8_t* body, uint16_t len, void* ctx) {
+    (void)ctx;
+    int8_t slot = PeerTable::getIndex(mac);
+    Serial.printf("[%d] %02X:%02X ", slot, mac[4], mac[5]);
+    if (!body) {
+        Serial.println("TIMEOUT");
+        return;
+    }
+    ConfigBinHeader hdr;
+    if (len < sizeof(hdr)) {
+        Serial.println("MALFORMED");
+        return;
+    }
+    memcpy(&hdr, body, sizeof(hdr));
+    if (hdr.code == CFG_ST_SCHEMA) {
+        Serial.printf("SCHEMA MISMATCH (peer %04X, local %04X) — different firmware\n",
+            hdr.schema, configSchemaId());
+        return;
+    }
+    if (hdr.code != CFG_ST_OK) {
+        Serial.printf("ERROR (status %u)\n", hdr.code);
+        return;
+    }
+    JsonDocument doc;
+    uint16_t pos = sizeof(hdr);
+    for (uint8_t i = 0; i < hdr.count && pos + sizeof(ConfigBinValue) <= len; i++) {
+        ConfigBinValue v;
+        memcpy(&v, body + pos, sizeof(v));
+        pos += sizeof(v);
+        configRawToJson(doc, v.idx, v.raw);
+    }
+    serializeJson(doc, Serial);
+    Serial.println();
+}
+
+// Heap accounting for the JSON side of `config bench`
+struct BenchAllocator : ArduinoJson::Allocator {
+    size_t inUse = 0, peak = 0, calls = 0;
+    void* allocate(size_t n) override {
+        size_t* p = (size_t*)malloc(n + sizeof(size_t));
+        if (!p) return nullptr;
+        *p = n;
+        track(n);
+        return p + 1;
+    }
+    void deallocate(void* ptr) override {
+        if (!ptr) return;
+        size_t* p = (size_t*)ptr - 1;
+        inUse -= *p;
+        free(p);
+    }
+    void* reallocate(void* ptr, size_t n) override {
+        if (!ptr) return allocate(n);
+        size_t* p = (size_t*)ptr - 1;
+        size_t old = *p;
+        p = (size_t*)realloc(p, n + sizeof(size_t));
+        if (!p) return nullptr;
+        *p = n;
+        inUse -= old;
+        track(n);
+        return p + 1;
+    }
+    void track(size_t n) {
+        inUse += n;
+        calls++;
+        if (inUse > peak) peak = inUse;
+    }
+};
+
+// Node-side cost of answering one "get all" CONFIG_REQ: the old JSON path
+// (parse request, build + serialize response) vs configHandleBinary().
+static void configBench(uint32_t iters) {
+    if (iters == 0) iters = 200;
+
+    BenchAllocator alloc;
+    const char* reqJson = "{\"action\":\"get\"}";
+    char respJson[460];
+    size_t jsonLen = 0;
+    uint32_t freeBefore = esp_get_free_heap_size();
+    uint32_t t0 = micros();
+    for (uint32_t i = 0; i < iters; i++) {
+        JsonDocument reqDoc(&alloc);
+        deserializeJson(reqDoc, reqJson);
+        JsonDocument respDoc(&alloc);
+        respDoc["mac"] = "00:00:00:00:00:00";
+        configBuildJson(respDoc, nullptr, 0);
+        jsonLen = serializeJson(respDoc, respJson, sizeof(respJson));
+    }
+    uint32_t jsonUs = micros() - t0;
+
+    uint8_t req[sizeof(ConfigBinHeader)];
+    ConfigBinHeader* hdr = (ConfigBinHeader*)req;
+    hdr->schema = configSchemaId();
+    hdr->code = CFG_OP_GET;
+    hdr->count = 0;
+    uint8_t resp[MESH_REL_MAX_PAYLOAD];
+    uint16_t binLen = 0;
+    uint32_t freeMid = esp_get_free_heap_size();
+    t0 = micros();
+    for (uint32_t i = 0; i < iters; i++)
+        binLen = configHandleBinary(req, sizeof(req), resp, sizeof(resp));
+    uint32_t binUs = micros() - t0;
+    uint32_t freeAfter = esp_get_free_heap_size();
+
+    Serial.printf("config bench: %lu iterations, %u fields (get all)\n",
+        (unsigned long)iters, configFieldCount());
+    Serial.printf("  JSON  : %6.1f us/req, req %u B, resp %u B, heap peak %u B (%u allocs/req)\n",
+        (float)jsonUs / iters, (unsigned)strlen(reqJson), (unsigned)jsonLen,
+        (unsigned)alloc.peak, (unsigned)(alloc.calls / iters));
+    Serial.printf("  binary: %6.1f us/req, req %u B, resp %u B, heap peak 0 B (free heap %ld B delta)\n",
+        (float)binUs / iters, (unsigned)sizeof(req), binLen,
+        (long)freeAfter - (long)freeMid);
+    Serial.printf("  free heap before/after: %lu / %lu B\n",
+        (unsigned long)freeBefore, (unsigned long)freeAfter);
+}
 
 static void configDumpLocal() {
     JsonDocument doc;
-    uint8_t own_mac[6];
-    esp_read_mac(own_mac, ESP_MAC_WIFI_STA);
+    const uint8_t* own_mac = MeshConductor::staMac();
     char macStr[18];
     snprintf(macStr, sizeof(macStr), "%02X:%02X:%02X:%02X:%02X:%02X",
         own_mac[0], own_mac[1], own_mac[2],
@@ -423,54 +554,39 @@ static void configRemoteGetSet(bool isSet, const char* target, const char* rest)
         return;
     }
 
-    // Build JSON request
-    JsonDocument reqDoc;
-    if (isSet) {
-        reqDoc["action"] = "set";
-        // Parse key=val pairs from rest
-        if (rest && *rest) {
-            char buf[128];
-            strncpy(buf, rest, sizeof(buf) - 1);
-            buf[sizeof(buf) - 1] = '\0';
-            char* token = strtok(buf, " ");
-            while (token) {
-                char* eq = strchr(token, '=');
-                if (eq) {
-                    *eq = '\0';
-                    const char* key = token;
-                    const char* val = eq + 1;
-                    const ConfigField* f = configLookup(key);
-                    if (!f) {
-                        Serial.printf("Unknown field: %s\n", key);
-                    } else if (f->type == CFG_BOOL) {
-                        reqDoc[key] = (strcmp(val, "1") == 0 || strcasecmp(val, "true") == 0);
-                    } else if (f->type == CFG_FLOAT) {
-                        reqDoc[key] = (float)atof(val);
-                    } else {
-                        reqDoc[key] = (uint32_t)strtoul(val, nullptr, 0);
-                    }
-                }
-                token = strtok(nullptr, " ");
-            }
-        }
-    } else {
-        reqDoc["action"] = "get";
-        // Parse optional field names from rest
-        if (rest && *rest) {
-            JsonArray arr = reqDoc["fields"].to<JsonArray>();
-            char buf[128];
-            strncpy(buf, rest, sizeof(buf) - 1);
-            buf[sizeof(buf) - 1] = '\0';
-            char* token = strtok(buf, " ");
-            while (token) {
-                arr.add(token);
-                token = strtok(nullptr, " ");
+    // Build binary request (registry indices; JSON stays on this side)
+    uint8_t body[sizeof(ConfigBinHeader) + 32 * sizeof(ConfigBinValue)];
+    ConfigBinHeader* hdr = (ConfigBinHeader*)body;
+    hdr->schema = configSchemaId();
+    hdr->code = isSet ? CFG_OP_SET : CFG_OP_GET;
+    hdr->count = 0;
+    uint16_t bodyLen = sizeof(ConfigBinHeader);
+    if (rest && *rest) {
+        char buf[128];
+        strncpy(buf, rest, sizeof(buf) - 1);
+        buf[sizeof(buf) - 1] = '\0';
+        char* token = strtok(buf, " ");
+        while (token && hdr->count < 32) {
+            char* eq = isSet ? strchr(token, '=') : nullptr;
+            if (eq) *eq = '\0';
+            uint8_t idx = configFieldIndex(token);
+            if (idx == CFG_FIELD_NONE) {
+                Serial.printf("Unknown field: %s\n", token);
+            } else if (!isSet) {
+                body[bodyLen++] = idx;
+                hdr->count++;
+            } else if (eq) {
+                ConfigBinValue v;
+                v.idx = idx;
+                configParseRaw(idx, eq + 1, &v.raw);
+                memcpy(body + bodyLen, &v, sizeof(v));
+                bodyLen += sizeof(v);
+                hdr->count++;
             }
+            token = strtok(nullptr, " ");
         }
     }
-
-    char reqJson[256];
-    serializeJson(reqDoc, reqJson, sizeof(reqJson));
+    if (isSet && hdr->count == 0) return;
 
     // Determine target peer(s)
     bool allPeers = (strcmp(target, "*") == 0);
@@ -478,13 +594,13 @@ static void configRemoteGetSet(bool isSet, const char* target, const char* rest)
     if (allPeers) {
         // Include local node in * operations
         if (isSet) {
-            configApplyJson(reqDoc.as<JsonObjectConst>());
+            uint8_t scratch[sizeof(ConfigBinHeader) + 32 * sizeof(ConfigBinValue)];
+            configHandleBinary(body, bodyLen, scratch, sizeof(scratch));
         }
         // Show local config (filtered by requested fields for get, full dump for set)
         {
             JsonDocument localDoc;
-            uint8_t own_mac[6];
-            esp_read_mac(own_mac, ESP_MAC_WIFI_STA);
+            const uint8_t* own_mac = MeshConductor::staMac();
             char macStr[18];
             snprintf(macStr, sizeof(macStr), "%02X:%02X:%02X:%02X:%02X:%02X",
                 own_mac[0], own_mac[1], own_mac[2],
@@ -509,54 +625,43 @@ static void configRemoteGetSet(bool isSet, const char* target, const char* rest)
         }
 
         uint8_t count = MeshConductor::isGateway() ? PeerTable::peerCount() : MeshConductor::peerShadowCount();
-        uint8_t own_mac[6];
-        esp_read_mac(own_mac, ESP_MAC_WIFI_STA);
+        const uint8_t* own_mac = MeshConductor::staMac();
 
+        // All live peers in one round-trip; replies print as they arrive
+        static uint8_t targets[MESH_MAX_NODES][6];
+        uint8_t n = 0;
         for (uint8_t i = 0; i < count; i++) {
-            PeerEntry* e = MeshConductor::isGateway() ? PeerTable::getEntryByIndex(i) : nullptr;
-            if (!e) continue;
-            if (memcmp(e->mac, own_mac, 6) == 0) continue;
-            if (e->flags & PEER_STATUS_DEAD) continue;
-
-            uint8_t reqId = ++s_configReqId;
-            Serial.printf("[%u] Requesting %02X:%02X... ", i, e->mac[4], e->mac[5]);
-            if (MeshConductor::sendConfigReq(e->mac, reqJson, reqId)) {
-                char resp[480];
-                if (MeshConductor::waitConfigResp(resp, sizeof(resp), 5000)) {
-                    Serial.println(resp);
-                } else {
-                    Serial.println("TIMEOUT");
-                }
-            } else {
-                Serial.println("SEND FAILED");
-            }
+            PeerEntry e;
+            if (!MeshConductor::isGateway() || !PeerTable::readEntry(i, &e)) continue;
+            if (memcmp(e.mac, own_mac, 6) == 0) continue;
+            if (e.flags & PEER_STATUS_DEAD) continue;
+            memcpy(targets[n++], e.mac, 6);
         }
+        if (n == 0) return;
+
+        Serial.printf("Requesting %u peers...\n", n);
+        uint32_t t0 = millis();
+        uint8_t replies = MeshConductor::configFanout(targets, n, body, bodyLen,
+                                                      MESH_CONFIG_TIMEOUT_MS, configPrintResp, nullptr);
+        Serial.printf("%u/%u replied in %lu ms\n", replies, n, (unsigned long)(millis() - t0));
     } else {
         int slot = atoi(target);
-        PeerEntry* e = MeshConductor::isGateway() ? PeerTable::getEntryByIndex((uint8_t)slot) : nullptr;
-        if (!e) {
+        PeerEntry e;
+        if (!MeshConductor::isGateway() || !PeerTable::readEntry((uint8_t)slot, &e)) {
             Serial.printf("Peer slot %d not found.\n", slot);
             return;
         }
-        if (e->flags & PEER_STATUS_DEAD) {
+        if (e.flags & PEER_STATUS_DEAD) {
             Serial.printf("Peer slot %d is dead.\n", slot);
             return;
         }
 
-        uint8_t reqId = ++s_configReqId;
         Serial.printf("Requesting slot %d (%02X:%02X:%02X:%02X:%02X:%02X)...\n",
-            slot, e->mac[0], e->mac[1], e->mac[2], e->mac[3], e->mac[4], e->mac[5]);
+            slot, e.mac[0], e.mac[1], e.mac[2], e.mac[3], e.mac[4], e.mac[5]);
 
-        if (MeshConductor::sendConfigReq(e->mac, reqJson, reqId)) {
-            char resp[480];
-            if (MeshConductor::waitConfigResp(resp, sizeof(resp), 5000)) {
-                Serial.println(resp);
-            } else {
-                Serial.println("TIMEOUT — no response from peer.");
-            }
-        } else {
-            Serial.println("Failed to send config request.");
-        }
+        uint8_t mac[1][6];
+        memcpy(mac[0], e.mac, 6);
+        MeshConductor::configFanout(mac, 1, body, bodyLen, MESH_CONFIG_TIMEOUT_MS, configPrintResp, nullptr);
     }
 }
 
@@ -586,6 +691,11 @@ static void cmd_config(const char* args) {
         return;
     }
 
+    if (strcasecmp(subcmd, "bench") == 0) {
+        configBench(rest ? (uint32_t)strtoul(rest, nullptr, 0) : 0);
+        return;
+    }
+
     if (strcasecmp(subcmd, "get") == 0) {
         if (!rest || !*rest) {
             Serial.println("Usage: config get <slot|*> [field1 field2...]");
@@ -638,7 +748,7 @@ static void cmd_config(const char* args) {
         return;
     }
 
-    Serial.println("Usage: config [list|get <slot|*> [fields...]|set <slot|*|local> key=val...]");
+    Serial.println("Usage: config [list|bench [n]|get <slot|*> [fields...]|set <slot|*|local> key=val...]");
 }
 
 static void cmd_mode(const char* args) {
@@ -661,12 +771,13 @@ static void cmd_mode(const char* args) {
         Serial.flush();
         NominateMsg msg;
         msg.type = MSG_TYPE_NOMINATE;
-        esp_read_mac(msg.mac, ESP_MAC_WIFI_STA);
+        memcpy(msg.mac, MeshConductor::staMac(), 6);
         // Send to logical gateway (may differ from ESP-IDF root after role transfer)
         const uint8_t* gw = MeshConductor::gatewayMac();
         static const uint8_t zero[6] = {0};
         if (memcmp(gw, zero, 6) != 0) {
-            MeshConductor::sendToNode(gw, &msg, sizeof(msg));
+            if (MeshConductor::sendReliable(gw, &msg, sizeof(msg)) != ESP_OK)
+                Serial.println("Reliable channel busy — try again");
         } else {
             MeshConductor::sendToRoot(&msg, sizeof(msg));
         }
@@ -693,15 +804,15 @@ static void cmd_ftm(const char* args) {
     Serial.println("FTM single-shot test");
 
     if (MeshConductor::isGateway() && PeerTable::peerCount() >= 2) {
-        PeerEntry* peer = PeerTable::getEntryByIndex(1);
-        if (peer && !(peer->flags & PEER_STATUS_DEAD)) {
+        PeerEntry peer;
+        if (PeerTable::readEntry(1, &peer) && !(peer.flags & PEER_STATUS_DEAD)) {
             Serial.printf("Ranging to peer slot 1: %02X:%02X:%02X:%02X:%02X:%02X (SoftAP: %02X:%02X:%02X:%02X:%02X:%02X)\n",
-                peer->mac[0], peer->mac[1], peer->mac[2],
-                peer->mac[3], peer->mac[4], peer->mac[5],
-                peer->softap_mac[0], peer->softap_mac[1], peer->softap_mac[2],
-                peer->softap_mac[3], peer->softap_mac[4], peer->softap_mac[5]);
+                peer.mac[0], peer.mac[1], peer.mac[2],
+                peer.mac[3], peer.mac[4], peer.mac[5],
+                peer.softap_mac[0], peer.softap_mac[1], peer.softap_mac[2],
+                peer.softap_mac[3], peer.softap_mac[4], peer.softap_mac[5]);
 
-            float dist = FtmManager::initiateSession(peer->softap_mac, MESH_CHANNEL, (uint8_t)(uint32_t)NvsConfigManager::ftmSamplesPerPair);
+            float dist = FtmManager::initiateSession(peer.softap_mac, MESH_CHANNEL, (uint8_t)(uint32_t)NvsConfigManager::ftmSamplesPerPair);
             if (dist >= 0) {
                 Serial.printf("SUCCESS: distance = %.1f cm (%.2f m)\n", dist, dist / 100.0f);
             } else {
@@ -716,11 +827,11 @@ static void cmd_ftm(const char* args) {
     if (!MeshConductor::isGateway()) {
         Serial.println("(Not gateway -- FTM ranging only runs on gateway)");
     } else if (PeerTable::peerCount() >= 2) {
-        PeerEntry* p = PeerTable::getEntryByIndex(1);
-        if (p) {
+        PeerEntry p;
+        if (PeerTable::readEntry(1, &p)) {
             Serial.printf("Slot 1 SoftAP: %02X:%02X:%02X:%02X:%02X:%02X flags=0x%02X\n",
-                p->softap_mac[0], p->softap_mac[1], p->softap_mac[2],
-                p->softap_mac[3], p->softap_mac[4], p->softap_mac[5], p->flags);
+                p.softap_mac[0], p.softap_mac[1], p.softap_mac[2],
+                p.softap_mac[3], p.softap_mac[4], p.softap_mac[5], p.flags);
         }
     } else {
         Serial.println("(Peer must have sent a heartbeat so its SoftAP MAC is in PeerTable)");
@@ -785,11 +896,13 @@ static void cmd_solve(const char* args) {
     uint8_t dim = PeerTable::getDimension();
     Serial.printf("Positions (%uD):\n", dim);
     for (uint8_t i = 0; i < n; i++) {
-        PeerEntry* e = PeerTable::getEntryByIndex(i);
-        if (e) {
+        PeerEntry e;
+        if (PeerTable::readEntry(i, &e)) {
+            float pos[3];
+            PeerTable::getPosition(i, pos);
             Serial.printf("  [%u] %02X:%02X  pos=(%.0f, %.0f, %.0f) cm  conf=%.2f\n",
-                i, e->mac[4], e->mac[5],
-                e->position[0], e->position[1], e->position[2], e->confidence);
+                i, e.mac[4], e.mac[5],
+                pos[0], pos[1], pos[2], PeerTable::getConfidence(i));
         }
     }
 }
@@ -824,6 +937,138 @@ static void cmd_status(const char* args) {
     }
 }
 
+// Resolve a peer slot to its STA MAC (PeerTable on the gateway, shadow elsewhere)
+static bool peerMacBySlot(uint8_t slot, uint8_t* mac) {
+    if (MeshConductor::isGateway()) {
+        PeerEntry e;
+        if (!PeerTable::readEntry(slot, &e) || (e.flags & PEER_STATUS_DEAD)) return false;
+        memcpy(mac, e.mac, 6);
+        return true;
+    }
+    if (slot >= MeshConductor::peerShadowCount()) return false;
+    const PeerSyncEntry* e = &MeshConductor::peerShadowEntries()[slot];
+    if (e->flags & PEER_STATUS_DEAD) return false;
+    memcpy(mac, e->mac, 6);
+    return true;
+}
+
+static void cmd_link(const char* args) {
+    if (!args || !*args) {
+        LinkStats::printStatus(Serial);
+        return;
+    }
+    if (strcasecmp(args, "json") == 0) {
+        LinkStats::printJson(Serial);
+        Serial.println();
+        return;
+    }
+    if (strcasecmp(args, "reset") == 0) {
+        LinkStats::reset();
+        Serial.println("Link stats cleared.");
+        return;
+    }
+    if (strncasecmp(args, "ping ", 5) == 0) {
+        if (!MeshConductor::isConnected()) {
+            Serial.println("Mesh not connected.");
+            return;
+        }
+        char target[8] = {0};
+        int n = 5;
+        sscanf(args + 5, "%7s %d", target, &n);
+        if (n < 1) n = 1;
+        if (n > 100) n = 100;
+        bool all = (strcmp(target, "*") == 0);
+        uint8_t count = MeshConductor::isGateway() ? PeerTable::peerCount()
+                                                   : MeshConductor::peerShadowCount();
+        uint8_t first = all ? 0 : (uint8_t)atoi(target);
+        uint8_t last = all ? count : first + 1;
+        uint8_t mac[6];
+        if (!all && !peerMacBySlot(first, mac)) {
+            Serial.printf("Peer slot %u not found or dead.\n", first);
+            return;
+        }
+        for (int k = 0; k < n; k++) {
+            for (uint8_t i = first; i < last; i++) {
+                if (peerMacBySlot(i, mac) && !MeshConductor::isSelf(mac)) LinkStats::ping(mac);
+            }
+            delay(100);
+        }
+        delay(500);   // let the last PONGs land
+        LinkStats::printStatus(Serial);
+        return;
+    }
+    Serial.println("Usage: link [ping <slot|*> [n]|json|reset]");
+}
+
+static void cmd_geo(const char* args) {
+    if (!args || !*args) {
+        GeoCache::printStatus(Serial);
+        return;
+    }
+    if (strcasecmp(args, "save") == 0) {
+        if (!MeshConductor::isGateway()) {
+            Serial.println("Not gateway -- only the gateway keeps geometry.");
+            return;
+        }
+        Serial.println(GeoCache::flush() ? "Geometry cache saved." : "Geometry cache write failed.");
+        return;
+    }
+    if (strcasecmp(args, "clear") == 0) {
+        GeoCache::clear();
+        Serial.println("Geometry cache deleted.");
+        return;
+    }
+    Serial.println("Usage: geo [save|clear]");
+}
+
+// Travel path quality on random layouts (20 m square): the old greedy walk
+// from node 0 vs TravelPath::optimise(), open and closed
+static void pathBench(uint8_t n, uint16_t layouts) {
+    if (n < 3 || n > MESH_MAX_NODES) n = MESH_MAX_NODES;
+    if (layouts == 0) layouts = 10;
+
+    uint16_t* cost = (uint16_t*)malloc((size_t)n * n * sizeof(uint16_t));
+    if (!cost) {
+        Serial.println("orch bench: out of memory");
+        return;
+    }
+    float x[MESH_MAX_NODES], y[MESH_MAX_NODES];
+    uint8_t order[MESH_MAX_NODES];
+
+    Serial.printf("orch bench: %u nodes, %u random layouts\n", n, layouts);
+    for (uint8_t loop = 0; loop < 2; loop++) {
+        uint64_t greedyCm = 0, optCm = 0, evals = 0;
+        uint32_t optUs = 0, worstUs = 0;
+        uint16_t budgetHits = 0;
+        for (uint16_t t = 0; t < layouts; t++) {
+            for (uint8_t i = 0; i < n; i++) {
+                x[i] = (float)(esp_random() % 2000);
+                y[i] = (float)(esp_random() % 2000);
+            }
+            for (uint8_t i = 0; i < n; i++)
+                for (uint8_t j = 0; j < n; j++)
+                    cost[i * n + j] = (uint16_t)lroundf(hypotf(x[i] - x[j], y[i] - y[j]));
+
+            greedyCm += TravelPath::greedy(cost, n, 0, loop, order);
+            uint32_t t0 = micros();
+            optCm += TravelPath::optimise(cost, n, loop, order, TRAVEL_PATH_BUDGET);
+            uint32_t us = micros() - t0;
+            optUs += us;
+            if (us > worstUs) worstUs = us;
+            evals += TravelPath::lastEvaluations();
+            if (TravelPath::lastHitBudget()) budgetHits++;
+        }
+        Serial.printf("  %s: greedy %lu cm, optimised %lu cm (%.1f%% shorter), "
+                      "%lu us avg / %lu us worst, %lu evals avg, %u on budget\n",
+            loop ? "loop" : "open",
+            (unsigned long)(greedyCm / layouts), (unsigned long)(optCm / layouts),
+            greedyCm ? 100.0f * (1.0f - (float)optCm / (float)greedyCm) : 0.0f,
+            (unsigned long)(optUs / layouts), (unsigned long)worstUs,
+            (unsigned long)(evals / layouts), budgetHits);
+    }
+    free(cost);
+}
+
 static void cmd_orch(const char* args) {
     if (!args || !*args) {
         Orchestrator::printStatus(Serial);
@@ -848,7 +1093,11 @@ static void cmd_orch(const char* args) {
         if (arg1) {
             if (strcasecmp(arg1, "axis") == 0) order = TRAVEL_AXIS;
             else if (strcasecmp(arg1, "random") == 0) order = TRAVEL_RANDOM;
+            else if (strcasecmp(arg1, "shortest") == 0) order = TRAVEL_SHORTEST;
+            else if (strcasecmp(arg1, "loop") == 0) order = TRAVEL_LOOP;
         }
+        Orchestrator::setTravelMetric((arg2 && strcasecmp(arg2, "pos") == 0)
+                                      ? PATH_METRIC_POSITIONS : PATH_METRIC_EDGES);
         Orchestrator::setTravelOrder(order);
         Orchestrator::setMode(ORCH_TRAVEL);
     }
@@ -859,6 +1108,13 @@ static void cmd_orch(const char* args) {
         }
         Orchestrator::setMode(ORCH_RANDOM);
     }
+    else if (strcasecmp(sub, "pan") == 0) {
+        if (!MeshConductor::isGateway()) {
+            Serial.println("Not gateway — pan mode only runs on gateway");
+            return;
+        }
+        Orchestrator::setMode(ORCH_PAN);
+    }
     else if (strcasecmp(sub, "seq") == 0) {
         if (!arg1) {
             Serial.println("Usage: orch seq list|add|clear|save|load|play");
@@ -920,6 +1176,7 @@ static void cmd_orch(const char* args) {
                 if (strcasecmp(arg2, "travel") == 0)   mode = ORCH_TRAVEL;
                 else if (strcasecmp(arg2, "random") == 0)  mode = ORCH_RANDOM;
                 else if (strcasecmp(arg2, "seq") == 0)     mode = ORCH_SEQUENCE;
+                else if (strcasecmp(arg2, "pan") == 0)     mode = ORCH_PAN;
             }
             Orchestrator::scheduleRelative(delayMs, mode);
         }
@@ -930,8 +1187,52 @@ static void cmd_orch(const char* args) {
     else if (strcasecmp(sub, "status") == 0) {
         Orchestrator::printStatus(Serial);
     }
+    else if (strcasecmp(sub, "play") == 0) {
+        if (!arg1 || !arg2) {
+            Serial.println("Usage: orch play <node> <tone> [gain 0-255]");
+            return;
+        }
+        uint8_t node = atoi(arg1);
+        uint8_t tone = atoi(arg2);
+        uint8_t gain = arg3 ? (uint8_t)atoi(arg3) : 255;
+        esp_err_t err = Orchestrator::playOnNode(node, tone, gain);
+        if (err == ESP_OK) {
+            Serial.printf("Tone %u on node %u (gain %u) in %u ms\n", tone, node, gain, ORCH_PLAY_LEAD_MS);
+        } else {
+            Serial.printf("Play failed: %s\n", err == ESP_ERR_NOT_FOUND ? "no such live node"
+                          : err == ESP_ERR_INVALID_ARG ? "no such tone" : "reliable channel busy");
+        }
+    }
+    else if (strcasecmp(sub, "listener") == 0) {
+        if (!arg1) {
+            Serial.println("Usage: orch listener off|centroid|<x> <y> [z]  (cm, map frame)");
+            return;
+        }
+        if (strcasecmp(arg1, "off") == 0) {
+            Orchestrator::setListener(LISTENER_OFF);
+        } else if (strcasecmp(arg1, "centroid") == 0) {
+            Orchestrator::setListener(LISTENER_CENTROID);
+        } else if (arg2) {
+            Orchestrator::setListener(LISTENER_POINT, atof(arg1), atof(arg2), arg3 ? atof(arg3) : 0.0f);
+        } else {
+            Serial.println("Usage: orch listener off|centroid|<x> <y> [z]  (cm, map frame)");
+            return;
+        }
+        Serial.printf("Listener: %s\n", arg1);
+    }
+    else if (strcasecmp(sub, "align") == 0) {
+        if (!arg1) {
+            Serial.println("Usage: orch align <percent>  (100 = arrive together, 0 = none)");
+            return;
+        }
+        Orchestrator::setAlignment((int16_t)atoi(arg1));
+        Serial.printf("Alignment: %d%%\n", atoi(arg1));
+    }
+    else if (strcasecmp(sub, "bench") == 0) {
+        pathBench(arg1 ? (uint8_t)atoi(arg1) : 0, arg2 ? (uint16_t)atoi(arg2) : 0);
+    }
     else {
-        Serial.println("Usage: orch travel|random|seq|sched|stop|status");
+        Serial.println("Usage: orch travel [nearest|axis|random|shortest|loop] [pos]|random|pan|play|seq|sched|listener|align|stop|status|bench [n] [layouts]");
     }
 }
 
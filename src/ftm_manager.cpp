@@ -28,6 +28,16 @@ static bool     s_initialized       = false;
 static uint8_t  s_currentResponder[6] = {};
 static uint8_t  s_ownMac[6]           = {};
 
+// FTM_GO arrives on the mesh dispatch task (or its loopback) with the
+// dispatch lock held; a session blocks for up to ftmPairTimeout_ms, so
+// the ranging itself runs on a task of its own.
+struct FtmGoRequest {
+    uint8_t target_ap[6];
+    uint8_t responder[6];   // STA MAC, for the result
+    uint8_t samples;
+};
+static QueueHandle_t s_goQueue = nullptr;
+
 // --- FTM event handler ---
 
 static void ftmEventHandler(void* arg, esp_event_base_t event_base,
@@ -117,12 +127,46 @@ static void ftmEventHandler(void* arg, esp_event_base_t event_base,
     }
 }
 
+// Reply to the logical gateway (loops back when that is us); the ESP-IDF
+// root only as long as no gateway is known
+static void sendToGateway(const void* data, uint16_t len) {
+    static const uint8_t zero[6] = {0};
+    const uint8_t* gw = MeshConductor::gatewayMac();
+    if (memcmp(gw, zero, 6) != 0) {
+        MeshConductor::sendToNode(gw, data, len);
+    } else {
+        MeshConductor::sendToRoot(data, len);
+    }
+}
+
+static void goTask(void* pvParameters) {
+    (void)pvParameters;
+    FtmGoRequest req;
+    for (;;) {
+        if (xQueueReceive(s_goQueue, &req, portMAX_DELAY) != pdTRUE) continue;
+
+        float dist = FtmManager::initiateSession(req.target_ap, MESH_CHANNEL, req.samples);
+
+        // Send result back to gateway
+        FtmResultMsg result;
+        result.type = MSG_TYPE_FTM_RESULT;
+        memcpy(result.initiator, s_ownMac, 6);
+        memcpy(result.responder, req.responder, 6);
+        result.distance_cm = dist;
+        result.status = (dist >= 0) ? 0 : 1;  // 0=ok, 1=timeout
+
+        sendToGateway(&result, sizeof(result));
+    }
+}
+
 // --- Public API ---
 
 void FtmManager::init() {
     if (!s_initialized) {
         s_ftmSem = xSemaphoreCreateBinary();
-        esp_read_mac(s_ownMac, ESP_MAC_WIFI_STA);
+        s_goQueue = xQueueCreate(1, sizeof(FtmGoRequest));
+        xTaskCreate(goTask, "ftmGo", 4096, nullptr, tskIDLE_PRIORITY + 2, nullptr);
+        memcpy(s_ownMac, MeshConductor::staMac(), 6);
         esp_event_handler_register(WIFI_EVENT, WIFI_EVENT_FTM_REPORT,
                                    &ftmEventHandler, NULL);
         s_initialized = true;
@@ -206,25 +250,23 @@ void FtmManager::onFtmWake(const uint8_t* initiator_mac, const uint8_t* responde
     FtmReadyMsg ready;
     ready.type = MSG_TYPE_FTM_READY;
     memcpy(ready.mac, s_ownMac, 6);
-    MeshConductor::sendToRoot(&ready, sizeof(ready));
+    sendToGateway(&ready, sizeof(ready));
 }
 
 void FtmManager::onFtmGo(const uint8_t* target_ap_mac, uint8_t samples) {
     SqLog.printf("[ftm] GO received — ranging to %02X:%02X:%02X:%02X:%02X:%02X\n",
         target_ap_mac[0], target_ap_mac[1], target_ap_mac[2],
         target_ap_mac[3], target_ap_mac[4], target_ap_mac[5]);
-
-    float dist = initiateSession(target_ap_mac, MESH_CHANNEL, samples);
-
-    // Send result back to gateway
-    FtmResultMsg result;
-    result.type = MSG_TYPE_FTM_RESULT;
-    memcpy(result.initiator, s_ownMac, 6);
-    memcpy(result.responder, s_currentResponder, 6);  // STA MAC, not AP MAC
-    result.distance_cm = dist;
-    result.status = (dist >= 0) ? 0 : 1;  // 0=ok, 1=timeout
-
-    MeshConductor::sendToRoot(&result, sizeof(result));
+    if (!s_goQueue) return;
+
+    FtmGoRequest req;
+    memcpy(req.target_ap, target_ap_mac, 6);
+    memcpy(req.responder, s_currentResponder, 6);
+    req.samples = samples;
+    // One pair at a time: a GO while a session is queued is a duplicate,
+    // and the scheduler times the pair out if it was not
+    if (xQueueSend(s_goQueue, &req, 0) != pdTRUE)
+        SqLog.println("[ftm] GO dropped: session already pending");
 }
 
 bool FtmManager::isBusy() {
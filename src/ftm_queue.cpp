@@ -0,0 +1,52 @@
+#include "ftm_queue.h"
+#include <string.h>
+
+void FtmQueue::clear() {
+    memset(_queued, 0, sizeof(_queued));
+    for (uint8_t p = 0; p < FTM_PRIO_COUNT; p++)
+        _head[p] = _tail[p] = NONE;
+    _count = 0;
+}
+
+const FtmQueueItem* FtmQueue::find(uint16_t edge) const {
+    if (edge >= CAPACITY || !queued(edge)) return nullptr;
+    return &_items[edge];
+}
+
+bool FtmQueue::push(uint16_t edge, const FtmQueueItem& item) {
+    if (edge >= CAPACITY || item.priority >= FTM_PRIO_COUNT) return false;
+    if (queued(edge)) unlink(edge);
+
+    uint8_t p = item.priority;
+    _items[edge] = item;
+    _next[edge] = NONE;
+    _prev[edge] = _tail[p];
+    if (_tail[p] != NONE) _next[_tail[p]] = edge;
+    else                  _head[p] = edge;
+    _tail[p] = edge;
+    _queued[edge >> 3] |= (uint8_t)(1u << (edge & 7));
+    _count++;
+    return true;
+}
+
+bool FtmQueue::pop(FtmQueueItem* out, uint16_t* edge) {
+    for (uint8_t p = 0; p < FTM_PRIO_COUNT; p++) {
+        uint16_t e = _head[p];
+        if (e == NONE) continue;
+        *out = _items[e];
+        *edge = e;
+        unlink(e);
+        return true;
+    }
+    return false;
+}
+
+void FtmQueue::unlink(uint16_t edge) {
+    uint8_t p = _items[edge].priority;
+    if (_prev[edge] != NONE) _next[_prev[edge]] = _next[edge];
+    else                     _head[p] = _next[edge];
+    if (_next[edge] != NONE) _prev[_next[edge]] = _prev[edge];
+    else                     _tail[p] = _prev[edge];
+    _queued[edge >> 3] &= (uint8_t)~(1u << (edge & 7));
+    _count--;
+}
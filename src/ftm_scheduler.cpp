@@ -1,25 +1,25 @@
 #include "ftm_scheduler.h"
 #include "peer_table.h"
+#include "mesh_footprint.h"
 #include "mesh_conductor.h"
 #include "ftm_manager.h"
+#include "link_stats.h"
+#include "orchestrator.h"
 #include "position_solver.h"
+#include "geo_cache.h"
 #include "nvs_config.h"
 #include "bsp.hpp"
 #include "sq_log.h"
 #include <Arduino.h>
 #include <esp_mac.h>
 #include <string.h>
+#include <math.h>
 
 static const char* TAG = "ftmsched";
 
 // --- File-scope state ---
 
-#define FTM_QUEUE_MAX  ((MESH_MAX_NODES * (MESH_MAX_NODES - 1)) / 2)
-
-static FtmQueueItem   s_queue[FTM_QUEUE_MAX];
-static uint8_t        s_queueHead = 0;
-static uint8_t        s_queueTail = 0;
-static uint8_t        s_queueCount = 0;
+static FtmQueue       s_queue;   // pending pairs, one slot per edge
 
 static FtmPairState   s_pairState = FTM_PAIR_IDLE;
 static uint8_t        s_currentA = 0;
@@ -33,112 +33,81 @@ static TimerHandle_t  s_sweepTimer   = nullptr;
 static bool           s_active       = false;
 
 // Edge staleness tracking: timestamp of last measurement per pair
-static uint32_t       s_lastMeasured[MESH_MAX_NODES][MESH_MAX_NODES];
-
-// --- Queue helpers ---
-
-static bool queuePush(const FtmQueueItem& item) {
-    if (s_queueCount >= FTM_QUEUE_MAX) return false;
-
-    // Insert sorted by priority (lower = higher priority)
-    // Simple insertion into array — fine for 120 max items
-    uint8_t insertAt = s_queueCount;
-    for (uint8_t i = 0; i < s_queueCount; i++) {
-        uint8_t idx = (s_queueHead + i) % FTM_QUEUE_MAX;
-        if (item.priority < s_queue[idx].priority) {
-            insertAt = i;
-            break;
-        }
-    }
-
-    // Shift items to make room
-    for (uint8_t i = s_queueCount; i > insertAt; i--) {
-        uint8_t dst = (s_queueHead + i) % FTM_QUEUE_MAX;
-        uint8_t src = (s_queueHead + i - 1) % FTM_QUEUE_MAX;
-        s_queue[dst] = s_queue[src];
-    }
-    uint8_t pos = (s_queueHead + insertAt) % FTM_QUEUE_MAX;
-    s_queue[pos] = item;
-    s_queueCount++;
-    return true;
-}
+// (packed triangular, indexed by PeerTable::edgeIndex)
+static uint32_t       s_lastMeasured[PEER_EDGE_COUNT];
+static_assert(sizeof(s_lastMeasured) == FOOTPRINT_EDGE_AGES, "mesh_footprint.h: edge ages");
 
-static bool queuePop(FtmQueueItem* out) {
-    if (s_queueCount == 0) return false;
-    *out = s_queue[s_queueHead];
-    s_queueHead = (s_queueHead + 1) % FTM_QUEUE_MAX;
-    s_queueCount--;
-    return true;
-}
+// Last POS_UPDATE contents, for delta encoding
+static PosUpdateEntry s_posSent[MESH_MAX_NODES];
+static uint8_t        s_posSentCount = 0;
+static uint8_t        s_posSentDim   = 0;
+static uint8_t        s_posSinceFull = 0;
 
-static bool isDuplicatePair(uint8_t a, uint8_t b) {
-    for (uint8_t i = 0; i < s_queueCount; i++) {
-        uint8_t idx = (s_queueHead + i) % FTM_QUEUE_MAX;
-        if ((s_queue[idx].nodeA_idx == a && s_queue[idx].nodeB_idx == b) ||
-            (s_queue[idx].nodeA_idx == b && s_queue[idx].nodeB_idx == a)) {
-            return true;
-        }
-    }
-    return false;
-}
+// Slots PeerTable recycled, not yet forgotten here. Set on the recycling
+// (RX) task, drained on the timer task that owns the state above.
+static volatile bool  s_recyclePending[MESH_MAX_NODES];
 
 // --- Pair state machine ---
 
 static void startNextPair();
 
 static void sendWakeMessages(uint8_t idxA, uint8_t idxB) {
-    PeerEntry* entA = PeerTable::getEntryByIndex(idxA);
-    PeerEntry* entB = PeerTable::getEntryByIndex(idxB);
-    if (!entA || !entB) return;
+    PeerEntry entA, entB;
+    if (!PeerTable::readEntry(idxA, &entA) || !PeerTable::readEntry(idxB, &entB)) return;
 
     FtmWakeMsg wake;
     wake.type = MSG_TYPE_FTM_WAKE;
-    memcpy(wake.initiator, entA->mac, 6);
-    memcpy(wake.responder, entB->mac, 6);
-    memcpy(wake.responder_ap, entB->softap_mac, 6);
-
-    // Send to both nodes (or handle locally if one is gateway)
-    uint8_t own_mac[6];
-    esp_read_mac(own_mac, ESP_MAC_WIFI_STA);
-
-    if (memcmp(entA->mac, own_mac, 6) == 0) {
-        // Gateway is initiator — mark self as ready
-        s_readyA = true;
-    } else {
-        MeshConductor::sendToNode(entA->mac, &wake, sizeof(wake));
-    }
-
-    if (memcmp(entB->mac, own_mac, 6) == 0) {
-        // Gateway is responder — mark self as ready (passive)
-        s_readyB = true;
-    } else {
-        MeshConductor::sendToNode(entB->mac, &wake, sizeof(wake));
-    }
+    memcpy(wake.initiator, entA.mac, 6);
+    memcpy(wake.responder, entB.mac, 6);
+    memcpy(wake.responder_ap, entB.softap_mac, 6);
+
+    // Send to both nodes; if one is the gateway it loops back and answers
+    // FTM_READY through the same handlers as a peer would
+    MeshConductor::sendToNode(entA.mac, &wake, sizeof(wake));
+    MeshConductor::sendToNode(entB.mac, &wake, sizeof(wake));
 }
 
 static void sendGoMessage(uint8_t initiatorIdx, const uint8_t* responder_ap_mac) {
-    PeerEntry* initiator = PeerTable::getEntryByIndex(initiatorIdx);
-    if (!initiator) return;
+    PeerEntry initiator;
+    if (!PeerTable::readEntry(initiatorIdx, &initiator)) return;
 
     FtmGoMsg go;
     go.type = MSG_TYPE_FTM_GO;
     memcpy(go.target_ap, responder_ap_mac, 6);
     go.samples = (uint8_t)(uint32_t)NvsConfigManager::ftmSamplesPerPair;
 
-    uint8_t own_mac[6];
-    esp_read_mac(own_mac, ESP_MAC_WIFI_STA);
+    // Gateway as initiator: looped back like any GO; FtmManager ranges on
+    // its own task, not the dispatch task
+    MeshConductor::sendToNode(initiator.mac, &go, sizeof(go));
+}
 
-    if (memcmp(initiator->mac, own_mac, 6) == 0) {
-        // Gateway is the initiator — invoke FTM directly
-        FtmManager::onFtmGo(go.target_ap, go.samples);
-    } else {
-        MeshConductor::sendToNode(initiator->mac, &go, sizeof(go));
+// Forget recycled slots: their edge ages, a pair in progress on them and
+// the receivers' position shadow. Timer task only.
+static void drainRecycled() {
+    for (uint8_t idx = 0; idx < MESH_MAX_NODES; idx++) {
+        if (!s_recyclePending[idx]) continue;
+        s_recyclePending[idx] = false;
+        for (uint8_t j = 0; j < MESH_MAX_NODES; j++) {
+            if (j != idx) s_lastMeasured[PeerTable::edgeIndex(idx, j)] = 0;
+        }
+        if (s_pairState != FTM_PAIR_IDLE && (s_currentA == idx || s_currentB == idx)) {
+            SqLog.printf("[ftmsched] Pair (%u,%u) aborted: slot %u recycled\n",
+                s_currentA, s_currentB, idx);
+            s_pairState = FTM_PAIR_IDLE;
+        }
+        s_posSentCount = 0;   // receivers' s_posShadow[idx] still holds the old node
     }
 }
 
+static void recyclePend(void* p1, uint32_t p2) {
+    (void)p1; (void)p2;
+    drainRecycled();
+}
+
 static void processTimerCb(TimerHandle_t t) {
     (void)t;
 
+    drainRecycled();   // in case the pended drain did not fit the timer queue
     uint32_t timeout = (uint32_t)NvsConfigManager::ftmPairTimeout_ms;
 
     switch (s_pairState) {
@@ -149,10 +118,10 @@ static void processTimerCb(TimerHandle_t t) {
     case FTM_PAIR_WAITING_READY:
         if (s_readyA && s_readyB) {
             // Both ready — send GO to initiator
-            PeerEntry* responder = PeerTable::getEntryByIndex(s_currentB);
-            if (responder) {
+            PeerEntry responder;
+            if (PeerTable::readEntry(s_currentB, &responder)) {
                 s_pairState = FTM_PAIR_GO_SENT;
-                sendGoMessage(s_currentA, responder->softap_mac);
+                sendGoMessage(s_currentA, responder.softap_mac);
                 s_pairState = FTM_PAIR_WAITING_RESULT;
             }
         } else if ((millis() - s_pairStartMs) > timeout) {
@@ -177,15 +146,29 @@ static void processTimerCb(TimerHandle_t t) {
 
 static void startNextPair() {
     FtmQueueItem item;
-    while (queuePop(&item)) {
-        // Verify both peers are still alive
-        PeerEntry* a = PeerTable::getEntryByIndex(item.nodeA_idx);
-        PeerEntry* b = PeerTable::getEntryByIndex(item.nodeB_idx);
-        if (!a || !b) continue;
-        if ((a->flags & PEER_STATUS_DEAD) || (b->flags & PEER_STATUS_DEAD)) continue;
-
-        s_currentA = item.nodeA_idx;
-        s_currentB = item.nodeB_idx;
+    uint16_t edge;
+    while (s_queue.pop(&item, &edge)) {
+        uint8_t lo, hi;
+        PeerTable::edgeNodes(edge, &lo, &hi);
+        // Same occupants as when queued, and both still alive
+        if (!PeerTable::isCurrent(lo, item.genLo) || !PeerTable::isCurrent(hi, item.genHi)) continue;
+        bool swapped = item.flags & FTM_ITEM_SWAPPED;
+        uint8_t nodeA = swapped ? hi : lo;
+        uint8_t nodeB = swapped ? lo : hi;
+        PeerEntry a, b;
+        if (!PeerTable::readEntry(nodeA, &a) || !PeerTable::readEntry(nodeB, &b)) continue;
+        if ((a.flags & PEER_STATUS_DEAD) || (b.flags & PEER_STATUS_DEAD)) continue;
+        // During playback, keep WAKE/GO/RESULT off links that are already
+        // struggling; the edge stays stale and the next sweep re-queues it
+        if (Orchestrator::getMode() != ORCH_OFF &&
+            (LinkStats::isPoor(a.mac) || LinkStats::isPoor(b.mac))) {
+            SqLog.printf("[ftmsched] Deferring pair (%u,%u): poor link during playback\n",
+                nodeA, nodeB);
+            continue;
+        }
+
+        s_currentA = nodeA;
+        s_currentB = nodeB;
         s_readyA = false;
         s_readyB = false;
         s_pairStartMs = millis();
@@ -216,7 +199,7 @@ static void sweepTimerCb(TimerHandle_t t) {
 
     for (uint8_t i = 0; i < count; i++) {
         for (uint8_t j = i + 1; j < count; j++) {
-            uint32_t age_ms = now - s_lastMeasured[i][j];
+            uint32_t age_ms = now - s_lastMeasured[PeerTable::edgeIndex(i, j)];
             if (age_ms > stale_s * 1000) {
                 FtmScheduler::enqueuePair(i, j, FTM_PRIO_STALE);
             }
@@ -234,12 +217,13 @@ static void sweepTimerCb(TimerHandle_t t) {
 // --- Public API ---
 
 void FtmScheduler::init() {
-    s_queueHead = 0;
-    s_queueTail = 0;
-    s_queueCount = 0;
+    s_queue.clear();
     s_pairState = FTM_PAIR_IDLE;
     s_active = false;
     memset(s_lastMeasured, 0, sizeof(s_lastMeasured));
+    for (uint8_t i = 0; i < MESH_MAX_NODES; i++)
+        s_recyclePending[i] = false;
+    s_posSentCount = 0;   // first broadcast after (re)init is a full snapshot
 
     // Process timer: checks pair state machine every 500ms
     if (s_processTimer == nullptr) {
@@ -258,29 +242,42 @@ void FtmScheduler::init() {
         xTimerStart(s_sweepTimer, 0);
     }
 
-    SqLog.println("[ftmsched] Initialized");
+    SqLog.printf("[ftmsched] Initialized (queue %u B, edge ages %u B)\n",
+        (unsigned)sizeof(s_queue), (unsigned)sizeof(s_lastMeasured));
 }
 
 void FtmScheduler::shutdown() {
     if (s_processTimer) xTimerStop(s_processTimer, 0);
     if (s_sweepTimer) xTimerStop(s_sweepTimer, 0);
     s_active = false;
-    s_queueCount = 0;
+    s_queue.clear();
     s_pairState = FTM_PAIR_IDLE;
     SqLog.println("[ftmsched] Shutdown");
 }
 
 void FtmScheduler::enqueuePair(uint8_t nodeA_idx, uint8_t nodeB_idx, FtmPriority prio) {
     if (nodeA_idx == nodeB_idx) return;
-    if (isDuplicatePair(nodeA_idx, nodeB_idx)) return;
+
+    // One entry per edge, either direction. A live entry only moves up to
+    // a more urgent priority; one aimed at a recycled slot's old occupant
+    // is replaced.
+    uint16_t edge = PeerTable::edgeIndex(nodeA_idx, nodeB_idx);
+    bool swapped = nodeA_idx > nodeB_idx;
+    uint8_t lo = swapped ? nodeB_idx : nodeA_idx;
+    uint8_t hi = swapped ? nodeA_idx : nodeB_idx;
+    const FtmQueueItem* q = s_queue.find(edge);
+    if (q && q->priority <= prio &&
+        PeerTable::isCurrent(lo, q->genLo) && PeerTable::isCurrent(hi, q->genHi))
+        return;
 
     FtmQueueItem item;
-    item.nodeA_idx = nodeA_idx;
-    item.nodeB_idx = nodeB_idx;
-    item.priority = prio;
     item.queued_ms = millis();
+    item.genLo = PeerTable::generation(lo);
+    item.genHi = PeerTable::generation(hi);
+    item.priority = prio;
+    item.flags = swapped ? FTM_ITEM_SWAPPED : 0;
 
-    if (queuePush(item)) {
+    if (s_queue.push(edge, item)) {
         s_active = true;
     }
 }
@@ -304,8 +301,8 @@ void FtmScheduler::enqueueNewNode(uint8_t node_idx) {
 
     for (uint8_t i = 0; i < count && queued < anchors; i++) {
         if (i == node_idx) continue;
-        PeerEntry* e = PeerTable::getEntryByIndex(i);
-        if (!e || (e->flags & PEER_STATUS_DEAD)) continue;
+        PeerEntry e;
+        if (!PeerTable::readEntry(i, &e) || (e.flags & PEER_STATUS_DEAD)) continue;
         enqueuePair(node_idx, i, FTM_PRIO_NEW_NODE);
         queued++;
     }
@@ -316,27 +313,23 @@ void FtmScheduler::enqueueNewNode(uint8_t node_idx) {
 void FtmScheduler::onFtmReady(const uint8_t* mac) {
     if (s_pairState != FTM_PAIR_WAITING_READY) return;
 
-    PeerEntry* a = PeerTable::getEntryByIndex(s_currentA);
-    PeerEntry* b = PeerTable::getEntryByIndex(s_currentB);
-    if (!a || !b) return;
+    PeerEntry a, b;
+    if (!PeerTable::readEntry(s_currentA, &a) || !PeerTable::readEntry(s_currentB, &b)) return;
 
-    if (memcmp(mac, a->mac, 6) == 0) {
+    if (memcmp(mac, a.mac, 6) == 0) {
         s_readyA = true;
         SqLog.printf("[ftmsched] Node A (slot %u) ready\n", s_currentA);
     }
-    if (memcmp(mac, b->mac, 6) == 0) {
+    if (memcmp(mac, b.mac, 6) == 0) {
         s_readyB = true;
         SqLog.printf("[ftmsched] Node B (slot %u) ready\n", s_currentB);
     }
 
     // Check if both ready — immediate transition
     if (s_readyA && s_readyB) {
-        PeerEntry* responder = PeerTable::getEntryByIndex(s_currentB);
-        if (responder) {
-            s_pairState = FTM_PAIR_GO_SENT;
-            sendGoMessage(s_currentA, responder->softap_mac);
-            s_pairState = FTM_PAIR_WAITING_RESULT;
-        }
+        s_pairState = FTM_PAIR_GO_SENT;
+        sendGoMessage(s_currentA, b.softap_mac);
+        s_pairState = FTM_PAIR_WAITING_RESULT;
     }
 }
 
@@ -350,8 +343,8 @@ void FtmScheduler::onFtmResult(const uint8_t* initiator, const uint8_t* responde
     if (status == 0 && distance_cm >= 0) {
         // Store distance in peer table
         PeerTable::setDistance(s_currentA, s_currentB, distance_cm);
-        s_lastMeasured[s_currentA][s_currentB] = millis();
-        s_lastMeasured[s_currentB][s_currentA] = millis();
+        s_lastMeasured[PeerTable::edgeIndex(s_currentA, s_currentB)] = millis();
+        GeoCache::markDirty();
 
         SqLog.printf("[ftmsched] Pair (%u,%u) distance=%.1f cm\n",
             s_currentA, s_currentB, distance_cm);
@@ -366,52 +359,108 @@ void FtmScheduler::onFtmResult(const uint8_t* initiator, const uint8_t* responde
 
 void FtmScheduler::triggerSolve() {
     PositionSolver::solve();
+    GeoCache::markDirty();
+}
+
+static int16_t quantizeCm(float v) {
+    if (v >  32767.0f) return  32767;
+    if (v < -32767.0f) return -32767;
+    return (int16_t)lroundf(v);
 }
 
 void FtmScheduler::broadcastPositions() {
     uint8_t count = PeerTable::peerCount();
     uint8_t dim = PeerTable::getDimension();
 
-    // Build position update message
-    uint16_t msgSize = sizeof(PosUpdateMsg) + count * sizeof(PosUpdateEntry);
-    uint8_t buf[sizeof(PosUpdateMsg) + MESH_MAX_NODES * sizeof(PosUpdateEntry)];
+    // Full snapshot on membership/dimension change and every
+    // MESH_POS_FULL_EVERY broadcasts (heals lost deltas); otherwise only
+    // entries whose quantized value moved are sent.
+    bool full = (count != s_posSentCount) || (dim != s_posSentDim) ||
+                (++s_posSinceFull >= MESH_POS_FULL_EVERY);
+
+    static uint8_t buf[sizeof(PosUpdateMsg) + MESH_MAX_NODES * sizeof(PosUpdateEntry)];
 
     PosUpdateMsg* msg = (PosUpdateMsg*)buf;
     msg->type = MSG_TYPE_POS_UPDATE;
+    msg->version = MESH_WIRE_VERSION;
     msg->dimension = dim;
-    msg->count = count;
+    msg->sync_flags = full ? SYNC_FLAG_FULL : 0;
 
     PosUpdateEntry* entries = (PosUpdateEntry*)(buf + sizeof(PosUpdateMsg));
+    uint8_t n = 0;
     for (uint8_t i = 0; i < count; i++) {
-        PeerEntry* e = PeerTable::getEntryByIndex(i);
-        if (e) {
-            memcpy(entries[i].mac, e->mac, 6);
-            entries[i].x = e->position[0];
-            entries[i].y = e->position[1];
-            entries[i].z = e->position[2];
-            entries[i].confidence = e->confidence;
-        }
+        float pos[3];
+        PeerTable::getPosition(i, pos);
+        float conf = PeerTable::getConfidence(i);
+
+        PosUpdateEntry q;
+        q.short_id = i;
+        q.x = quantizeCm(pos[0]);
+        q.y = quantizeCm(pos[1]);
+        q.z = quantizeCm(pos[2]);
+        q.confidence = (conf <= 0.0f) ? 0 : (conf >= 1.0f) ? 255 : (uint8_t)(conf * 255.0f + 0.5f);
+
+        if (!full && memcmp(&q, &s_posSent[i], sizeof(q)) == 0) continue;
+        s_posSent[i] = q;
+        entries[n++] = q;
     }
 
+    s_posSentCount = count;
+    s_posSentDim = dim;
+    if (full) s_posSinceFull = 0;
+
+    if (n == 0) {
+        SqLog.println("[ftmsched] Positions unchanged, nothing to broadcast");
+        return;
+    }
+    msg->count = n;
+
+    uint16_t msgSize = sizeof(PosUpdateMsg) + n * sizeof(PosUpdateEntry);
     MeshConductor::broadcastToAll(buf, msgSize);
-    SqLog.printf("[ftmsched] Broadcast %u positions (%uD)\n", count, dim);
+    SqLog.printf("[ftmsched] Broadcast %u/%u positions (%uD, %s, %u B)\n",
+        n, count, dim, full ? "full" : "delta", msgSize);
 }
 
 bool FtmScheduler::isActive() {
     return s_active || s_pairState != FTM_PAIR_IDLE;
 }
 
+uint16_t FtmScheduler::edgeAge_s(uint16_t edge) {
+    if (edge >= PEER_EDGE_COUNT || s_lastMeasured[edge] == 0) return FTM_EDGE_AGE_UNKNOWN;
+    uint32_t age_s = (millis() - s_lastMeasured[edge]) / 1000;
+    return (age_s < FTM_EDGE_AGE_UNKNOWN) ? (uint16_t)age_s : FTM_EDGE_AGE_UNKNOWN - 1;
+}
+
+void FtmScheduler::setEdgeAge(uint16_t edge, uint16_t age_s) {
+    if (edge >= PEER_EDGE_COUNT) return;
+    if (age_s == FTM_EDGE_AGE_UNKNOWN) {
+        s_lastMeasured[edge] = 0;
+        return;
+    }
+    s_lastMeasured[edge] = (millis() - (uint32_t)age_s * 1000u) | 1u;   // 0 = never
+}
+
+void FtmScheduler::onSlotRecycled(uint8_t idx) {
+    if (idx >= MESH_MAX_NODES) return;
+    // Called under the PeerTable write lock on the RX task: never block
+    // here, and leave the scheduler's own state to the timer task
+    s_recyclePending[idx] = true;
+    xTimerPendFunctionCall(recyclePend, nullptr, 0, 0);
+}
+
 void FtmScheduler::print() {
     SqLog.println("=== FTM Scheduler ===");
     SqLog.printf("Queue: %u items, State: %u, Active: %s\n",
-        s_queueCount, s_pairState, s_active ? "yes" : "no");
+        s_queue.size(), s_pairState, s_active ? "yes" : "no");
     if (s_pairState != FTM_PAIR_IDLE) {
         SqLog.printf("Current pair: (%u,%u) readyA=%d readyB=%d\n",
             s_currentA, s_currentB, s_readyA, s_readyB);
     }
-    for (uint8_t i = 0; i < s_queueCount; i++) {
-        uint8_t idx = (s_queueHead + i) % FTM_QUEUE_MAX;
-        SqLog.printf("  [%u] pair=(%u,%u) prio=%u\n",
-            i, s_queue[idx].nodeA_idx, s_queue[idx].nodeB_idx, s_queue[idx].priority);
-    }
+    uint16_t i = 0;
+    s_queue.forEach([&i](uint16_t edge, const FtmQueueItem& q) {
+        uint8_t a, b;
+        PeerTable::edgeNodes(edge, &a, &b);
+        if (q.flags & FTM_ITEM_SWAPPED) { uint8_t t = a; a = b; b = t; }
+        SqLog.printf("  [%u] pair=(%u,%u) prio=%u\n", i++, a, b, q.priority);
+    });
 }
@@ -0,0 +1,315 @@
+#include "geo_cache.h"
+#include "peer_table.h"
+#include "ftm_scheduler.h"
+#include "mesh_conductor.h"
+#include "storage_manager.h"
+#include "nvs_config.h"
+#include "bsp.hpp"
+#include "sq_log.h"
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <esp_attr.h>
+#include <esp_random.h>
+#include <string.h>
+#include <time.h>
+
+static const char* TAG = "geocache";
+
+// --- File format ---
+//
+// GeoFileHeader, node_count × GeoFileNode, edge_count × GeoFileEdge.
+// Edge endpoints are positions in the node list (file-local), so a load
+// maps them to whatever slots the MACs have now.
+
+#define GEO_CACHE_MAGIC    0x43475153u   // "SQGC"
+#define GEO_CACHE_VERSION  2
+
+static const char* GEO_PATH     = "/geo.bin";
+static const char* GEO_PATH_TMP = "/geo.tmp";
+
+struct __attribute__((packed)) GeoFileHeader {
+    uint32_t magic;
+    uint8_t  version;
+    uint8_t  node_count;
+    uint16_t edge_count;
+    uint32_t saved_at;       // time(): advances across deep sleep and soft reset
+    uint32_t clock_id;       // rtcClockId() at save time
+};
+
+struct __attribute__((packed)) GeoFileNode {
+    uint8_t mac[6];
+    uint8_t softap_mac[6];
+    float   pos[3];
+    float   confidence;
+};
+// 28 bytes per node
+
+struct __attribute__((packed)) GeoFileEdge {
+    uint8_t  a, b;           // indices into the node list
+    uint16_t distance_cm;
+    uint8_t  quality;
+    uint16_t age_s;          // FtmScheduler::edgeAge_s() at save time
+};
+// 7 bytes per edge
+
+// --- File-scope state ---
+
+static bool              s_enabled  = false;   // gateway role active
+static volatile bool     s_dirty    = false;
+static TaskHandle_t      s_task     = nullptr;
+static SemaphoreHandle_t s_fileMutex = nullptr;
+
+static uint32_t s_writes      = 0;
+static uint32_t s_lastWriteMs = 0;
+static uint16_t s_lastBytes   = 0;
+static uint8_t  s_loadedNodes = 0;
+static uint16_t s_loadedEdges = 0;
+
+// Save scratch (static: far too large for the writer's stack)
+static PeerSnapshot s_snap;
+static GeoFileEdge  s_edgeBuf[32];
+
+// Identifies the run of boots time() has counted through. RTC no-init
+// memory survives soft reset and deep sleep, as the RTC timer behind
+// time() does; power loss scrambles both, and the check word with them.
+RTC_NOINIT_ATTR static uint32_t s_rtcClockId;
+RTC_NOINIT_ATTR static uint32_t s_rtcClockCheck;
+
+// --- Helpers ---
+
+static uint32_t rtcClockId() {
+    if (s_rtcClockCheck != ~s_rtcClockId) {
+        s_rtcClockId = esp_random();
+        s_rtcClockCheck = ~s_rtcClockId;
+    }
+    return s_rtcClockId;
+}
+
+static bool mountFs() {
+    return StorageManager::isReady() || StorageManager::init();
+}
+
+static bool writeFile() {
+    if (!mountFs()) return false;
+
+    PeerTable::snapshot(&s_snap);
+    uint8_t n = s_snap.count;
+
+    GeoFileHeader hdr;
+    hdr.magic = GEO_CACHE_MAGIC;
+    hdr.version = GEO_CACHE_VERSION;
+    hdr.node_count = n;
+    hdr.edge_count = 0;
+    hdr.saved_at = (uint32_t)time(nullptr);
+    hdr.clock_id = rtcClockId();
+    for (uint8_t i = 0; i < n; i++)
+        for (uint8_t j = i + 1; j < n; j++)
+            if (PeerTable::getEdge(PeerTable::edgeIndex(i, j)).distance_cm != PEER_DIST_UNKNOWN)
+                hdr.edge_count++;
+
+    File f = LittleFS.open(GEO_PATH_TMP, "w");
+    if (!f) {
+        SqLog.println("[geocache] Cannot open cache file for writing");
+        return false;
+    }
+    size_t bytes = f.write((const uint8_t*)&hdr, sizeof(hdr));
+
+    for (uint8_t i = 0; i < n; i++) {
+        GeoFileNode node;
+        memcpy(node.mac, s_snap.entries[i].mac, 6);
+        memcpy(node.softap_mac, s_snap.entries[i].softap_mac, 6);
+        memcpy(node.pos, s_snap.pos[i], sizeof(node.pos));
+        node.confidence = s_snap.confidence[i];
+        bytes += f.write((const uint8_t*)&node, sizeof(node));
+    }
+
+    // An edge measured after the count pass is left for the next write
+    uint16_t written = 0;
+    uint8_t fill = 0;
+    for (uint8_t i = 0; i < n && written < hdr.edge_count; i++) {
+        for (uint8_t j = i + 1; j < n && written < hdr.edge_count; j++) {
+            uint16_t e = PeerTable::edgeIndex(i, j);
+            PeerEdge pe = PeerTable::getEdge(e);
+            if (pe.distance_cm == PEER_DIST_UNKNOWN) continue;
+            GeoFileEdge& out = s_edgeBuf[fill++];
+            out.a = i;
+            out.b = j;
+            out.distance_cm = pe.distance_cm;
+            out.quality = pe.quality;
+            out.age_s = FtmScheduler::edgeAge_s(e);
+            written++;
+            if (fill == sizeof(s_edgeBuf) / sizeof(s_edgeBuf[0])) {
+                bytes += f.write((const uint8_t*)s_edgeBuf, fill * sizeof(GeoFileEdge));
+                fill = 0;
+            }
+        }
+    }
+    if (fill) bytes += f.write((const uint8_t*)s_edgeBuf, fill * sizeof(GeoFileEdge));
+    f.close();
+
+    size_t expected = sizeof(hdr) + n * sizeof(GeoFileNode) + written * sizeof(GeoFileEdge);
+    if (written != hdr.edge_count || bytes != expected) {
+        // Edges vanished mid-write (slot recycled): keep the previous file
+        SqLog.printf("[geocache] Write incomplete (%u/%u edges, %u B), retrying later\n",
+            written, hdr.edge_count, (unsigned)bytes);
+        LittleFS.remove(GEO_PATH_TMP);
+        s_dirty = true;
+        return false;
+    }
+
+    // Replace atomically: LittleFS rename overwrites the old file in one
+    // commit, so a reset at any point leaves either the old or the new cache
+    if (!LittleFS.rename(GEO_PATH_TMP, GEO_PATH)) {
+        SqLog.println("[geocache] Rename failed");
+        return false;
+    }
+    s_writes++;
+    s_lastWriteMs = millis();
+    s_lastBytes = (uint16_t)bytes;
+    SqLog.printf("[geocache] Saved %u nodes, %u edges (%u B)\n", n, written, (unsigned)bytes);
+    return true;
+}
+
+// Low-priority writer: first change wakes it, later ones within the batch
+// window ride along in the same write
+static void writerTask(void*) {
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        vTaskDelay(pdMS_TO_TICKS(GEO_CACHE_BATCH_MS));
+        ulTaskNotifyTake(pdTRUE, 0);
+        if (!s_enabled || !s_dirty) continue;
+        xSemaphoreTake(s_fileMutex, portMAX_DELAY);
+        s_dirty = false;
+        writeFile();
+        xSemaphoreGive(s_fileMutex);
+    }
+}
+
+static void loadFile() {
+    s_loadedNodes = 0;
+    s_loadedEdges = 0;
+    if (!mountFs() || !LittleFS.exists(GEO_PATH)) return;
+
+    File f = LittleFS.open(GEO_PATH, "r");
+    if (!f) return;
+
+    GeoFileHeader hdr;
+    if (f.read((uint8_t*)&hdr, sizeof(hdr)) != sizeof(hdr)
+        || hdr.magic != GEO_CACHE_MAGIC || hdr.version != GEO_CACHE_VERSION
+        || f.size() != sizeof(hdr) + hdr.node_count * sizeof(GeoFileNode)
+                       + hdr.edge_count * sizeof(GeoFileEdge)) {
+        SqLog.println("[geocache] Cache file invalid, ignoring");
+        f.close();
+        return;
+    }
+
+    // Time since the save is known only if time() kept running since
+    // (same RTC clock run: deep sleep, soft reset) or both ends are SNTP
+    // wall-clock time. Otherwise a power cycle restarted time() near 0 and
+    // the gap is unknown: load every edge as stale, keep the distance as
+    // a seed for the solver.
+    uint32_t now = (uint32_t)time(nullptr);
+    bool sameClock = (hdr.clock_id == rtcClockId());
+    bool wallClock = (hdr.saved_at >= GEO_CACHE_EPOCH_VALID && now >= GEO_CACHE_EPOCH_VALID);
+    bool trusted = (sameClock || wallClock) && now >= hdr.saved_at;
+    uint32_t gap_s = trusted ? now - hdr.saved_at : 0;
+    uint32_t stale_s = (uint32_t)NvsConfigManager::ftmStaleness_s;
+
+    const uint8_t* own_mac = MeshConductor::staMac();
+
+    int8_t map[256];
+    memset(map, -1, sizeof(map));
+    for (uint16_t i = 0; i < hdr.node_count; i++) {
+        GeoFileNode node;
+        if (f.read((uint8_t*)&node, sizeof(node)) != sizeof(node)) break;
+        int8_t idx = (memcmp(node.mac, own_mac, 6) == 0)
+                   ? 0 : PeerTable::seedCached(node.mac, node.softap_mac);
+        map[i] = idx;
+        if (idx < 0) continue;
+        PeerTable::setPosition((uint8_t)idx, node.pos[0], node.pos[1], node.pos[2], node.confidence);
+        s_loadedNodes++;
+    }
+
+    for (uint16_t k = 0; k < hdr.edge_count; k++) {
+        GeoFileEdge e;
+        if (f.read((uint8_t*)&e, sizeof(e)) != sizeof(e)) break;
+        int8_t a = map[e.a], b = map[e.b];
+        if (a < 0 || b < 0 || a == b) continue;
+        PeerTable::setDistance((uint8_t)a, (uint8_t)b, (float)e.distance_cm, e.quality);
+        uint16_t age = e.age_s;
+        if (age != FTM_EDGE_AGE_UNKNOWN) {
+            uint32_t aged = (uint32_t)age + gap_s;
+            if (!trusted && aged < stale_s) aged = stale_s;
+            age = (aged < FTM_EDGE_AGE_UNKNOWN) ? (uint16_t)aged : FTM_EDGE_AGE_UNKNOWN - 1;
+        }
+        FtmScheduler::setEdgeAge(PeerTable::edgeIndex((uint8_t)a, (uint8_t)b), age);
+        s_loadedEdges++;
+    }
+    f.close();
+
+    if (trusted) {
+        SqLog.printf("[geocache] Loaded %u nodes, %u edges (saved %lu s ago)\n",
+            s_loadedNodes, s_loadedEdges, (unsigned long)gap_s);
+    } else {
+        SqLog.printf("[geocache] Loaded %u nodes, %u edges (save time unknown, edges stale)\n",
+            s_loadedNodes, s_loadedEdges);
+    }
+}
+
+// --- Public API ---
+
+void GeoCache::begin() {
+    if (!s_fileMutex) s_fileMutex = xSemaphoreCreateMutex();
+    if (!s_task)
+        xTaskCreate(writerTask, "geocache", 4096, nullptr, tskIDLE_PRIORITY + 1, &s_task);
+
+    xSemaphoreTake(s_fileMutex, portMAX_DELAY);
+    loadFile();
+    xSemaphoreGive(s_fileMutex);
+    s_dirty = false;
+    s_enabled = true;
+}
+
+void GeoCache::end() {
+    if (!s_enabled) return;
+    s_enabled = false;
+    if (s_dirty) {
+        xSemaphoreTake(s_fileMutex, portMAX_DELAY);
+        s_dirty = false;
+        writeFile();
+        xSemaphoreGive(s_fileMutex);
+    }
+}
+
+void GeoCache::markDirty() {
+    if (!s_enabled || !s_task) return;
+    s_dirty = true;
+    xTaskNotifyGive(s_task);
+}
+
+bool GeoCache::flush() {
+    if (!s_fileMutex) return false;
+    xSemaphoreTake(s_fileMutex, portMAX_DELAY);
+    s_dirty = false;
+    bool ok = writeFile();
+    xSemaphoreGive(s_fileMutex);
+    return ok;
+}
+
+void GeoCache::clear() {
+    if (!mountFs()) return;
+    if (s_fileMutex) xSemaphoreTake(s_fileMutex, portMAX_DELAY);
+    LittleFS.remove(GEO_PATH);
+    if (s_fileMutex) xSemaphoreGive(s_fileMutex);
+    SqLog.println("[geocache] Cache cleared");
+}
+
+void GeoCache::printStatus(Print& out) {
+    out.printf("Geometry cache: %s%s, loaded %u nodes / %u edges at start\n",
+        s_enabled ? "active" : "inactive", s_dirty ? " (write pending)" : "",
+        s_loadedNodes, s_loadedEdges);
+    if (s_writes > 0) {
+        out.printf("  %lu writes, last %lu s ago (%u B)\n", (unsigned long)s_writes,
+            (unsigned long)((millis() - s_lastWriteMs) / 1000), s_lastBytes);
+    }
+}
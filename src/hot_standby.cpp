@@ -0,0 +1,443 @@
+#include "hot_standby.h"
+#include "mesh_conductor.h"
+#include "peer_table.h"
+#include "mesh_footprint.h"
+#include "rtc_mesh_map.h"
+#include "orchestrator.h"
+#include "ftm_scheduler.h"
+#include "bsp.hpp"
+#include "sq_log.h"
+#include <Arduino.h>
+#include <esp_mac.h>
+#include <esp_system.h>
+#include <string.h>
+
+static const char* TAG = "standby";
+
+#define SEQ_MAX_STEPS  32   // Orchestrator sequence capacity
+
+// --- File-scope state ---
+
+static bool          s_primary      = false;   // this node is gateway and replicates
+static bool          s_isStandby    = false;   // this node receives the replica
+static bool          s_haveStandby  = false;   // a standby is designated (any node's view)
+static uint8_t       s_standbyMac[6] = {0};
+static bool          s_takeoverPending = false;
+static TimerHandle_t s_tickTimer     = nullptr;
+static TimerHandle_t s_fallbackTimer = nullptr;
+
+// Failover timing
+static uint32_t s_lastReplRxMs = 0;   // standby: last frame from the gateway
+static uint32_t s_gwLostMs     = 0;   // node: parent/gateway loss observed (0 = none)
+static uint32_t s_failoverMs   = 0;   // last measured loss → new gateway
+
+// Stats
+static uint32_t s_replFrames = 0;     // sent (primary) or received (standby)
+static uint32_t s_replEdges  = 0;
+
+// Replica (standby), in the old gateway's slot numbering
+static PeerEdge         s_replica[PEER_EDGE_COUNT];
+static StandbyOrchState s_replOrch;
+static SeqStep          s_replSteps[SEQ_MAX_STEPS];
+static bool             s_replOrchValid = false;
+static_assert(sizeof(s_replica) == FOOTPRINT_STANDBY_REPLICA, "mesh_footprint.h: replica");
+
+// Last orchestrator block sent (primary) — resent only when it changes
+static uint8_t  s_orchSent[sizeof(StandbyOrchState) + SEQ_MAX_STEPS * sizeof(SeqStep)];
+static uint16_t s_orchSentLen = 0;
+
+// A replication frame was given up on: its edges are gone from the dirty
+// set, so the next tick resends everything (set from the reliable layer)
+static volatile bool s_replResync = false;
+
+// --- Helpers ---
+
+static bool isSelf(const uint8_t* mac) {
+    return MeshConductor::isSelf(mac);
+}
+
+static void clearReplica() {
+    for (uint16_t e = 0; e < PEER_EDGE_COUNT; e++) {
+        s_replica[e].distance_cm = PEER_DIST_UNKNOWN;
+        s_replica[e].quality = 0;
+    }
+    s_replOrchValid = false;
+}
+
+static uint16_t buildOrchBlock(uint8_t* out) {
+    StandbyOrchState* st = (StandbyOrchState*)out;
+    st->mode = (uint8_t)Orchestrator::getMode();
+    st->travel_order = (uint8_t)Orchestrator::getTravelOrder();
+    st->seq_idx = Orchestrator::sequenceIndex();
+    st->seq_count = Orchestrator::sequenceCount();
+    if (st->seq_count > SEQ_MAX_STEPS) st->seq_count = SEQ_MAX_STEPS;
+    memcpy(out + sizeof(StandbyOrchState), Orchestrator::sequenceSteps(),
+           st->seq_count * sizeof(SeqStep));
+    return sizeof(StandbyOrchState) + st->seq_count * sizeof(SeqStep);
+}
+
+// Pick the best-ranked alive peer from the last election; fall back to the
+// alive peer with the most battery if the ranking is unavailable.
+static bool selectStandby() {
+    for (uint8_t r = 0; ; r++) {
+        const uint8_t* mac = MeshConductor::electionRanked(r);
+        if (!mac) break;
+        if (isSelf(mac)) continue;
+        PeerEntry e;
+        if (PeerTable::readEntry(mac, &e) && !(e.flags & PEER_STATUS_DEAD)) {
+            memcpy(s_standbyMac, mac, 6);
+            return true;
+        }
+    }
+
+    PeerEntry best;
+    bool found = false;
+    for (uint8_t i = 1; i < PeerTable::peerCount(); i++) {   // slot 0 = self
+        PeerEntry e;
+        if (!PeerTable::readEntry(i, &e) || (e.flags & PEER_STATUS_DEAD)) continue;
+        if (!found || e.battery_mv > best.battery_mv) {
+            best = e;
+            found = true;
+        }
+    }
+    if (!found) return false;
+    memcpy(s_standbyMac, best.mac, 6);
+    return true;
+}
+
+// --- Primary: replication tick ---
+
+static void replDone(const uint8_t* mac, bool acked, void* ctx) {
+    (void)ctx;
+    if (!acked && memcmp(mac, s_standbyMac, 6) == 0) s_replResync = true;
+}
+
+static void primaryTick() {
+    bool resync = s_replResync;
+    s_replResync = false;
+    if (s_haveStandby) {
+        PeerEntry e;
+        if (!PeerTable::readEntry(s_standbyMac, &e) || (e.flags & PEER_STATUS_DEAD)) {
+            SqLog.printf("[standby] Standby %02X:%02X lost — reselecting\n",
+                s_standbyMac[4], s_standbyMac[5]);
+            s_haveStandby = false;
+        }
+    }
+    if (!s_haveStandby) {
+        if (!selectStandby()) return;
+        s_haveStandby = true;
+        s_orchSentLen = 0;
+        PeerTable::markAllEdgesDirty();   // new standby starts from a full snapshot
+
+        StandbyAssignMsg am;
+        am.type = MSG_TYPE_STANDBY_ASSIGN;
+        memcpy(am.standby, s_standbyMac, 6);
+        MeshConductor::broadcastReliable(&am, sizeof(am));
+        SqLog.printf("[standby] Designated standby %02X:%02X:%02X:%02X:%02X:%02X\n",
+            s_standbyMac[0], s_standbyMac[1], s_standbyMac[2],
+            s_standbyMac[3], s_standbyMac[4], s_standbyMac[5]);
+    } else if (resync) {
+        SqLog.println("[standby] Replication frame lost — resending full snapshot");
+        s_orchSentLen = 0;
+        PeerTable::markAllEdgesDirty();
+    }
+
+    // Static: too large for the timer task stack
+    static uint8_t  buf[MESH_REL_MAX_PAYLOAD];
+    static uint8_t  orch[sizeof(s_orchSent)];
+    static uint16_t dirty[MESH_REL_MAX_PAYLOAD / sizeof(StandbyEdge)];
+
+    for (uint8_t f = 0; f < MESH_STANDBY_BATCH; f++) {
+        StandbyReplMsg* hdr = (StandbyReplMsg*)buf;
+        hdr->type = MSG_TYPE_STANDBY_REPL;
+        hdr->flags = 0;
+        uint16_t pos = sizeof(StandbyReplMsg);
+
+        uint16_t orchLen = buildOrchBlock(orch);
+        if (orchLen != s_orchSentLen || memcmp(orch, s_orchSent, orchLen) != 0) {
+            memcpy(buf + pos, orch, orchLen);
+            memcpy(s_orchSent, orch, orchLen);
+            s_orchSentLen = orchLen;
+            hdr->flags |= REPL_FLAG_ORCH;
+            pos += orchLen;
+        }
+
+        uint16_t room = (MESH_REL_MAX_PAYLOAD - pos) / sizeof(StandbyEdge);
+        if (room > 255) room = 255;
+        uint16_t n = PeerTable::takeDirtyEdges(dirty, room);
+        for (uint16_t i = 0; i < n; i++) {
+            PeerEdge pe = PeerTable::getEdge(dirty[i]);
+            StandbyEdge rec;
+            rec.edge = dirty[i];
+            rec.distance_cm = pe.distance_cm;
+            rec.quality = pe.quality;
+            memcpy(buf + pos, &rec, sizeof(rec));
+            pos += sizeof(rec);
+        }
+        hdr->edge_count = (uint8_t)n;
+
+        // First frame always goes out: an empty one is the keepalive
+        if (f > 0 && hdr->flags == 0 && n == 0) break;
+        if (MeshConductor::sendReliable(s_standbyMac, buf, pos, replDone) != ESP_OK) {
+            // Nothing went out: put the edges back and retry next tick
+            PeerTable::markEdgesDirty(dirty, n);
+            if (hdr->flags & REPL_FLAG_ORCH) s_orchSentLen = 0;
+            break;
+        }
+        s_replFrames++;
+        s_replEdges += n;
+        if (n < room) break;   // backlog drained
+    }
+}
+
+// --- Standby: gateway watchdog ---
+
+static void standbyTick() {
+    if (s_takeoverPending) return;
+    uint32_t silent = millis() - s_lastReplRxMs;
+    if (silent < MESH_STANDBY_MISSED * MESH_STANDBY_REPL_MS) return;
+
+    SqLog.printf("[standby] Gateway silent for %lu ms — taking over\n", (unsigned long)silent);
+    s_takeoverPending = true;
+    MeshConductor::requestTakeover();
+}
+
+static void tickTimerCb(TimerHandle_t t) {
+    (void)t;
+    if (s_primary) primaryTick();
+    else if (s_isStandby) standbyTick();
+}
+
+static void startTick() {
+    if (s_tickTimer == nullptr) {
+        s_tickTimer = xTimerCreate("standby", pdMS_TO_TICKS(MESH_STANDBY_REPL_MS),
+                                   pdTRUE, nullptr, tickTimerCb);
+    }
+    xTimerStart(s_tickTimer, 0);
+}
+
+// Node-side fallback: no new gateway appeared — old reboot-and-re-elect path
+static void fallbackTimerCb(TimerHandle_t t) {
+    (void)t;
+    SqLog.println("[standby] No new gateway — sleep and reboot for re-election");
+    RtcMap::get()->mesh_generation = 0;   // no warm rejoin into the dead mesh
+    RtcMap::save();
+    MeshConductor::stop();
+    SQ_LIGHT_SLEEP(MESH_REELECT_SLEEP_MS);
+    esp_restart();
+}
+
+// --- Public API ---
+
+void HotStandby::beginPrimary() {
+    s_primary = true;
+    s_isStandby = false;
+    s_haveStandby = false;
+    s_takeoverPending = false;
+    s_gwLostMs = 0;
+    if (s_fallbackTimer) xTimerStop(s_fallbackTimer, 0);
+    startTick();
+    SqLog.println("[standby] Replication active (gateway)");
+}
+
+void HotStandby::endPrimary() {
+    s_primary = false;
+    s_haveStandby = false;
+    if (s_tickTimer && !s_isStandby) xTimerStop(s_tickTimer, 0);
+}
+
+void HotStandby::onAssign(const uint8_t* from, const uint8_t* standby_mac) {
+    if (s_primary) return;
+    if (memcmp(from, MeshConductor::gatewayMac(), 6) != 0) return;   // stale gateway
+
+    memcpy(s_standbyMac, standby_mac, 6);
+    s_haveStandby = true;
+
+    if (isSelf(standby_mac)) {
+        if (!s_isStandby) {
+            // Replication frames may already have arrived (implicit assign) —
+            // only start from scratch if this is news
+            clearReplica();
+            s_isStandby = true;
+            s_lastReplRxMs = millis();
+            s_takeoverPending = false;
+            startTick();
+            SqLog.println("[standby] This node is now the hot standby");
+        }
+    } else if (s_isStandby) {
+        s_isStandby = false;
+        if (s_tickTimer) xTimerStop(s_tickTimer, 0);
+        SqLog.println("[standby] Standby role moved to another node");
+    }
+}
+
+void HotStandby::onRepl(const uint8_t* from, const uint8_t* buf, uint16_t len) {
+    if (s_primary || len < sizeof(StandbyReplMsg)) return;
+    if (memcmp(from, MeshConductor::gatewayMac(), 6) != 0) return;
+
+    if (!s_isStandby) {
+        // ASSIGN not seen yet (or lost) — the stream itself makes us standby
+        clearReplica();
+        s_isStandby = true;
+        s_takeoverPending = false;
+        memcpy(s_standbyMac, MeshConductor::staMac(), 6);
+        s_haveStandby = true;
+        startTick();
+        SqLog.println("[standby] Replication stream received — acting as standby");
+    }
+    s_lastReplRxMs = millis();
+    s_replFrames++;
+
+    const StandbyReplMsg* hdr = (const StandbyReplMsg*)buf;
+    uint16_t pos = sizeof(StandbyReplMsg);
+
+    if (hdr->flags & REPL_FLAG_ORCH) {
+        if (pos + sizeof(StandbyOrchState) > len) return;
+        memcpy(&s_replOrch, buf + pos, sizeof(StandbyOrchState));
+        pos += sizeof(StandbyOrchState);
+        if (s_replOrch.seq_count > SEQ_MAX_STEPS) s_replOrch.seq_count = SEQ_MAX_STEPS;
+        uint16_t stepBytes = s_replOrch.seq_count * sizeof(SeqStep);
+        if (pos + stepBytes > len) return;
+        memcpy(s_replSteps, buf + pos, stepBytes);
+        pos += stepBytes;
+        s_replOrchValid = true;
+    }
+
+    for (uint8_t i = 0; i < hdr->edge_count && pos + sizeof(StandbyEdge) <= len; i++) {
+        StandbyEdge rec;
+        memcpy(&rec, buf + pos, sizeof(rec));
+        pos += sizeof(rec);
+        if (rec.edge >= PEER_EDGE_COUNT) continue;
+        s_replica[rec.edge].distance_cm = rec.distance_cm;
+        s_replica[rec.edge].quality = rec.quality;
+        s_replEdges++;
+    }
+}
+
+void HotStandby::onGatewayHeard() {
+    if (s_gwLostMs == 0) return;
+    // Parent loss was local (re-parented under a live gateway)
+    s_gwLostMs = 0;
+    if (s_fallbackTimer) xTimerStop(s_fallbackTimer, 0);
+}
+
+void HotStandby::onGatewayChanged(const uint8_t* new_gw) {
+    if (s_gwLostMs != 0) {
+        s_failoverMs = millis() - s_gwLostMs;
+        s_gwLostMs = 0;
+        SqLog.printf("[standby] New gateway %02X:%02X after %lu ms (no reboot)\n",
+            new_gw[4], new_gw[5], (unsigned long)s_failoverMs);
+    }
+    if (s_fallbackTimer) xTimerStop(s_fallbackTimer, 0);
+
+    // The new gateway designates its own standby
+    if (s_haveStandby && memcmp(new_gw, s_standbyMac, 6) == 0)
+        s_haveStandby = false;
+    if (s_isStandby && !isSelf(new_gw)) {
+        s_isStandby = false;
+        if (s_tickTimer && !s_primary) xTimerStop(s_tickTimer, 0);
+    }
+}
+
+bool HotStandby::onGatewayLost() {
+    if (!s_haveStandby) return false;
+    if (s_gwLostMs == 0) s_gwLostMs = millis();
+
+    if (s_isStandby) {
+        // We are the standby and our parent was the gateway: don't wait
+        // for the replication timeout
+        if (!s_takeoverPending) {
+            SqLog.println("[standby] Gateway link lost — taking over");
+            s_takeoverPending = true;
+            MeshConductor::requestTakeover();
+        }
+        return true;
+    }
+
+    SqLog.printf("[standby] Gateway lost — waiting for standby %02X:%02X (fallback %u ms)\n",
+        s_standbyMac[4], s_standbyMac[5], MESH_STANDBY_FAILOVER_MS);
+    if (s_fallbackTimer == nullptr) {
+        s_fallbackTimer = xTimerCreate("sbyFail", pdMS_TO_TICKS(MESH_STANDBY_FAILOVER_MS),
+                                       pdFALSE, nullptr, fallbackTimerCb);
+    }
+    xTimerStart(s_fallbackTimer, 0);
+    return true;
+}
+
+void HotStandby::applyReplica() {
+    const PeerSyncEntry* shadow = MeshConductor::peerShadowEntries();
+    uint8_t count = MeshConductor::peerShadowCount();
+
+    // Old gateway slot (= shadow index) → slot in the freshly seeded PeerTable
+    int8_t remap[MESH_MAX_NODES];
+    for (uint8_t i = 0; i < MESH_MAX_NODES; i++)
+        remap[i] = (i < count) ? PeerTable::getIndex(shadow[i].mac) : -1;
+
+    uint16_t edges = 0;
+    for (uint8_t a = 0; a < count; a++) {
+        if (remap[a] < 0) continue;
+        for (uint8_t b = a + 1; b < count; b++) {
+            if (remap[b] < 0) continue;
+            const PeerEdge& pe = s_replica[PeerTable::edgeIndex(a, b)];
+            if (pe.distance_cm == PEER_DIST_UNKNOWN) continue;
+            PeerTable::setDistance(remap[a], remap[b], pe.distance_cm, pe.quality);
+            edges++;
+        }
+    }
+
+    if (s_replOrchValid) {
+        Orchestrator::setTravelOrder((TravelOrder)s_replOrch.travel_order);
+        Orchestrator::clearSequence();
+        for (uint8_t i = 0; i < s_replOrch.seq_count; i++) {
+            const SeqStep& st = s_replSteps[i];
+            int8_t node = (st.node_index < count) ? remap[st.node_index] : -1;
+            if (node < 0) continue;   // step targeted a node we no longer know
+            Orchestrator::addSequenceStep((uint8_t)node, st.tone_index, st.delay_ms);
+        }
+        Orchestrator::setSequenceIndex(s_replOrch.seq_idx);
+        Orchestrator::saveSequence();
+        Orchestrator::setMode((OrchMode)s_replOrch.mode);
+    }
+
+    // Geometry is anchored on the gateway: re-solve from the replicated edges
+    // instead of waiting for an FTM sweep
+    if (edges > 0) {
+        FtmScheduler::triggerSolve();
+        FtmScheduler::broadcastPositions();
+    }
+
+    s_isStandby = false;
+    s_takeoverPending = false;
+    s_failoverMs = millis() - s_lastReplRxMs;
+    SqLog.printf("[standby] Took over in place: %u edges, orch %s, %lu ms since last gateway frame\n",
+        edges, s_replOrchValid ? "restored" : "none", (unsigned long)s_failoverMs);
+}
+
+bool HotStandby::isStandby() {
+    return s_isStandby;
+}
+
+const uint8_t* HotStandby::standbyMac() {
+    return s_haveStandby ? s_standbyMac : nullptr;
+}
+
+void HotStandby::printStatus(Print& out) {
+    if (s_primary) {
+        out.printf("Hot standby: %s\n", s_haveStandby ? "designated" : "none");
+    } else {
+        out.printf("Hot standby: %s\n", s_isStandby ? "THIS NODE" : (s_haveStandby ? "known" : "none"));
+    }
+    if (s_haveStandby) {
+        out.printf("  Standby MAC: %02X:%02X:%02X:%02X:%02X:%02X\n",
+            s_standbyMac[0], s_standbyMac[1], s_standbyMac[2],
+            s_standbyMac[3], s_standbyMac[4], s_standbyMac[5]);
+    }
+    if (s_isStandby) {
+        out.printf("  Last gateway frame: %lu ms ago (takeover at %u ms)\n",
+            (unsigned long)(millis() - s_lastReplRxMs),
+            MESH_STANDBY_MISSED * MESH_STANDBY_REPL_MS);
+    }
+    out.printf("  Replication: %lu frames, %lu edges\n",
+        (unsigned long)s_replFrames, (unsigned long)s_replEdges);
+    out.printf("  Last failover: %lu ms\n", (unsigned long)s_failoverMs);
+}
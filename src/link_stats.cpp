@@ -0,0 +1,334 @@
+#include "link_stats.h"
+#include "mesh_conductor.h"
+#include "bsp.hpp"
+#include "sq_log.h"
+#include <Arduino.h>
+#include <esp_mesh.h>
+#include <esp_wifi.h>
+#include <string.h>
+
+// Histogram bucket upper bounds (last bucket = everything above)
+static const uint32_t SEND_EDGES_US[LINK_HIST_BUCKETS - 1] = {250, 1000, 4000, 16000, 64000};
+static const uint32_t RTT_EDGES_MS[LINK_HIST_BUCKETS - 1]  = {10, 25, 50, 100, 250};
+static const int8_t   RSSI_EDGES[LINK_HIST_BUCKETS - 1]    = {-50, -60, -70, -80, -90};   // ≥ edge
+
+// --- File-scope state ---
+
+struct LinkSlot {
+    bool           used;
+    LinkStatsEntry e;
+};
+
+static LinkSlot          s_links[MESH_MAX_NODES];
+static SemaphoreHandle_t s_linkMutex = nullptr;
+static uint16_t          s_pingSeq   = 0;
+
+// --- Helpers ---
+
+// Find (or create, evicting the longest-idle peer) the slot for `mac`.
+// Caller holds s_linkMutex.
+static LinkStatsEntry* linkFor(const uint8_t* mac, bool create) {
+    LinkSlot* freeSlot = nullptr;
+    LinkSlot* oldest = nullptr;
+    for (uint8_t i = 0; i < MESH_MAX_NODES; i++) {
+        LinkSlot* s = &s_links[i];
+        if (!s->used) {
+            if (!freeSlot) freeSlot = s;
+            continue;
+        }
+        if (memcmp(s->e.mac, mac, 6) == 0) return &s->e;
+        if (!oldest || (int32_t)(s->e.last_ms - oldest->e.last_ms) < 0) oldest = s;
+    }
+    if (!create) return nullptr;
+
+    LinkSlot* s = freeSlot ? freeSlot : oldest;
+    memset(s, 0, sizeof(LinkSlot));
+    s->used = true;
+    memcpy(s->e.mac, mac, 6);
+    return &s->e;
+}
+
+static uint8_t bucketOf(uint32_t v, const uint32_t* edges) {
+    uint8_t b = 0;
+    while (b < LINK_HIST_BUCKETS - 1 && v >= edges[b]) b++;
+    return b;
+}
+
+static uint8_t rssiBucket(int8_t rssi) {
+    uint8_t b = 0;
+    while (b < LINK_HIST_BUCKETS - 1 && rssi < RSSI_EDGES[b]) b++;
+    return b;
+}
+
+// Loss estimate: EWMA (1/8) over transmission outcomes. A retransmit,
+// give-up or send failure counts as a loss; an RTT sample as a success.
+static void lossEvent(LinkStatsEntry* e, bool lost) {
+    e->loss_x1000 -= (e->loss_x1000 + 7) / 8;
+    if (lost) e->loss_x1000 += 1000 / 8;
+}
+
+static uint8_t scoreOf(const LinkStatsEntry& e, uint32_t now) {
+    if ((now - e.last_ms) > LINK_STALE_MS) return 100;   // old evidence no longer counts
+
+    int32_t q = 100;
+    q -= 2 * (int32_t)e.loss_x1000 / 10;                 // 2 points per % lost
+    if (e.srtt_us) {
+        int32_t over = (int32_t)(e.srtt_us / 1000) - LINK_RTT_GOOD_MS;
+        if (over > 0) q -= over / 5;                      // 1 point per 5 ms
+    }
+    if (e.rssi != 0 && e.rssi < LINK_RSSI_GOOD_DBM)
+        q -= 3 * (LINK_RSSI_GOOD_DBM - e.rssi);           // 3 points per dB
+    if (q < 0) q = 0;
+    if (q > 100) q = 100;
+    return (uint8_t)q;
+}
+
+static bool lock() {
+    return s_linkMutex && xSemaphoreTake(s_linkMutex, portMAX_DELAY) == pdTRUE;
+}
+
+static void unlock() {
+    xSemaphoreGive(s_linkMutex);
+}
+
+// --- Public API ---
+
+void LinkStats::init() {
+    if (s_linkMutex == nullptr) s_linkMutex = xSemaphoreCreateMutex();
+}
+
+void LinkStats::reset() {
+    if (!lock()) return;
+    memset(s_links, 0, sizeof(s_links));
+    unlock();
+}
+
+void LinkStats::onSend(const uint8_t* mac, uint32_t us, bool ok) {
+    if (!lock()) return;
+    LinkStatsEntry* e = linkFor(mac, true);
+    e->tx_frames++;
+    e->send_hist[bucketOf(us, SEND_EDGES_US)]++;
+    if (us > e->send_max_us) e->send_max_us = us;
+    if (!ok) {
+        e->tx_fail++;
+        lossEvent(e, true);
+    }
+    e->last_ms = millis();
+    unlock();
+}
+
+void LinkStats::onReliableSent(const uint8_t* mac) {
+    if (!lock()) return;
+    LinkStatsEntry* e = linkFor(mac, true);
+    e->rel_sent++;
+    e->last_ms = millis();
+    unlock();
+}
+
+void LinkStats::onRetransmit(const uint8_t* mac) {
+    if (!lock()) return;
+    LinkStatsEntry* e = linkFor(mac, true);
+    e->rel_retx++;
+    lossEvent(e, true);
+    e->last_ms = millis();
+    unlock();
+}
+
+void LinkStats::onGiveUp(const uint8_t* mac) {
+    if (!lock()) return;
+    LinkStatsEntry* e = linkFor(mac, true);
+    e->rel_giveup++;
+    lossEvent(e, true);
+    e->last_ms = millis();
+    unlock();
+}
+
+void LinkStats::onRtt(const uint8_t* mac, uint32_t us) {
+    if (!lock()) return;
+    LinkStatsEntry* e = linkFor(mac, true);
+    e->rtt_hist[bucketOf(us / 1000, RTT_EDGES_MS)]++;
+    e->srtt_us = e->srtt_us ? (7 * e->srtt_us + us) / 8 : us;
+    if (e->rtt_min_us == 0 || us < e->rtt_min_us) e->rtt_min_us = us;
+    if (us > e->rtt_max_us) e->rtt_max_us = us;
+    lossEvent(e, false);
+    e->last_ms = millis();
+    unlock();
+}
+
+void LinkStats::onLinkReport(const uint8_t* mac, uint8_t layer, int8_t rssi) {
+    if (layer == 0 && rssi == 0) return;   // sender could not sample its link
+    if (!lock()) return;
+    LinkStatsEntry* e = linkFor(mac, true);
+    e->layer = layer;
+    e->rssi = rssi;
+    if (rssi != 0) e->rssi_hist[rssiBucket(rssi)]++;
+    e->last_ms = millis();
+    unlock();
+}
+
+void LinkStats::ping(const uint8_t* mac) {
+    LinkPingMsg msg;
+    msg.type = MSG_TYPE_LINK_PING;
+    msg.seq = ++s_pingSeq;
+    msg.t_us = micros();
+    if (lock()) {
+        LinkStatsEntry* e = linkFor(mac, true);
+        e->pings++;
+        e->last_ms = millis();
+        unlock();
+    }
+    MeshConductor::sendToNode(mac, &msg, sizeof(msg));
+}
+
+void LinkStats::onPing(const uint8_t* from, const uint8_t* buf, uint16_t len) {
+    if (len < sizeof(LinkPingMsg)) return;
+    LinkPingMsg msg;
+    memcpy(&msg, buf, sizeof(msg));
+    msg.type = MSG_TYPE_LINK_PONG;   // echo seq and timestamp untouched
+    MeshConductor::sendToNode(from, &msg, sizeof(msg));
+}
+
+void LinkStats::onPong(const uint8_t* from, const uint8_t* buf, uint16_t len) {
+    if (len < sizeof(LinkPingMsg)) return;
+    const LinkPingMsg* msg = (const LinkPingMsg*)buf;
+    uint32_t rtt = micros() - msg->t_us;
+    if (lock()) {
+        LinkStatsEntry* e = linkFor(from, true);
+        e->pongs++;
+        unlock();
+    }
+    onRtt(from, rtt);
+}
+
+void LinkStats::sampleOwnLink(uint8_t* layer, int8_t* rssi) {
+    int l = esp_mesh_get_layer();
+    *layer = (l > 0 && l < 256) ? (uint8_t)l : 0;
+    *rssi = 0;
+    // The root's STA faces the router, not a mesh parent
+    if (*layer > 1) {
+        wifi_ap_record_t ap;
+        if (esp_wifi_sta_get_ap_info(&ap) == ESP_OK) *rssi = ap.rssi;
+    }
+}
+
+uint8_t LinkStats::quality(const uint8_t* mac) {
+    if (!lock()) return 100;
+    LinkStatsEntry* e = linkFor(mac, false);
+    uint8_t q = e ? scoreOf(*e, millis()) : 100;
+    unlock();
+    return q;
+}
+
+bool LinkStats::isPoor(const uint8_t* mac) {
+    return quality(mac) < LINK_POOR_QUALITY;
+}
+
+bool LinkStats::get(const uint8_t* mac, LinkStatsEntry* out) {
+    if (!lock()) return false;
+    LinkStatsEntry* e = linkFor(mac, false);
+    if (e) *out = *e;
+    unlock();
+    return e != nullptr;
+}
+
+// Copy slot `i` out under the lock so printing never holds it
+static bool snapshot(uint8_t i, LinkStatsEntry* out) {
+    if (!lock()) return false;
+    bool used = s_links[i].used;
+    if (used) *out = s_links[i].e;
+    unlock();
+    return used;
+}
+
+static void printHist(Print& out, const char* name, const uint32_t* h) {
+    out.printf("    %-4s", name);
+    for (uint8_t b = 0; b < LINK_HIST_BUCKETS; b++)
+        out.printf(" %6lu", (unsigned long)h[b]);
+    out.println();
+}
+
+void LinkStats::printStatus(Print& out) {
+    uint8_t layer;
+    int8_t rssi;
+    sampleOwnLink(&layer, &rssi);
+    out.printf("Own link: layer %u, parent RSSI %d dBm\n", layer, rssi);
+    out.println("    buckets   send: <250us <1ms <4ms <16ms <64ms +");
+    out.println("              rtt:  <10ms <25ms <50ms <100ms <250ms +");
+    out.println("              rssi: >=-50 >=-60 >=-70 >=-80 >=-90 -");
+
+    uint32_t now = millis();
+    uint8_t shown = 0;
+    LinkStatsEntry e;
+    for (uint8_t i = 0; i < MESH_MAX_NODES; i++) {
+        if (!snapshot(i, &e)) continue;
+        shown++;
+        out.printf("%02X:%02X:%02X:%02X:%02X:%02X  q=%3u  L%u  RSSI %4d  idle %lus\n",
+            e.mac[0], e.mac[1], e.mac[2], e.mac[3], e.mac[4], e.mac[5],
+            scoreOf(e, now), e.layer, e.rssi, (unsigned long)((now - e.last_ms) / 1000));
+        out.printf("    tx %lu (fail %lu)  rel %lu retx %lu lost %lu  loss %u.%u%%\n",
+            (unsigned long)e.tx_frames, (unsigned long)e.tx_fail,
+            (unsigned long)e.rel_sent, (unsigned long)e.rel_retx, (unsigned long)e.rel_giveup,
+            e.loss_x1000 / 10, e.loss_x1000 % 10);
+        out.printf("    srtt %lu us (min %lu, max %lu)  send max %lu us  ping %lu/%lu\n",
+            (unsigned long)e.srtt_us, (unsigned long)e.rtt_min_us, (unsigned long)e.rtt_max_us,
+            (unsigned long)e.send_max_us, (unsigned long)e.pongs, (unsigned long)e.pings);
+        printHist(out, "send", e.send_hist);
+        printHist(out, "rtt", e.rtt_hist);
+        printHist(out, "rssi", e.rssi_hist);
+    }
+    if (shown == 0) out.println("(no link samples yet)");
+}
+
+static void printJsonArray(Print& out, const uint32_t* h) {
+    out.print('[');
+    for (uint8_t b = 0; b < LINK_HIST_BUCKETS; b++)
+        out.printf(b ? ",%lu" : "%lu", (unsigned long)h[b]);
+    out.print(']');
+}
+
+void LinkStats::printJson(Print& out) {
+    uint8_t layer;
+    int8_t rssi;
+    sampleOwnLink(&layer, &rssi);
+    out.printf("{\"self\":{\"layer\":%u,\"rssi\":%d},", layer, rssi);
+
+    out.print("\"edges\":{\"send_us\":[");
+    for (uint8_t b = 0; b < LINK_HIST_BUCKETS - 1; b++)
+        out.printf(b ? ",%lu" : "%lu", (unsigned long)SEND_EDGES_US[b]);
+    out.print("],\"rtt_ms\":[");
+    for (uint8_t b = 0; b < LINK_HIST_BUCKETS - 1; b++)
+        out.printf(b ? ",%lu" : "%lu", (unsigned long)RTT_EDGES_MS[b]);
+    out.print("],\"rssi_dbm\":[");
+    for (uint8_t b = 0; b < LINK_HIST_BUCKETS - 1; b++)
+        out.printf(b ? ",%d" : "%d", RSSI_EDGES[b]);
+    out.print("]},\"peers\":[");
+
+    uint32_t now = millis();
+    bool first = true;
+    LinkStatsEntry e;
+    for (uint8_t i = 0; i < MESH_MAX_NODES; i++) {
+        if (!snapshot(i, &e)) continue;
+        if (!first) out.print(',');
+        first = false;
+        out.printf("{\"mac\":\"%02X:%02X:%02X:%02X:%02X:%02X\",\"quality\":%u,"
+                   "\"layer\":%u,\"rssi\":%d,\"idle_ms\":%lu,",
+            e.mac[0], e.mac[1], e.mac[2], e.mac[3], e.mac[4], e.mac[5],
+            scoreOf(e, now), e.layer, e.rssi, (unsigned long)(now - e.last_ms));
+        out.printf("\"tx\":%lu,\"tx_fail\":%lu,\"rel\":%lu,\"retx\":%lu,\"giveup\":%lu,"
+                   "\"loss_permille\":%u,",
+            (unsigned long)e.tx_frames, (unsigned long)e.tx_fail, (unsigned long)e.rel_sent,
+            (unsigned long)e.rel_retx, (unsigned long)e.rel_giveup, e.loss_x1000);
+        out.printf("\"srtt_us\":%lu,\"rtt_min_us\":%lu,\"rtt_max_us\":%lu,\"send_max_us\":%lu,"
+                   "\"pings\":%lu,\"pongs\":%lu,",
+            (unsigned long)e.srtt_us, (unsigned long)e.rtt_min_us, (unsigned long)e.rtt_max_us,
+            (unsigned long)e.send_max_us, (unsigned long)e.pings, (unsigned long)e.pongs);
+        out.print("\"send_hist\":");
+        printJsonArray(out, e.send_hist);
+        out.print(",\"rtt_hist\":");
+        printJsonArray(out, e.rtt_hist);
+        out.print(",\"rssi_hist\":");
+        printJsonArray(out, e.rssi_hist);
+        out.print('}');
+    }
+    out.print("]}");
+}
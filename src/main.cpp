@@ -15,6 +15,10 @@
 #include "debug_cli.h"
 #endif
 
+// pio test links src/ into each test image (test_build_src); the test
+// runner brings its own setup()/loop().
+#ifndef PIO_UNIT_TESTING
+
 void setup()
 {
     Serial.begin(115200);
@@ -59,3 +63,5 @@ void loop()
 
     SQ_POWER_DELAY(5000);
 }
+
+#endif // PIO_UNIT_TESTING
@@ -9,10 +9,13 @@
 #include "nvs_config.h"
 #include "sq_log.h"
 #include "orchestrator.h"
+#include "orch_script.h"
 #include "clock_sync.h"
 #include "web_server.h"
+#include "hot_standby.h"
+#include "mesh_merge.h"
+#include "link_stats.h"
 #include <Arduino.h>
-#include <ArduinoJson.h>
 #include <string.h>
 #include <esp_wifi.h>
 #include <esp_mesh.h>
@@ -22,6 +25,7 @@
 #include <nvs_flash.h>
 #include <nvs.h>
 #include <driver/gpio.h>
+#include <freertos/ringbuf.h>
 
 static const char* TAG = "mesh";
 
@@ -38,10 +42,27 @@ static MeshNode    s_meshNode;
 // Peer shadow (non-gateway nodes receive this from gateway)
 static PeerSyncEntry s_peerShadow[MESH_MAX_NODES];
 static uint8_t       s_peerShadowCount = 0;
+static uint16_t      s_peerShadowEpoch = 0;      // gateway table epoch the shadow reflects
+static bool          s_peerShadowSynced = false; // a FULL sync has bound the short IDs
+static uint16_t      s_peerShadowBindEpoch = 0;  // epoch of the FULL that bound them
+static uint32_t      s_peerSyncReqMs = 0;        // last PEER_SYNC_REQ (holdoff)
+static PosUpdateEntry s_posShadow[MESH_MAX_NODES];   // by short ID (= shadow index)
 
 // Gateway MAC — all nodes track this for heartbeat routing
 static uint8_t       s_gatewayMac[6] = {0};
 
+// Own identity, read once in init() (esp_read_mac is not free per send)
+static uint8_t       s_staMac[6] = {0};
+static uint8_t       s_apMac[6]  = {0};
+
+// Loopback: self-addressed sends are queued here and dispatched by the
+// meshLoop task like any received message (no radio, same handlers).
+// s_dispatchMutex keeps RX and loopback dispatch mutually exclusive.
+static RingbufHandle_t   s_loopRing      = nullptr;
+static SemaphoreHandle_t s_dispatchMutex = nullptr;
+static uint32_t          s_loopDelivered = 0;
+static uint32_t          s_loopDropped   = 0;
+
 // Election state
 static uint8_t     s_parentRetries  = 0;
 static TimerHandle_t s_electTimer   = nullptr;
@@ -51,10 +72,44 @@ static TaskHandle_t  s_electTaskHandle = nullptr;
 static ElectionScore s_scores[MESH_MAX_NODES];
 static uint8_t     s_scoreCount     = 0;
 static uint16_t    s_gwTenure       = 0;        // cached from NVS
+static uint16_t    s_electEpoch     = 0;        // last epoch decided or accepted
+static uint32_t    s_electStartMs   = 0;        // 0 = no election in progress
+static uint32_t    s_electConvergeMs = 0;       // last trigger → role assigned
+static uint8_t     s_electCandidates = 0;
+static uint8_t     s_rankMac[MESH_MAX_NODES][6];  // last election, best first
+static uint8_t     s_rankCount      = 0;
+
+// Warm rejoin: RtcMap still holds a settled mesh, so join the cached
+// parent and adopt the cached gateway instead of scanning and electing
+enum WarmPhase : uint8_t {
+    WARM_OFF = 0,
+    WARM_PARENT,     // waiting for the cached parent (falls back to a scan)
+    WARM_CONFIRM,    // role adopted, waiting for the gateway to accept us
+};
+static WarmPhase     s_warmPhase     = WARM_OFF;
+static bool          s_warmResumed   = false;   // this boot skipped the election
+static TimerHandle_t s_warmTimer     = nullptr;
+static uint8_t       s_warmPeers[MESH_MAX_NODES][6];   // cached routing table
+static uint8_t       s_warmPeerCount = 0;
+static uint32_t      s_joinMs        = 0;       // wake → first heartbeat accepted (0 = not yet)
+static bool          s_joinWarm      = false;
+
+// Gateway heartbeat ingress (frames/records/bytes since boot)
+static uint32_t    s_hbRxFrames     = 0;
+static uint32_t    s_hbRxRecords    = 0;
+static uint32_t    s_hbRxBytes      = 0;
+
+static esp_err_t meshSendFramed(const mesh_addr_t* to, int flag,
+                                const uint8_t* data, uint16_t len, uint16_t msgId);
+static uint16_t  fragNextMsgId();
 
 // BOOT button — force gateway promotion
 static void promoteTimerCb(TimerHandle_t t);  // forward decl
 
+// Warm rejoin: join timing (see "Warm rejoin" below)
+static void joinAccepted();
+static void checkOwnSyncEntry();
+
 static volatile uint32_t s_bootBtnLastEdge = 0;
 static volatile uint8_t  s_bootBtnEdges    = 0;
 
@@ -83,14 +138,29 @@ static void IRAM_ATTR bootButtonISR(void* arg) {
     }
 }
 
-// Config response wait mechanism
-static SemaphoreHandle_t s_configRespSema = nullptr;
-static char              s_configRespBuf[480];
-static uint8_t           s_configRespReqId = 0;
+// Remote config: outstanding requests keyed by (peer, reqId). Responses
+// are queued by the mesh RX task and drained by the configFanout() caller.
+struct CfgPending {
+    bool     used;
+    uint8_t  mac[6];
+    uint8_t  reqId;
+    uint32_t deadline_ms;
+};
+
+static CfgPending        s_cfgPending[MESH_MAX_NODES];
+static SemaphoreHandle_t s_cfgMutex     = nullptr;   // guards s_cfgPending
+static SemaphoreHandle_t s_cfgCallMutex = nullptr;   // one fan-out at a time
+static RingbufHandle_t   s_cfgRing      = nullptr;   // item: mac[6] + binary body
+static uint8_t           s_cfgNextReqId = 0;
+static uint32_t          s_cfgDropped   = 0;         // responses lost to a full ring
+
+static void configOnResp(const uint8_t* from, uint8_t reqId, const uint8_t* body, uint16_t len);
 
 // Task-notification bits for the election task
 static constexpr uint32_t ELECT_NOTIFY_RUN     = (1u << 0);
 static constexpr uint32_t ELECT_NOTIFY_TIMEOUT = (1u << 1);
+static constexpr uint32_t ELECT_NOTIFY_TAKEOVER = (1u << 2);
+static constexpr uint32_t ELECT_NOTIFY_MERGE   = (1u << 3);
 
 // --- NVS tenure helpers ---
 
@@ -116,14 +186,20 @@ static void nvsWriteTenure() {
 static void updateRtcMap() {
     rtc_mesh_map_t* map = RtcMap::get();
     map->own_role = (s_role && s_role->isGateway()) ? 1 : 0;
-    map->mesh_channel = MESH_CHANNEL;
+    if (s_connected) {
+        uint8_t primary = 0;
+        wifi_second_chan_t second;
+        if (esp_wifi_get_channel(&primary, &second) == ESP_OK && primary != 0)
+            map->mesh_channel = primary;
+        int layer = esp_mesh_get_layer();
+        map->own_layer = (layer > 0 && layer < 256) ? (uint8_t)layer : 0;
+    }
 
     mesh_addr_t routing_table[MESH_MAX_NODES];
     int table_size = 0;
-    esp_mesh_get_routing_table(routing_table, MESH_MAX_NODES, &table_size);
+    esp_mesh_get_routing_table(routing_table, sizeof(routing_table), &table_size);
 
-    uint8_t own_mac[6];
-    esp_read_mac(own_mac, ESP_MAC_WIFI_STA);
+    const uint8_t* own_mac = s_staMac;
 
     uint8_t count = 0;
     for (int i = 0; i < table_size && count < MESH_MAX_NODES; i++) {
@@ -134,10 +210,12 @@ static void updateRtcMap() {
         count++;
     }
     map->peer_count = count;
-    map->mesh_generation++;
 
-    if (esp_mesh_is_root()) {
-        memcpy(map->gateway_mac, own_mac, 6);
+    // Gateway and generation only change once a role is settled
+    static const uint8_t zero[6] = {0};
+    if (s_electionDone && memcmp(s_gatewayMac, zero, 6) != 0) {
+        memcpy(map->gateway_mac, s_gatewayMac, 6);
+        map->mesh_generation = 0x10000u | s_electEpoch;
     }
 
     RtcMap::save();
@@ -145,16 +223,27 @@ static void updateRtcMap() {
 
 // --- Election logic ---
 
+// Mean extra hops a command from this node travels, compared with a
+// gateway at the root. Peers outside our subtree pay (layer - 1) more hops
+// (up to the root and back down); peers inside it save as many. A node
+// whose subtree holds most of the flotilla can score better than the root.
+static float extraHopsVsRoot(int layer, int subtree, int total) {
+    if (layer <= 1 || total <= 1) return 0.0f;
+    if (subtree > total) subtree = total;
+    return (float)(layer - 1) * (float)(total - 2 * subtree + 1) / (float)(total - 1);
+}
+
 double MeshConductor::computeScore() {
     uint16_t battery = (uint16_t)PowerManager::batteryMv();
-    uint8_t own_mac[6];
-    esp_read_mac(own_mac, ESP_MAC_WIFI_STA);
+    const uint8_t* own_mac = s_staMac;
 
-    // Peer count from routing table
+    // Subtree size from routing table (includes self)
     mesh_addr_t routing_table[MESH_MAX_NODES];
     int table_size = 0;
-    esp_mesh_get_routing_table(routing_table, MESH_MAX_NODES, &table_size);
+    esp_mesh_get_routing_table(routing_table, sizeof(routing_table), &table_size);
     uint8_t peers = (table_size > 1) ? (uint8_t)(table_size - 1) : 0;
+    float extraHops = extraHopsVsRoot(esp_mesh_get_layer(), table_size,
+                                      esp_mesh_get_total_node_num());
 
     // MAC tiebreaker: last 2 bytes, scaled small so it never outweighs real factors
     double mac_tb = (double)(((uint16_t)own_mac[4] << 8) | own_mac[5]) / 65536.0;
@@ -162,6 +251,7 @@ double MeshConductor::computeScore() {
     double score = (double)battery    * (float)NvsConfigManager::electWBattery
                  + (double)peers      * (float)NvsConfigManager::electWAdjacency
                  - (double)s_gwTenure * (float)NvsConfigManager::electWTenure
+                 - (double)extraHops  * (float)NvsConfigManager::electWHops
                  + mac_tb;
 
     // Below battery floor: heavy penalty, but not disqualifying
@@ -172,32 +262,50 @@ double MeshConductor::computeScore() {
 }
 
 static void buildOwnScore(ElectionScore* out) {
-    uint8_t own_mac[6];
-    esp_read_mac(own_mac, ESP_MAC_WIFI_STA);
+    const uint8_t* own_mac = s_staMac;
 
     mesh_addr_t routing_table[MESH_MAX_NODES];
     int table_size = 0;
-    esp_mesh_get_routing_table(routing_table, MESH_MAX_NODES, &table_size);
+    esp_mesh_get_routing_table(routing_table, sizeof(routing_table), &table_size);
 
     out->type          = MSG_TYPE_ELECTION;
     memcpy(out->mac, own_mac, 6);
     out->battery_mv    = (uint16_t)PowerManager::batteryMv();
     out->peer_count    = (table_size > 1) ? (uint8_t)(table_size - 1) : 0;
     out->gateway_tenure = s_gwTenure;
+    out->layer         = (uint8_t)esp_mesh_get_layer();
+    out->extra_hops_x100 = (int16_t)(extraHopsVsRoot(out->layer, table_size,
+                                         esp_mesh_get_total_node_num()) * 100.0f);
     out->score         = MeshConductor::computeScore();
 }
 
-static void assignRole(const uint8_t* winnerMac) {
-    uint8_t own_mac[6];
-    esp_read_mac(own_mac, ESP_MAC_WIFI_STA);
+// Convergence timing: from the first election trigger (settle start or first
+// score seen) to the moment this node's role is settled.
+static void electionMarkStart() {
+    if (s_electStartMs == 0) s_electStartMs = millis() | 1;
+}
+
+static void electionMarkConverged() {
+    if (s_electStartMs == 0) return;
+    s_electConvergeMs = millis() - s_electStartMs;
+    s_electStartMs = 0;
+    SqLog.printf("[mesh] Election converged in %lu ms (epoch %u, %u candidates)\n",
+        (unsigned long)s_electConvergeMs, s_electEpoch, s_electCandidates);
+}
+
+// `newTerm` = false when a warm rejoin resumes the cached gateway's term
+static void assignRole(const uint8_t* winnerMac, bool newTerm = true) {
+    const uint8_t* own_mac = s_staMac;
 
     // Track logical gateway MAC on all nodes
     memcpy(s_gatewayMac, winnerMac, 6);
 
     IMeshRole* newRole;
     if (memcmp(own_mac, winnerMac, 6) == 0) {
-        s_gwTenure++;
-        nvsWriteTenure();
+        if (newTerm) {
+            s_gwTenure++;
+            nvsWriteTenure();
+        }
         newRole = &s_gateway;
         SqLog.println("[mesh] Role assigned: GATEWAY");
     } else {
@@ -210,12 +318,16 @@ static void assignRole(const uint8_t* winnerMac) {
     // Skip transition if already in the correct role
     if (s_role == newRole) {
         s_electionDone = true;
+        electionMarkConverged();
+        updateRtcMap();
         return;
     }
     if (s_role) s_role->end();
     s_electionDone = true;
+    electionMarkConverged();
     s_role = newRole;
     s_role->begin();
+    updateRtcMap();
 }
 
 static const uint8_t* pickWinner() {
@@ -235,6 +347,46 @@ static const uint8_t* pickWinner() {
     return s_scores[best].mac;
 }
 
+// Root only: publish the outcome as one ranked message instead of echoing
+// every ElectionScore, so nodes can decide the moment it arrives.
+static void broadcastElectionResult(const uint8_t* winner) {
+    static uint8_t buf[sizeof(ElectionResultMsg) + MESH_MAX_NODES * sizeof(ElectionResultEntry)];
+
+    // Rank: best first, exact ties broken by highest MAC (same order as pickWinner)
+    uint8_t order[MESH_MAX_NODES];
+    for (uint8_t i = 0; i < s_scoreCount; i++) {
+        uint8_t j = i;
+        while (j > 0) {
+            const ElectionScore& a = s_scores[order[j - 1]];
+            const ElectionScore& b = s_scores[i];
+            bool before = (b.score > a.score) ||
+                          (b.score == a.score && memcmp(b.mac, a.mac, 6) > 0);
+            if (!before) break;
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = i;
+    }
+
+    ElectionResultMsg* hdr = (ElectionResultMsg*)buf;
+    hdr->type = MSG_TYPE_ELECTION_RESULT;
+    hdr->epoch = ++s_electEpoch;
+    memcpy(hdr->winner, winner, 6);
+    hdr->count = s_scoreCount;
+    ElectionResultEntry* entries = (ElectionResultEntry*)(buf + sizeof(ElectionResultMsg));
+    for (uint8_t i = 0; i < s_scoreCount; i++) {
+        memcpy(entries[i].mac, s_scores[order[i]].mac, 6);
+        entries[i].score = (float)s_scores[order[i]].score;
+        memcpy(s_rankMac[i], entries[i].mac, 6);
+    }
+    s_rankCount = s_scoreCount;
+
+    mesh_addr_t bcast;
+    memset(&bcast, 0xFF, sizeof(bcast));
+    uint16_t len = sizeof(ElectionResultMsg) + s_scoreCount * sizeof(ElectionResultEntry);
+    meshSendFramed(&bcast, MESH_DATA_P2P, buf, len, fragNextMsgId());
+}
+
 // Called by the election timer or when single-node fallback triggers
 static void electionTimerCallback(TimerHandle_t xTimer) {
     (void)xTimer;
@@ -252,14 +404,14 @@ static void electionTimerCallback(TimerHandle_t xTimer) {
                 s_role->begin();
             }
             s_electionDone = true;
+            electionMarkConverged();
             return;
         }
     }
 
     // Add own score if not already present
     bool selfPresent = false;
-    uint8_t own_mac[6];
-    esp_read_mac(own_mac, ESP_MAC_WIFI_STA);
+    const uint8_t* own_mac = s_staMac;
     for (uint8_t i = 0; i < s_scoreCount; i++) {
         if (memcmp(s_scores[i].mac, own_mac, 6) == 0) {
             selfPresent = true;
@@ -272,18 +424,22 @@ static void electionTimerCallback(TimerHandle_t xTimer) {
 
     SqLog.printf("[mesh] Election: %d candidates\n", s_scoreCount);
     for (uint8_t i = 0; i < s_scoreCount; i++) {
-        SqLog.printf("[mesh]   %02X:%02X:%02X:%02X:%02X:%02X  bat=%umV peers=%u tenure=%u score=%.1f\n",
+        SqLog.printf("[mesh]   %02X:%02X:%02X:%02X:%02X:%02X  bat=%umV peers=%u layer=%u hops%+.2f tenure=%u score=%.1f\n",
             s_scores[i].mac[0], s_scores[i].mac[1], s_scores[i].mac[2],
             s_scores[i].mac[3], s_scores[i].mac[4], s_scores[i].mac[5],
-            s_scores[i].battery_mv, s_scores[i].peer_count,
+            s_scores[i].battery_mv, s_scores[i].peer_count, s_scores[i].layer,
+            s_scores[i].extra_hops_x100 / 100.0f,
             s_scores[i].gateway_tenure, s_scores[i].score);
     }
 
     const uint8_t* winner = pickWinner();
+    s_electCandidates = s_scoreCount;
     if (winner) {
         SqLog.printf("[mesh] Election winner: %02X:%02X:%02X:%02X:%02X:%02X\n",
             winner[0], winner[1], winner[2], winner[3], winner[4], winner[5]);
 
+        if (esp_mesh_is_root()) broadcastElectionResult(winner);
+
         // Check if ESP-IDF root matches election winner
         if (esp_mesh_is_root() && memcmp(own_mac, winner, 6) != 0) {
             // We are root but not the winner — waive root to winner
@@ -309,22 +465,28 @@ static void electionTimerCallback(TimerHandle_t xTimer) {
             s_role = &s_meshNode;
             s_electionDone = true;
             s_role->begin();
+            electionMarkConverged();
         }
     }
 }
 
 void MeshConductor::runElection() {
     if (s_electionDone) return;
-
-    s_scoreCount = 0;
+    electionMarkStart();
 
     // Broadcast own score to root (or to all if we are root)
     ElectionScore myScore;
     buildOwnScore(&myScore);
 
-    // Store own score locally
-    if (s_scoreCount < MESH_MAX_NODES) {
-        s_scores[s_scoreCount++] = myScore;
+    // Store own score locally. Scores that arrived while we were still
+    // settling are kept — s_scoreCount is reset when an election is armed.
+    uint8_t own = s_scoreCount;
+    for (uint8_t i = 0; i < s_scoreCount; i++) {
+        if (memcmp(s_scores[i].mac, myScore.mac, 6) == 0) { own = i; break; }
+    }
+    if (own < MESH_MAX_NODES) {
+        s_scores[own] = myScore;
+        if (own == s_scoreCount) s_scoreCount++;
     }
 
     // Check total nodes in mesh
@@ -333,8 +495,7 @@ void MeshConductor::runElection() {
     if (totalNodes <= 1) {
         // Single node — instant self-election
         SqLog.println("[mesh] Single node — self-electing as Gateway");
-        uint8_t own_mac[6];
-        esp_read_mac(own_mac, ESP_MAC_WIFI_STA);
+        const uint8_t* own_mac = s_staMac;
         assignRole(own_mac);
         return;
     }
@@ -361,299 +522,867 @@ void MeshConductor::runElection() {
     // Stop settle timer (election is now active) and start election timeout
     if (s_settleTimer) xTimerStop(s_settleTimer, 0);
     xTimerChangePeriod(s_electTimer, pdMS_TO_TICKS(ELECT_TIMEOUT_MS), 0);
+
+    // Root may already hold every score (children that finished settling first)
+    if (esp_mesh_is_root() && (int)s_scoreCount >= totalNodes) {
+        xTimerStop(s_electTimer, 0);
+        electionTimerCallback(nullptr);
+    }
 }
 
-// --- Mesh data receive task ---
+// --- Fragmentation / reassembly ---
+//
+// Messages longer than MESH_FRAG_MTU are split into FRAGMENT frames by the
+// send helpers and stitched back together here before normal dispatch, so
+// callers never see the frame limit.  Reassembly uses a fixed pool; a slot
+// that has not completed within MESH_FRAG_TIMEOUT_MS is reclaimed lazily.
+
+static constexpr uint16_t FRAG_CHUNK = MESH_FRAG_MTU - sizeof(FragmentHeader);
+static constexpr uint16_t FRAG_MAX_COUNT =
+    (MESH_FRAG_MAX_PAYLOAD + FRAG_CHUNK - 1) / FRAG_CHUNK;
+static_assert(FRAG_MAX_COUNT <= 32, "rx_mask holds at most 32 fragments");
+
+struct FragSlot {
+    bool     used;
+    uint8_t  src[6];
+    uint16_t msg_id;
+    uint16_t total_len;
+    uint8_t  frag_count;
+    uint32_t rx_mask;        // bit i set = fragment i received
+    uint32_t started_ms;
+    uint8_t  buf[MESH_FRAG_MAX_PAYLOAD];
+};
+
+static FragSlot  s_fragPool[MESH_FRAG_POOL_SLOTS];
+static uint16_t  s_fragNextId   = 0;
+static uint32_t  s_fragTimeouts = 0;   // partial messages dropped (timeout/eviction)
+static uint32_t  s_fragRejects  = 0;   // malformed or oversize fragments
+
+static uint16_t fragNextMsgId() {
+    return ++s_fragNextId;
+}
 
-static void meshRxTask(void* pvParameters) {
-    mesh_addr_t from;
-    mesh_data_t data;
-    uint8_t rx_buf[512];
-    data.data = rx_buf;
-    data.size = sizeof(rx_buf);
-    int flag = 0;
+// One esp_mesh_send, timed into the destination's link stats. The call
+// blocks while the mesh TX queue towards the next hop is full, so its
+// duration tracks local congestion on that path. Broadcast and group
+// addresses (I/G bit set) name no single peer and are not recorded.
+static esp_err_t meshSendTimed(const mesh_addr_t* to, const mesh_data_t* mdata, int flag) {
+    uint32_t t0 = micros();
+    esp_err_t err = esp_mesh_send(to, mdata, flag, NULL, 0);
+    if (to && !(to->addr[0] & 0x01)) LinkStats::onSend(to->addr, micros() - t0, err == ESP_OK);
+    return err;
+}
 
-    while (s_started) {
-        esp_err_t err = esp_mesh_recv(&from, &data, portMAX_DELAY, &flag, NULL, 0);
-        if (err != ESP_OK) {
-            vTaskDelay(pdMS_TO_TICKS(100));
+// Send `len` bytes to `to` (nullptr = root), splitting into FRAGMENT frames
+// when the payload does not fit a single frame.
+static esp_err_t meshSendFramed(const mesh_addr_t* to, int flag,
+                                const uint8_t* data, uint16_t len, uint16_t msgId) {
+    mesh_data_t mdata;
+    mdata.proto = MESH_PROTO_BIN;
+    mdata.tos = MESH_TOS_P2P;
+
+    if (len <= MESH_FRAG_MTU) {
+        mdata.data = (uint8_t*)data;
+        mdata.size = len;
+        return meshSendTimed(to, &mdata, flag);
+    }
+    if (len > MESH_FRAG_MAX_PAYLOAD) {
+        SqLog.printf("[mesh] Message type 0x%02X too large to fragment (%u > %u)\n",
+                     data[0], len, MESH_FRAG_MAX_PAYLOAD);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint8_t frame[MESH_FRAG_MTU];
+    FragmentHeader* hdr = (FragmentHeader*)frame;
+    hdr->type = MSG_TYPE_FRAGMENT;
+    hdr->msg_id = msgId;
+    hdr->frag_count = (uint8_t)((len + FRAG_CHUNK - 1) / FRAG_CHUNK);
+    hdr->total_len = len;
+
+    for (uint8_t i = 0; i < hdr->frag_count; i++) {
+        uint16_t offset = i * FRAG_CHUNK;
+        uint16_t chunk = (len - offset < FRAG_CHUNK) ? (len - offset) : FRAG_CHUNK;
+        hdr->frag_idx = i;
+        memcpy(frame + sizeof(FragmentHeader), data + offset, chunk);
+        mdata.data = frame;
+        mdata.size = sizeof(FragmentHeader) + chunk;
+        esp_err_t err = meshSendTimed(to, &mdata, flag);
+        if (err != ESP_OK) return err;  // receiver will time the partial out
+    }
+    return ESP_OK;
+}
+
+// Store one fragment. Returns the slot once the message is complete (caller
+// dispatches and then clears slot->used), nullptr otherwise.
+static FragSlot* fragAccept(const uint8_t* src, const uint8_t* frame, uint16_t len) {
+    const FragmentHeader* hdr = (const FragmentHeader*)frame;
+    uint16_t chunk = len - sizeof(FragmentHeader);
+    uint16_t offset = hdr->frag_idx * FRAG_CHUNK;
+
+    if (hdr->total_len == 0 || hdr->total_len > MESH_FRAG_MAX_PAYLOAD ||
+        hdr->frag_count == 0 || hdr->frag_count > FRAG_MAX_COUNT ||
+        hdr->frag_idx >= hdr->frag_count ||
+        offset + chunk > hdr->total_len) {
+        s_fragRejects++;
+        return nullptr;
+    }
+
+    uint32_t now = millis();
+    FragSlot* slot = nullptr;
+    FragSlot* freeSlot = nullptr;
+    FragSlot* oldest = nullptr;
+
+    for (uint8_t i = 0; i < MESH_FRAG_POOL_SLOTS; i++) {
+        FragSlot* s = &s_fragPool[i];
+        if (s->used && (now - s->started_ms) > MESH_FRAG_TIMEOUT_MS) {
+            SqLog.printf("[mesh] Reassembly timeout: msg %u from %02X:%02X (%u/%u frags)\n",
+                s->msg_id, s->src[4], s->src[5],
+                (unsigned)__builtin_popcount(s->rx_mask), s->frag_count);
+            s->used = false;
+            s_fragTimeouts++;
+        }
+        if (!s->used) {
+            if (!freeSlot) freeSlot = s;
             continue;
         }
+        if (s->msg_id == hdr->msg_id && memcmp(s->src, src, 6) == 0) {
+            slot = s;
+            break;
+        }
+        if (!oldest || (int32_t)(s->started_ms - oldest->started_ms) < 0)
+            oldest = s;
+    }
 
-        if (data.size >= 1 && rx_buf[0] == MSG_TYPE_ELECTION) {
-            if (data.size >= sizeof(ElectionScore) && !s_electionDone) {
-                ElectionScore* incoming = (ElectionScore*)rx_buf;
+    if (!slot) {
+        if (!freeSlot) {
+            // Pool exhausted — evict the oldest partial message
+            freeSlot = oldest;
+            s_fragTimeouts++;
+        }
+        slot = freeSlot;
+        slot->used = true;
+        memcpy(slot->src, src, 6);
+        slot->msg_id = hdr->msg_id;
+        slot->total_len = hdr->total_len;
+        slot->frag_count = hdr->frag_count;
+        slot->rx_mask = 0;
+        slot->started_ms = now;
+    } else if (slot->total_len != hdr->total_len || slot->frag_count != hdr->frag_count) {
+        s_fragRejects++;
+        slot->used = false;
+        return nullptr;
+    }
 
-                // Check for duplicate
-                bool dup = false;
-                for (uint8_t i = 0; i < s_scoreCount; i++) {
-                    if (memcmp(s_scores[i].mac, incoming->mac, 6) == 0) {
-                        dup = true;
-                        break;
-                    }
-                }
-                if (!dup && s_scoreCount < MESH_MAX_NODES) {
-                    s_scores[s_scoreCount++] = *incoming;
-                    SqLog.printf("[mesh] Received election score from %02X:%02X:%02X:%02X:%02X:%02X score=%.1f\n",
-                        incoming->mac[0], incoming->mac[1], incoming->mac[2],
-                        incoming->mac[3], incoming->mac[4], incoming->mac[5],
-                        incoming->score);
-
-                    // If we are root, check if we have all scores
-                    if (esp_mesh_is_root()) {
-                        int totalNodes = esp_mesh_get_total_node_num();
-                        if ((int)s_scoreCount >= totalNodes) {
-                            // All scores collected — broadcast results and decide
-                            // Send all scores to every node
-                            for (uint8_t i = 0; i < s_scoreCount; i++) {
-                                mesh_data_t bcast_data;
-                                bcast_data.data = (uint8_t*)&s_scores[i];
-                                bcast_data.size = sizeof(ElectionScore);
-                                bcast_data.proto = MESH_PROTO_BIN;
-                                bcast_data.tos = MESH_TOS_P2P;
-                                mesh_addr_t bcast;
-                                memset(&bcast, 0xFF, sizeof(bcast));
-                                esp_mesh_send(&bcast, &bcast_data, MESH_DATA_P2P, NULL, 0);
-                            }
-                            // Cancel timeout and decide now
-                            if (s_electTimer) xTimerStop(s_electTimer, 0);
-                            electionTimerCallback(nullptr);
-                        }
-                    } else {
-                        // Non-root: check if we have enough scores to decide
-                        int totalNodes = esp_mesh_get_total_node_num();
-                        if ((int)s_scoreCount >= totalNodes && !s_electionDone) {
-                            if (s_electTimer) xTimerStop(s_electTimer, 0);
-                            electionTimerCallback(nullptr);
-                        }
-                    }
-                }
-            }
+    memcpy(slot->buf + offset, frame + sizeof(FragmentHeader), chunk);
+    slot->rx_mask |= (1u << hdr->frag_idx);
+
+    uint32_t full = (slot->frag_count == 32) ? 0xFFFFFFFFu : ((1u << slot->frag_count) - 1);
+    return (slot->rx_mask == full) ? slot : nullptr;
+}
+
+// --- Reliable channel ---
+//
+// Opt-in ACK/retransmit for critical messages. Each frame carries the
+// sender's boot session and a per-destination sequence number; the receiver
+// answers with a cumulative + selective ACK and suppresses duplicates.
+// Messages are delivered as soon as they arrive (no reordering), so a lost
+// frame never holds back later ones, and best-effort traffic bypasses this
+// layer entirely. RTO follows the Jacobson/Karels estimator per destination.
+
+struct RelPeer {
+    bool     used;
+    uint8_t  mac[6];
+    uint32_t last_used_ms;
+    // TX side
+    uint16_t tx_seq;          // next sequence number to send
+    uint16_t srtt_ms;         // 0 = no RTT sample yet
+    uint16_t rttvar_ms;
+    uint16_t rto_ms;
+    // RX side
+    bool     rx_valid;
+    uint16_t rx_session;
+    uint16_t rx_base;         // next expected sequence number
+    uint32_t rx_mask;         // bit i = seq rx_base+1+i already received
+};
+
+struct RelSlot {
+    bool     used;
+    bool     sending;         // frame being transmitted outside the mutex: don't reuse
+    uint8_t  dest[6];
+    uint16_t seq;
+    uint8_t  retries;
+    uint32_t sent_ms;         // last (re)transmission
+    uint32_t first_ms;        // first transmission (for RTT sampling)
+    uint16_t len;             // header + payload
+    MeshConductor::ReliableDoneCb done;   // optional, called once with the outcome
+    void*    ctx;
+    uint8_t  frame[MESH_FRAG_MTU];
+};
+
+static RelPeer           s_relPeers[MESH_MAX_NODES];
+static RelSlot           s_relSlots[MESH_REL_SLOTS];
+static SemaphoreHandle_t s_relMutex   = nullptr;
+static TimerHandle_t     s_relTimer   = nullptr;
+static uint16_t          s_relSession = 0;
+
+static uint32_t s_relSent = 0, s_relRetx = 0, s_relAcked = 0, s_relFailed = 0, s_relDups = 0;
+static uint32_t s_relNoSlot = 0;   // sends refused with ESP_ERR_NO_MEM
+
+static RelPeer* relPeer(const uint8_t* mac, bool create) {
+    RelPeer* freeP = nullptr;
+    RelPeer* oldest = nullptr;
+    for (uint8_t i = 0; i < MESH_MAX_NODES; i++) {
+        RelPeer* p = &s_relPeers[i];
+        if (!p->used) {
+            if (!freeP) freeP = p;
+            continue;
+        }
+        if (memcmp(p->mac, mac, 6) == 0) {
+            p->last_used_ms = millis();
+            return p;
         }
+        if (!oldest || (int32_t)(p->last_used_ms - oldest->last_used_ms) < 0)
+            oldest = p;
+    }
+    if (!create) return nullptr;
+
+    RelPeer* p = freeP ? freeP : oldest;
+    memset(p, 0, sizeof(RelPeer));
+    p->used = true;
+    memcpy(p->mac, mac, 6);
+    p->rto_ms = MESH_REL_RTO_INIT_MS;
+    p->last_used_ms = millis();
+    return p;
+}
 
-        // --- Phase 2 message dispatch ---
+static void relSampleRtt(RelPeer* p, uint32_t rtt) {
+    if (rtt > 0xFFFF) rtt = 0xFFFF;
+    if (p->srtt_ms == 0) {
+        p->srtt_ms = (uint16_t)rtt;
+        p->rttvar_ms = (uint16_t)(rtt / 2);
+    } else {
+        int32_t err = (int32_t)rtt - (int32_t)p->srtt_ms;
+        if (err < 0) err = -err;
+        p->rttvar_ms = (uint16_t)((3 * (uint32_t)p->rttvar_ms + (uint32_t)err) / 4);
+        p->srtt_ms   = (uint16_t)((7 * (uint32_t)p->srtt_ms + rtt) / 8);
+    }
+    uint32_t rto = (uint32_t)p->srtt_ms + 4 * (uint32_t)p->rttvar_ms;
+    if (rto < MESH_REL_RTO_MIN_MS) rto = MESH_REL_RTO_MIN_MS;
+    if (rto > MESH_REL_RTO_MAX_MS) rto = MESH_REL_RTO_MAX_MS;
+    p->rto_ms = (uint16_t)rto;
+}
 
-        if (data.size >= 1) {
-            uint8_t msgType = rx_buf[0];
+static void relSendFrame(const uint8_t* dest, const uint8_t* frame, uint16_t len) {
+    mesh_addr_t addr;
+    memcpy(addr.addr, dest, 6);
+    meshSendFramed(&addr, MESH_DATA_P2P, frame, len, 0);
+}
 
-            if (msgType == MSG_TYPE_HEARTBEAT && data.size >= sizeof(HeartbeatMsg)) {
-                HeartbeatMsg* hb = (HeartbeatMsg*)rx_buf;
-                if (s_role && s_role->isGateway()) {
-                    PeerTable::updateFromHeartbeat(hb->mac, hb->battery_mv,
-                                                    hb->flags, hb->softap_mac);
+// Periodic retransmit scan (timer service context). The mutex is held
+// only to inspect a slot: sends, callbacks and stats run after releasing
+// it, so a blocking esp_mesh_send never stalls the RX task's ACK path.
+static void relTimerCb(TimerHandle_t t) {
+    (void)t;
+    if (!s_relMutex) return;
+
+    for (uint8_t i = 0; i < MESH_REL_SLOTS; i++) {
+        RelSlot* s = &s_relSlots[i];
+        xSemaphoreTake(s_relMutex, portMAX_DELAY);
+        if (!s->used || s->sending) {
+            xSemaphoreGive(s_relMutex);
+            continue;
+        }
+        uint32_t now = millis();
+        RelPeer* p = relPeer(s->dest, true);
+        // Exponential backoff on top of the current RTO
+        uint32_t timeout = (uint32_t)p->rto_ms << s->retries;
+        if (timeout > MESH_REL_RTO_MAX_MS) timeout = MESH_REL_RTO_MAX_MS;
+        if ((now - s->sent_ms) < timeout) {
+            xSemaphoreGive(s_relMutex);
+            continue;
+        }
+
+        uint8_t dest[6];
+        memcpy(dest, s->dest, 6);
+        if (s->retries >= MESH_REL_MAX_RETRIES) {
+            MeshConductor::ReliableDoneCb done = s->done;
+            void* ctx = s->ctx;
+            uint8_t type = s->frame[sizeof(ReliableHeader)];
+            uint16_t seq = s->seq;
+            uint8_t tries = s->retries + 1;
+            s->used = false;
+            s_relFailed++;
+            xSemaphoreGive(s_relMutex);
+
+            SqLog.printf("[mesh] Reliable: type 0x%02X seq %u to %02X:%02X undelivered after %u tries\n",
+                type, seq, dest[4], dest[5], tries);
+            LinkStats::onGiveUp(dest);
+            if (done) done(dest, false, ctx);
+            continue;
+        }
+        s->retries++;
+        s->sent_ms = now;
+        s->sending = true;
+        s_relRetx++;
+        xSemaphoreGive(s_relMutex);
+
+        // The slot can be ACKed meanwhile, but not reused until sending clears
+        LinkStats::onRetransmit(dest);
+        relSendFrame(dest, s->frame, s->len);
+        xSemaphoreTake(s_relMutex, portMAX_DELAY);
+        s->sending = false;
+        xSemaphoreGive(s_relMutex);
+    }
+}
+
+static void relOnAck(const uint8_t* src, const ReliableAckMsg* ack) {
+    if (ack->session != s_relSession) return;   // ACK for a previous boot
+    MeshConductor::ReliableDoneCb done[MESH_REL_SLOTS];
+    void*    ctx[MESH_REL_SLOTS];
+    uint8_t  nDone = 0;
+    uint32_t rttMs = UINT32_MAX;
+
+    xSemaphoreTake(s_relMutex, portMAX_DELAY);
+    RelPeer* p = relPeer(src, false);
+    uint32_t now = millis();
+    for (uint8_t i = 0; i < MESH_REL_SLOTS; i++) {
+        RelSlot* s = &s_relSlots[i];
+        if (!s->used || memcmp(s->dest, src, 6) != 0) continue;
+        int16_t d = (int16_t)(s->seq - ack->cum_seq);
+        bool acked = (d < 0) || (d >= 1 && d <= 32 && ((ack->sack_mask >> (d - 1)) & 1));
+        if (!acked) continue;
+        // Karn: only sample RTT from frames that were never retransmitted
+        if (s->retries == 0) {
+            if (p) relSampleRtt(p, now - s->first_ms);
+            rttMs = now - s->first_ms;
+        }
+        if (s->done) {
+            done[nDone] = s->done;
+            ctx[nDone++] = s->ctx;
+        }
+        s->used = false;
+        s_relAcked++;
+    }
+    xSemaphoreGive(s_relMutex);
+
+    if (rttMs != UINT32_MAX) LinkStats::onRtt(src, rttMs * 1000u);
+    for (uint8_t i = 0; i < nDone; i++) done[i](src, true, ctx[i]);
+}
+
+// Update RX window for an incoming reliable frame and ACK it.
+// Returns true if the payload is new and should be dispatched.
+static bool relAccept(const uint8_t* src, const ReliableHeader* hdr) {
+    xSemaphoreTake(s_relMutex, portMAX_DELAY);
+    RelPeer* p = relPeer(src, true);
+    if (!p->rx_valid || p->rx_session != hdr->session) {
+        // First frame from this sender (or it rebooted) — start a fresh window
+        p->rx_valid = true;
+        p->rx_session = hdr->session;
+        p->rx_base = hdr->seq;
+        p->rx_mask = 0;
+    }
+
+    bool fresh;
+    int16_t d = (int16_t)(hdr->seq - p->rx_base);
+    if (d < 0) {
+        fresh = false;
+    } else if (d == 0) {
+        fresh = true;
+        p->rx_base++;
+        while (p->rx_mask & 1) {   // slide over frames already received out of order
+            p->rx_mask >>= 1;
+            p->rx_base++;
+        }
+        p->rx_mask >>= 1;
+    } else if (d <= 32) {
+        uint32_t bit = 1u << (d - 1);
+        fresh = !(p->rx_mask & bit);
+        p->rx_mask |= bit;
+    } else {
+        // Far ahead: the sender has given up on the gap, so restart the window
+        fresh = true;
+        p->rx_base = hdr->seq + 1;
+        p->rx_mask = 0;
+    }
+
+    ReliableAckMsg ack;
+    ack.type = MSG_TYPE_RELIABLE_ACK;
+    ack.session = hdr->session;
+    ack.cum_seq = p->rx_base;
+    ack.sack_mask = p->rx_mask;
+    xSemaphoreGive(s_relMutex);
+
+    if (!fresh) s_relDups++;
+    relSendFrame(src, (const uint8_t*)&ack, sizeof(ack));
+    return fresh;
+}
+
+// --- Mesh data receive task ---
+
+// Dispatch one complete message.
+static void dispatchMessage(const mesh_addr_t& from, uint8_t* rx_buf, uint16_t size) {
+    if (memcmp(from.addr, s_gatewayMac, 6) == 0)
+        HotStandby::onGatewayHeard();
+
+    // Reliable-channel framing: ACK and unwrap, then dispatch the payload
+    if (size > sizeof(ReliableHeader) && rx_buf[0] == MSG_TYPE_RELIABLE) {
+        if (s_relMutex && relAccept(from.addr, (const ReliableHeader*)rx_buf))
+            dispatchMessage(from, rx_buf + sizeof(ReliableHeader), size - sizeof(ReliableHeader));
+        return;
+    }
+    if (size >= sizeof(ReliableAckMsg) && rx_buf[0] == MSG_TYPE_RELIABLE_ACK) {
+        if (s_relMutex) relOnAck(from.addr, (const ReliableAckMsg*)rx_buf);
+        return;
+    }
+    if (size >= sizeof(LinkPingMsg) && rx_buf[0] == MSG_TYPE_LINK_PING) {
+        LinkStats::onPing(from.addr, rx_buf, size);
+        return;
+    }
+    if (size >= sizeof(LinkPingMsg) && rx_buf[0] == MSG_TYPE_LINK_PONG) {
+        LinkStats::onPong(from.addr, rx_buf, size);
+        return;
+    }
+
+    if (size >= 1 && rx_buf[0] == MSG_TYPE_ELECTION) {
+        if (size >= sizeof(ElectionScore) && s_electionDone && !esp_mesh_is_root()) {
+            // Root re-elects (e.g. a child joined): only the root broadcasts
+            // scores, so rejoin with a fresh score rather than letting it
+            // wait for ELECT_TIMEOUT_MS. Current role stays until the result.
+            SqLog.println("[mesh] Root started re-election — rejoining");
+            s_electionDone = false;
+            s_scoreCount = 0;
+            electionMarkStart();
+            if (s_electTaskHandle)
+                xTaskNotify(s_electTaskHandle, ELECT_NOTIFY_RUN, eSetBits);
+        }
+        if (size >= sizeof(ElectionScore) && !s_electionDone) {
+            ElectionScore* incoming = (ElectionScore*)rx_buf;
+            electionMarkStart();
+
+            // Check for duplicate
+            bool dup = false;
+            for (uint8_t i = 0; i < s_scoreCount; i++) {
+                if (memcmp(s_scores[i].mac, incoming->mac, 6) == 0) {
+                    dup = true;
+                    break;
                 }
             }
-            else if (msgType == MSG_TYPE_FTM_WAKE && data.size >= sizeof(FtmWakeMsg)) {
-                FtmWakeMsg* wake = (FtmWakeMsg*)rx_buf;
-                FtmManager::onFtmWake(wake->initiator, wake->responder, wake->responder_ap);
-            }
-            else if (msgType == MSG_TYPE_FTM_GO && data.size >= sizeof(FtmGoMsg)) {
-                FtmGoMsg* go = (FtmGoMsg*)rx_buf;
-                FtmManager::onFtmGo(go->target_ap, go->samples);
+            if (!dup && s_scoreCount < MESH_MAX_NODES) {
+                s_scores[s_scoreCount++] = *incoming;
+                SqLog.printf("[mesh] Received election score from %02X:%02X:%02X:%02X:%02X:%02X score=%.1f\n",
+                    incoming->mac[0], incoming->mac[1], incoming->mac[2],
+                    incoming->mac[3], incoming->mac[4], incoming->mac[5],
+                    incoming->score);
             }
-            else if (msgType == MSG_TYPE_FTM_READY && data.size >= sizeof(FtmReadyMsg)) {
-                FtmReadyMsg* ready = (FtmReadyMsg*)rx_buf;
-                if (s_role && s_role->isGateway()) {
-                    FtmScheduler::onFtmReady(ready->mac);
+
+            if (s_settleTimer && xTimerIsTimerActive(s_settleTimer) == pdTRUE) {
+                // Someone else already started — join now instead of waiting
+                // out our own settle delay
+                xTimerStop(s_settleTimer, 0);
+                if (s_electTaskHandle)
+                    xTaskNotify(s_electTaskHandle, ELECT_NOTIFY_RUN, eSetBits);
+            } else if (!dup && esp_mesh_is_root()) {
+                // Root decides as soon as every node has reported
+                int totalNodes = esp_mesh_get_total_node_num();
+                if ((int)s_scoreCount >= totalNodes) {
+                    if (s_electTimer) xTimerStop(s_electTimer, 0);
+                    electionTimerCallback(nullptr);
                 }
             }
-            else if (msgType == MSG_TYPE_FTM_RESULT && data.size >= sizeof(FtmResultMsg)) {
-                FtmResultMsg* result = (FtmResultMsg*)rx_buf;
-                if (s_role && s_role->isGateway()) {
-                    FtmScheduler::onFtmResult(result->initiator, result->responder,
-                                               result->distance_cm, result->status);
-                }
+        }
+    }
+    else if (size >= sizeof(ElectionResultMsg) && rx_buf[0] == MSG_TYPE_ELECTION_RESULT) {
+        const ElectionResultMsg* res = (const ElectionResultMsg*)rx_buf;
+        uint16_t need = sizeof(ElectionResultMsg) + res->count * sizeof(ElectionResultEntry);
+        // Accept while electing, or a newer epoch (re-election we were not part of)
+        bool newer = (int16_t)(res->epoch - s_electEpoch) > 0;
+        if (size >= need && !esp_mesh_is_root() && (!s_electionDone || newer)) {
+            s_electEpoch = res->epoch;
+            s_electCandidates = res->count;
+            const ElectionResultEntry* entries =
+                (const ElectionResultEntry*)(rx_buf + sizeof(ElectionResultMsg));
+            s_rankCount = (res->count < MESH_MAX_NODES) ? res->count : MESH_MAX_NODES;
+            for (uint8_t i = 0; i < s_rankCount; i++)
+                memcpy(s_rankMac[i], entries[i].mac, 6);
+            SqLog.printf("[mesh] Election result (epoch %u, %u candidates): winner %02X:%02X:%02X:%02X:%02X:%02X\n",
+                res->epoch, res->count,
+                res->winner[0], res->winner[1], res->winner[2],
+                res->winner[3], res->winner[4], res->winner[5]);
+            if (s_settleTimer) xTimerStop(s_settleTimer, 0);
+            if (s_electTimer) xTimerStop(s_electTimer, 0);
+            assignRole(res->winner);
+        }
+    }
+
+    // --- Phase 2 message dispatch ---
+
+    if (size >= 1) {
+        uint8_t msgType = rx_buf[0];
+
+        if (msgType == MSG_TYPE_HEARTBEAT && size >= sizeof(HeartbeatMsg)) {
+            HeartbeatMsg* hb = (HeartbeatMsg*)rx_buf;
+            if (s_role && s_role->isGateway()) {
+                PeerTable::updateFromHeartbeat(hb->mac, hb->battery_mv,
+                                                hb->flags, hb->softap_mac, hb->interval_s);
+                s_hbRxFrames++;
+                s_hbRxRecords++;
+                s_hbRxBytes += size;
+                joinAccepted();
+            } else {
+                MeshNode::onChildHeartbeat(hb);   // fold into our next HB_AGG
             }
-            else if (msgType == MSG_TYPE_FTM_CANCEL) {
-                // Cancel any in-progress FTM session
-                SqLog.println("[mesh] FTM_CANCEL received");
+        }
+        else if (msgType == MSG_TYPE_HB_AGG && size >= sizeof(HeartbeatAggMsg)) {
+            if (s_role && s_role->isGateway()) {
+                const HeartbeatAggMsg* agg = (const HeartbeatAggMsg*)rx_buf;
+                uint8_t applied = PeerTable::applyHeartbeatBatch(
+                    rx_buf + sizeof(HeartbeatAggMsg), size - sizeof(HeartbeatAggMsg), agg->count,
+                    agg->epoch);
+                if (applied) joinAccepted();
+                s_hbRxRecords += applied;
+                s_hbRxFrames++;
+                s_hbRxBytes += size;
+            } else {
+                MeshNode::onChildAggregate(rx_buf, size);
             }
-            else if (msgType == MSG_TYPE_POS_UPDATE && data.size >= sizeof(PosUpdateMsg)) {
-                PosUpdateMsg* pos = (PosUpdateMsg*)rx_buf;
+        }
+        else if (msgType == MSG_TYPE_HB_PARENT && size >= sizeof(HbParentMsg)) {
+            MeshNode::setHeartbeatParent(((const HbParentMsg*)rx_buf)->parent);
+        }
+        else if (msgType == MSG_TYPE_FTM_WAKE && size >= sizeof(FtmWakeMsg)) {
+            FtmWakeMsg* wake = (FtmWakeMsg*)rx_buf;
+            FtmManager::onFtmWake(wake->initiator, wake->responder, wake->responder_ap);
+        }
+        else if (msgType == MSG_TYPE_FTM_GO && size >= sizeof(FtmGoMsg)) {
+            FtmGoMsg* go = (FtmGoMsg*)rx_buf;
+            FtmManager::onFtmGo(go->target_ap, go->samples);
+        }
+        else if (msgType == MSG_TYPE_FTM_READY && size >= sizeof(FtmReadyMsg)) {
+            FtmReadyMsg* ready = (FtmReadyMsg*)rx_buf;
+            if (s_role && s_role->isGateway()) {
+                FtmScheduler::onFtmReady(ready->mac);
+            }
+        }
+        else if (msgType == MSG_TYPE_FTM_RESULT && size >= sizeof(FtmResultMsg)) {
+            FtmResultMsg* result = (FtmResultMsg*)rx_buf;
+            if (s_role && s_role->isGateway()) {
+                FtmScheduler::onFtmResult(result->initiator, result->responder,
+                                           result->distance_cm, result->status);
+            }
+        }
+        else if (msgType == MSG_TYPE_FTM_CANCEL) {
+            // Cancel any in-progress FTM session
+            SqLog.println("[mesh] FTM_CANCEL received");
+        }
+        else if (msgType == MSG_TYPE_POS_UPDATE && size >= sizeof(PosUpdateMsg)) {
+            PosUpdateMsg* pos = (PosUpdateMsg*)rx_buf;
+            uint16_t expected = sizeof(PosUpdateMsg) + pos->count * sizeof(PosUpdateEntry);
+            if (pos->version != MESH_WIRE_VERSION) {
+                SqLog.printf("[mesh] POS_UPDATE: wire v%u unsupported\n", pos->version);
+            } else if (size >= expected) {
                 PosUpdateEntry* entries = (PosUpdateEntry*)(rx_buf + sizeof(PosUpdateMsg));
-                SqLog.printf("[mesh] POS_UPDATE: %u nodes, %uD\n", pos->count, pos->dimension);
-                // Nodes could store their own position from this
+                if (pos->sync_flags & SYNC_FLAG_FULL)
+                    memset(s_posShadow, 0, sizeof(s_posShadow));
+                for (uint8_t i = 0; i < pos->count; i++) {
+                    if (entries[i].short_id < MESH_MAX_NODES)
+                        s_posShadow[entries[i].short_id] = entries[i];
+                }
+                SqLog.printf("[mesh] POS_UPDATE: %u nodes, %uD%s\n", pos->count, pos->dimension,
+                    (pos->sync_flags & SYNC_FLAG_FULL) ? " (full)" : "");
             }
-            else if (msgType == MSG_TYPE_PEER_SYNC && data.size >= sizeof(PeerSyncMsg)) {
-                PeerSyncMsg* sync = (PeerSyncMsg*)rx_buf;
-                uint8_t count = sync->count;
-                if (count > MESH_MAX_NODES) count = MESH_MAX_NODES;
+        }
+        else if (msgType == MSG_TYPE_PEER_SYNC && size >= sizeof(PeerSyncMsg)) {
+            PeerSyncMsg* sync = (PeerSyncMsg*)rx_buf;
+            uint8_t count = sync->count;
+            if (count > MESH_MAX_NODES) count = MESH_MAX_NODES;
+            if (sync->version != MESH_WIRE_VERSION) {
+                SqLog.printf("[mesh] PEER_SYNC: wire v%u unsupported\n", sync->version);
+            } else if (sync->sync_flags & SYNC_FLAG_FULL) {
                 uint16_t expected = sizeof(PeerSyncMsg) + count * sizeof(PeerSyncEntry);
-                if (data.size >= expected) {
+                if (size >= expected) {
                     PeerSyncEntry* entries = (PeerSyncEntry*)(rx_buf + sizeof(PeerSyncMsg));
                     memcpy(s_peerShadow, entries, count * sizeof(PeerSyncEntry));
                     s_peerShadowCount = count;
-                    SqLog.printf("[mesh] PEER_SYNC received: %u entries\n", count);
+                    s_peerShadowEpoch = sync->epoch;
+                    s_peerShadowBindEpoch = sync->epoch;
+                    s_peerShadowSynced = true;
+                    MeshNode::resetAggregation();
+                    SqLog.printf("[mesh] PEER_SYNC received: %u entries, epoch %u\n", count, sync->epoch);
                 }
-            }
-            else if (msgType == MSG_TYPE_CONFIG_REQ && data.size >= 3) {
-                uint8_t reqId = rx_buf[1];
-                const char* json = (const char*)&rx_buf[2];
-                // Ensure null-terminated
-                rx_buf[data.size] = '\0';
-
-                JsonDocument reqDoc;
-                DeserializationError jsonErr = deserializeJson(reqDoc, json);
-                if (jsonErr) {
-                    SqLog.printf("[mesh] CONFIG_REQ: JSON parse error: %s\n", jsonErr.c_str());
-                } else {
-                    const char* action = reqDoc["action"] | "get";
-                    JsonDocument respDoc;
-
-                    // Add own MAC to response
-                    uint8_t own_mac[6];
-                    esp_read_mac(own_mac, ESP_MAC_WIFI_STA);
-                    char macStr[18];
-                    snprintf(macStr, sizeof(macStr), "%02X:%02X:%02X:%02X:%02X:%02X",
-                        own_mac[0], own_mac[1], own_mac[2],
-                        own_mac[3], own_mac[4], own_mac[5]);
-                    respDoc["mac"] = macStr;
-
-                    if (strcmp(action, "set") == 0) {
-                        uint8_t applied = configApplyJson(reqDoc.as<JsonObjectConst>());
-                        SqLog.printf("[mesh] CONFIG_REQ set: applied %u fields\n", applied);
-                        // Respond with new values of all fields that were set
-                        for (JsonPairConst kv : reqDoc.as<JsonObjectConst>()) {
-                            const char* key = kv.key().c_str();
-                            if (strcmp(key, "action") == 0) continue;
-                            const ConfigField* f = configLookup(key);
-                            if (f) configBuildJson(respDoc, (const char**)&key, 1);
-                        }
-                    } else {
-                        // "get"
-                        if (reqDoc["fields"].is<JsonArray>()) {
-                            JsonArray arr = reqDoc["fields"];
-                            const char* fields[20];
-                            uint8_t cnt = 0;
-                            for (JsonVariant v : arr) {
-                                if (cnt < 20) fields[cnt++] = v.as<const char*>();
-                            }
-                            configBuildJson(respDoc, fields, cnt);
-                        } else {
-                            configBuildJson(respDoc, nullptr, 0);
-                        }
+            } else if (s_peerShadowSynced && sync->epoch == s_peerShadowEpoch) {
+                // Duplicate, or already covered by a FULL reply
+            } else if (!s_peerShadowSynced || sync->epoch != (uint16_t)(s_peerShadowEpoch + 1)) {
+                // Missed a sync: a delta on top of the wrong epoch would
+                // leave the shadow silently diverged. Ask for a FULL, and
+                // stop trusting short IDs until it arrives.
+                MeshNode::resetAggregation();
+                if (!(s_role && s_role->isGateway())
+                    && (s_peerSyncReqMs == 0 || millis() - s_peerSyncReqMs >= MESH_SYNC_REQ_HOLDOFF_MS)) {
+                    s_peerSyncReqMs = millis() | 1;
+                    PeerSyncReqMsg req;
+                    req.type = MSG_TYPE_PEER_SYNC_REQ;
+                    req.have_epoch = s_peerShadowEpoch;
+                    MeshConductor::sendToNode(from.addr, &req, sizeof(req));
+                    SqLog.printf("[mesh] PEER_SYNC delta epoch %u, have %u: requesting full\n",
+                        sync->epoch, s_peerShadowEpoch);
+                }
+            } else {
+                uint16_t expected = sizeof(PeerSyncMsg) + count * sizeof(PeerSyncDelta);
+                if (size >= expected) {
+                    PeerSyncDelta* deltas = (PeerSyncDelta*)(rx_buf + sizeof(PeerSyncMsg));
+                    uint8_t applied = 0;
+                    for (uint8_t i = 0; i < count; i++) {
+                        // Short IDs are bound by the FULL this epoch chain started from
+                        if (deltas[i].short_id >= s_peerShadowCount) continue;
+                        s_peerShadow[deltas[i].short_id].battery_mv = deltas[i].battery_mv;
+                        s_peerShadow[deltas[i].short_id].flags = deltas[i].flags;
+                        applied++;
                     }
-
-                    // Serialize and send response
-                    char respJson[460];
-                    size_t jsonLen = serializeJson(respDoc, respJson, sizeof(respJson));
-
-                    uint8_t respBuf[464];
-                    respBuf[0] = MSG_TYPE_CONFIG_RESP;
-                    respBuf[1] = reqId;
-                    memcpy(&respBuf[2], respJson, jsonLen + 1);  // include null
-
-                    MeshConductor::sendToNode(from.addr, respBuf, 2 + jsonLen + 1);
+                    s_peerShadowEpoch = sync->epoch;
+                    SqLog.printf("[mesh] PEER_SYNC delta: %u/%u applied, epoch %u\n",
+                        applied, count, sync->epoch);
                 }
             }
-            else if (msgType == MSG_TYPE_CONFIG_RESP && data.size >= 3) {
-                uint8_t reqId = rx_buf[1];
-                if (reqId == s_configRespReqId && s_configRespSema) {
-                    size_t payloadLen = data.size - 2;
-                    if (payloadLen >= sizeof(s_configRespBuf))
-                        payloadLen = sizeof(s_configRespBuf) - 1;
-                    memcpy(s_configRespBuf, &rx_buf[2], payloadLen);
-                    s_configRespBuf[payloadLen] = '\0';
-                    xSemaphoreGive(s_configRespSema);
-                }
+            checkOwnSyncEntry();
+        }
+        else if (msgType == MSG_TYPE_PEER_SYNC_REQ && size >= sizeof(PeerSyncReqMsg)) {
+            if (s_role && s_role->isGateway()) {
+                const PeerSyncReqMsg* req = (const PeerSyncReqMsg*)rx_buf;
+                SqLog.printf("[mesh] PEER_SYNC_REQ (has epoch %u)\n", req->have_epoch);
+                PeerTable::sendFullSync(from.addr);
             }
-            else if (msgType == MSG_TYPE_ROLE_CHANGE && data.size >= sizeof(RoleChangeMsg)) {
-                RoleChangeMsg* rc = (RoleChangeMsg*)rx_buf;
-                uint8_t own_mac[6];
-                esp_read_mac(own_mac, ESP_MAC_WIFI_STA);
-
-                SqLog.printf("[mesh] ROLE_CHANGE: new gateway=%02X:%02X:%02X:%02X:%02X:%02X\n",
-                    rc->new_gw[0], rc->new_gw[1], rc->new_gw[2],
-                    rc->new_gw[3], rc->new_gw[4], rc->new_gw[5]);
-
-                memcpy(s_gatewayMac, rc->new_gw, 6);
-
-                if (memcmp(own_mac, rc->new_gw, 6) == 0) {
-                    // I am the new gateway — seed PeerTable from shadow, become Gateway
-                    SqLog.println("[mesh] I am the new gateway!");
-                    if (s_role) s_role->end();
-                    s_role = &s_gateway;
-                    s_role->begin();
-                    // Seed PeerTable from peerShadow (received via PEER_SYNC before role change)
-                    PeerTable::seedFromShadow(s_peerShadow, s_peerShadowCount);
-                    s_electionDone = true;
-                } else {
-                    // I am not the new gateway — ensure I am NODE role
-                    if (s_role && s_role->isGateway()) {
-                        // This shouldn't happen (gateway sends the message, not receives it)
-                        // but handle defensively
-                        if (s_role) s_role->end();
-                        s_role = &s_meshNode;
-                        s_role->begin();
-                    }
-                    // If already a node, just update gateway MAC (already done above)
-                }
+        }
+        else if (msgType == MSG_TYPE_CONFIG_REQ && size >= 2 + sizeof(ConfigBinHeader)) {
+            // Binary body keyed by registry index: no JSON, no heap
+            uint8_t respBuf[MESH_REL_MAX_PAYLOAD];
+            respBuf[0] = MSG_TYPE_CONFIG_RESP;
+            respBuf[1] = rx_buf[1];   // reqId
+            uint16_t n = configHandleBinary(&rx_buf[2], size - 2, &respBuf[2], sizeof(respBuf) - 2);
+            const ConfigBinHeader* resp = (const ConfigBinHeader*)&respBuf[2];
+            if (resp->code != CFG_ST_OK) {
+                SqLog.printf("[mesh] CONFIG_REQ rejected (status %u)\n", resp->code);
+            } else if (((const ConfigBinHeader*)&rx_buf[2])->code == CFG_OP_SET) {
+                SqLog.printf("[mesh] CONFIG_REQ set: applied %u fields\n", resp->count);
             }
-            else if (msgType == MSG_TYPE_NOMINATE && data.size >= sizeof(NominateMsg)) {
-                NominateMsg* nom = (NominateMsg*)rx_buf;
+            if (MeshConductor::sendReliable(from.addr, respBuf, 2 + n) == ESP_ERR_NO_MEM)
+                MeshConductor::sendToNode(from.addr, respBuf, 2 + n);   // a reply beats a timeout
+        }
+        else if (msgType == MSG_TYPE_CONFIG_RESP && size >= 2 + sizeof(ConfigBinHeader)) {
+            configOnResp(from.addr, rx_buf[1], &rx_buf[2], size - 2);
+        }
+        else if (msgType == MSG_TYPE_ROLE_CHANGE && size >= sizeof(RoleChangeMsg)) {
+            RoleChangeMsg* rc = (RoleChangeMsg*)rx_buf;
+            const uint8_t* own_mac = s_staMac;
+
+            SqLog.printf("[mesh] ROLE_CHANGE: new gateway=%02X:%02X:%02X:%02X:%02X:%02X\n",
+                rc->new_gw[0], rc->new_gw[1], rc->new_gw[2],
+                rc->new_gw[3], rc->new_gw[4], rc->new_gw[5]);
+
+            memcpy(s_gatewayMac, rc->new_gw, 6);
+            HotStandby::onGatewayChanged(rc->new_gw);
+            // The new gateway numbers its slots its own way
+            MeshNode::resetAggregation();
+
+            if (memcmp(own_mac, rc->new_gw, 6) == 0 && s_role && s_role->isGateway()) {
+                // Already gateway (e.g. merge survivor): keep PeerTable as is
+                s_electionDone = true;
+            } else if (memcmp(own_mac, rc->new_gw, 6) == 0) {
+                // I am the new gateway — seed PeerTable from shadow, become Gateway
+                SqLog.println("[mesh] I am the new gateway!");
+                if (s_role) s_role->end();
+                s_role = &s_gateway;
+                s_role->begin();
+                // Seed PeerTable from peerShadow (received via PEER_SYNC before role change)
+                PeerTable::seedFromShadow(s_peerShadow, s_peerShadowCount);
+                s_electionDone = true;
+            } else {
+                // I am not the new gateway — ensure I am NODE role
                 if (s_role && s_role->isGateway()) {
-                    SqLog.printf("[mesh] NOMINATE received from %02X:%02X:%02X:%02X:%02X:%02X\n",
-                        nom->mac[0], nom->mac[1], nom->mac[2],
-                        nom->mac[3], nom->mac[4], nom->mac[5]);
-                    MeshConductor::nominateNode(nom->mac);
+                    // This shouldn't happen (gateway sends the message, not receives it)
+                    // but handle defensively
+                    if (s_role) s_role->end();
+                    s_role = &s_meshNode;
+                    s_role->begin();
                 }
+                // If already a node, just update gateway MAC (already done above)
             }
-            // Phase 4: Orchestrator messages
-            else if (msgType == MSG_TYPE_PLAY_CMD && data.size >= sizeof(PlayCmdMsg)) {
-                PlayCmdMsg* play = (PlayCmdMsg*)rx_buf;
-                Orchestrator::onPlayCmd(play->tone_index);
-            }
-            else if (msgType == MSG_TYPE_ORCH_MODE && data.size >= sizeof(OrchModeMsg)) {
-                OrchModeMsg* om = (OrchModeMsg*)rx_buf;
-                Orchestrator::onModeChange(om->mode);
-            }
-            else if (msgType == MSG_TYPE_CLOCK_SYNC && data.size >= sizeof(ClockSyncMsg)) {
-                ClockSyncMsg* cs = (ClockSyncMsg*)rx_buf;
-                ClockSync::onSyncReceived(cs->gateway_ms);
-            }
-            // Phase 5: Setup Delegate messages
-            else if (msgType == MSG_TYPE_WIFI_CREDS && data.size >= sizeof(WifiCredsMsg)) {
-                WifiCredsMsg* wc = (WifiCredsMsg*)rx_buf;
-                wc->ssid[32] = '\0';      // safety null-terminate
-                wc->password[64] = '\0';
-                SqWebServer::saveWifiCreds(wc->ssid, wc->password);
-                SqLog.printf("[mesh] Received WiFi credentials (SSID=%s)\n", wc->ssid);
-                // Send ACK back
-                WifiCredsAckMsg ack = { .type = MSG_TYPE_WIFI_CREDS_ACK };
-                MeshConductor::sendToRoot(&ack, sizeof(ack));
-            }
-            else if (msgType == MSG_TYPE_WIFI_CREDS_ACK) {
-                SqLog.println("[mesh] WiFi credentials ACK received");
-                // TODO: mark peer as creds-received (stop retrying)
+        }
+        else if (msgType == MSG_TYPE_STANDBY_ASSIGN && size >= sizeof(StandbyAssignMsg)) {
+            StandbyAssignMsg* am = (StandbyAssignMsg*)rx_buf;
+            HotStandby::onAssign(from.addr, am->standby);
+        }
+        else if (msgType == MSG_TYPE_STANDBY_REPL && size >= sizeof(StandbyReplMsg)) {
+            HotStandby::onRepl(from.addr, rx_buf, size);
+        }
+        else if (msgType == MSG_TYPE_MERGE_HELLO && size >= sizeof(MergeHelloMsg)) {
+            MeshMerge::onHello(from.addr, (const MergeHelloMsg*)rx_buf);
+        }
+        else if (msgType == MSG_TYPE_MERGE_STATE && size >= sizeof(MergeStateMsg)) {
+            MeshMerge::onState(from.addr, rx_buf, size);
+        }
+        else if (msgType == MSG_TYPE_NOMINATE && size >= sizeof(NominateMsg)) {
+            NominateMsg* nom = (NominateMsg*)rx_buf;
+            if (s_role && s_role->isGateway()) {
+                SqLog.printf("[mesh] NOMINATE received from %02X:%02X:%02X:%02X:%02X:%02X\n",
+                    nom->mac[0], nom->mac[1], nom->mac[2],
+                    nom->mac[3], nom->mac[4], nom->mac[5]);
+                MeshConductor::nominateNode(nom->mac);
             }
-            else if (msgType == MSG_TYPE_MERGE_CHECK && data.size >= sizeof(MergeCheckMsg)) {
-                MergeCheckMsg* mc = (MergeCheckMsg*)rx_buf;
-                if (esp_mesh_is_root()) {
-                    mesh_addr_t rt[MESH_MAX_NODES];
-                    int rtSize = 0;
-                    esp_mesh_get_routing_table(rt, sizeof(rt), &rtSize);
-                    if (rtSize < mc->root_table_size) {
-                        SqLog.printf("[mesh] Merge check: yielding root (my %d < sender %d)\n",
-                                     rtSize, mc->root_table_size);
-                        esp_mesh_set_self_organized(true, true);  // rescan
-                    }
+        }
+        // Phase 4: Orchestrator messages
+        else if (msgType == MSG_TYPE_PLAY_CMD && size >= sizeof(PlayCmdMsg)) {
+            PlayCmdMsg* play = (PlayCmdMsg*)rx_buf;
+            Orchestrator::onPlayCmd(play->tone_index, play->start_ms, play->gain);
+        }
+        else if (msgType == MSG_TYPE_ORCH_MODE && size >= sizeof(OrchModeMsg)) {
+            OrchModeMsg* om = (OrchModeMsg*)rx_buf;
+            Orchestrator::onModeChange(om->mode);
+        }
+        else if (msgType == MSG_TYPE_ORCH_SCRIPT && size >= sizeof(OrchScriptMsg)) {
+            OrchScript::onScript(rx_buf, size);
+        }
+        else if (msgType == MSG_TYPE_ORCH_GO && size >= sizeof(OrchGoMsg)) {
+            OrchGoMsg* go = (OrchGoMsg*)rx_buf;
+            OrchScript::onGo(go->script_id, go->start_ms);
+        }
+        else if (msgType == MSG_TYPE_CLOCK_SYNC && size >= sizeof(ClockSyncMsg)) {
+            ClockSyncMsg* cs = (ClockSyncMsg*)rx_buf;
+            ClockSync::onSyncReceived(cs->gateway_ms);
+        }
+        else if (msgType == MSG_TYPE_CLOCK_PROBE && size >= sizeof(ClockProbeMsg)) {
+            ClockSync::onProbe(from.addr, (const ClockProbeMsg*)rx_buf);
+        }
+        else if (msgType == MSG_TYPE_CLOCK_PROBE_REPLY && size >= sizeof(ClockProbeMsg)) {
+            ClockSync::onProbeReply((const ClockProbeMsg*)rx_buf);
+        }
+        // Phase 5: Setup Delegate messages
+        else if (msgType == MSG_TYPE_WIFI_CREDS && size >= sizeof(WifiCredsMsg)) {
+            WifiCredsMsg* wc = (WifiCredsMsg*)rx_buf;
+            wc->ssid[32] = '\0';      // safety null-terminate
+            wc->password[64] = '\0';
+            SqWebServer::saveWifiCreds(wc->ssid, wc->password);
+            SqLog.printf("[mesh] Received WiFi credentials (SSID=%s)\n", wc->ssid);
+            // Send ACK back
+            WifiCredsAckMsg ack = { .type = MSG_TYPE_WIFI_CREDS_ACK };
+            MeshConductor::sendToRoot(&ack, sizeof(ack));
+        }
+        else if (msgType == MSG_TYPE_WIFI_CREDS_ACK) {
+            SqLog.println("[mesh] WiFi credentials ACK received");
+            // TODO: mark peer as creds-received (stop retrying)
+        }
+        else if (msgType == MSG_TYPE_MERGE_CHECK && size >= sizeof(MergeCheckMsg)) {
+            MergeCheckMsg* mc = (MergeCheckMsg*)rx_buf;
+            if (esp_mesh_is_root()) {
+                mesh_addr_t rt[MESH_MAX_NODES];
+                int rtSize = 0;
+                esp_mesh_get_routing_table(rt, sizeof(rt), &rtSize);
+                if (rtSize < mc->root_table_size) {
+                    SqLog.printf("[mesh] Merge check: yielding root (my %d < sender %d)\n",
+                                 rtSize, mc->root_table_size);
+                    esp_mesh_set_self_organized(true, true);  // rescan
                 }
             }
-            else if (msgType == MSG_TYPE_SETUP_DELEGATE && data.size >= sizeof(SetupDelegateMsg)) {
-                SetupDelegateMsg* sd = (SetupDelegateMsg*)rx_buf;
-                SqLog.println("[mesh] Designated as Setup Delegate");
-                // TODO: trigger SetupDelegate::begin(sd->gateway_mac) in Task 8
-                (void)sd;
+        }
+        else if (msgType == MSG_TYPE_SETUP_DELEGATE && size >= sizeof(SetupDelegateMsg)) {
+            SetupDelegateMsg* sd = (SetupDelegateMsg*)rx_buf;
+            SqLog.println("[mesh] Designated as Setup Delegate");
+            // TODO: trigger SetupDelegate::begin(sd->gateway_mac) in Task 8
+            (void)sd;
+        }
+    }
+}
+
+static void meshRxTask(void* pvParameters) {
+    mesh_addr_t from;
+    mesh_data_t data;
+    uint8_t rx_buf[MESH_FRAG_MTU];
+    data.data = rx_buf;
+    data.size = MESH_FRAG_MTU;
+    int flag = 0;
+
+    while (s_started) {
+        esp_err_t err = esp_mesh_recv(&from, &data, portMAX_DELAY, &flag, NULL, 0);
+        if (err != ESP_OK) {
+            vTaskDelay(pdMS_TO_TICKS(100));
+            continue;
+        }
+
+        xSemaphoreTake(s_dispatchMutex, portMAX_DELAY);
+        if (data.size >= sizeof(FragmentHeader) && rx_buf[0] == MSG_TYPE_FRAGMENT) {
+            FragSlot* slot = fragAccept(from.addr, rx_buf, data.size);
+            if (slot) {
+                dispatchMessage(from, slot->buf, slot->total_len);
+                slot->used = false;
             }
+        } else {
+            dispatchMessage(from, rx_buf, data.size);
         }
+        xSemaphoreGive(s_dispatchMutex);
 
         // Reset buffer for next receive
-        data.size = sizeof(rx_buf);
+        data.size = MESH_FRAG_MTU;
     }
 
     vTaskDelete(nullptr);
 }
 
+// --- Loopback ---
+
+// Queue a self-addressed message. Never blocks: the caller may be a
+// handler holding s_dispatchMutex, which the loop task needs to drain.
+static esp_err_t loopbackPush(const void* data, uint16_t len) {
+    if (!s_loopRing || len == 0) return ESP_ERR_INVALID_STATE;
+    if (xRingbufferSend(s_loopRing, data, len, 0) != pdTRUE) {
+        s_loopDropped++;
+        SqLog.printf("[mesh] Loopback full, dropped type 0x%02X\n", ((const uint8_t*)data)[0]);
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+static void meshLoopTask(void* pvParameters) {
+    (void)pvParameters;
+    mesh_addr_t self;
+    memcpy(self.addr, s_staMac, 6);
+    for (;;) {
+        size_t size = 0;
+        uint8_t* item = (uint8_t*)xRingbufferReceive(s_loopRing, &size, portMAX_DELAY);
+        if (!item) continue;
+        xSemaphoreTake(s_dispatchMutex, portMAX_DELAY);
+        dispatchMessage(self, item, (uint16_t)size);
+        xSemaphoreGive(s_dispatchMutex);
+        vRingbufferReturnItem(s_loopRing, item);
+        s_loopDelivered++;
+    }
+}
+
+// --- Standby takeover: become gateway in place (no reboot, no election) ---
+
+static void standbyTakeover() {
+    uint8_t own_mac[6], prev_gw[6];
+    memcpy(own_mac, s_staMac, 6);
+    memcpy(prev_gw, s_gatewayMac, 6);
+
+    SqLog.printf("[mesh] Standby takeover from %02X:%02X:%02X:%02X:%02X:%02X\n",
+        prev_gw[0], prev_gw[1], prev_gw[2], prev_gw[3], prev_gw[4], prev_gw[5]);
+
+    memcpy(s_gatewayMac, own_mac, 6);
+    if (s_role) s_role->end();
+    s_role = &s_gateway;
+    s_role->begin();
+    PeerTable::seedFromShadow(s_peerShadow, s_peerShadowCount);
+    PeerTable::markDead(prev_gw);
+    s_electionDone = true;
+
+    // Announce first so peers re-route heartbeats while we restore state
+    RoleChangeMsg rc;
+    rc.type = MSG_TYPE_ROLE_CHANGE;
+    memcpy(rc.new_gw, own_mac, 6);
+    MeshConductor::broadcastReliable(&rc, sizeof(rc));
+
+    HotStandby::applyReplica();
+}
+
 // --- Election task: runs heavy election logic with a proper stack ---
 
 static void electTask(void* pvParameters) {
@@ -665,6 +1394,10 @@ static void electTask(void* pvParameters) {
                 MeshConductor::runElection();
             if (bits & ELECT_NOTIFY_TIMEOUT)
                 electionTimerCallback(nullptr);
+            if (bits & ELECT_NOTIFY_TAKEOVER)
+                standbyTakeover();
+            if (bits & ELECT_NOTIFY_MERGE)
+                MeshMerge::runPending();
         }
     }
 }
@@ -672,10 +1405,98 @@ static void electTask(void* pvParameters) {
 // --- Settle timer: debounced election trigger ---
 
 static void startSettleTimer() {
+    electionMarkStart();
     if (s_electTimer) xTimerStop(s_electTimer, 0);
     xTimerChangePeriod(s_settleTimer, pdMS_TO_TICKS(ELECT_SETTLE_MS), 0);
 }
 
+// --- Warm rejoin ---
+
+// The RtcMap describes a mesh we can walk back into: a gateway settled by
+// an election, the channel it ran on, and either our parent link or (for
+// the gateway) the root seat.
+static bool warmRejoinPossible(const rtc_mesh_map_t* map) {
+    static const uint8_t zero[6] = {0};
+    if (!RtcMap::isValid() || map->mesh_generation == 0 || map->mesh_channel == 0) return false;
+    if (memcmp(map->gateway_mac, zero, 6) == 0) return false;
+    bool selfGw = memcmp(map->gateway_mac, s_staMac, 6) == 0;
+    if ((map->own_role == 1) != selfGw) return false;   // role and gateway disagree
+    if (selfGw) return map->own_layer == 1;               // resume as root gateway
+    return map->own_layer > 1 && memcmp(map->parent_bssid, zero, 6) != 0;
+}
+
+static bool warmKnownPeer(const uint8_t* mac) {
+    for (uint8_t i = 0; i < s_warmPeerCount; i++)
+        if (memcmp(s_warmPeers[i], mac, 6) == 0) return true;
+    return false;
+}
+
+// Connected with a warm map: take the cached role without an election
+static void warmAdopt() {
+    rtc_mesh_map_t* map = RtcMap::get();
+    if (s_settleTimer) xTimerStop(s_settleTimer, 0);
+    s_electEpoch = (uint16_t)map->mesh_generation;   // newer results still win
+    s_warmResumed = true;
+    s_warmPhase = WARM_CONFIRM;
+    xTimerChangePeriod(s_warmTimer, pdMS_TO_TICKS(MESH_WARM_CONFIRM_MS), 0);
+    SqLog.printf("[mesh] Warm rejoin: adopting gateway %02X:%02X:%02X:%02X:%02X:%02X (epoch %u), no election\n",
+        map->gateway_mac[0], map->gateway_mac[1], map->gateway_mac[2],
+        map->gateway_mac[3], map->gateway_mac[4], map->gateway_mac[5], s_electEpoch);
+    assignRole(map->gateway_mac, false);
+}
+
+// Timer service context
+static void warmTimerCb(TimerHandle_t t) {
+    (void)t;
+    if (s_warmPhase == WARM_PARENT) {
+        // Cached parent is gone or moved: scan like a cold start, but still
+        // adopt the cached gateway once any parent takes us
+        SqLog.println("[mesh] Warm rejoin: cached parent not found — scanning");
+        esp_mesh_set_self_organized(true, true);
+        return;
+    }
+    if (s_warmPhase != WARM_CONFIRM) return;
+
+    // The cached gateway never accepted a heartbeat: the mesh moved on
+    SqLog.println("[mesh] Warm rejoin: cached gateway silent — electing");
+    s_warmPhase = WARM_OFF;
+    s_warmResumed = false;
+    RtcMap::get()->mesh_generation = 0;
+    RtcMap::save();
+    s_electionDone = false;
+    s_scoreCount = 0;
+    startSettleTimer();
+}
+
+// First heartbeat accepted: our own record in a PEER_SYNC (node), or the
+// first peer record applied (gateway). millis() counts from the wake.
+static void joinAccepted() {
+    if (s_joinMs != 0) return;
+    s_joinMs = millis() | 1;
+    s_joinWarm = (s_warmPhase != WARM_OFF);
+    if (s_warmPhase != WARM_OFF) {
+        s_warmPhase = WARM_OFF;
+        if (s_warmTimer) xTimerStop(s_warmTimer, 0);
+    }
+    rtc_mesh_map_t* map = RtcMap::get();
+    if (s_joinWarm) map->join_warm_ms = s_joinMs;
+    else            map->join_cold_ms = s_joinMs;
+    RtcMap::save();
+    SqLog.printf("[mesh] %s join: first heartbeat accepted %lu ms after wake (last cold %lu ms, last warm %lu ms)\n",
+        s_joinWarm ? "Warm" : "Cold", (unsigned long)s_joinMs,
+        (unsigned long)map->join_cold_ms, (unsigned long)map->join_warm_ms);
+}
+
+static void checkOwnSyncEntry() {
+    if (s_joinMs != 0) return;
+    for (uint8_t i = 0; i < s_peerShadowCount; i++) {
+        if (memcmp(s_peerShadow[i].mac, s_staMac, 6) != 0) continue;
+        if ((s_peerShadow[i].flags & PEER_STATUS_ALIVE) && !(s_peerShadow[i].flags & PEER_STATUS_DEAD))
+            joinAccepted();
+        return;
+    }
+}
+
 // --- Promote timer callback (routerless root self-connect) ---
 
 static void promoteTimerCb(TimerHandle_t t) {
@@ -692,7 +1513,9 @@ static void promoteTimerCb(TimerHandle_t t) {
     s_parentRetries = 0;
     updateRtcMap();
 
-    if (!s_electionDone) {
+    if (s_warmPhase != WARM_OFF) {
+        warmAdopt();
+    } else if (!s_electionDone) {
         startSettleTimer();
     }
 }
@@ -723,6 +1546,11 @@ static void meshEventHandler(void* arg, esp_event_base_t event_base,
         // Start RX task
         xTaskCreateUniversal(meshRxTask, "meshRx", 4096, nullptr,
                              tskIDLE_PRIORITY + 2, nullptr, tskNO_AFFINITY);
+
+        // Warm gateway: it held the root seat, so take it back now rather
+        // than after the scan failures and promotion jitter
+        if (s_warmPhase != WARM_OFF && RtcMap::get()->own_role == 1)
+            promoteTimerCb(nullptr);
         break;
 
     case MESH_EVENT_STOPPED:
@@ -732,13 +1560,24 @@ static void meshEventHandler(void* arg, esp_event_base_t event_base,
         break;
 
     case MESH_EVENT_PARENT_CONNECTED: {
+        mesh_event_connected_t* conn = (mesh_event_connected_t*)event_data;
         if (s_promoteTimer) xTimerStop(s_promoteTimer, 0);
         SqLog.println("[mesh] Parent connected");
         s_connected = true;
         s_parentRetries = 0;
         if (esp_mesh_is_root()) {
             SqLog.println("[mesh] I am ROOT");
+        } else {
+            // Remember the parent link for a warm rejoin after deep sleep
+            rtc_mesh_map_t* map = RtcMap::get();
+            memcpy(map->parent_bssid, conn->connected.bssid, 6);
+            uint8_t n = conn->connected.ssid_len;
+            if (n > sizeof(map->parent_ssid)) n = sizeof(map->parent_ssid);
+            memcpy(map->parent_ssid, conn->connected.ssid, n);
+            map->parent_ssid_len = n;
         }
+        if (s_warmPhase == WARM_PARENT)
+            esp_mesh_set_self_organized(true, false);   // heal normally from here on
         updateRtcMap();
 
         // Send heartbeat immediately so the gateway adds us to PeerTable
@@ -746,10 +1585,11 @@ static void meshEventHandler(void* arg, esp_event_base_t event_base,
         if (!esp_mesh_is_root()) {
             HeartbeatMsg hb;
             hb.type = MSG_TYPE_HEARTBEAT;
-            esp_read_mac(hb.mac, ESP_MAC_WIFI_STA);
+            memcpy(hb.mac, s_staMac, 6);
             hb.battery_mv = (uint16_t)PowerManager::batteryMv();
             hb.flags = 0;
-            esp_read_mac(hb.softap_mac, ESP_MAC_WIFI_SOFTAP);
+            memcpy(hb.softap_mac, s_apMac, 6);
+            hb.interval_s = 0;   // cadence not set yet — gateway uses the idle period
             // Use logical gateway MAC if known, else fall back to ESP-IDF root
             static const uint8_t zero[6] = {0};
             if (memcmp(s_gatewayMac, zero, 6) != 0) {
@@ -759,16 +1599,24 @@ static void meshEventHandler(void* arg, esp_event_base_t event_base,
             }
         }
 
-        // Start election after settle delay
-        if (!s_electionDone) {
+        // Warm: adopt the cached gateway; cold: elect after the settle delay
+        if (s_warmPhase == WARM_PARENT) {
+            warmAdopt();
+        } else if (!s_electionDone) {
             startSettleTimer();
         }
+
+        // A gateway with a parent has joined another root's tree (healed
+        // partition): find that mesh's gateway and merge state with it
+        if (s_role && s_role->isGateway() && !esp_mesh_is_root())
+            MeshMerge::announce();
         break;
     }
 
     case MESH_EVENT_PARENT_DISCONNECTED:
         SqLog.println("[mesh] Parent disconnected");
         s_connected = false;
+        MeshNode::setHeartbeatParent(nullptr);   // report to the gateway until re-adopted
         updateRtcMap();
         if (s_role && !s_role->isGateway()) {
             ((MeshNode*)s_role)->onGatewayLost();
@@ -783,8 +1631,18 @@ static void meshEventHandler(void* arg, esp_event_base_t event_base,
         if (s_role) s_role->onPeerJoined(child->mac);
         updateRtcMap();
 
-        // Re-run election so the new child can participate
-        if (s_electionDone && esp_mesh_is_root()) {
+        // Adopt the child's heartbeats: it reports to us and we aggregate
+        {
+            HbParentMsg adopt;
+            adopt.type = MSG_TYPE_HB_PARENT;
+            memcpy(adopt.parent, s_staMac, 6);
+            MeshConductor::sendToNode(child->mac, &adopt, sizeof(adopt));
+        }
+
+        // Re-run election so the new child can participate — unless it is
+        // a member of the mesh this node warm-resumed (it is rejoining too)
+        if (s_electionDone && esp_mesh_is_root() &&
+            !(s_warmResumed && warmKnownPeer(child->mac))) {
             SqLog.println("[mesh] Child joined after election — re-electing");
             s_electionDone = false;
             s_scoreCount = 0;
@@ -813,8 +1671,7 @@ static void meshEventHandler(void* arg, esp_event_base_t event_base,
         SqLog.printf("[mesh] Root address: %02X:%02X:%02X:%02X:%02X:%02X\n",
             root->addr[0], root->addr[1], root->addr[2],
             root->addr[3], root->addr[4], root->addr[5]);
-        rtc_mesh_map_t* map = RtcMap::get();
-        memcpy(map->gateway_mac, root->addr, 6);
+        // Root is not necessarily the gateway: RtcMap keeps the elected one
         updateRtcMap();
         break;
     }
@@ -825,7 +1682,7 @@ static void meshEventHandler(void* arg, esp_event_base_t event_base,
             // Only schedule the promote timer once — don't reset it on every scan failure
             if (s_promoteTimer == nullptr) {
                 uint8_t mac[6];
-                esp_read_mac(mac, ESP_MAC_WIFI_STA);
+                memcpy(mac, s_staMac, 6);
                 uint32_t jitter = MESH_PROMOTE_BASE_MS + (((mac[4] << 8) | mac[5]) % MESH_PROMOTE_JITTER_MS);
                 SqLog.printf("[mesh] Scheduling root promotion in %u ms\n", jitter);
                 s_promoteTimer = xTimerCreate("promote",
@@ -836,6 +1693,8 @@ static void meshEventHandler(void* arg, esp_event_base_t event_base,
         } else {
             if (s_parentRetries >= MESH_MAX_RETRIES) {
                 SqLog.println("[mesh] Root with no children — rebooting");
+                RtcMap::get()->mesh_generation = 0;
+                RtcMap::save();
                 MeshConductor::stop();
                 SQ_LIGHT_SLEEP(MESH_REELECT_SLEEP_MS);
                 esp_restart();
@@ -843,10 +1702,20 @@ static void meshEventHandler(void* arg, esp_event_base_t event_base,
         }
         break;
 
+    case MESH_EVENT_ROOT_ASKED_YIELD: {
+        // Another root on our mesh ID: the partition has healed. Join under
+        // it; once connected the two gateways merge (MeshMerge)
+        mesh_event_root_conflict_t* rc = (mesh_event_root_conflict_t*)event_data;
+        SqLog.printf("[mesh] Root conflict with %02X:%02X:%02X:%02X:%02X:%02X (rssi %d, capacity %u) — yielding\n",
+            rc->addr[0], rc->addr[1], rc->addr[2], rc->addr[3], rc->addr[4], rc->addr[5],
+            rc->rssi, rc->capacity);
+        esp_mesh_set_self_organized(true, true);  // rescan
+        break;
+    }
+
     case MESH_EVENT_ROOT_SWITCH_REQ: {
         SqLog.println("[mesh] Root switch requested — accepting, becoming gateway");
-        uint8_t own_mac[6];
-        esp_read_mac(own_mac, ESP_MAC_WIFI_STA);
+        const uint8_t* own_mac = s_staMac;
         assignRole(own_mac);
         break;
     }
@@ -864,6 +1733,15 @@ void MeshConductor::init() {
     if (s_meshInited) return;
     s_meshInited = true;
 
+    esp_read_mac(s_staMac, ESP_MAC_WIFI_STA);
+    esp_read_mac(s_apMac, ESP_MAC_WIFI_SOFTAP);
+
+    s_dispatchMutex = xSemaphoreCreateMutex();
+    LinkStats::init();
+    s_loopRing = xRingbufferCreate(MESH_LOOPBACK_RING_BYTES, RINGBUF_TYPE_NOSPLIT);
+    xTaskCreateUniversal(meshLoopTask, "meshLoop", 4096, nullptr,
+                         tskIDLE_PRIORITY + 2, nullptr, tskNO_AFFINITY);
+
     // Initialize NVS
     esp_err_t err = nvs_flash_init();
     if (err == ESP_ERR_NVS_NO_FREE_PAGES || err == ESP_ERR_NVS_NEW_VERSION_FOUND) {
@@ -874,9 +1752,12 @@ void MeshConductor::init() {
     nvsReadTenure();
     SqLog.printf("[mesh] Gateway tenure from NVS: %u\n", s_gwTenure);
 
-    // Config response semaphore
-    if (!s_configRespSema)
-        s_configRespSema = xSemaphoreCreateBinary();
+    // Remote config request table
+    if (!s_cfgMutex) {
+        s_cfgMutex = xSemaphoreCreateMutex();
+        s_cfgCallMutex = xSemaphoreCreateMutex();
+        s_cfgRing = xRingbufferCreate(MESH_CONFIG_RING_BYTES, RINGBUF_TYPE_NOSPLIT);
+    }
 
     // Initialize network interface
     ESP_ERROR_CHECK(esp_netif_init());
@@ -944,6 +1825,11 @@ void MeshConductor::start() {
     // No encryption for Phase 1
     cfg.crypto_funcs = NULL;
 
+    // Warm rejoin: stay on the channel the cached mesh ran on (no scan)
+    rtc_mesh_map_t* map = RtcMap::get();
+    bool warm = warmRejoinPossible(map);
+    if (warm) cfg.channel = map->mesh_channel;
+
     esp_err_t err = esp_mesh_set_config(&cfg);
     if (err == ESP_ERR_MESH_ARGUMENT) {
         // SSID check failed — use placeholder (routerless mesh)
@@ -956,7 +1842,10 @@ void MeshConductor::start() {
 
     // Configure mesh topology
     ESP_ERROR_CHECK(esp_mesh_set_max_layer(MESH_MAX_LAYER));
-    ESP_ERROR_CHECK(esp_mesh_set_self_organized(true, true));
+    bool fixedParent = warm && map->own_role == 0;
+    // A warm node goes straight for its cached parent; self-organization
+    // (parent selection) comes back once connected or on fallback
+    ESP_ERROR_CHECK(esp_mesh_set_self_organized(!fixedParent, !fixedParent));
 
     // Create election task (runs heavy election logic off the timer stack)
     if (s_electTaskHandle == nullptr) {
@@ -983,14 +1872,56 @@ void MeshConductor::start() {
         });
     }
 
+    // Reliable channel: fresh session per boot so receivers reset their windows
+    if (s_relMutex == nullptr) {
+        s_relMutex = xSemaphoreCreateMutex();
+        s_relSession = (uint16_t)esp_random();
+    }
+    if (s_relTimer == nullptr) {
+        s_relTimer = xTimerCreate("relRetx", pdMS_TO_TICKS(MESH_REL_TICK_MS),
+                                  pdTRUE, nullptr, relTimerCb);
+    }
+    xTimerStart(s_relTimer, 0);
+
     // Reset election state
     s_electionDone = false;
     s_role = nullptr;
     s_scoreCount = 0;
     s_parentRetries = 0;
 
+    if (s_warmTimer == nullptr) {
+        s_warmTimer = xTimerCreate("warm", pdMS_TO_TICKS(MESH_WARM_PARENT_MS),
+                                   pdFALSE, nullptr, warmTimerCb);
+    }
+    s_warmPhase = warm ? WARM_PARENT : WARM_OFF;
+    s_warmResumed = false;
+    s_joinMs = 0;
+    if (warm) {
+        s_warmPeerCount = 0;
+        for (uint8_t i = 0; i < map->peer_count && i < MESH_MAX_NODES; i++)
+            memcpy(s_warmPeers[s_warmPeerCount++], map->peers[i].mac, 6);
+        memcpy(s_gatewayMac, map->gateway_mac, 6);   // first heartbeat goes straight there
+        SqLog.printf("[mesh] Warm rejoin: channel %u, layer %u, %u cached peers\n",
+            map->mesh_channel, map->own_layer, map->peer_count);
+    }
+
     ESP_ERROR_CHECK(esp_mesh_start());
     SqLog.println("[mesh] Mesh starting...");
+
+    if (fixedParent) {
+        wifi_config_t parent = {};
+        memcpy(parent.sta.ssid, map->parent_ssid, map->parent_ssid_len);
+        memcpy(parent.sta.bssid, map->parent_bssid, 6);
+        parent.sta.bssid_set = true;
+        parent.sta.channel = map->mesh_channel;
+        mesh_addr_t id;
+        memcpy(id.addr, s_meshId, 6);
+        if (esp_mesh_set_parent(&parent, &id, MESH_NODE, map->own_layer) != ESP_OK) {
+            SqLog.println("[mesh] Warm rejoin: set_parent failed — scanning");
+            esp_mesh_set_self_organized(true, true);
+        }
+    }
+    if (warm) xTimerChangePeriod(s_warmTimer, pdMS_TO_TICKS(MESH_WARM_PARENT_MS), 0);
 }
 
 void MeshConductor::stop() {
@@ -1007,6 +1938,13 @@ void MeshConductor::stop() {
     if (s_electTimer) {
         xTimerStop(s_electTimer, 0);
     }
+    if (s_relTimer) {
+        xTimerStop(s_relTimer, 0);
+    }
+    if (s_warmTimer) {
+        xTimerStop(s_warmTimer, 0);
+    }
+    s_warmPhase = WARM_OFF;
     esp_mesh_stop();
     s_started = false;
     s_connected = false;
@@ -1034,13 +1972,50 @@ void MeshConductor::printStatus() {
     Serial.printf("Role: %s\n", s_role ? (s_role->isGateway() ? "GATEWAY" : "NODE") : "none");
     Serial.printf("Layer: %d\n", esp_mesh_get_layer());
     Serial.printf("Gateway tenure: %u\n", s_gwTenure);
+    Serial.printf("Election: epoch %u, %u candidates, converged in %lu ms\n",
+        s_electEpoch, s_electCandidates, (unsigned long)s_electConvergeMs);
+    {
+        const rtc_mesh_map_t* map = RtcMap::get();
+        if (s_joinMs)
+            Serial.printf("Join: %s, first heartbeat accepted %lu ms after wake\n",
+                s_joinWarm ? "warm" : "cold", (unsigned long)s_joinMs);
+        else
+            Serial.printf("Join: %s, no heartbeat accepted yet\n",
+                s_warmPhase != WARM_OFF ? "warm (pending)" : "cold");
+        Serial.printf("Join history (RTC): cold %lu ms, warm %lu ms\n",
+            (unsigned long)map->join_cold_ms, (unsigned long)map->join_warm_ms);
+    }
+
+    uint8_t fragBusy = 0;
+    for (uint8_t i = 0; i < MESH_FRAG_POOL_SLOTS; i++)
+        if (s_fragPool[i].used) fragBusy++;
+    Serial.printf("Reassembly: %u/%u slots busy, %lu dropped, %lu rejected\n",
+        fragBusy, MESH_FRAG_POOL_SLOTS,
+        (unsigned long)s_fragTimeouts, (unsigned long)s_fragRejects);
+    Serial.printf("Loopback: %lu delivered, %lu dropped\n",
+        (unsigned long)s_loopDelivered, (unsigned long)s_loopDropped);
+    if (s_cfgDropped > 0)
+        Serial.printf("Config replies dropped (ring full): %lu\n", (unsigned long)s_cfgDropped);
+    if (s_role && s_role->isGateway() && s_hbRxFrames > 0) {
+        Serial.printf("Heartbeat RX: %lu frames, %lu records (%.1f/frame), %lu bytes\n",
+            (unsigned long)s_hbRxFrames, (unsigned long)s_hbRxRecords,
+            (float)s_hbRxRecords / (float)s_hbRxFrames, (unsigned long)s_hbRxBytes);
+    }
+
+    uint8_t relBusy = 0;
+    for (uint8_t i = 0; i < MESH_REL_SLOTS; i++)
+        if (s_relSlots[i].used) relBusy++;
+    Serial.printf("Reliable: %u/%u in flight, %lu sent, %lu acked, %lu retx, %lu failed, %lu dup, %lu refused (pool full)\n",
+        relBusy, MESH_REL_SLOTS, (unsigned long)s_relSent, (unsigned long)s_relAcked,
+        (unsigned long)s_relRetx, (unsigned long)s_relFailed, (unsigned long)s_relDups,
+        (unsigned long)s_relNoSlot);
 
     int total = esp_mesh_get_total_node_num();
     Serial.printf("Total nodes: %d\n", total);
 
     mesh_addr_t routing_table[MESH_MAX_NODES];
     int table_size = 0;
-    esp_mesh_get_routing_table(routing_table, MESH_MAX_NODES, &table_size);
+    esp_mesh_get_routing_table(routing_table, sizeof(routing_table), &table_size);
     Serial.printf("Routing table size: %d\n", table_size);
 
     for (int i = 0; i < table_size; i++) {
@@ -1056,8 +2031,7 @@ void MeshConductor::printStatus() {
 }
 
 void MeshConductor::printPeerShadow() {
-    uint8_t own_mac[6];
-    esp_read_mac(own_mac, ESP_MAC_WIFI_STA);
+    const uint8_t* own_mac = s_staMac;
 
     Serial.println("=== Peer Table (synced from gateway) ===");
     Serial.printf("Entries: %u\n", s_peerShadowCount);
@@ -1071,9 +2045,10 @@ void MeshConductor::printPeerShadow() {
         const char* suffix = (isGw && isSelf) ? " <-- Gateway, this" :
                              isGw             ? " <-- Gateway" :
                              isSelf           ? " <-- this" : "";
-        Serial.printf("  [%u] %02X:%02X:%02X:%02X:%02X:%02X  bat=%umV  %s%s\n",
+        const PosUpdateEntry* p = &s_posShadow[i];
+        Serial.printf("  [%u] %02X:%02X:%02X:%02X:%02X:%02X  bat=%umV  %s  pos=(%d,%d,%d) conf=%u%s\n",
             i, e->mac[0], e->mac[1], e->mac[2], e->mac[3], e->mac[4], e->mac[5],
-            e->battery_mv, status, suffix);
+            e->battery_mv, status, p->x, p->y, p->z, p->confidence, suffix);
     }
 }
 
@@ -1081,6 +2056,16 @@ uint8_t MeshConductor::peerShadowCount() {
     return s_peerShadowCount;
 }
 
+uint16_t MeshConductor::peerShadowEpoch() {
+    return s_peerShadowEpoch;
+}
+
+bool MeshConductor::shadowNumberingMatches(uint16_t epoch) {
+    if (!s_peerShadowSynced) return false;
+    return (uint16_t)(epoch - s_peerShadowBindEpoch)
+        <= (uint16_t)(s_peerShadowEpoch - s_peerShadowBindEpoch);
+}
+
 void MeshConductor::nominateNode(const uint8_t* sta_mac) {
     if (!s_role || !s_role->isGateway()) {
         SqLog.println("[mesh] nominateNode: not gateway, ignoring");
@@ -1094,7 +2079,7 @@ void MeshConductor::nominateNode(const uint8_t* sta_mac) {
     RoleChangeMsg rc;
     rc.type = MSG_TYPE_ROLE_CHANGE;
     memcpy(rc.new_gw, sta_mac, 6);
-    broadcastToAll(&rc, sizeof(rc));
+    broadcastReliable(&rc, sizeof(rc));
 
     // Small delay so the message reaches all peers before we transition
     vTaskDelay(pdMS_TO_TICKS(200));
@@ -1114,29 +2099,28 @@ void MeshConductor::stepDown() {
     }
 
     // Find best alive candidate (highest battery_mv, skip self at slot 0)
-    uint8_t bestIdx = 0;
-    uint16_t bestBat = 0;
+    PeerEntry candidate;
+    bool found = false;
     uint8_t count = PeerTable::peerCount();
     for (uint8_t i = 1; i < count; i++) {
-        PeerEntry* e = PeerTable::getEntryByIndex(i);
-        if (!e || (e->flags & PEER_STATUS_DEAD)) continue;
-        if (e->battery_mv > bestBat) {
-            bestBat = e->battery_mv;
-            bestIdx = i;
+        PeerEntry e;
+        if (!PeerTable::readEntry(i, &e) || (e.flags & PEER_STATUS_DEAD)) continue;
+        if (!found || e.battery_mv > candidate.battery_mv) {
+            candidate = e;
+            found = true;
         }
     }
 
-    if (bestIdx == 0) {
+    if (!found) {
         Serial.println("No alive peers to hand off gateway role.");
         return;
     }
 
-    PeerEntry* candidate = PeerTable::getEntryByIndex(bestIdx);
     Serial.printf("Stepping down, nominating %02X:%02X:%02X:%02X:%02X:%02X (%u mV)\n",
-        candidate->mac[0], candidate->mac[1], candidate->mac[2],
-        candidate->mac[3], candidate->mac[4], candidate->mac[5], candidate->battery_mv);
+        candidate.mac[0], candidate.mac[1], candidate.mac[2],
+        candidate.mac[3], candidate.mac[4], candidate.mac[5], candidate.battery_mv);
 
-    nominateNode(candidate->mac);
+    nominateNode(candidate.mac);
 }
 
 // One-shot task to perform role transfer outside timer callback context
@@ -1157,35 +2141,25 @@ void MeshConductor::forceReelection() {
 // --- Messaging helpers ---
 
 esp_err_t MeshConductor::sendToRoot(const void* data, uint16_t len) {
-    mesh_data_t mdata;
-    mdata.data = (uint8_t*)data;
-    mdata.size = len;
-    mdata.proto = MESH_PROTO_BIN;
-    mdata.tos = MESH_TOS_P2P;
-    return esp_mesh_send(NULL, &mdata, MESH_DATA_TODS, NULL, 0);
+    if (esp_mesh_is_root()) return loopbackPush(data, len);
+    uint16_t msgId = (len > MESH_FRAG_MTU) ? fragNextMsgId() : 0;
+    return meshSendFramed(NULL, MESH_DATA_TODS, (const uint8_t*)data, len, msgId);
 }
 
 esp_err_t MeshConductor::sendToNode(const uint8_t* sta_mac, const void* data, uint16_t len) {
-    mesh_data_t mdata;
-    mdata.data = (uint8_t*)data;
-    mdata.size = len;
-    mdata.proto = MESH_PROTO_BIN;
-    mdata.tos = MESH_TOS_P2P;
-
+    if (isSelf(sta_mac)) return loopbackPush(data, len);
     mesh_addr_t addr;
     memcpy(addr.addr, sta_mac, 6);
-    return esp_mesh_send(&addr, &mdata, MESH_DATA_P2P, NULL, 0);
+    uint16_t msgId = (len > MESH_FRAG_MTU) ? fragNextMsgId() : 0;
+    return meshSendFramed(&addr, MESH_DATA_P2P, (const uint8_t*)data, len, msgId);
 }
 
 esp_err_t MeshConductor::broadcastToAll(const void* data, uint16_t len) {
-    uint8_t own_mac[6];
-    esp_read_mac(own_mac, ESP_MAC_WIFI_STA);
+    const uint8_t* own_mac = s_staMac;
 
-    mesh_data_t mdata;
-    mdata.data = (uint8_t*)data;
-    mdata.size = len;
-    mdata.proto = MESH_PROTO_BIN;
-    mdata.tos = MESH_TOS_P2P;
+    // One message ID for every copy — receivers key reassembly on (source, id)
+    uint16_t msgId = (len > MESH_FRAG_MTU) ? fragNextMsgId() : 0;
+    const uint8_t* bytes = (const uint8_t*)data;
 
     esp_err_t last_err = ESP_OK;
 
@@ -1193,24 +2167,118 @@ esp_err_t MeshConductor::broadcastToAll(const void* data, uint16_t len) {
         // ESP-IDF root: use routing table for complete mesh coverage
         mesh_addr_t routing_table[MESH_MAX_NODES];
         int table_size = 0;
-        esp_mesh_get_routing_table(routing_table, MESH_MAX_NODES, &table_size);
+        esp_mesh_get_routing_table(routing_table, sizeof(routing_table), &table_size);
 
         for (int i = 0; i < table_size; i++) {
             if (memcmp(routing_table[i].addr, own_mac, 6) == 0) continue;
-            esp_err_t err = esp_mesh_send(&routing_table[i], &mdata, MESH_DATA_P2P, NULL, 0);
+            esp_err_t err = meshSendFramed(&routing_table[i], MESH_DATA_P2P, bytes, len, msgId);
             if (err != ESP_OK) last_err = err;
         }
     } else {
         // Non-root gateway (after role transfer): use PeerTable MACs
         uint8_t count = PeerTable::peerCount();
         for (uint8_t i = 0; i < count; i++) {
-            PeerEntry* e = PeerTable::getEntryByIndex(i);
-            if (!e) continue;
-            if (memcmp(e->mac, own_mac, 6) == 0) continue;
-            if (e->flags & PEER_STATUS_DEAD) continue;
+            PeerEntry e;
+            if (!PeerTable::readEntry(i, &e)) continue;
+            if (memcmp(e.mac, own_mac, 6) == 0) continue;
+            if (e.flags & PEER_STATUS_DEAD) continue;
             mesh_addr_t addr;
-            memcpy(addr.addr, e->mac, 6);
-            esp_err_t err = esp_mesh_send(&addr, &mdata, MESH_DATA_P2P, NULL, 0);
+            memcpy(addr.addr, e.mac, 6);
+            esp_err_t err = meshSendFramed(&addr, MESH_DATA_P2P, bytes, len, msgId);
+            if (err != ESP_OK) last_err = err;
+        }
+    }
+    return last_err;
+}
+
+esp_err_t MeshConductor::sendReliable(const uint8_t* sta_mac, const void* data, uint16_t len,
+                                       ReliableDoneCb done, void* ctx) {
+    if (len == 0 || len > MESH_REL_MAX_PAYLOAD) return ESP_ERR_INVALID_ARG;
+    if (isSelf(sta_mac)) {
+        esp_err_t err = loopbackPush(data, len);   // nothing to lose in flight
+        if (done) done(sta_mac, err == ESP_OK, ctx);
+        return err;
+    }
+    if (!s_relMutex) return ESP_ERR_INVALID_STATE;
+
+    xSemaphoreTake(s_relMutex, portMAX_DELAY);
+    RelSlot* slot = nullptr;
+    for (uint8_t i = 0; i < MESH_REL_SLOTS; i++) {
+        if (!s_relSlots[i].used && !s_relSlots[i].sending) { slot = &s_relSlots[i]; break; }
+    }
+    if (!slot) {
+        s_relNoSlot++;
+        xSemaphoreGive(s_relMutex);
+        return ESP_ERR_NO_MEM;   // nothing sent: the caller decides
+    }
+
+    RelPeer* p = relPeer(sta_mac, true);
+    ReliableHeader* hdr = (ReliableHeader*)slot->frame;
+    hdr->type = MSG_TYPE_RELIABLE;
+    hdr->session = s_relSession;
+    hdr->seq = p->tx_seq++;
+    memcpy(slot->frame + sizeof(ReliableHeader), data, len);
+
+    slot->used = true;
+    memcpy(slot->dest, sta_mac, 6);
+    slot->seq = hdr->seq;
+    slot->retries = 0;
+    slot->len = sizeof(ReliableHeader) + len;
+    slot->first_ms = slot->sent_ms = millis();
+    slot->done = done;
+    slot->ctx = ctx;
+    slot->sending = true;
+    s_relSent++;
+    xSemaphoreGive(s_relMutex);
+
+    LinkStats::onReliableSent(sta_mac);
+    // A failed first send is left to the retransmit timer — the slot is queued
+    relSendFrame(sta_mac, slot->frame, slot->len);
+    xSemaphoreTake(s_relMutex, portMAX_DELAY);
+    slot->sending = false;
+    xSemaphoreGive(s_relMutex);
+    return ESP_OK;
+}
+
+uint8_t MeshConductor::reliableFreeSlots() {
+    if (!s_relMutex) return 0;
+    uint8_t n = 0;
+    xSemaphoreTake(s_relMutex, portMAX_DELAY);
+    for (uint8_t i = 0; i < MESH_REL_SLOTS; i++)
+        if (!s_relSlots[i].used && !s_relSlots[i].sending) n++;
+    xSemaphoreGive(s_relMutex);
+    return n;
+}
+
+// One copy of broadcastReliable(): with the pool full it goes out
+// best-effort, and the caller hears about it through ESP_ERR_NO_MEM
+static esp_err_t relBroadcastOne(const uint8_t* mac, const void* data, uint16_t len) {
+    esp_err_t err = MeshConductor::sendReliable(mac, data, len);
+    if (err == ESP_ERR_NO_MEM) MeshConductor::sendToNode(mac, data, len);
+    return err;
+}
+
+esp_err_t MeshConductor::broadcastReliable(const void* data, uint16_t len) {
+    const uint8_t* own_mac = s_staMac;
+
+    esp_err_t last_err = ESP_OK;
+    if (esp_mesh_is_root()) {
+        mesh_addr_t routing_table[MESH_MAX_NODES];
+        int table_size = 0;
+        esp_mesh_get_routing_table(routing_table, sizeof(routing_table), &table_size);
+        for (int i = 0; i < table_size; i++) {
+            if (memcmp(routing_table[i].addr, own_mac, 6) == 0) continue;
+            esp_err_t err = relBroadcastOne(routing_table[i].addr, data, len);
+            if (err != ESP_OK) last_err = err;
+        }
+    } else {
+        uint8_t count = PeerTable::peerCount();
+        for (uint8_t i = 0; i < count; i++) {
+            PeerEntry e;
+            if (!PeerTable::readEntry(i, &e)) continue;
+            if (memcmp(e.mac, own_mac, 6) == 0) continue;
+            if (e.flags & PEER_STATUS_DEAD) continue;
+            esp_err_t err = relBroadcastOne(e.mac, data, len);
             if (err != ESP_OK) last_err = err;
         }
     }
@@ -1219,37 +2287,172 @@ esp_err_t MeshConductor::broadcastToAll(const void* data, uint16_t len) {
 
 // --- Remote config helpers ---
 
-bool MeshConductor::sendConfigReq(const uint8_t* sta_mac, const char* json, uint8_t reqId) {
-    size_t jsonLen = strlen(json);
-    if (jsonLen + 3 > 512) return false;  // too large
+uint8_t MeshConductor::configFanout(const uint8_t (*macs)[6], uint8_t count,
+                                    const uint8_t* body, uint16_t len,
+                                    uint32_t timeout_ms, ConfigRespCb cb, void* ctx) {
+    if (len + 2 > MESH_REL_MAX_PAYLOAD) return 0;  // too large
+    if (!s_cfgRing || count == 0) return 0;
+    if (count > MESH_MAX_NODES) count = MESH_MAX_NODES;
 
-    uint8_t buf[512];
+    uint8_t buf[MESH_REL_MAX_PAYLOAD];
     buf[0] = MSG_TYPE_CONFIG_REQ;
+    memcpy(&buf[2], body, len);
+
+    xSemaphoreTake(s_cfgCallMutex, portMAX_DELAY);
+    uint8_t reqId = ++s_cfgNextReqId;
     buf[1] = reqId;
-    memcpy(&buf[2], json, jsonLen + 1);  // include null terminator
 
-    s_configRespReqId = reqId;
-    s_configRespBuf[0] = '\0';
-    // Drain any stale semaphore
-    if (s_configRespSema)
-        xSemaphoreTake(s_configRespSema, 0);
+    // Register every target before the first send so no fast reply is
+    // missed. One deadline for the whole fanout: waiting for reliable
+    // slots eats into it rather than adding a timeout per target.
+    uint32_t deadline = millis() + timeout_ms;
+    xSemaphoreTake(s_cfgMutex, portMAX_DELAY);
+    for (uint8_t i = 0; i < count; i++) {
+        s_cfgPending[i].used = true;
+        memcpy(s_cfgPending[i].mac, macs[i], 6);
+        s_cfgPending[i].reqId = reqId;
+        s_cfgPending[i].deadline_ms = deadline;
+    }
+    xSemaphoreGive(s_cfgMutex);
+
+    uint8_t outstanding = count;
+    for (uint8_t i = 0; i < count; i++) {
+        esp_err_t err = sendReliable(macs[i], buf, 2 + len);
+        // More targets than reliable slots: wait for one to free up
+        while (err == ESP_ERR_NO_MEM && (int32_t)(deadline - millis()) > 0) {
+            vTaskDelay(pdMS_TO_TICKS(10));
+            err = sendReliable(macs[i], buf, 2 + len);
+        }
+        if (err != ESP_OK) {
+            xSemaphoreTake(s_cfgMutex, portMAX_DELAY);
+            bool wasPending = s_cfgPending[i].used;
+            s_cfgPending[i].used = false;
+            xSemaphoreGive(s_cfgMutex);
+            if (wasPending) {
+                outstanding--;
+                cb(macs[i], nullptr, 0, ctx);
+            }
+        }
+    }
 
-    esp_err_t err = sendToNode(sta_mac, buf, 2 + jsonLen + 1);
-    return err == ESP_OK;
+    // Collect replies in arrival order; expire whatever is left at the deadline
+    uint8_t replies = 0;
+    while (outstanding > 0) {
+        uint32_t now = millis();
+        int32_t wait = (int32_t)timeout_ms;
+        uint8_t expired[MESH_MAX_NODES];
+        uint8_t nExpired = 0;
+        xSemaphoreTake(s_cfgMutex, portMAX_DELAY);
+        for (uint8_t i = 0; i < count; i++) {
+            if (!s_cfgPending[i].used) continue;
+            int32_t left = (int32_t)(s_cfgPending[i].deadline_ms - now);
+            if (left <= 0) {
+                s_cfgPending[i].used = false;
+                expired[nExpired++] = i;
+            } else if (left < wait) {
+                wait = left;
+            }
+        }
+        xSemaphoreGive(s_cfgMutex);
+        for (uint8_t k = 0; k < nExpired; k++)
+            cb(macs[expired[k]], nullptr, 0, ctx);
+        outstanding -= nExpired;
+        if (outstanding == 0) break;
+
+        size_t itemSize = 0;
+        uint8_t* item = (uint8_t*)xRingbufferReceive(s_cfgRing, &itemSize, pdMS_TO_TICKS(wait));
+        if (!item) continue;
+        cb(item, item + 6, (uint16_t)(itemSize - 6), ctx);
+        vRingbufferReturnItem(s_cfgRing, item);
+        replies++;
+        outstanding--;
+    }
+    xSemaphoreGive(s_cfgCallMutex);
+    return replies;
 }
 
-bool MeshConductor::waitConfigResp(char* outBuf, size_t bufSize, uint32_t timeout_ms) {
-    if (!s_configRespSema) return false;
-    if (xSemaphoreTake(s_configRespSema, pdMS_TO_TICKS(timeout_ms)) == pdTRUE) {
-        strncpy(outBuf, s_configRespBuf, bufSize - 1);
-        outBuf[bufSize - 1] = '\0';
-        return true;
+// RX task: match a CONFIG_RESP to its outstanding request and queue it
+static void configOnResp(const uint8_t* from, uint8_t reqId, const uint8_t* body, uint16_t len) {
+    if (!s_cfgMutex) return;
+    xSemaphoreTake(s_cfgMutex, portMAX_DELAY);
+    CfgPending* p = nullptr;
+    for (uint8_t i = 0; i < MESH_MAX_NODES; i++) {
+        CfgPending* c = &s_cfgPending[i];
+        if (c->used && c->reqId == reqId && memcmp(c->mac, from, 6) == 0) { p = c; break; }
     }
-    return false;
+    if (!p) {
+        xSemaphoreGive(s_cfgMutex);
+        return;   // late, duplicate or unsolicited
+    }
+
+    // Never block here: the caller drains the ring but needs s_cfgMutex to
+    // do so. A full ring leaves the request pending and it times out.
+    void* item = nullptr;
+    if (xRingbufferSendAcquire(s_cfgRing, &item, 6 + len, 0) != pdTRUE) {
+        xSemaphoreGive(s_cfgMutex);
+        s_cfgDropped++;
+        SqLog.printf("[mesh] CONFIG_RESP from %02X:%02X dropped (ring full, %lu total)\n",
+            from[4], from[5], (unsigned long)s_cfgDropped);
+        return;
+    }
+    p->used = false;
+    memcpy(item, from, 6);
+    memcpy((uint8_t*)item + 6, body, len);
+    xRingbufferSendComplete(s_cfgRing, item);
+    xSemaphoreGive(s_cfgMutex);
+}
+
+// --- Self identity ---
+
+const uint8_t* MeshConductor::staMac()    { return s_staMac; }
+const uint8_t* MeshConductor::softapMac() { return s_apMac; }
+
+bool MeshConductor::isSelf(const uint8_t* sta_mac) {
+    return memcmp(sta_mac, s_staMac, 6) == 0;
 }
 
 // --- Gateway MAC tracking ---
 
+const uint8_t* MeshConductor::electionRanked(uint8_t rank) {
+    return (rank < s_rankCount) ? s_rankMac[rank] : nullptr;
+}
+
+void MeshConductor::requestTakeover() {
+    if (s_electTaskHandle)
+        xTaskNotify(s_electTaskHandle, ELECT_NOTIFY_TAKEOVER, eSetBits);
+}
+
+// --- Split-mesh merge hooks ---
+
+void MeshConductor::holdElection() {
+    // The merge settles the gateway: drop the re-election a joining child
+    // (the other gateway) would otherwise trigger on the root
+    if (s_settleTimer) xTimerStop(s_settleTimer, 0);
+    if (s_electTimer) xTimerStop(s_electTimer, 0);
+    s_electionDone = true;
+    s_scoreCount = 0;
+    s_electStartMs = 0;
+}
+
+void MeshConductor::requestMergeStep() {
+    if (s_electTaskHandle)
+        xTaskNotify(s_electTaskHandle, ELECT_NOTIFY_MERGE, eSetBits);
+}
+
+void MeshConductor::handOver(const uint8_t* new_gw) {
+    if (!s_role || !s_role->isGateway()) return;
+
+    if (esp_mesh_is_root()) {
+        mesh_vote_t vote;
+        vote.percentage = 0.8f;
+        vote.is_rc_specified = true;
+        memcpy(vote.config.rc_addr.addr, new_gw, 6);
+        SqLog.println("[mesh] Waiving root to merge survivor...");
+        esp_mesh_waive_root(&vote, MESH_VOTE_REASON_ROOT_INITIATED);
+    }
+    assignRole(new_gw);   // the survivor announces itself with ROLE_CHANGE
+}
+
 const uint8_t* MeshConductor::gatewayMac() {
     return s_gatewayMac;
 }
@@ -11,9 +11,11 @@
 #include "clock_sync.h"
 #include "web_server.h"
 #include "setup_delegate.h"
+#include "hot_standby.h"
+#include "mesh_merge.h"
+#include "geo_cache.h"
 #include <Arduino.h>
 #include <esp_wifi.h>
-#include <esp_mac.h>
 
 // Gateway self-heartbeat timer — updates own battery in PeerTable
 static TimerHandle_t s_gwHeartbeatTimer = nullptr;
@@ -34,6 +36,9 @@ void Gateway::begin() {
     FtmScheduler::init();
     ClockSync::init();
 
+    // Last known geometry: peers, edges (with age) and positions by MAC
+    GeoCache::begin();
+
     // Start self-heartbeat timer (update own battery in PeerTable)
     uint32_t hbInterval = (uint32_t)NvsConfigManager::heartbeatInterval_s;
     if (s_gwHeartbeatTimer == nullptr) {
@@ -44,6 +49,9 @@ void Gateway::begin() {
     }
     xTimerStart(s_gwHeartbeatTimer, 0);
 
+    // Stream state to a hot standby so a gateway loss needs no reboot
+    HotStandby::beginPrimary();
+
     // Phase 5: Web UI
     if (SqWebServer::hasWifiCreds()) {
         SqWebServer::start();
@@ -51,15 +59,13 @@ void Gateway::begin() {
         // No WiFi creds — enter Setup Delegate mode
         // Lone gateway (0 peers) handles it itself
         if (m_peerCount == 0) {
-            uint8_t ownMac[6];
-            esp_read_mac(ownMac, ESP_MAC_WIFI_STA);
+            const uint8_t* ownMac = MeshConductor::staMac();
             SqLog.println("[gateway] No WiFi creds, self-delegating for setup");
             SetupDelegate::begin(ownMac);
         } else {
             // TODO: designate a peer as Setup Delegate (send MSG_TYPE_SETUP_DELEGATE)
             // For now, self-delegate even with peers
-            uint8_t ownMac[6];
-            esp_read_mac(ownMac, ESP_MAC_WIFI_STA);
+            const uint8_t* ownMac = MeshConductor::staMac();
             SqLog.println("[gateway] No WiFi creds, self-delegating for setup (has peers)");
             SetupDelegate::begin(ownMac);
         }
@@ -75,6 +81,9 @@ void Gateway::end() {
     if (s_gwHeartbeatTimer) {
         xTimerStop(s_gwHeartbeatTimer, 0);
     }
+    HotStandby::endPrimary();
+    MeshMerge::cancel();
+    GeoCache::end();
 
     Orchestrator::setMode(ORCH_OFF);
     ClockSync::stop();
@@ -98,14 +107,14 @@ void Gateway::onPeerLeft(const uint8_t* mac) {
         m_peerCount, mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
 
     // Mark peer as dead in PeerTable
-    PeerEntry* e = PeerTable::getEntry(mac);
-    if (e) {
-        e->flags = PEER_STATUS_DEAD;
-    }
+    PeerTable::markDead(mac);
 }
 
 void Gateway::printStatus() {
     Serial.println("--- Gateway Status ---");
     Serial.printf("Peers: %u\n", m_peerCount);
+    HotStandby::printStatus(Serial);
+    MeshMerge::printStatus(Serial);
+    GeoCache::printStatus(Serial);
     PeerTable::print();
 }
@@ -0,0 +1,406 @@
+#include "mesh_merge.h"
+#include "mesh_conductor.h"
+#include "peer_table.h"
+#include "mesh_footprint.h"
+#include "ftm_scheduler.h"
+#include "bsp.hpp"
+#include "sq_log.h"
+#include <Arduino.h>
+#include <esp_mesh.h>
+#include <string.h>
+
+static const char* TAG = "merge";
+
+enum MergePhase : uint8_t {
+    MERGE_IDLE = 0,
+    MERGE_HELLO,       // looking for another gateway
+    MERGE_SENDING,     // loser: streaming state to the survivor
+    MERGE_HANDOVER,    // loser: transfer queued, step down on the election task
+    MERGE_RECEIVING,   // survivor: collecting the loser's state
+    MERGE_APPLY,       // survivor: fold it in on the election task
+};
+
+// --- File-scope state ---
+
+static MergePhase    s_phase      = MERGE_IDLE;
+static TimerHandle_t s_tickTimer  = nullptr;
+static uint8_t       s_otherMac[6] = {0};
+static float         s_otherScore = 0.0f;
+static float         s_ownScore   = 0.0f;   // as sent: both sides must judge the same numbers
+static uint8_t       s_helloTries = 0;
+static uint32_t      s_startMs    = 0;
+
+// Loser: transfer cursors
+static uint8_t  s_txPeer = 0;
+static uint16_t s_txEdge = 0;
+
+// Survivor: the loser's state, in the loser's slot numbering
+static PeerSyncEntry s_inPeers[MESH_MAX_NODES];
+static bool          s_inHave[MESH_MAX_NODES];
+static uint8_t       s_inPeerTotal = 0;
+static PeerEdge      s_inEdges[PEER_EDGE_COUNT];
+static uint16_t      s_inAge[PEER_EDGE_COUNT];
+static_assert(sizeof(s_inPeers) + sizeof(s_inHave) + sizeof(s_inEdges) + sizeof(s_inAge)
+              == FOOTPRINT_MERGE_BUFFERS, "mesh_footprint.h: merge buffers");
+
+// Last merge (either side)
+static uint32_t s_merges    = 0;
+static bool     s_lastWon   = false;
+static uint8_t  s_lastPeer[6] = {0};
+static uint8_t  s_lastAdded = 0;     // survivor: peers new to us
+static uint16_t s_lastTaken = 0;     // survivor: edges taken from the loser
+static uint16_t s_lastKept  = 0;     // survivor: edges where ours was fresher
+static uint16_t s_lastSent  = 0;     // loser: edges shipped
+static uint32_t s_lastMs    = 0;     // decision → handover / applied
+
+// --- Helpers ---
+
+static void tickTimerCb(TimerHandle_t t);
+
+static void startTick() {
+    if (s_tickTimer == nullptr) {
+        s_tickTimer = xTimerCreate("merge", pdMS_TO_TICKS(MESH_MERGE_TICK_MS),
+                                   pdTRUE, nullptr, tickTimerCb);
+    }
+    xTimerStart(s_tickTimer, 0);
+}
+
+static void stopTick() {
+    if (s_tickTimer) xTimerStop(s_tickTimer, 0);
+}
+
+static void sendHello(const uint8_t* to, uint8_t flags) {
+    MergeHelloMsg h;
+    h.type = MSG_TYPE_MERGE_HELLO;
+    h.flags = flags;
+    memcpy(h.mac, MeshConductor::staMac(), 6);
+    h.score = s_ownScore;
+    h.peer_count = PeerTable::peerCount();
+    if (to) {
+        // The merge tick repeats HELLOs, so a full pool only costs the guarantee
+        if (MeshConductor::sendReliable(to, &h, sizeof(h)) == ESP_ERR_NO_MEM)
+            MeshConductor::sendToNode(to, &h, sizeof(h));
+    } else {
+        MeshConductor::sendToRoot(&h, sizeof(h));
+    }
+}
+
+static void clearInbound() {
+    memset(s_inHave, 0, sizeof(s_inHave));
+    s_inPeerTotal = 0;
+    for (uint16_t e = 0; e < PEER_EDGE_COUNT; e++) {
+        s_inEdges[e].distance_cm = PEER_DIST_UNKNOWN;
+        s_inEdges[e].quality = 0;
+        s_inAge[e] = FTM_EDGE_AGE_UNKNOWN;
+    }
+}
+
+// Both gateways run this on the same pair of scores and reach the same
+// verdict: higher score survives, exact ties go to the higher MAC.
+static void decide(const uint8_t* other, float otherScore, uint8_t otherPeers) {
+    float own = s_ownScore;
+    bool survive = (own > otherScore) ||
+                   (own == otherScore && memcmp(MeshConductor::staMac(), other, 6) > 0);
+
+    memcpy(s_otherMac, other, 6);
+    s_otherScore = otherScore;
+    s_startMs = millis();
+    MeshConductor::holdElection();
+
+    SqLog.printf("[merge] Second gateway %02X:%02X:%02X:%02X:%02X:%02X (score %.1f, %u peers) vs ours %.1f (%u peers) — %s\n",
+        other[0], other[1], other[2], other[3], other[4], other[5],
+        otherScore, otherPeers, own, PeerTable::peerCount(),
+        survive ? "surviving" : "handing over");
+
+    if (survive) {
+        clearInbound();
+        s_phase = MERGE_RECEIVING;
+    } else {
+        s_txPeer = 0;
+        s_txEdge = 0;
+        s_lastSent = 0;
+        s_phase = MERGE_SENDING;
+    }
+    startTick();
+}
+
+// Loser: one tick's worth of MERGE_STATE frames. Peers go first, then every
+// known edge with its age. Returns true once the DONE frame is queued.
+static bool sendBatch() {
+    // Static: too large for the timer task stack
+    static uint8_t buf[MESH_REL_MAX_PAYLOAD];
+    uint8_t total = PeerTable::peerCount();
+
+    for (uint8_t f = 0; f < MESH_MERGE_BATCH; f++) {
+        uint8_t  startPeer = s_txPeer;
+        uint16_t startEdge = s_txEdge;
+        MergeStateMsg* hdr = (MergeStateMsg*)buf;
+        hdr->type = MSG_TYPE_MERGE_STATE;
+        hdr->flags = 0;
+        hdr->peer_total = total;
+        hdr->peer_base = s_txPeer;
+        hdr->peer_count = 0;
+        hdr->edge_count = 0;
+        uint16_t pos = sizeof(MergeStateMsg);
+
+        while (s_txPeer < total && pos + sizeof(PeerSyncEntry) <= MESH_REL_MAX_PAYLOAD) {
+            PeerEntry e;
+            PeerSyncEntry rec = {};
+            if (PeerTable::readEntry(s_txPeer, &e)) {
+                memcpy(rec.mac, e.mac, 6);
+                memcpy(rec.softap_mac, e.softap_mac, 6);
+                rec.battery_mv = e.battery_mv;
+                rec.flags = e.flags;
+            }
+            memcpy(buf + pos, &rec, sizeof(rec));
+            pos += sizeof(rec);
+            hdr->peer_count++;
+            s_txPeer++;
+        }
+
+        while (s_txEdge < PEER_EDGE_COUNT && hdr->edge_count < 255 &&
+               pos + sizeof(MergeEdge) <= MESH_REL_MAX_PAYLOAD) {
+            uint16_t e = s_txEdge++;
+            PeerEdge pe = PeerTable::getEdge(e);
+            if (pe.distance_cm == PEER_DIST_UNKNOWN) continue;
+            MergeEdge rec;
+            rec.edge = e;
+            rec.distance_cm = pe.distance_cm;
+            rec.quality = pe.quality;
+            rec.age_s = FtmScheduler::edgeAge_s(e);
+            memcpy(buf + pos, &rec, sizeof(rec));
+            pos += sizeof(rec);
+            hdr->edge_count++;
+        }
+        bool done = (s_txPeer >= total && s_txEdge >= PEER_EDGE_COUNT);
+        if (done) hdr->flags |= MERGE_STATE_DONE;
+        if (MeshConductor::sendReliable(s_otherMac, buf, pos) != ESP_OK) {
+            // Pool full: rebuild this frame on the next tick
+            s_txPeer = startPeer;
+            s_txEdge = startEdge;
+            return false;
+        }
+        s_lastSent += hdr->edge_count;
+        if (done) return true;
+    }
+    return false;
+}
+
+// Survivor: union the loser's peers, then take each of its edges where ours
+// is missing or older. Runs on the election task (PeerTable + solver work).
+static void applyInbound() {
+    static PeerSyncEntry live[MESH_MAX_NODES];
+    uint8_t n = 0;
+    for (uint8_t i = 0; i < s_inPeerTotal; i++) {
+        if (s_inHave[i]) live[n++] = s_inPeers[i];
+    }
+
+    uint8_t before = PeerTable::peerCount();
+    PeerTable::seedFromShadow(live, n);   // skips known, dead and self
+    s_lastAdded = PeerTable::peerCount() - before;
+
+    // Loser slot → our slot
+    int8_t remap[MESH_MAX_NODES];
+    for (uint8_t i = 0; i < MESH_MAX_NODES; i++)
+        remap[i] = (i < s_inPeerTotal && s_inHave[i]) ? PeerTable::getIndex(s_inPeers[i].mac) : -1;
+
+    s_lastTaken = 0;
+    s_lastKept = 0;
+    for (uint8_t a = 0; a < s_inPeerTotal; a++) {
+        if (remap[a] < 0) continue;
+        for (uint8_t b = a + 1; b < s_inPeerTotal; b++) {
+            if (remap[b] < 0 || remap[b] == remap[a]) continue;
+            uint16_t ie = PeerTable::edgeIndex(a, b);
+            const PeerEdge& in = s_inEdges[ie];
+            if (in.distance_cm == PEER_DIST_UNKNOWN) continue;
+
+            uint16_t oe = PeerTable::edgeIndex(remap[a], remap[b]);
+            PeerEdge ours = PeerTable::getEdge(oe);
+            uint16_t oursAge = FtmScheduler::edgeAge_s(oe);
+            bool take = (ours.distance_cm == PEER_DIST_UNKNOWN) ||
+                        (s_inAge[ie] < oursAge) ||
+                        (s_inAge[ie] == oursAge && in.quality > ours.quality);
+            if (!take) { s_lastKept++; continue; }
+
+            PeerTable::setDistance(remap[a], remap[b], in.distance_cm, in.quality);
+            FtmScheduler::setEdgeAge(oe, s_inAge[ie]);
+            s_lastTaken++;
+        }
+    }
+
+    // The loser's subtree still reports to it: point everyone at us
+    RoleChangeMsg rc;
+    rc.type = MSG_TYPE_ROLE_CHANGE;
+    memcpy(rc.new_gw, MeshConductor::staMac(), 6);
+    MeshConductor::broadcastReliable(&rc, sizeof(rc));
+
+    if (s_lastTaken > 0) {
+        FtmScheduler::triggerSolve();
+        FtmScheduler::broadcastPositions();
+    }
+}
+
+static void tickTimerCb(TimerHandle_t t) {
+    (void)t;
+    switch (s_phase) {
+    case MERGE_HELLO:
+        if (s_helloTries >= MESH_MERGE_HELLO_TRIES) {
+            SqLog.println("[merge] No other gateway answered");
+            s_phase = MERGE_IDLE;
+            stopTick();
+            break;
+        }
+        s_helloTries++;
+        sendHello(nullptr, 0);
+        break;
+
+    case MERGE_SENDING:
+        if (sendBatch()) {
+            stopTick();
+            s_phase = MERGE_HANDOVER;
+            MeshConductor::requestMergeStep();
+        }
+        break;
+
+    case MERGE_RECEIVING:
+        if (millis() - s_startMs >= MESH_MERGE_TIMEOUT_MS) {
+            SqLog.println("[merge] Transfer stalled — applying what arrived");
+            stopTick();
+            s_phase = MERGE_APPLY;
+            MeshConductor::requestMergeStep();
+        }
+        break;
+
+    default:
+        stopTick();
+        break;
+    }
+}
+
+// --- Public API ---
+
+void MeshMerge::announce() {
+    if (!MeshConductor::isGateway()) return;
+    if (s_phase != MERGE_IDLE && s_phase != MERGE_HELLO) return;
+    s_phase = MERGE_HELLO;
+    s_ownScore = (float)MeshConductor::computeScore();
+    s_helloTries = 1;
+    sendHello(nullptr, 0);
+    startTick();
+    SqLog.println("[merge] Gateway under a foreign root — looking for its gateway");
+}
+
+void MeshMerge::onHello(const uint8_t* from, const MergeHelloMsg* msg) {
+    if (MeshConductor::isSelf(msg->mac)) return;
+
+    if (!MeshConductor::isGateway()) {
+        // HELLO travels to the root; relay it if the root isn't the gateway
+        const uint8_t* gw = MeshConductor::gatewayMac();
+        static const uint8_t zero[6] = {0};
+        if (esp_mesh_is_root() && memcmp(gw, zero, 6) != 0 &&
+            memcmp(gw, msg->mac, 6) != 0 && memcmp(gw, from, 6) != 0) {
+            if (MeshConductor::sendReliable(gw, msg, sizeof(*msg)) == ESP_ERR_NO_MEM)
+                MeshConductor::sendToNode(gw, msg, sizeof(*msg));
+        }
+        return;
+    }
+
+    bool reply = (msg->flags & MERGE_HELLO_REPLY) != 0;
+    if (s_phase != MERGE_IDLE && s_phase != MERGE_HELLO) {
+        // Already merging: re-answer a repeated HELLO from the same peer
+        // (our reply may have been lost), ignore anyone else
+        if (!reply && memcmp(msg->mac, s_otherMac, 6) == 0)
+            sendHello(msg->mac, MERGE_HELLO_REPLY);
+        return;
+    }
+
+    if (s_phase == MERGE_IDLE) s_ownScore = (float)MeshConductor::computeScore();
+    if (!reply) sendHello(msg->mac, MERGE_HELLO_REPLY);
+    decide(msg->mac, msg->score, msg->peer_count);
+}
+
+void MeshMerge::onState(const uint8_t* from, const uint8_t* buf, uint16_t len) {
+    if (s_phase != MERGE_RECEIVING || len < sizeof(MergeStateMsg)) return;
+    if (memcmp(from, s_otherMac, 6) != 0) return;
+
+    const MergeStateMsg* hdr = (const MergeStateMsg*)buf;
+    uint16_t pos = sizeof(MergeStateMsg);
+    if (hdr->peer_total > MESH_MAX_NODES) return;
+    s_inPeerTotal = hdr->peer_total;
+    s_startMs = millis();   // progress: restart the stall timeout
+
+    for (uint8_t i = 0; i < hdr->peer_count && pos + sizeof(PeerSyncEntry) <= len; i++) {
+        uint16_t slot = hdr->peer_base + i;
+        if (slot < MESH_MAX_NODES) {
+            memcpy(&s_inPeers[slot], buf + pos, sizeof(PeerSyncEntry));
+            s_inHave[slot] = true;
+        }
+        pos += sizeof(PeerSyncEntry);
+    }
+
+    for (uint8_t i = 0; i < hdr->edge_count && pos + sizeof(MergeEdge) <= len; i++) {
+        MergeEdge rec;
+        memcpy(&rec, buf + pos, sizeof(rec));
+        pos += sizeof(rec);
+        if (rec.edge >= PEER_EDGE_COUNT) continue;
+        s_inEdges[rec.edge].distance_cm = rec.distance_cm;
+        s_inEdges[rec.edge].quality = rec.quality;
+        s_inAge[rec.edge] = rec.age_s;
+    }
+
+    if (hdr->flags & MERGE_STATE_DONE) {
+        stopTick();
+        s_phase = MERGE_APPLY;
+        MeshConductor::requestMergeStep();
+    }
+}
+
+void MeshMerge::runPending() {
+    if (s_phase == MERGE_HANDOVER) {
+        s_phase = MERGE_IDLE;
+        s_merges++;
+        s_lastWon = false;
+        memcpy(s_lastPeer, s_otherMac, 6);
+        s_lastMs = millis() - s_startMs;
+        SqLog.printf("[merge] Shipped %u peers + %u edges in %lu ms — stepping down\n",
+            s_txPeer, s_lastSent, (unsigned long)s_lastMs);
+        MeshConductor::handOver(s_otherMac);
+    } else if (s_phase == MERGE_APPLY) {
+        applyInbound();
+        s_phase = MERGE_IDLE;
+        s_merges++;
+        s_lastWon = true;
+        memcpy(s_lastPeer, s_otherMac, 6);
+        s_lastMs = millis() - s_startMs;
+        SqLog.printf("[merge] Merged: +%u peers, %u edges taken, %u kept (ours fresher)\n",
+            s_lastAdded, s_lastTaken, s_lastKept);
+    }
+}
+
+void MeshMerge::cancel() {
+    if (s_phase == MERGE_IDLE) return;
+    SqLog.println("[merge] Cancelled");
+    s_phase = MERGE_IDLE;
+    stopTick();
+}
+
+bool MeshMerge::active() {
+    return s_phase != MERGE_IDLE;
+}
+
+void MeshMerge::printStatus(Print& out) {
+    static const char* const names[] = {
+        "idle", "looking for gateway", "sending", "handing over", "receiving", "applying"
+    };
+    out.printf("Split-mesh merge: %s (%lu done)\n", names[s_phase], (unsigned long)s_merges);
+    if (s_merges == 0) return;
+    out.printf("  Last: %s %02X:%02X:%02X:%02X:%02X:%02X in %lu ms",
+        s_lastWon ? "absorbed" : "handed over to",
+        s_lastPeer[0], s_lastPeer[1], s_lastPeer[2],
+        s_lastPeer[3], s_lastPeer[4], s_lastPeer[5], (unsigned long)s_lastMs);
+    if (s_lastWon) {
+        out.printf(", +%u peers, %u edges taken, %u kept\n", s_lastAdded, s_lastTaken, s_lastKept);
+    } else {
+        out.printf(", %u edges shipped\n", s_lastSent);
+    }
+}
@@ -4,6 +4,11 @@
 #include "nvs_config.h"
 #include "bsp.hpp"
 #include "sq_log.h"
+#include "orchestrator.h"
+#include "hot_standby.h"
+#include "peer_table.h"
+#include "link_stats.h"
+#include "rtc_mesh_map.h"
 #include <Arduino.h>
 #include <esp_system.h>
 #include <esp_mac.h>
@@ -13,25 +18,297 @@
 // Heartbeat timers
 static TimerHandle_t s_hbTimer      = nullptr;
 static TimerHandle_t s_earlyHbTimer = nullptr;
+static uint32_t      s_hbPeriod_s   = 0;   // current cadence (sent in every heartbeat)
 
+// Fast heartbeats while the orchestrator plays (dead peers must drop out of
+// travel/sequence quickly), slow ones when idle to save power.
+static uint32_t pickHeartbeatPeriod() {
+    uint32_t s = (Orchestrator::getMode() != ORCH_OFF)
+               ? (uint32_t)NvsConfigManager::heartbeatActive_s
+               : (uint32_t)NvsConfigManager::heartbeatInterval_s;
+    if (s == 0) s = 1;
+    if (s > 255) s = 255;
+    return s;
+}
+
+// --- Heartbeat aggregation ---
+//
+// Every node reports to its mesh parent, which folds its subtree's reports
+// into one HB_AGG frame per interval (own record first). Only fields that
+// changed since the last forward are sent, keyed by short ID, so a stable
+// peer costs 2 bytes per hop instead of a full 22-byte unicast to the root.
+
+struct AggSlot {
+    bool     used;
+    uint8_t  mac[6];
+    uint8_t  softap_mac[6];
+    uint16_t battery_mv;
+    uint8_t  flags;
+    uint8_t  interval_s;
+    uint8_t  layer;
+    int8_t   rssi;
+    uint32_t heard_ms;        // when the peer itself last reported (our receipt - relayed age)
+    bool     sent_valid;      // sent_* hold what the gateway last got from us
+    uint16_t sent_battery;
+    uint8_t  sent_flags;
+    uint8_t  sent_interval;
+    uint8_t  sent_layer;
+    int8_t   sent_rssi;
+};
+
+static AggSlot           s_agg[MESH_MAX_NODES];
+static SemaphoreHandle_t s_aggMutex     = nullptr;
+static uint8_t           s_hbParent[6]  = {0};
+static bool              s_hasHbParent  = false;
+static uint8_t           s_aggSinceFull = 0;
+
+static AggSlot* aggFind(const uint8_t* mac) {
+    AggSlot* freeSlot = nullptr;
+    AggSlot* oldest = nullptr;
+    for (uint8_t i = 0; i < MESH_MAX_NODES; i++) {
+        AggSlot* a = &s_agg[i];
+        if (!a->used) {
+            if (!freeSlot) freeSlot = a;
+            continue;
+        }
+        if (memcmp(a->mac, mac, 6) == 0) return a;
+        if (!oldest || (int32_t)(a->heard_ms - oldest->heard_ms) < 0) oldest = a;
+    }
+    AggSlot* a = freeSlot ? freeSlot : oldest;   // evict the longest-silent peer
+    memset(a, 0, sizeof(AggSlot));
+    a->used = true;
+    memcpy(a->mac, mac, 6);
+    return a;
+}
+
+static int shortIdOf(const uint8_t* mac) {
+    const PeerSyncEntry* shadow = MeshConductor::peerShadowEntries();
+    uint8_t n = MeshConductor::peerShadowCount();
+    for (uint8_t i = 0; i < n; i++)
+        if (memcmp(shadow[i].mac, mac, 6) == 0) return i;
+    return -1;
+}
+
+// Date a report from its source; an older relay never moves it back
+static void aggHeard(AggSlot* a, uint8_t age_s, bool fresh) {
+    uint32_t heard = millis() - (uint32_t)age_s * 1000u;
+    if (fresh || (int32_t)(heard - a->heard_ms) > 0) a->heard_ms = heard;
+}
+
+static void aggStore(const HbAggFull& r) {
+    AggSlot* a = aggFind(r.mac);
+    bool fresh = !a->sent_valid && a->interval_s == 0;
+    memcpy(a->softap_mac, r.softap_mac, 6);
+    a->battery_mv = r.battery_mv;
+    a->flags = r.flags;
+    a->interval_s = r.interval_s;
+    a->layer = r.layer;
+    a->rssi = r.rssi;
+    aggHeard(a, r.age_s, fresh);
+}
+
+static bool rssiMoved(const AggSlot* a) {
+    int d = (int)a->rssi - (int)a->sent_rssi;
+    return d >= LINK_RSSI_REPORT_DB || d <= -LINK_RSSI_REPORT_DB;
+}
+
+// Encode one record and remember what was sent; returns bytes written.
+// useIds: our shadow is bound, so short IDs may stand in for the MAC.
+static uint16_t aggEncode(AggSlot* a, uint8_t* out, bool refresh, bool useIds, uint32_t now) {
+    uint32_t age = (now - a->heard_ms) / 1000u;
+    uint8_t age_s = (uint8_t)(age > 255 ? 255 : age);
+    int sid = useIds ? shortIdOf(a->mac) : -1;
+    if (sid < 0 || sid >= HB_AGG_FULL || !a->sent_valid) {
+        HbAggFull f;
+        f.marker = HB_AGG_FULL;
+        memcpy(f.mac, a->mac, 6);
+        memcpy(f.softap_mac, a->softap_mac, 6);
+        f.battery_mv = a->battery_mv;
+        f.flags = a->flags;
+        f.interval_s = a->interval_s;
+        f.layer = a->layer;
+        f.rssi = a->rssi;
+        f.age_s = age_s;
+        memcpy(out, &f, sizeof(f));
+        a->sent_valid = true;
+        a->sent_battery = a->battery_mv;
+        a->sent_flags = a->flags;
+        a->sent_interval = a->interval_s;
+        a->sent_layer = a->layer;
+        a->sent_rssi = a->rssi;
+        return sizeof(f);
+    }
+
+    uint8_t mask = 0;
+    if (refresh || a->battery_mv != a->sent_battery) mask |= HB_AGG_F_BATTERY;
+    if (refresh || a->flags != a->sent_flags)        mask |= HB_AGG_F_FLAGS;
+    if (refresh || a->interval_s != a->sent_interval) mask |= HB_AGG_F_INTERVAL;
+    // RSSI jitters by a dB or two every beat — only report real moves
+    if (refresh || a->layer != a->sent_layer || rssiMoved(a)) mask |= HB_AGG_F_LINK;
+    if (age_s) mask |= HB_AGG_F_AGE;
+    uint16_t n = 0;
+    out[n++] = (uint8_t)sid;
+    out[n++] = mask;
+    if (mask & HB_AGG_F_BATTERY)  { memcpy(out + n, &a->battery_mv, 2); n += 2; }
+    if (mask & HB_AGG_F_FLAGS)    out[n++] = a->flags;
+    if (mask & HB_AGG_F_INTERVAL) out[n++] = a->interval_s;
+    if (mask & HB_AGG_F_LINK) {
+        out[n++] = a->layer;
+        out[n++] = (uint8_t)a->rssi;
+        a->sent_layer = a->layer;
+        a->sent_rssi = a->rssi;
+    }
+    if (mask & HB_AGG_F_AGE) out[n++] = age_s;
+    a->sent_battery = a->battery_mv;
+    a->sent_flags = a->flags;
+    a->sent_interval = a->interval_s;
+    return n;
+}
+
+// Runs on the timer-service task only: begin() and updateCadence() pend it
+// there rather than calling it, so the static frame has a single writer.
 static void heartbeatTimerCb(TimerHandle_t t) {
     (void)t;
+    if (!s_aggMutex) return;
 
-    HeartbeatMsg hb;
-    hb.type = MSG_TYPE_HEARTBEAT;
-    esp_read_mac(hb.mac, ESP_MAC_WIFI_STA);
-    hb.battery_mv = (uint16_t)PowerManager::batteryMv();
-    hb.flags = 0;  // awake
-    esp_read_mac(hb.softap_mac, ESP_MAC_WIFI_SOFTAP);
+    // Own record
+    HbAggFull self;
+    self.marker = HB_AGG_FULL;
+    memcpy(self.mac, MeshConductor::staMac(), 6);
+    memcpy(self.softap_mac, MeshConductor::softapMac(), 6);
+    self.battery_mv = (uint16_t)PowerManager::batteryMv();
+    self.flags = 0;  // awake
+    self.interval_s = (uint8_t)s_hbPeriod_s;
+    self.age_s = 0;
+    LinkStats::sampleOwnLink(&self.layer, &self.rssi);
 
-    // Route heartbeat to logical gateway (may differ from ESP-IDF root after role transfer)
-    const uint8_t* gw = MeshConductor::gatewayMac();
+    // Static: too large for the timer task stack
+    static uint8_t buf[sizeof(HeartbeatAggMsg) + MESH_MAX_NODES * sizeof(HbAggFull)];
+    HeartbeatAggMsg* hdr = (HeartbeatAggMsg*)buf;
+    uint16_t pos = sizeof(HeartbeatAggMsg);
+
+    xSemaphoreTake(s_aggMutex, portMAX_DELAY);
+    hdr->type = MSG_TYPE_HB_AGG;
+    hdr->count = 0;
+    hdr->epoch = MeshConductor::peerShadowEpoch();
+    bool useIds = MeshConductor::shadowNumberingMatches(hdr->epoch);
+    bool refresh = (++s_aggSinceFull >= MESH_HB_AGG_FULL_EVERY);
+    if (refresh) s_aggSinceFull = 0;
+    aggStore(self);
+    uint32_t now = millis();
+    for (uint8_t i = 0; i < MESH_MAX_NODES; i++) {
+        AggSlot* a = &s_agg[i];
+        if (!a->used) continue;
+        // Forward while the peer's own report is within its period (+ ours,
+        // for phase). Measured from the source, so a silent peer does not
+        // gain a period per relay.
+        uint32_t window = ((uint32_t)a->interval_s + s_hbPeriod_s) * 1000u;
+        if ((now - a->heard_ms) > window) continue;
+        pos += aggEncode(a, buf + pos, refresh, useIds, now);
+        hdr->count++;
+    }
+    xSemaphoreGive(s_aggMutex);
+
+    // Parent aggregates; if it is unknown, go straight to the logical
+    // gateway (may differ from ESP-IDF root after role transfer)
     static const uint8_t zero[6] = {0};
-    if (memcmp(gw, zero, 6) != 0) {
-        MeshConductor::sendToNode(gw, &hb, sizeof(hb));
+    const uint8_t* gw = MeshConductor::gatewayMac();
+    if (s_hasHbParent) {
+        MeshConductor::sendToNode(s_hbParent, buf, pos);
+    } else if (memcmp(gw, zero, 6) != 0) {
+        MeshConductor::sendToNode(gw, buf, pos);
     } else {
         // Gateway MAC not yet known (pre-election) — fall back to ESP-IDF root
-        MeshConductor::sendToRoot(&hb, sizeof(hb));
+        MeshConductor::sendToRoot(buf, pos);
+    }
+}
+
+static void heartbeatPend(void* p1, uint32_t p2) {
+    (void)p1; (void)p2;
+    heartbeatTimerCb(nullptr);
+}
+
+void MeshNode::onChildHeartbeat(const HeartbeatMsg* hb) {
+    if (!s_aggMutex) return;
+    HbAggFull r;
+    r.marker = HB_AGG_FULL;
+    memcpy(r.mac, hb->mac, 6);
+    memcpy(r.softap_mac, hb->softap_mac, 6);
+    r.battery_mv = hb->battery_mv;
+    r.flags = hb->flags;
+    r.interval_s = hb->interval_s ? hb->interval_s : (uint8_t)s_hbPeriod_s;
+    r.layer = 0;   // plain heartbeats carry no link report
+    r.rssi = 0;
+    r.age_s = 0;
+    xSemaphoreTake(s_aggMutex, portMAX_DELAY);
+    aggStore(r);
+    xSemaphoreGive(s_aggMutex);
+}
+
+void MeshNode::onChildAggregate(const uint8_t* buf, uint16_t len) {
+    if (!s_aggMutex || len < sizeof(HeartbeatAggMsg)) return;
+    const HeartbeatAggMsg* hdr = (const HeartbeatAggMsg*)buf;
+    const PeerSyncEntry* shadow = MeshConductor::peerShadowEntries();
+    uint8_t shadowCount = MeshConductor::peerShadowCount();
+    uint16_t pos = sizeof(HeartbeatAggMsg);
+    // The child's short IDs are only ours if its shadow is bound by the
+    // same FULL (the parent may have rebound after a renumbering)
+    bool idsMatch = MeshConductor::shadowNumberingMatches(hdr->epoch);
+
+    xSemaphoreTake(s_aggMutex, portMAX_DELAY);
+    for (uint8_t i = 0; i < hdr->count && pos < len; i++) {
+        if (buf[pos] == HB_AGG_FULL) {
+            if (pos + sizeof(HbAggFull) > len) break;
+            HbAggFull r;
+            memcpy(&r, buf + pos, sizeof(r));
+            pos += sizeof(r);
+            aggStore(r);
+            continue;
+        }
+        if (pos + 2 > len) break;
+        uint8_t sid = buf[pos], mask = buf[pos + 1];
+        pos += 2;
+        uint16_t need = ((mask & HB_AGG_F_BATTERY) ? 2 : 0) + ((mask & HB_AGG_F_FLAGS) ? 1 : 0)
+                      + ((mask & HB_AGG_F_INTERVAL) ? 1 : 0) + ((mask & HB_AGG_F_LINK) ? 2 : 0)
+                      + ((mask & HB_AGG_F_AGE) ? 1 : 0);
+        if (pos + need > len) break;
+        if (!idsMatch || sid >= shadowCount) { pos += need; continue; }   // unknown short ID
+
+        AggSlot* a = aggFind(shadow[sid].mac);
+        bool fresh = !a->sent_valid && a->interval_s == 0;
+        if (fresh) {
+            // First time we see this peer: seed unsent fields from the shadow
+            memcpy(a->softap_mac, shadow[sid].softap_mac, 6);
+            a->battery_mv = shadow[sid].battery_mv;
+            a->flags = shadow[sid].flags & ~PEER_STATUS_DEAD;
+            a->interval_s = (uint8_t)s_hbPeriod_s;
+        }
+        if (mask & HB_AGG_F_BATTERY)  { memcpy(&a->battery_mv, buf + pos, 2); pos += 2; }
+        if (mask & HB_AGG_F_FLAGS)    a->flags = buf[pos++];
+        if (mask & HB_AGG_F_INTERVAL) a->interval_s = buf[pos++];
+        if (mask & HB_AGG_F_LINK) {
+            a->layer = buf[pos++];
+            a->rssi = (int8_t)buf[pos++];
+        }
+        aggHeard(a, (mask & HB_AGG_F_AGE) ? buf[pos++] : 0, fresh);
+    }
+    xSemaphoreGive(s_aggMutex);
+}
+
+void MeshNode::resetAggregation() {
+    if (!s_aggMutex) return;
+    xSemaphoreTake(s_aggMutex, portMAX_DELAY);
+    for (uint8_t i = 0; i < MESH_MAX_NODES; i++)
+        s_agg[i].sent_valid = false;
+    xSemaphoreGive(s_aggMutex);
+}
+
+void MeshNode::setHeartbeatParent(const uint8_t* sta_mac) {
+    if (sta_mac) {
+        memcpy(s_hbParent, sta_mac, 6);
+        s_hasHbParent = true;
+    } else {
+        s_hasHbParent = false;
     }
 }
 
@@ -42,8 +319,14 @@ void MeshNode::begin() {
     // Initialize FTM manager (for responding to FTM_WAKE/GO)
     FtmManager::init();
 
+    if (s_aggMutex == nullptr) s_aggMutex = xSemaphoreCreateMutex();
+    s_aggSinceFull = 0;
+    for (uint8_t i = 0; i < MESH_MAX_NODES; i++)
+        s_agg[i].sent_valid = false;   // gateway may have changed: resend in full
+
     // Start heartbeat timer
-    uint32_t hbInterval = (uint32_t)NvsConfigManager::heartbeatInterval_s;
+    s_hbPeriod_s = pickHeartbeatPeriod();
+    uint32_t hbInterval = s_hbPeriod_s;
     if (s_hbTimer == nullptr) {
         s_hbTimer = xTimerCreate("nodeHb", pdMS_TO_TICKS(hbInterval * 1000),
                                   pdTRUE, nullptr, heartbeatTimerCb);
@@ -52,8 +335,8 @@ void MeshNode::begin() {
     }
     xTimerStart(s_hbTimer, 0);
 
-    // Send first heartbeat immediately
-    heartbeatTimerCb(nullptr);
+    // Send first heartbeat immediately (on the timer task, see heartbeatTimerCb)
+    xTimerPendFunctionCall(heartbeatPend, nullptr, 0, 0);
 
     // Send a second heartbeat after 5s so the gateway gets it after election completes
     if (s_earlyHbTimer == nullptr) {
@@ -70,6 +353,18 @@ void MeshNode::end() {
     }
 }
 
+void MeshNode::updateCadence() {
+    if (!s_hbTimer || xTimerIsTimerActive(s_hbTimer) == pdFALSE) return;   // not a node
+    uint32_t period = pickHeartbeatPeriod();
+    if (period == s_hbPeriod_s) return;
+
+    s_hbPeriod_s = period;
+    xTimerChangePeriod(s_hbTimer, pdMS_TO_TICKS(period * 1000), 0);
+    // Beat now so the gateway re-arms our deadline at the new cadence
+    xTimerPendFunctionCall(heartbeatPend, nullptr, 0, 0);
+    SqLog.printf("[node] Heartbeat cadence %lus\n", (unsigned long)period);
+}
+
 void MeshNode::onPeerJoined(const uint8_t* mac) {
     SqLog.printf("[node] Peer joined: %02X:%02X:%02X:%02X:%02X:%02X\n",
         mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
@@ -81,8 +376,17 @@ void MeshNode::onPeerLeft(const uint8_t* mac) {
 }
 
 void MeshNode::onGatewayLost() {
-    SqLog.println("[node] WARNING: Gateway lost — sleep and reboot for re-election");
     m_gatewayAlive = false;
+    if (HotStandby::onGatewayLost()) {
+        // Standby takes over in place; heartbeats keep running and follow
+        // the ROLE_CHANGE. HotStandby reboots us if nobody shows up.
+        return;
+    }
+    SqLog.println("[node] WARNING: Gateway lost — sleep and reboot for re-election");
+    // RTC memory survives the reboot: make sure it does not warm-rejoin
+    // the gateway we just lost
+    RtcMap::get()->mesh_generation = 0;
+    RtcMap::save();
     if (s_hbTimer) {
         xTimerStop(s_hbTimer, 0);
     }
@@ -94,4 +398,6 @@ void MeshNode::onGatewayLost() {
 void MeshNode::printStatus() {
     Serial.println("--- Node Status ---");
     Serial.printf("Gateway alive: %s\n", m_gatewayAlive ? "yes" : "no");
+    Serial.printf("Heartbeat: every %lus\n", (unsigned long)s_hbPeriod_s);
+    HotStandby::printStatus(Serial);
 }
@@ -19,6 +19,7 @@ PropertyValue<NVS_KEY_EW_BAT, float, NvsConfigManager>    NvsConfigManager::elec
 PropertyValue<NVS_KEY_EW_ADJ, float, NvsConfigManager>    NvsConfigManager::electWAdjacency(DEFAULT_ELECT_W_ADJACENCY);
 PropertyValue<NVS_KEY_EW_TEN, float, NvsConfigManager>    NvsConfigManager::electWTenure(DEFAULT_ELECT_W_TENURE);
 PropertyValue<NVS_KEY_EW_LBP, float, NvsConfigManager>    NvsConfigManager::electWLowbatPenalty(DEFAULT_ELECT_W_LOWBAT_PEN);
+PropertyValue<NVS_KEY_EW_HOP, float, NvsConfigManager>    NvsConfigManager::electWHops(DEFAULT_ELECT_W_HOPS);
 PropertyValue<NVS_KEY_CLR_INIT, uint32_t, NvsConfigManager> NvsConfigManager::colorInit(DEFAULT_CLR_INIT);
 PropertyValue<NVS_KEY_CLR_RDY,  uint32_t, NvsConfigManager> NvsConfigManager::colorReady(DEFAULT_CLR_READY);
 PropertyValue<NVS_KEY_CLR_GW,   uint32_t, NvsConfigManager> NvsConfigManager::colorGateway(DEFAULT_CLR_GATEWAY);
@@ -28,6 +29,7 @@ PropertyValue<NVS_KEY_CLR_DISC, uint32_t, NvsConfigManager> NvsConfigManager::co
 // Phase 2: Heartbeat & re-election
 PropertyValue<NVS_KEY_HB_INT,   uint32_t, NvsConfigManager> NvsConfigManager::heartbeatInterval_s(DEFAULT_HB_INTERVAL_S);
 PropertyValue<NVS_KEY_HB_STALE, uint32_t, NvsConfigManager> NvsConfigManager::heartbeatStaleMultiplier(DEFAULT_HB_STALE_MULT);
+PropertyValue<NVS_KEY_HB_ACT,   uint32_t, NvsConfigManager> NvsConfigManager::heartbeatActive_s(DEFAULT_HB_ACTIVE_S);
 PropertyValue<NVS_KEY_REEL_DMV, uint32_t, NvsConfigManager> NvsConfigManager::reelectionBatteryDelta_mv(DEFAULT_REELECT_DELTA_MV);
 PropertyValue<NVS_KEY_REEL_CD,  uint16_t, NvsConfigManager> NvsConfigManager::reelectionCooldown_s(DEFAULT_REELECT_COOLDOWN_S);
 PropertyValue<NVS_KEY_REEL_DTH, uint16_t, NvsConfigManager> NvsConfigManager::reelectionDethrone_mv(DEFAULT_REELECT_DETHRONE_MV);
@@ -153,6 +155,7 @@ void NvsConfigManager::reloadFromNvs()
     electWAdjacency.loadInitial(nvsGetFloat(NVS_KEY_EW_ADJ, DEFAULT_ELECT_W_ADJACENCY));
     electWTenure.loadInitial(nvsGetFloat(NVS_KEY_EW_TEN, DEFAULT_ELECT_W_TENURE));
     electWLowbatPenalty.loadInitial(nvsGetFloat(NVS_KEY_EW_LBP, DEFAULT_ELECT_W_LOWBAT_PEN));
+    electWHops.loadInitial(nvsGetFloat(NVS_KEY_EW_HOP, DEFAULT_ELECT_W_HOPS));
     colorInit.loadInitial(nvsGetU32(NVS_KEY_CLR_INIT, DEFAULT_CLR_INIT));
     colorReady.loadInitial(nvsGetU32(NVS_KEY_CLR_RDY, DEFAULT_CLR_READY));
     colorGateway.loadInitial(nvsGetU32(NVS_KEY_CLR_GW, DEFAULT_CLR_GATEWAY));
@@ -162,6 +165,7 @@ void NvsConfigManager::reloadFromNvs()
     // Phase 2
     heartbeatInterval_s.loadInitial(nvsGetU32(NVS_KEY_HB_INT, DEFAULT_HB_INTERVAL_S));
     heartbeatStaleMultiplier.loadInitial(nvsGetU32(NVS_KEY_HB_STALE, DEFAULT_HB_STALE_MULT));
+    heartbeatActive_s.loadInitial(nvsGetU32(NVS_KEY_HB_ACT, DEFAULT_HB_ACTIVE_S));
     reelectionBatteryDelta_mv.loadInitial(nvsGetU32(NVS_KEY_REEL_DMV, DEFAULT_REELECT_DELTA_MV));
     reelectionCooldown_s.loadInitial(nvsGetU16(NVS_KEY_REEL_CD, DEFAULT_REELECT_COOLDOWN_S));
     reelectionDethrone_mv.loadInitial(nvsGetU16(NVS_KEY_REEL_DTH, DEFAULT_REELECT_DETHRONE_MV));
@@ -200,6 +204,7 @@ bool NvsConfigManager::restoreFactoryDefault(uint32_t safeKey)
     electWAdjacency     = DEFAULT_ELECT_W_ADJACENCY;
     electWTenure        = DEFAULT_ELECT_W_TENURE;
     electWLowbatPenalty  = DEFAULT_ELECT_W_LOWBAT_PEN;
+    electWHops          = DEFAULT_ELECT_W_HOPS;
     colorInit          = DEFAULT_CLR_INIT;
     colorReady         = DEFAULT_CLR_READY;
     colorGateway       = DEFAULT_CLR_GATEWAY;
@@ -209,6 +214,7 @@ bool NvsConfigManager::restoreFactoryDefault(uint32_t safeKey)
     // Phase 2
     heartbeatInterval_s       = (uint32_t)DEFAULT_HB_INTERVAL_S;
     heartbeatStaleMultiplier  = (uint32_t)DEFAULT_HB_STALE_MULT;
+    heartbeatActive_s         = (uint32_t)DEFAULT_HB_ACTIVE_S;
     reelectionBatteryDelta_mv = (uint32_t)DEFAULT_REELECT_DELTA_MV;
     reelectionCooldown_s      = DEFAULT_REELECT_COOLDOWN_S;
     reelectionDethrone_mv     = DEFAULT_REELECT_DETHRONE_MV;
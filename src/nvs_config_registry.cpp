@@ -1,120 +1,88 @@
 #include "nvs_config_registry.h"
 #include "nvs_config.h"
 #include <Arduino.h>
+#include <string.h>
+
+// --- Raw value accessors ---
+//
+// Every field travels as a 32-bit raw value: bool as 0/1, u32 as-is, float
+// as its IEEE-754 bits. Each entry carries its own get/set so the binary
+// path (configHandleBinary) resolves a field by index, without strcmp.
+
+static inline uint32_t f2raw(float f) { uint32_t r; memcpy(&r, &f, 4); return r; }
+static inline float    raw2f(uint32_t r) { float f; memcpy(&f, &r, 4); return f; }
+
+#define FIELD_BOOL(key, desc, prop)  { key, desc, CFG_BOOL, \
+    [] { return (uint32_t)(bool)NvsConfigManager::prop; }, \
+    [](uint32_t v) { NvsConfigManager::prop = (v != 0); } }
+#define FIELD_U32(key, desc, prop)   { key, desc, CFG_U32, \
+    [] { return (uint32_t)NvsConfigManager::prop; }, \
+    [](uint32_t v) { NvsConfigManager::prop = v; } }
+#define FIELD_FLOAT(key, desc, prop) { key, desc, CFG_FLOAT, \
+    [] { return f2raw(NvsConfigManager::prop); }, \
+    [](uint32_t v) { NvsConfigManager::prop = raw2f(v); } }
 
 // --- Registry table ---
 
 static const ConfigField s_fields[] = {
-    { NVS_KEY_LEDSEN,    "LEDs enabled",                CFG_BOOL  },
-    { NVS_KEY_EW_BAT,   "Election weight: battery",    CFG_FLOAT },
-    { NVS_KEY_EW_ADJ,   "Election weight: adjacency",  CFG_FLOAT },
-    { NVS_KEY_EW_TEN,   "Election weight: tenure",     CFG_FLOAT },
-    { NVS_KEY_EW_LBP,   "Election weight: low-bat penalty", CFG_FLOAT },
-    { NVS_KEY_CLR_INIT,  "Color: init (0xRRGGBB)",     CFG_U32   },
-    { NVS_KEY_CLR_RDY,   "Color: ready",               CFG_U32   },
-    { NVS_KEY_CLR_GW,    "Color: gateway",              CFG_U32   },
-    { NVS_KEY_CLR_PEER,  "Color: peer",                 CFG_U32   },
-    { NVS_KEY_CLR_DISC,  "Color: disconnected",         CFG_U32   },
-    { NVS_KEY_HB_INT,    "Heartbeat interval (s)",      CFG_U32   },
-    { NVS_KEY_HB_STALE,  "Heartbeat stale multiplier",  CFG_U32   },
-    { NVS_KEY_REEL_DMV,  "Re-election battery delta (mV)", CFG_U32 },
-    { NVS_KEY_REEL_CD,   "Re-election cooldown (s)",      CFG_U32 },
-    { NVS_KEY_REEL_DTH,  "Re-election dethrone delta (mV)", CFG_U32 },
-    { NVS_KEY_FTM_STALE, "FTM staleness (s)",           CFG_U32   },
-    { NVS_KEY_FTM_ANCH,  "FTM new-node anchors",        CFG_U32   },
-    { NVS_KEY_FTM_SAMP,  "FTM samples per pair",        CFG_U32   },
-    { NVS_KEY_FTM_TMO,   "FTM pair timeout (ms)",       CFG_U32   },
-    { NVS_KEY_FTM_SWP,   "FTM sweep interval (s)",      CFG_U32   },
-    { NVS_KEY_FTM_KPN,   "FTM Kalman process noise",    CFG_FLOAT },
-    { NVS_KEY_FTM_OFS,   "FTM responder offset (cm)",   CFG_U32   },
-    { NVS_KEY_ORCH_MODE, "Orchestrator mode",            CFG_U32   },
-    { NVS_KEY_ORCH_TRVD, "Orch travel delay (ms)",       CFG_U32   },
-    { NVS_KEY_ORCH_RMIN, "Orch random min (ms)",         CFG_U32   },
-    { NVS_KEY_ORCH_RMAX, "Orch random max (ms)",         CFG_U32   },
-    { NVS_KEY_ORCH_TONE, "Orch tone index",              CFG_U32   },
-    { NVS_KEY_CSYNC_INT, "Clock sync interval (s)",      CFG_U32   },
-    { NVS_KEY_WEB_EN,   "Web UI enabled",              CFG_BOOL  },
+    FIELD_BOOL (NVS_KEY_LEDSEN,    "LEDs enabled",                     ledsEnabled),
+    FIELD_FLOAT(NVS_KEY_EW_BAT,    "Election weight: battery",         electWBattery),
+    FIELD_FLOAT(NVS_KEY_EW_ADJ,    "Election weight: adjacency",       electWAdjacency),
+    FIELD_FLOAT(NVS_KEY_EW_TEN,    "Election weight: tenure",          electWTenure),
+    FIELD_FLOAT(NVS_KEY_EW_LBP,    "Election weight: low-bat penalty", electWLowbatPenalty),
+    FIELD_FLOAT(NVS_KEY_EW_HOP,    "Election weight: per extra hop",   electWHops),
+    FIELD_U32  (NVS_KEY_CLR_INIT,  "Color: init (0xRRGGBB)",           colorInit),
+    FIELD_U32  (NVS_KEY_CLR_RDY,   "Color: ready",                     colorReady),
+    FIELD_U32  (NVS_KEY_CLR_GW,    "Color: gateway",                   colorGateway),
+    FIELD_U32  (NVS_KEY_CLR_PEER,  "Color: peer",                      colorPeer),
+    FIELD_U32  (NVS_KEY_CLR_DISC,  "Color: disconnected",              colorDisconnected),
+    FIELD_U32  (NVS_KEY_HB_INT,    "Heartbeat interval (s)",           heartbeatInterval_s),
+    FIELD_U32  (NVS_KEY_HB_STALE,  "Heartbeat stale multiplier",       heartbeatStaleMultiplier),
+    FIELD_U32  (NVS_KEY_HB_ACT,    "Heartbeat interval, playing (s)",  heartbeatActive_s),
+    FIELD_U32  (NVS_KEY_REEL_DMV,  "Re-election battery delta (mV)",   reelectionBatteryDelta_mv),
+    { NVS_KEY_REEL_CD, "Re-election cooldown (s)", CFG_U32,
+        [] { return (uint32_t)(uint16_t)NvsConfigManager::reelectionCooldown_s; },
+        [](uint32_t v) {
+            if (v < 30) v = 30;
+            if (v > 0xFFFF) v = 0xFFFF;
+            NvsConfigManager::reelectionCooldown_s = (uint16_t)v;
+        } },
+    { NVS_KEY_REEL_DTH, "Re-election dethrone delta (mV)", CFG_U32,
+        [] { return (uint32_t)(uint16_t)NvsConfigManager::reelectionDethrone_mv; },
+        [](uint32_t v) {
+            if (v < 50)   v = 50;
+            if (v > 1000) v = 1000;
+            NvsConfigManager::reelectionDethrone_mv = (uint16_t)v;
+        } },
+    FIELD_U32  (NVS_KEY_FTM_STALE, "FTM staleness (s)",                ftmStaleness_s),
+    FIELD_U32  (NVS_KEY_FTM_ANCH,  "FTM new-node anchors",             ftmNewNodeAnchors),
+    FIELD_U32  (NVS_KEY_FTM_SAMP,  "FTM samples per pair",             ftmSamplesPerPair),
+    FIELD_U32  (NVS_KEY_FTM_TMO,   "FTM pair timeout (ms)",            ftmPairTimeout_ms),
+    FIELD_U32  (NVS_KEY_FTM_SWP,   "FTM sweep interval (s)",           ftmSweepInterval_s),
+    FIELD_FLOAT(NVS_KEY_FTM_KPN,   "FTM Kalman process noise",         ftmKalmanProcessNoise),
+    FIELD_U32  (NVS_KEY_FTM_OFS,   "FTM responder offset (cm)",        ftmResponderOffset_cm),
+    FIELD_U32  (NVS_KEY_ORCH_MODE, "Orchestrator mode",                orchMode),
+    FIELD_U32  (NVS_KEY_ORCH_TRVD, "Orch travel delay (ms)",           orchTravelDelay_ms),
+    FIELD_U32  (NVS_KEY_ORCH_RMIN, "Orch random min (ms)",             orchRandomMin_ms),
+    FIELD_U32  (NVS_KEY_ORCH_RMAX, "Orch random max (ms)",             orchRandomMax_ms),
+    FIELD_U32  (NVS_KEY_ORCH_TONE, "Orch tone index",                  orchToneIndex),
+    FIELD_U32  (NVS_KEY_CSYNC_INT, "Clock sync interval (s)",          clockSyncInterval_s),
+    FIELD_BOOL (NVS_KEY_WEB_EN,    "Web UI enabled",                   webEnabled),
 };
 static constexpr uint8_t FIELD_COUNT = sizeof(s_fields) / sizeof(s_fields[0]);
+static_assert(FIELD_COUNT < CFG_FIELD_NONE, "field index must fit the wire format");
 
-// --- Getter helper: read current value into JsonDocument ---
+// --- JSON edge (CLI/web on the gateway) ---
 
 static void getField(JsonDocument& doc, const ConfigField& f) {
-    if (strcmp(f.key, NVS_KEY_LEDSEN) == 0)     { doc[f.key] = (bool)NvsConfigManager::ledsEnabled; return; }
-    if (strcmp(f.key, NVS_KEY_EW_BAT) == 0)     { doc[f.key] = (float)NvsConfigManager::electWBattery; return; }
-    if (strcmp(f.key, NVS_KEY_EW_ADJ) == 0)     { doc[f.key] = (float)NvsConfigManager::electWAdjacency; return; }
-    if (strcmp(f.key, NVS_KEY_EW_TEN) == 0)     { doc[f.key] = (float)NvsConfigManager::electWTenure; return; }
-    if (strcmp(f.key, NVS_KEY_EW_LBP) == 0)     { doc[f.key] = (float)NvsConfigManager::electWLowbatPenalty; return; }
-    if (strcmp(f.key, NVS_KEY_CLR_INIT) == 0)   { doc[f.key] = (uint32_t)NvsConfigManager::colorInit; return; }
-    if (strcmp(f.key, NVS_KEY_CLR_RDY) == 0)    { doc[f.key] = (uint32_t)NvsConfigManager::colorReady; return; }
-    if (strcmp(f.key, NVS_KEY_CLR_GW) == 0)     { doc[f.key] = (uint32_t)NvsConfigManager::colorGateway; return; }
-    if (strcmp(f.key, NVS_KEY_CLR_PEER) == 0)   { doc[f.key] = (uint32_t)NvsConfigManager::colorPeer; return; }
-    if (strcmp(f.key, NVS_KEY_CLR_DISC) == 0)   { doc[f.key] = (uint32_t)NvsConfigManager::colorDisconnected; return; }
-    if (strcmp(f.key, NVS_KEY_HB_INT) == 0)     { doc[f.key] = (uint32_t)NvsConfigManager::heartbeatInterval_s; return; }
-    if (strcmp(f.key, NVS_KEY_HB_STALE) == 0)   { doc[f.key] = (uint32_t)NvsConfigManager::heartbeatStaleMultiplier; return; }
-    if (strcmp(f.key, NVS_KEY_REEL_DMV) == 0)   { doc[f.key] = (uint32_t)NvsConfigManager::reelectionBatteryDelta_mv; return; }
-    if (strcmp(f.key, NVS_KEY_REEL_CD) == 0)    { doc[f.key] = (uint32_t)(uint16_t)NvsConfigManager::reelectionCooldown_s; return; }
-    if (strcmp(f.key, NVS_KEY_REEL_DTH) == 0)   { doc[f.key] = (uint32_t)(uint16_t)NvsConfigManager::reelectionDethrone_mv; return; }
-    if (strcmp(f.key, NVS_KEY_FTM_STALE) == 0)  { doc[f.key] = (uint32_t)NvsConfigManager::ftmStaleness_s; return; }
-    if (strcmp(f.key, NVS_KEY_FTM_ANCH) == 0)   { doc[f.key] = (uint32_t)NvsConfigManager::ftmNewNodeAnchors; return; }
-    if (strcmp(f.key, NVS_KEY_FTM_SAMP) == 0)   { doc[f.key] = (uint32_t)NvsConfigManager::ftmSamplesPerPair; return; }
-    if (strcmp(f.key, NVS_KEY_FTM_TMO) == 0)    { doc[f.key] = (uint32_t)NvsConfigManager::ftmPairTimeout_ms; return; }
-    if (strcmp(f.key, NVS_KEY_FTM_SWP) == 0)    { doc[f.key] = (uint32_t)NvsConfigManager::ftmSweepInterval_s; return; }
-    if (strcmp(f.key, NVS_KEY_FTM_KPN) == 0)    { doc[f.key] = (float)NvsConfigManager::ftmKalmanProcessNoise; return; }
-    if (strcmp(f.key, NVS_KEY_FTM_OFS) == 0)    { doc[f.key] = (uint32_t)NvsConfigManager::ftmResponderOffset_cm; return; }
-    if (strcmp(f.key, NVS_KEY_ORCH_MODE) == 0) { doc[f.key] = (uint32_t)NvsConfigManager::orchMode; return; }
-    if (strcmp(f.key, NVS_KEY_ORCH_TRVD) == 0) { doc[f.key] = (uint32_t)NvsConfigManager::orchTravelDelay_ms; return; }
-    if (strcmp(f.key, NVS_KEY_ORCH_RMIN) == 0) { doc[f.key] = (uint32_t)NvsConfigManager::orchRandomMin_ms; return; }
-    if (strcmp(f.key, NVS_KEY_ORCH_RMAX) == 0) { doc[f.key] = (uint32_t)NvsConfigManager::orchRandomMax_ms; return; }
-    if (strcmp(f.key, NVS_KEY_ORCH_TONE) == 0) { doc[f.key] = (uint32_t)NvsConfigManager::orchToneIndex; return; }
-    if (strcmp(f.key, NVS_KEY_CSYNC_INT) == 0) { doc[f.key] = (uint32_t)NvsConfigManager::clockSyncInterval_s; return; }
-    if (strcmp(f.key, NVS_KEY_WEB_EN) == 0)   { doc[f.key] = (bool)NvsConfigManager::webEnabled; return; }
+    configRawToJson(doc, (uint8_t)(&f - s_fields), f.get());
 }
 
-// --- Setter helper: apply a JSON value to the matching PropertyValue ---
-
 static bool setField(const char* key, JsonVariantConst val) {
-    if (strcmp(key, NVS_KEY_LEDSEN) == 0)     { NvsConfigManager::ledsEnabled = val.as<bool>(); return true; }
-    if (strcmp(key, NVS_KEY_EW_BAT) == 0)     { NvsConfigManager::electWBattery = val.as<float>(); return true; }
-    if (strcmp(key, NVS_KEY_EW_ADJ) == 0)     { NvsConfigManager::electWAdjacency = val.as<float>(); return true; }
-    if (strcmp(key, NVS_KEY_EW_TEN) == 0)     { NvsConfigManager::electWTenure = val.as<float>(); return true; }
-    if (strcmp(key, NVS_KEY_EW_LBP) == 0)     { NvsConfigManager::electWLowbatPenalty = val.as<float>(); return true; }
-    if (strcmp(key, NVS_KEY_CLR_INIT) == 0)   { NvsConfigManager::colorInit = val.as<uint32_t>(); return true; }
-    if (strcmp(key, NVS_KEY_CLR_RDY) == 0)    { NvsConfigManager::colorReady = val.as<uint32_t>(); return true; }
-    if (strcmp(key, NVS_KEY_CLR_GW) == 0)     { NvsConfigManager::colorGateway = val.as<uint32_t>(); return true; }
-    if (strcmp(key, NVS_KEY_CLR_PEER) == 0)   { NvsConfigManager::colorPeer = val.as<uint32_t>(); return true; }
-    if (strcmp(key, NVS_KEY_CLR_DISC) == 0)   { NvsConfigManager::colorDisconnected = val.as<uint32_t>(); return true; }
-    if (strcmp(key, NVS_KEY_HB_INT) == 0)     { NvsConfigManager::heartbeatInterval_s = val.as<uint32_t>(); return true; }
-    if (strcmp(key, NVS_KEY_HB_STALE) == 0)   { NvsConfigManager::heartbeatStaleMultiplier = val.as<uint32_t>(); return true; }
-    if (strcmp(key, NVS_KEY_REEL_DMV) == 0)   { NvsConfigManager::reelectionBatteryDelta_mv = val.as<uint32_t>(); return true; }
-    if (strcmp(key, NVS_KEY_REEL_CD) == 0)  {
-        uint16_t v = val.as<uint16_t>();
-        if (v < 30) v = 30;
-        NvsConfigManager::reelectionCooldown_s = v;
-        return true;
-    }
-    if (strcmp(key, NVS_KEY_REEL_DTH) == 0) {
-        uint16_t v = val.as<uint16_t>();
-        if (v < 50)   v = 50;
-        if (v > 1000)  v = 1000;
-        NvsConfigManager::reelectionDethrone_mv = v;
-        return true;
-    }
-    if (strcmp(key, NVS_KEY_FTM_STALE) == 0)  { NvsConfigManager::ftmStaleness_s = val.as<uint32_t>(); return true; }
-    if (strcmp(key, NVS_KEY_FTM_ANCH) == 0)   { NvsConfigManager::ftmNewNodeAnchors = val.as<uint32_t>(); return true; }
-    if (strcmp(key, NVS_KEY_FTM_SAMP) == 0)   { NvsConfigManager::ftmSamplesPerPair = val.as<uint32_t>(); return true; }
-    if (strcmp(key, NVS_KEY_FTM_TMO) == 0)    { NvsConfigManager::ftmPairTimeout_ms = val.as<uint32_t>(); return true; }
-    if (strcmp(key, NVS_KEY_FTM_SWP) == 0)    { NvsConfigManager::ftmSweepInterval_s = val.as<uint32_t>(); return true; }
-    if (strcmp(key, NVS_KEY_FTM_KPN) == 0)    { NvsConfigManager::ftmKalmanProcessNoise = val.as<float>(); return true; }
-    if (strcmp(key, NVS_KEY_FTM_OFS) == 0)    { NvsConfigManager::ftmResponderOffset_cm = val.as<uint32_t>(); return true; }
-    if (strcmp(key, NVS_KEY_ORCH_MODE) == 0) { NvsConfigManager::orchMode = val.as<uint32_t>(); return true; }
-    if (strcmp(key, NVS_KEY_ORCH_TRVD) == 0) { NvsConfigManager::orchTravelDelay_ms = val.as<uint32_t>(); return true; }
-    if (strcmp(key, NVS_KEY_ORCH_RMIN) == 0) { NvsConfigManager::orchRandomMin_ms = val.as<uint32_t>(); return true; }
-    if (strcmp(key, NVS_KEY_ORCH_RMAX) == 0) { NvsConfigManager::orchRandomMax_ms = val.as<uint32_t>(); return true; }
-    if (strcmp(key, NVS_KEY_ORCH_TONE) == 0) { NvsConfigManager::orchToneIndex = val.as<uint32_t>(); return true; }
-    if (strcmp(key, NVS_KEY_CSYNC_INT) == 0) { NvsConfigManager::clockSyncInterval_s = val.as<uint32_t>(); return true; }
-    if (strcmp(key, NVS_KEY_WEB_EN) == 0)   { NvsConfigManager::webEnabled = val.as<bool>(); return true; }
-    return false;
+    uint8_t idx = configFieldIndex(key);
+    if (idx == CFG_FIELD_NONE) return false;
+    s_fields[idx].set(configJsonToRaw(idx, val));
+    return true;
 }
 
 // --- Public API ---
@@ -127,6 +95,11 @@ const ConfigField* configLookup(const char* key) {
     return nullptr;
 }
 
+uint8_t configFieldIndex(const char* key) {
+    const ConfigField* f = configLookup(key);
+    return f ? (uint8_t)(f - s_fields) : CFG_FIELD_NONE;
+}
+
 uint8_t configFieldCount() {
     return FIELD_COUNT;
 }
@@ -170,3 +143,110 @@ void configListFields(Print& out) {
         out.printf("  %-10s [%-5s]  %s\n", s_fields[i].key, typeStr, s_fields[i].description);
     }
 }
+
+void configRawToJson(JsonDocument& doc, uint8_t idx, uint32_t raw) {
+    if (idx >= FIELD_COUNT) return;
+    const ConfigField& f = s_fields[idx];
+    switch (f.type) {
+    case CFG_BOOL:  doc[f.key] = (raw != 0); break;
+    case CFG_FLOAT: doc[f.key] = raw2f(raw); break;
+    default:        doc[f.key] = raw; break;
+    }
+}
+
+uint32_t configJsonToRaw(uint8_t idx, JsonVariantConst val) {
+    if (idx >= FIELD_COUNT) return 0;
+    switch (s_fields[idx].type) {
+    case CFG_BOOL:  return val.as<bool>() ? 1 : 0;
+    case CFG_FLOAT: return f2raw(val.as<float>());
+    default:        return val.as<uint32_t>();
+    }
+}
+
+bool configParseRaw(uint8_t idx, const char* text, uint32_t* raw) {
+    if (idx >= FIELD_COUNT) return false;
+    switch (s_fields[idx].type) {
+    case CFG_BOOL:  *raw = (strcmp(text, "1") == 0 || strcasecmp(text, "true") == 0); break;
+    case CFG_FLOAT: *raw = f2raw((float)atof(text)); break;
+    default:        *raw = (uint32_t)strtoul(text, nullptr, 0); break;
+    }
+    return true;
+}
+
+// --- Binary body (CONFIG_REQ / CONFIG_RESP) ---
+
+uint16_t configSchemaId() {
+    // FNV-1a over keys and types, folded to 16 bits; computed once
+    static uint16_t s_schema = 0;
+    if (s_schema == 0) {
+        uint32_t h = 2166136261u;
+        for (uint8_t i = 0; i < FIELD_COUNT; i++) {
+            for (const char* c = s_fields[i].key; *c; c++) { h ^= (uint8_t)*c; h *= 16777619u; }
+            h ^= (uint8_t)s_fields[i].type; h *= 16777619u;
+        }
+        s_schema = (uint16_t)(h ^ (h >> 16));
+        if (s_schema == 0) s_schema = 1;
+    }
+    return s_schema;
+}
+
+uint16_t configHandleBinary(const uint8_t* req, uint16_t len, uint8_t* resp, uint16_t respMax) {
+    if (respMax < sizeof(ConfigBinHeader)) return 0;
+    ConfigBinHeader* out = (ConfigBinHeader*)resp;
+    out->schema = configSchemaId();
+    out->code = CFG_ST_OK;
+    out->count = 0;
+    uint16_t pos = sizeof(ConfigBinHeader);
+
+    if (len < sizeof(ConfigBinHeader)) {
+        out->code = CFG_ST_BAD;
+        return pos;
+    }
+    ConfigBinHeader in;
+    memcpy(&in, req, sizeof(in));
+    if (in.schema != out->schema) {
+        // Different firmware: indices may not mean the same field
+        out->code = CFG_ST_SCHEMA;
+        return pos;
+    }
+    const uint8_t* body = req + sizeof(ConfigBinHeader);
+    uint16_t bodyLen = len - sizeof(ConfigBinHeader);
+
+    // Answer with the current value of each field read or written
+    auto emit = [&](uint8_t idx) {
+        if (idx >= FIELD_COUNT || pos + sizeof(ConfigBinValue) > respMax) return;
+        ConfigBinValue v;
+        v.idx = idx;
+        v.raw = s_fields[idx].get();
+        memcpy(resp + pos, &v, sizeof(v));
+        pos += sizeof(v);
+        out->count++;
+    };
+
+    if (in.code == CFG_OP_SET) {
+        if (bodyLen < (uint16_t)in.count * sizeof(ConfigBinValue)) {
+            out->code = CFG_ST_BAD;
+            return pos;
+        }
+        for (uint8_t i = 0; i < in.count; i++) {
+            ConfigBinValue v;
+            memcpy(&v, body + i * sizeof(ConfigBinValue), sizeof(v));
+            if (v.idx >= FIELD_COUNT) continue;
+            s_fields[v.idx].set(v.raw);
+            emit(v.idx);
+        }
+    } else if (in.code == CFG_OP_GET) {
+        if (in.count == 0) {
+            for (uint8_t i = 0; i < FIELD_COUNT; i++) emit(i);
+        } else {
+            if (bodyLen < in.count) {
+                out->code = CFG_ST_BAD;
+                return pos;
+            }
+            for (uint8_t i = 0; i < in.count; i++) emit(body[i]);
+        }
+    } else {
+        out->code = CFG_ST_BAD;
+    }
+    return pos;
+}
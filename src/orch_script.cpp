@@ -0,0 +1,414 @@
+#include "orch_script.h"
+#include "clock_sync.h"
+#include "mesh_conductor.h"
+#include "peer_table.h"
+#include "audio_engine.h"
+#include "tone_library.h"
+#include "bsp.hpp"
+#include "sq_log.h"
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include <esp_timer.h>
+#include <esp_random.h>
+#include <string.h>
+
+// One node's part of a script
+struct ScriptPart {
+    bool            valid;
+    uint8_t         id;
+    uint8_t         count;
+    uint32_t        period_ms;
+    uint32_t        delay_us;         // acoustic alignment offset
+    OrchScriptEvent events[ORCH_SCRIPT_NODE_EVENTS];
+};
+
+// --- Node-side state (guarded by s_mutex) ---
+
+static SemaphoreHandle_t  s_mutex = nullptr;
+static esp_timer_handle_t s_timer = nullptr;
+
+static ScriptPart s_staged;           // received, waiting for its GO
+static ScriptPart s_active;           // playing
+static bool     s_running   = false;
+static uint32_t s_startMs   = 0;      // mesh time of loop 0
+static uint32_t s_loop      = 0;
+static uint8_t  s_next      = 0;      // event to arm next
+static int64_t  s_armedUs   = 0;      // local time of the armed event
+static uint8_t  s_armedTone = 0;
+static uint8_t  s_armedGain = 255;
+static bool     s_waitSync  = false;  // timer only polls for a clock sync
+
+// A GO that overtook its part
+static bool     s_goPending = false;
+static uint8_t  s_goId      = 0;
+static uint32_t s_goStartMs = 0;
+
+static uint32_t s_played     = 0;
+static uint32_t s_missed     = 0;     // later than ORCH_SCRIPT_LATE_MS, skipped
+static int32_t  s_worstErrUs = 0;
+
+// Gateway: script IDs start random so a new gateway's first script never
+// matches a part staged by the previous one
+static uint8_t  s_nextId = 0;
+
+// Gateway: delivery of the distribution in progress, by PeerTable slot.
+// Written by the reliable channel's done callback (RX / timer task); the
+// generation in each callback's ctx keeps a late outcome off a newer script.
+enum DeliveryState : uint8_t {
+    DLV_NONE    = 0,   // nothing to send this node
+    DLV_QUEUED  = 1,   // waiting for a free reliable slot
+    DLV_PENDING = 2,   // in flight
+    DLV_ACKED   = 3,
+    DLV_FAILED  = 4,   // given up by the reliable channel
+};
+static volatile uint8_t s_partState[MESH_MAX_NODES];
+static volatile uint8_t s_goState[MESH_MAX_NODES];
+static uint8_t  s_partTries[MESH_MAX_NODES];
+static uint8_t  s_goTries[MESH_MAX_NODES];
+static volatile uint8_t s_dlvGen = 0;
+static uint8_t  s_undelivered = 0;    // nodes the last distribute() couldn't reach
+static uint32_t s_truncated   = 0;    // events dropped: a node's part overflowed
+
+// --- Playback (mutex held) ---
+
+static uint32_t eventMeshMs(const OrchScriptEvent& ev) {
+    // Wrapping 32-bit arithmetic, like the mesh clock itself
+    return s_startMs + s_loop * s_active.period_ms + ev.at_ms;
+}
+
+// Arm the timer for the next event still ahead
+static void armNext() {
+    if (!ClockSync::isSynced()) {
+        s_waitSync = true;
+        esp_timer_start_once(s_timer, 1000000);
+        return;
+    }
+    s_waitSync = false;
+
+    // Whole loops that passed unplayed (late GO, long clock stall)
+    if (s_active.period_ms > 0) {
+        int32_t elapsed = (int32_t)(ClockSync::meshTime() - s_startMs);
+        if (elapsed > 0 && (uint32_t)elapsed / s_active.period_ms > s_loop) {
+            s_loop = (uint32_t)elapsed / s_active.period_ms;
+            s_next = 0;
+        }
+    }
+
+    int64_t now = esp_timer_get_time();
+    for (uint16_t guard = 0; guard <= s_active.count; guard++) {
+        if (s_next >= s_active.count) {
+            if (s_active.period_ms == 0) break;   // played once
+            s_next = 0;
+            s_loop++;
+        }
+        const OrchScriptEvent& ev = s_active.events[s_next++];
+        int64_t atUs = ClockSync::localUs(eventMeshMs(ev)) + s_active.delay_us;
+        if (atUs < now - (int64_t)ORCH_SCRIPT_LATE_MS * 1000) {
+            s_missed++;
+            continue;
+        }
+        s_armedUs = atUs;
+        s_armedTone = ev.tone_index;
+        s_armedGain = ev.gain;
+        esp_timer_start_once(s_timer, atUs > now ? (uint64_t)(atUs - now) : 1);
+        return;
+    }
+    s_running = false;
+}
+
+static void startActive(uint32_t start_ms) {
+    esp_timer_stop(s_timer);
+    s_startMs = start_ms;
+    s_loop = 0;
+    s_next = 0;
+    s_running = s_active.count > 0;
+    if (s_running) armNext();
+}
+
+static void timerCb(void*) {
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    if (!s_running) {
+        // stopped while this callback waited for the mutex
+    } else if (s_waitSync) {
+        armNext();
+    } else if (esp_timer_get_time() >= s_armedUs - 1000) {
+        if (s_armedTone == ORCH_TONE_HOLD) {
+            AudioEngine::setGain(s_armedGain);   // crossfade step, tone keeps going
+        } else {
+            const ToneSequence* seq = ToneLibrary::getByIndex(s_armedTone);
+            if (seq) AudioEngine::play(seq, s_armedGain);
+        }
+        int32_t err = (int32_t)(esp_timer_get_time() - s_armedUs);
+        if (err > s_worstErrUs) s_worstErrUs = err;
+        s_played++;
+        armNext();
+    }
+    // else: re-armed for a newer script while we waited; that timer is pending
+    xSemaphoreGive(s_mutex);
+}
+
+static void activateStaged(uint32_t start_ms) {
+    s_active = s_staged;
+    s_staged.valid = false;
+    s_goPending = false;
+    startActive(start_ms);
+    SqLog.printf("[script] Script %u: %u events, period %lu ms, starts in %ld ms\n",
+        s_active.id, s_active.count, (unsigned long)s_active.period_ms,
+        (long)(int32_t)(start_ms - ClockSync::meshTime()));
+}
+
+// --- Public API ---
+
+void OrchScript::init() {
+    if (!s_mutex) s_mutex = xSemaphoreCreateMutex();
+    if (!s_timer) {
+        esp_timer_create_args_t args = {};
+        args.callback = timerCb;
+        args.dispatch_method = ESP_TIMER_TASK;
+        args.name = "orchScript";
+        esp_timer_create(&args, &s_timer);
+    }
+    s_nextId = (uint8_t)esp_random();
+}
+
+static void deliveryDone(const uint8_t* mac, bool acked, void* ctx) {
+    (void)mac;
+    uint32_t v = (uint32_t)(uintptr_t)ctx;
+    if ((uint8_t)(v >> 16) != s_dlvGen) return;   // an older distribution
+    uint8_t node = (uint8_t)v;
+    volatile uint8_t* state = (v & 0x100) ? s_goState : s_partState;
+    state[node] = acked ? DLV_ACKED : DLV_FAILED;
+}
+
+static void* deliveryCtx(uint8_t node, bool go) {
+    return (void*)(uintptr_t)(((uint32_t)s_dlvGen << 16) | (go ? 0x100u : 0u) | node);
+}
+
+// One node's part of events[] into buf; returns the message length
+static uint16_t buildPart(uint8_t* buf, uint8_t id, uint8_t node,
+                          const ScriptEvent* events, uint8_t count,
+                          uint32_t period_ms, uint32_t delay_us) {
+    OrchScriptMsg* msg = (OrchScriptMsg*)buf;
+    OrchScriptEvent* out = (OrchScriptEvent*)(buf + sizeof(OrchScriptMsg));
+    msg->type = MSG_TYPE_ORCH_SCRIPT;
+    msg->script_id = id;
+    msg->count = 0;
+    msg->period_ms = period_ms;
+    msg->delay_us = delay_us;
+    for (uint8_t j = 0; j < count && msg->count < ORCH_SCRIPT_NODE_EVENTS; j++) {
+        if (events[j].node != node) continue;
+        out[msg->count].at_ms = events[j].at_ms;
+        out[msg->count].tone_index = events[j].tone_index;
+        out[msg->count].gain = events[j].gain;
+        msg->count++;
+    }
+    return sizeof(OrchScriptMsg) + msg->count * sizeof(OrchScriptEvent);
+}
+
+uint8_t OrchScript::distribute(const ScriptEvent* events, uint8_t count,
+                               uint32_t period_ms, uint32_t start_ms,
+                               const uint32_t* delay_us) {
+    uint8_t id = s_nextId++;
+    uint8_t gen = s_dlvGen + 1;
+    s_dlvGen = gen;
+
+    // Who gets a part (in order of first appearance) and who gets the GO:
+    // every live peer, so nodes without a part fall silent
+    uint8_t order[MESH_MAX_NODES];
+    uint8_t nParts = 0;
+    uint8_t perNode[MESH_MAX_NODES] = {};
+    for (uint8_t i = 0; i < count; i++) {
+        uint8_t node = events[i].node;
+        if (node >= MESH_MAX_NODES) continue;
+        if (perNode[node]++ == 0) order[nParts++] = node;
+    }
+    uint8_t macs[MESH_MAX_NODES][6];
+    uint8_t peers = PeerTable::peerCount();
+    for (uint8_t node = 0; node < MESH_MAX_NODES; node++) {
+        s_partState[node] = DLV_NONE;
+        s_goState[node] = DLV_NONE;
+        s_partTries[node] = 0;
+        s_goTries[node] = 0;
+        PeerEntry pe;
+        if (node >= peers || !PeerTable::readEntry(node, &pe) || (pe.flags & PEER_STATUS_DEAD)) continue;
+        memcpy(macs[node], pe.mac, 6);
+        if (perNode[node] > 0) s_partState[node] = DLV_QUEUED;
+        if (!MeshConductor::isSelf(pe.mac)) s_goState[node] = DLV_QUEUED;   // self: onGo below
+    }
+    for (uint8_t k = 0; k < nParts; k++) {
+        uint8_t node = order[k];
+        if (perNode[node] > ORCH_SCRIPT_NODE_EVENTS) {
+            s_truncated += perNode[node] - ORCH_SCRIPT_NODE_EVENTS;
+            SqLog.printf("[script] Script %u: node %u has %u events, its part holds %u — rest dropped\n",
+                id, node, perNode[node], ORCH_SCRIPT_NODE_EVENTS);
+        }
+    }
+
+    // Parts first, then GOs, queued only as reliable slots free up (a full
+    // pool would refuse them); failures are retried up to
+    // ORCH_SCRIPT_SEND_TRIES, all within ORCH_SCRIPT_SEND_MS
+    uint8_t buf[sizeof(OrchScriptMsg) + ORCH_SCRIPT_NODE_EVENTS * sizeof(OrchScriptEvent)];
+    OrchGoMsg go;
+    go.type = MSG_TYPE_ORCH_GO;
+    go.script_id = id;
+    go.start_ms = start_ms;
+    bool goLocal = false;
+    uint32_t t0 = millis();
+    for (;;) {
+        bool busy = false;   // something still queued or in flight
+        bool full = false;
+        for (uint8_t pass = 0; pass < 2 && !full; pass++) {
+            bool isGo = (pass == 1);
+            volatile uint8_t* state = isGo ? s_goState : s_partState;
+            uint8_t* tries = isGo ? s_goTries : s_partTries;
+            for (uint8_t k = 0; k < (isGo ? MESH_MAX_NODES : nParts) && !full; k++) {
+                uint8_t node = isGo ? k : order[k];
+                uint8_t st = state[node];
+                if (st == DLV_FAILED && tries[node] < ORCH_SCRIPT_SEND_TRIES) st = DLV_QUEUED;
+                if (st == DLV_PENDING) busy = true;
+                if (st != DLV_QUEUED) continue;
+                busy = true;
+                if (MeshConductor::reliableFreeSlots() <= ORCH_SCRIPT_REL_SPARE) {
+                    full = true;
+                    break;
+                }
+                state[node] = DLV_PENDING;
+                esp_err_t err = isGo
+                    ? MeshConductor::sendReliable(macs[node], &go, sizeof(go),
+                                                  deliveryDone, deliveryCtx(node, true))
+                    : MeshConductor::sendReliable(macs[node], buf,
+                          buildPart(buf, id, node, events, count, period_ms,
+                                    delay_us ? delay_us[node] : 0),
+                          deliveryDone, deliveryCtx(node, false));
+                if (err == ESP_OK) {
+                    tries[node]++;
+                } else {
+                    state[node] = DLV_QUEUED;
+                    full = (err == ESP_ERR_NO_MEM);
+                    if (!full) { tries[node]++; state[node] = DLV_FAILED; }
+                }
+            }
+        }
+        // Own part is looped back synchronously: start it once every part is queued
+        if (!goLocal && !full) {
+            bool partsQueued = true;
+            for (uint8_t k = 0; k < nParts; k++)
+                if (s_partState[order[k]] == DLV_QUEUED) partsQueued = false;
+            if (partsQueued) {
+                onGo(id, start_ms);   // the GO's other copies skip the sender
+                goLocal = true;
+            }
+        }
+        if (!busy || millis() - t0 >= ORCH_SCRIPT_SEND_MS) break;
+        vTaskDelay(pdMS_TO_TICKS(MESH_REL_TICK_MS));
+    }
+    if (!goLocal) onGo(id, start_ms);
+    s_dlvGen = gen + 1;   // outcomes still in flight no longer count
+
+    uint8_t reached = 0;
+    s_undelivered = 0;
+    for (uint8_t node = 0; node < MESH_MAX_NODES; node++) {
+        bool partOk = s_partState[node] == DLV_NONE || s_partState[node] == DLV_ACKED;
+        bool goOk = s_goState[node] == DLV_NONE || s_goState[node] == DLV_ACKED;
+        if (s_partState[node] == DLV_NONE && s_goState[node] == DLV_NONE) continue;
+        if (partOk && goOk) {
+            reached++;
+            continue;
+        }
+        s_undelivered++;
+        SqLog.printf("[script] ERROR: script %u not delivered to node %u (%02X:%02X): %s%s\n",
+            id, node, macs[node][4], macs[node][5],
+            partOk ? "" : "part ", goOk ? "unACKed" : "GO unACKed");
+    }
+
+    SqLog.printf("[script] Script %u sent: %u events, %u parts, %u/%u nodes ACKed in %lu ms, period %lu ms\n",
+        id, count, nParts, reached, reached + s_undelivered,
+        (unsigned long)(millis() - t0), (unsigned long)period_ms);
+    return id;
+}
+
+uint8_t OrchScript::lastUndelivered() {
+    return s_undelivered;
+}
+
+void OrchScript::onScript(const uint8_t* buf, uint16_t len) {
+    if (len < sizeof(OrchScriptMsg) || !s_mutex) return;
+    const OrchScriptMsg* msg = (const OrchScriptMsg*)buf;
+    if (msg->count > ORCH_SCRIPT_NODE_EVENTS
+        || len < sizeof(OrchScriptMsg) + msg->count * sizeof(OrchScriptEvent)) return;
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    if (!(s_running && s_active.id == msg->script_id)) {   // else a duplicate
+        s_staged.valid = true;
+        s_staged.id = msg->script_id;
+        s_staged.count = msg->count;
+        s_staged.period_ms = msg->period_ms;
+        s_staged.delay_us = msg->delay_us;
+        memcpy(s_staged.events, buf + sizeof(OrchScriptMsg), msg->count * sizeof(OrchScriptEvent));
+
+        // Keep events ascending whatever the sender did
+        for (uint8_t i = 1; i < s_staged.count; i++) {
+            for (uint8_t j = i; j > 0 && s_staged.events[j].at_ms < s_staged.events[j - 1].at_ms; j--) {
+                OrchScriptEvent tmp = s_staged.events[j];
+                s_staged.events[j] = s_staged.events[j - 1];
+                s_staged.events[j - 1] = tmp;
+            }
+        }
+
+        if (s_goPending && s_goId == msg->script_id) activateStaged(s_goStartMs);
+    }
+    xSemaphoreGive(s_mutex);
+}
+
+void OrchScript::onGo(uint8_t script_id, uint32_t start_ms) {
+    if (!s_mutex) return;
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    if (s_running && s_active.id == script_id) {
+        // duplicate GO
+    } else if (s_staged.valid && s_staged.id == script_id) {
+        activateStaged(start_ms);
+    } else {
+        // No part in this script (yet): the old one must not play over it
+        esp_timer_stop(s_timer);
+        s_running = false;
+        s_goPending = true;
+        s_goId = script_id;
+        s_goStartMs = start_ms;
+    }
+    xSemaphoreGive(s_mutex);
+}
+
+void OrchScript::stop() {
+    if (!s_mutex) return;
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    esp_timer_stop(s_timer);
+    s_running = false;
+    s_staged.valid = false;
+    s_goPending = false;
+    xSemaphoreGive(s_mutex);
+}
+
+bool OrchScript::isPlaying() {
+    return s_running;
+}
+
+void OrchScript::printStatus(Print& out) {
+    if (s_running) {
+        out.printf("  Script %u: %u events, period %lu ms, +%lu us, loop %lu%s\n",
+                   s_active.id, s_active.count, (unsigned long)s_active.period_ms,
+                   (unsigned long)s_active.delay_us, (unsigned long)s_loop,
+                   s_waitSync ? " (waiting for clock sync)" : "");
+    } else {
+        out.printf("  Script: idle%s\n", s_staged.valid ? " (next one staged)" : "");
+    }
+    if (s_truncated > 0) {
+        out.printf("  Script events dropped (part over %u events): %lu\n",
+                   ORCH_SCRIPT_NODE_EVENTS, (unsigned long)s_truncated);
+    }
+    if (s_played > 0 || s_missed > 0) {
+        out.printf("  Script events: %lu played, %lu skipped late, worst start error %ld us\n",
+                   (unsigned long)s_played, (unsigned long)s_missed, (long)s_worstErrUs);
+    }
+}
@@ -1,11 +1,14 @@
 #include "orchestrator.h"
+#include "orch_script.h"
 #include "clock_sync.h"
 #include "mesh_conductor.h"
 #include "peer_table.h"
+#include "link_stats.h"
 #include "audio_engine.h"
 #include "tone_library.h"
 #include "nvs_config.h"
 #include "sq_log.h"
+#include "bsp.hpp"
 #include <Arduino.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
@@ -14,6 +17,8 @@
 #include <nvs_flash.h>
 #include <esp_random.h>
 #include <esp_mac.h>
+#include <esp_timer.h>
+#include <math.h>
 #include <string.h>
 
 static const char* TAG = "Orch";
@@ -30,22 +35,66 @@ static TaskHandle_t   s_taskHandle   = nullptr;
 static QueueHandle_t  s_queue        = nullptr;
 static OrchMode       s_mode         = ORCH_OFF;
 static TravelOrder    s_travelOrder  = TRAVEL_NEAREST;
+static PathMetric     s_travelMetric = PATH_METRIC_EDGES;
 
 // Travel state
 static uint8_t s_travelPath[MESH_MAX_NODES];
 static uint8_t s_travelLen  = 0;
 static uint8_t s_travelIdx  = 0;
-static uint32_t s_lastStepMs = 0;
 
-// Random state
-static uint32_t s_nextRandomMs = 0;
-static uint32_t s_lastRandomMs = 0;
+// Consistent PeerTable view for path building / random picks (orch task only)
+static PeerSnapshot s_view;
 
 // Sequence state
 static SeqStep s_seqSteps[32];
 static uint8_t s_seqCount   = 0;
 static uint8_t s_seqIdx     = 0;
-static uint32_t s_lastSeqMs = 0;
+
+// Script the nodes are looping (gateway). Re-compiled ahead of each loop
+// boundary and redistributed only when it changed (random: always).
+static ScriptEvent s_script[ORCH_SCRIPT_MAX_EVENTS];
+static uint8_t     s_scriptSrc[ORCH_SCRIPT_MAX_EVENTS];  // travel stop / sequence step
+static uint8_t     s_scriptCount    = 0;
+static uint32_t    s_scriptPeriod   = 0;
+static uint32_t    s_scriptStartMs  = 0;     // mesh time of loop 0
+static uint32_t    s_scriptCheckMs  = 0;     // loop boundary already compiled for
+static bool        s_scriptLive     = false;
+static uint8_t     s_scriptId       = 0;
+static uint32_t    s_scriptsSent    = 0;
+static bool        s_scriptResend   = false;  // a node missed the last one
+static uint32_t    s_scriptMisses   = 0;      // nodes left without a script, summed
+
+// Compile scratch (orch task only)
+static ScriptEvent s_build[ORCH_SCRIPT_MAX_EVENTS];
+static uint8_t     s_buildSrc[ORCH_SCRIPT_MAX_EVENTS];
+static uint16_t    s_buildWant = 0;    // addEvent() calls, kept or not
+static uint32_t    s_panGrainMs = 0;   // grain the last pan lap compiled at
+
+// Acoustic alignment: per-slot start delays (us) sent with the script,
+// and the ones just computed for the next one
+static ListenerMode s_listenerMode = LISTENER_OFF;
+static float        s_listenerPt[3] = {0.0f, 0.0f, 0.0f};   // cm, LISTENER_POINT
+static int16_t      s_alignPct     = 100;
+static float        s_alignAt[3]   = {0.0f, 0.0f, 0.0f};    // listener used last
+static uint32_t     s_scriptDelay[MESH_MAX_NODES];
+static uint32_t     s_buildDelay[MESH_MAX_NODES];
+static uint32_t     s_buildDelayMax = 0;
+
+// Who each step's slot named when it was bound (RAM only, not in the NVS
+// blob): a PeerTable slot recycled to a new peer is followed to the old
+// peer's new slot, or the step is skipped.
+struct SeqRef {
+    bool    bound;
+    uint8_t gen;      // PeerTable::generation() at bind time
+    uint8_t mac[6];
+};
+static SeqRef s_seqRef[32];
+
+// Timed PLAY_CMD (receiver side): how much margin the latency budget left
+static uint32_t s_playTimed   = 0;
+static uint32_t s_playLate    = 0;     // arrived after its start time
+static int32_t  s_worstLateUs = 0;
+static int32_t  s_minLeadUs   = INT32_MAX;
 
 // Schedule state
 static TimerHandle_t s_schedTimer   = nullptr;
@@ -63,6 +112,7 @@ static const char* modeName(OrchMode m) {
         case ORCH_RANDOM:    return "Random";
         case ORCH_SEQUENCE:  return "Sequence";
         case ORCH_SCHEDULED: return "Scheduled";
+        case ORCH_PAN:       return "Pan";
         default:             return "Unknown";
     }
 }
@@ -72,28 +122,19 @@ static const char* travelOrderName(TravelOrder t) {
         case TRAVEL_NEAREST: return "nearest";
         case TRAVEL_AXIS:    return "axis";
         case TRAVEL_RANDOM:  return "random";
+        case TRAVEL_SHORTEST: return "shortest";
+        case TRAVEL_LOOP:    return "loop";
         default:             return "unknown";
     }
 }
 
-static void sendPlayCmd(uint8_t peerIdx, uint8_t toneIdx) {
-    PeerEntry* pe = PeerTable::getEntryByIndex(peerIdx);
-    if (!pe || !(pe->flags & PEER_STATUS_ALIVE)) return;
-
-    // Check if target is self
-    uint8_t own_mac[6];
-    esp_read_mac(own_mac, ESP_MAC_WIFI_STA);
-    if (memcmp(own_mac, pe->mac, 6) == 0) {
-        // Play locally
-        const ToneSequence* seq = ToneLibrary::getByIndex(toneIdx);
-        if (seq) AudioEngine::play(seq);
-        return;
-    }
+static bool poorLink(uint8_t peerIdx) {
+    PeerEntry pe;
+    return PeerTable::readEntry(peerIdx, &pe) && LinkStats::isPoor(pe.mac);
+}
 
-    PlayCmdMsg msg;
-    msg.type       = MSG_TYPE_PLAY_CMD;
-    msg.tone_index = toneIdx;
-    MeshConductor::sendToNode(pe->mac, &msg, sizeof(msg));
+static bool viewAlive(uint8_t i) {
+    return i < s_view.count && (s_view.entries[i].flags & PEER_STATUS_ALIVE);
 }
 
 static uint32_t randomRange(uint32_t minVal, uint32_t maxVal) {
@@ -104,7 +145,7 @@ static uint32_t randomRange(uint32_t minVal, uint32_t maxVal) {
 // --- Travel path builders ---
 
 static void buildTravelNearest() {
-    uint8_t count = PeerTable::peerCount();
+    uint8_t count = s_view.count;
     if (count == 0) { s_travelLen = 0; return; }
 
     bool visited[MESH_MAX_NODES] = {};
@@ -114,14 +155,12 @@ static void buildTravelNearest() {
     uint8_t current = 0;
     for (uint8_t step = 0; step < count; step++) {
         // Find first alive unvisited if current is dead
-        PeerEntry* ce = PeerTable::getEntryByIndex(current);
-        if (!ce || !(ce->flags & PEER_STATUS_ALIVE)) {
+        if (!viewAlive(current)) {
             // Find any alive unvisited
             bool found = false;
             for (uint8_t i = 0; i < count; i++) {
                 if (visited[i]) continue;
-                PeerEntry* pe = PeerTable::getEntryByIndex(i);
-                if (pe && (pe->flags & PEER_STATUS_ALIVE)) {
+                if (viewAlive(i)) {
                     current = i;
                     found = true;
                     break;
@@ -138,8 +177,7 @@ static void buildTravelNearest() {
         int8_t bestIdx = -1;
         for (uint8_t i = 0; i < count; i++) {
             if (visited[i]) continue;
-            PeerEntry* pe = PeerTable::getEntryByIndex(i);
-            if (!pe || !(pe->flags & PEER_STATUS_ALIVE)) continue;
+            if (!viewAlive(i)) continue;
             float d = PeerTable::getDistance(current, i);
             if (d >= 0 && d < bestDist) {
                 bestDist = d;
@@ -152,12 +190,9 @@ static void buildTravelNearest() {
         } else {
             // No distances known — fall back to next alive index
             for (uint8_t i = 0; i < count; i++) {
-                if (!visited[i]) {
-                    PeerEntry* pe = PeerTable::getEntryByIndex(i);
-                    if (pe && (pe->flags & PEER_STATUS_ALIVE)) {
-                        current = i;
-                        break;
-                    }
+                if (!visited[i] && viewAlive(i)) {
+                    current = i;
+                    break;
                 }
             }
         }
@@ -165,7 +200,7 @@ static void buildTravelNearest() {
 }
 
 static void buildTravelAxis() {
-    uint8_t count = PeerTable::peerCount();
+    uint8_t count = s_view.count;
     if (count == 0) { s_travelLen = 0; return; }
 
     // Collect alive indices
@@ -173,10 +208,9 @@ static void buildTravelAxis() {
     float   xpos[MESH_MAX_NODES];
     uint8_t n = 0;
     for (uint8_t i = 0; i < count; i++) {
-        PeerEntry* pe = PeerTable::getEntryByIndex(i);
-        if (pe && (pe->flags & PEER_STATUS_ALIVE)) {
+        if (viewAlive(i)) {
             alive[n] = i;
-            xpos[n]  = pe->position[0];
+            xpos[n]  = s_view.pos[i][0];
             n++;
         }
     }
@@ -194,14 +228,13 @@ static void buildTravelAxis() {
 }
 
 static void buildTravelRandom() {
-    uint8_t count = PeerTable::peerCount();
+    uint8_t count = s_view.count;
     if (count == 0) { s_travelLen = 0; return; }
 
     // Collect alive indices
     uint8_t n = 0;
     for (uint8_t i = 0; i < count; i++) {
-        PeerEntry* pe = PeerTable::getEntryByIndex(i);
-        if (pe && (pe->flags & PEER_STATUS_ALIVE)) {
+        if (viewAlive(i)) {
             s_travelPath[n++] = i;
         }
     }
@@ -216,71 +249,446 @@ static void buildTravelRandom() {
     }
 }
 
+static bool isOptimisedOrder() {
+    return s_travelOrder == TRAVEL_SHORTEST || s_travelOrder == TRAVEL_LOOP;
+}
+
+// 2-opt/Or-opt over the geometry (s_view); cached until it changes.
+// Returns true if the path was recomputed.
+static bool buildTravelShortest() {
+    bool fresh = false;
+    uint32_t t0 = micros();
+    s_travelLen = TravelPath::build(s_view, s_travelOrder == TRAVEL_LOOP, s_travelMetric,
+                                    s_travelPath, &fresh);
+    if (fresh) {
+        SqLog.printf("[orch] Travel path optimised: %u nodes, %lu cm, %lu evals%s, %lu us\n",
+                     s_travelLen, (unsigned long)TravelPath::lastLength_cm(),
+                     (unsigned long)TravelPath::lastEvaluations(),
+                     TravelPath::lastHitBudget() ? " (budget)" : "",
+                     (unsigned long)(micros() - t0));
+    }
+    return fresh;
+}
+
 static void buildTravelPath() {
+    PeerTable::snapshot(&s_view);
     switch (s_travelOrder) {
         case TRAVEL_NEAREST: buildTravelNearest(); break;
         case TRAVEL_AXIS:    buildTravelAxis();    break;
         case TRAVEL_RANDOM:  buildTravelRandom();  break;
+        case TRAVEL_SHORTEST:
+        case TRAVEL_LOOP:    buildTravelShortest(); break;
     }
     s_travelIdx  = 0;
-    s_lastStepMs = millis();
     SqLog.printf("[orch] Travel path built (%s): %u nodes\n",
                  travelOrderName(s_travelOrder), s_travelLen);
 }
 
-// --- Mode stepping ---
+static void bindStep(uint8_t i) {
+    PeerEntry e;
+    s_seqRef[i].bound = PeerTable::readEntry(s_seqSteps[i].node_index, &e);
+    if (!s_seqRef[i].bound) return;
+    s_seqRef[i].gen = PeerTable::generation(s_seqSteps[i].node_index);
+    memcpy(s_seqRef[i].mac, e.mac, 6);
+}
 
-static void stepTravel() {
-    if (s_travelLen == 0) return;
-    uint32_t now = millis();
-    uint32_t delay = (uint32_t)NvsConfigManager::orchTravelDelay_ms;
-    if (now - s_lastStepMs < delay) return;
+// Slot to play for step i, or -1 if its peer is gone for good
+static int resolveStep(uint8_t i) {
+    SeqStep& step = s_seqSteps[i];
+    SeqRef& ref = s_seqRef[i];
+    if (!ref.bound) {   // loaded from NVS: take whoever holds the slot now
+        bindStep(i);
+        return step.node_index;
+    }
+    if (PeerTable::isCurrent(step.node_index, ref.gen)) return step.node_index;
 
-    uint8_t toneIdx = (uint32_t)NvsConfigManager::orchToneIndex;
-    sendPlayCmd(s_travelPath[s_travelIdx], toneIdx);
+    int8_t idx = PeerTable::getIndex(ref.mac);
+    if (idx < 0) {
+        SqLog.printf("[orch] Step %u skipped: slot %u recycled, peer gone\n", i, step.node_index);
+        return -1;
+    }
+    SqLog.printf("[orch] Step %u remapped: slot %u -> %d\n", i, step.node_index, idx);
+    step.node_index = (uint8_t)idx;
+    ref.gen = PeerTable::generation((uint8_t)idx);
+    return idx;
+}
 
-    s_travelIdx = (s_travelIdx + 1) % s_travelLen;
-    s_lastStepMs = now;
+// --- Script compilers: one period of the active mode into s_build ---
+
+static void addEvent(uint8_t& n, uint8_t node, uint8_t toneIdx, uint32_t at_ms, uint8_t src,
+                     uint8_t gain = 255) {
+    s_buildWant++;
+    if (n >= ORCH_SCRIPT_MAX_EVENTS) return;
+    s_build[n].node = node;
+    s_build[n].tone_index = toneIdx;
+    s_build[n].gain = gain;
+    s_build[n].at_ms = at_ms;
+    s_buildSrc[n] = src;
+    n++;
 }
 
-static void stepRandom() {
-    uint32_t now = millis();
-    if (now - s_lastRandomMs < s_nextRandomMs) return;
+// One pass over the travel path. Stops behind a poor link are left out
+// (late or lost notes break the sweep) unless every stop is poor.
+static uint8_t compileTravel(uint32_t* period_ms) {
+    uint32_t delay = (uint32_t)NvsConfigManager::orchTravelDelay_ms;
+    uint8_t toneIdx = (uint32_t)NvsConfigManager::orchToneIndex;
+
+    // Optimised orders follow the geometry as it is measured; cheap when
+    // nothing changed (cached)
+    if (isOptimisedOrder()) {
+        PeerTable::snapshot(&s_view);
+        buildTravelShortest();
+    }
 
-    uint8_t count = PeerTable::peerCount();
-    if (count == 0) return;
+    bool anyGood = false;
+    for (uint8_t k = 0; k < s_travelLen && !anyGood; k++)
+        anyGood = !poorLink(s_travelPath[k]);
 
-    // Pick random alive node
-    uint8_t alive[MESH_MAX_NODES];
     uint8_t n = 0;
-    for (uint8_t i = 0; i < count; i++) {
-        PeerEntry* pe = PeerTable::getEntryByIndex(i);
-        if (pe && (pe->flags & PEER_STATUS_ALIVE))
-            alive[n++] = i;
+    for (uint8_t k = 0; k < s_travelLen; k++) {
+        uint8_t node = s_travelPath[k];
+        PeerEntry pe;
+        if (!PeerTable::readEntry(node, &pe) || !(pe.flags & PEER_STATUS_ALIVE)) continue;
+        if (anyGood && LinkStats::isPoor(pe.mac)) continue;
+        addEvent(n, node, toneIdx, n * delay, k);
     }
-    if (n == 0) return;
+    *period_ms = n * delay;
+    return n;
+}
 
-    uint8_t pick = alive[esp_random() % n];
-    uint8_t toneIdx = (uint32_t)NvsConfigManager::orchToneIndex;
-    sendPlayCmd(pick, toneIdx);
+// Random picks over the next ORCH_SCRIPT_RANDOM_SPAN_MS, preferring good links
+static uint8_t compileRandom(uint32_t* period_ms) {
+    PeerTable::snapshot(&s_view);
+    uint8_t alive[MESH_MAX_NODES];
+    uint8_t good[MESH_MAX_NODES];
+    uint8_t na = 0, ng = 0;
+    for (uint8_t i = 0; i < s_view.count; i++) {
+        if (!viewAlive(i)) continue;
+        alive[na++] = i;
+        if (!LinkStats::isPoor(s_view.entries[i].mac)) good[ng++] = i;
+    }
+    *period_ms = 0;
+    if (na == 0) return 0;
 
+    uint8_t toneIdx = (uint32_t)NvsConfigManager::orchToneIndex;
     uint32_t minMs = (uint32_t)NvsConfigManager::orchRandomMin_ms;
     uint32_t maxMs = (uint32_t)NvsConfigManager::orchRandomMax_ms;
-    s_nextRandomMs = randomRange(minMs, maxMs);
-    s_lastRandomMs = now;
+    uint8_t perNode[MESH_MAX_NODES] = {};
+    uint8_t n = 0;
+    uint32_t t = 0;
+    while (t < ORCH_SCRIPT_RANDOM_SPAN_MS && n < ORCH_SCRIPT_MAX_EVENTS) {
+        uint8_t pick = ng ? good[esp_random() % ng] : alive[esp_random() % na];
+        if (perNode[pick] < ORCH_SCRIPT_NODE_EVENTS) {
+            perNode[pick]++;
+            addEvent(n, pick, toneIdx, t, pick);
+        }
+        uint32_t gap = randomRange(minMs, maxMs);
+        t += (gap < ORCH_SCRIPT_MIN_PERIOD_MS) ? ORCH_SCRIPT_MIN_PERIOD_MS : gap;
+    }
+    *period_ms = t;
+    return n;
+}
+
+static uint8_t compileSequence(uint32_t* period_ms) {
+    uint8_t n = 0;
+    uint32_t t = 0;
+    for (uint8_t i = 0; i < s_seqCount; i++) {
+        int node = resolveStep(i);
+        PeerEntry pe;
+        if (node >= 0 && PeerTable::readEntry((uint8_t)node, &pe) && (pe.flags & PEER_STATUS_ALIVE))
+            addEvent(n, (uint8_t)node, s_seqSteps[i].tone_index, t, i);
+        t += s_seqSteps[i].delay_ms;
+    }
+    *period_ms = t;
+    return n;
+}
+
+// --- Phantom source (pan mode) ---
+//
+// A virtual source circles the flotilla at constant speed along the
+// TravelPath loop through the solved positions; one lap takes a travel
+// delay per node. Every grain, the ORCH_PAN_NODES nodes nearest the source
+// share it with distance-based weights (1 / (d + blur)), normalised to
+// constant power. A node that joins the set starts the tone at its weight;
+// while it stays, HOLD events only re-level it, so a sustained tone
+// crossfades smoothly. A short tone that ran out is started again.
+
+static uint32_t toneDurationMs(const ToneSequence* seq) {
+    if (!seq || seq->repeats == 255) return UINT32_MAX;
+    uint32_t ms = 0;
+    for (uint8_t i = 0; i < seq->count; i++) ms += seq->segments[i].duration_ms;
+    return ms * (seq->repeats + 1u);
 }
 
-static void stepSequence() {
-    if (s_seqCount == 0) return;
-    uint32_t now = millis();
+static float dist3(const float* a, const float* b) {
+    float dx = a[0] - b[0], dy = a[1] - b[1], dz = a[2] - b[2];
+    return sqrtf(dx * dx + dy * dy + dz * dz);
+}
 
-    const SeqStep& step = s_seqSteps[s_seqIdx];
-    if (now - s_lastSeqMs < step.delay_ms && s_lastSeqMs != 0) return;
+// Gains (0-255) of the nodes sharing a source at p; zero for the rest
+static void panGains(const float (*pts)[3], uint8_t m, const float* p, uint8_t* gain) {
+    uint8_t near[ORCH_PAN_NODES];
+    float   d[ORCH_PAN_NODES];
+    uint8_t k = 0;
+    for (uint8_t i = 0; i < m; i++) {
+        float di = dist3(pts[i], p);
+        uint8_t j;
+        if (k < ORCH_PAN_NODES) j = k++;
+        else if (di < d[k - 1]) j = k - 1;
+        else continue;
+        for (; j > 0 && d[j - 1] > di; j--) { near[j] = near[j - 1]; d[j] = d[j - 1]; }
+        near[j] = i;
+        d[j] = di;
+    }
 
-    sendPlayCmd(step.node_index, step.tone_index);
+    float w[ORCH_PAN_NODES];
+    float power = 0.0f;
+    for (uint8_t j = 0; j < k; j++) {
+        w[j] = 1.0f / (d[j] + ORCH_PAN_BLUR_CM);
+        power += w[j] * w[j];
+    }
+    float norm = 255.0f / sqrtf(power);
+    memset(gain, 0, m);
+    for (uint8_t j = 0; j < k; j++) {
+        long g = lroundf(w[j] * norm);
+        gain[near[j]] = (g < ORCH_PAN_MIN_GAIN) ? 0 : (uint8_t)(g > 255 ? 255 : g);
+    }
+}
+
+static uint8_t compilePan(uint32_t* period_ms) {
+    *period_ms = 0;
+    PeerTable::snapshot(&s_view);
+
+    // Trajectory: the shortest loop through the nodes that have a position
+    uint8_t order[MESH_MAX_NODES];
+    uint8_t count = TravelPath::build(s_view, true, PATH_METRIC_POSITIONS, order);
+    uint8_t nodes[MESH_MAX_NODES];
+    float   pts[MESH_MAX_NODES][3];
+    uint8_t m = 0;
+    for (uint8_t k = 0; k < count; k++) {
+        if (s_view.confidence[order[k]] <= 0.0f) continue;
+        nodes[m] = order[k];
+        memcpy(pts[m], s_view.pos[order[k]], sizeof(pts[m]));
+        m++;
+    }
+    if (m < 2) return 0;
+
+    float seg[MESH_MAX_NODES];
+    float lap = 0.0f;
+    for (uint8_t k = 0; k < m; k++) {
+        seg[k] = dist3(pts[k], pts[(k + 1) % m]);
+        lap += seg[k];
+    }
+    if (lap <= 0.0f) return 0;
+
+    // Grain count. A grain costs up to 2 × ORCH_PAN_NODES events where the
+    // set changes (the old nodes fading out, the new ones in), plus the
+    // lap-wrap fade-outs: start from the ideal grain and coarsen until the
+    // lap fits the script. The worst-case budget always does.
+    uint32_t period = m * (uint32_t)NvsConfigManager::orchTravelDelay_ms;
+    uint32_t grains = period / ORCH_PAN_GRAIN_MS;
+    uint32_t safeGrains = (ORCH_SCRIPT_MAX_EVENTS - ORCH_PAN_NODES) / (2 * ORCH_PAN_NODES);
+    if (grains > ORCH_SCRIPT_NODE_EVENTS - 1) grains = ORCH_SCRIPT_NODE_EVENTS - 1;   // one part
+    if (grains < 2) grains = 2;
+
+    uint8_t toneIdx = (uint32_t)NvsConfigManager::orchToneIndex;
+    uint32_t toneMs = toneDurationMs(ToneLibrary::getByIndex(toneIdx));
+
+    uint8_t  n;
+    uint32_t grainMs;
+    for (;;) {
+        grainMs = period / grains;
+        n = 0;
+        s_buildWant = 0;
+
+        uint8_t  level[MESH_MAX_NODES] = {};     // gain the node sounds at now
+        uint8_t  first[MESH_MAX_NODES];          // gains at t = 0
+        uint32_t endsAt[MESH_MAX_NODES] = {};    // when its tone runs out
+        uint8_t  gain[MESH_MAX_NODES];
+        uint8_t  k = 0;                          // trajectory segment
+        float    along = 0.0f;                   // distance into segment k
+
+        for (uint32_t g = 0; g < grains; g++) {
+            uint32_t t = g * grainMs;
+
+            // Constant speed: the source covers lap / grains per grain
+            float target = lap * (float)g / (float)grains;
+            while (k < m - 1 && target - along > seg[k]) { along += seg[k]; k++; }
+            float f = (seg[k] > 0.0f) ? (target - along) / seg[k] : 0.0f;
+            if (f > 1.0f) f = 1.0f;
+            const float* a = pts[k];
+            const float* b = pts[(k + 1) % m];
+            float p[3] = { a[0] + (b[0] - a[0]) * f, a[1] + (b[1] - a[1]) * f, a[2] + (b[2] - a[2]) * f };
+
+            panGains(pts, m, p, gain);
+            if (g == 0) memcpy(first, gain, m);
+            for (uint8_t i = 0; i < m; i++) {
+                if (gain[i] == level[i]) continue;
+                if (gain[i] == 0) {
+                    addEvent(n, nodes[i], ORCH_TONE_HOLD, t, nodes[i], 0);
+                } else if (level[i] == 0 || t >= endsAt[i]) {
+                    addEvent(n, nodes[i], toneIdx, t, nodes[i], gain[i]);
+                    endsAt[i] = (toneMs == UINT32_MAX) ? UINT32_MAX : t + toneMs;
+                } else {
+                    addEvent(n, nodes[i], ORCH_TONE_HOLD, t, nodes[i], gain[i]);
+                }
+                level[i] = gain[i];
+            }
+        }
+
+        // Next lap: nodes still sounding that the source has left fade out at t = 0
+        for (uint8_t i = 0; i < m; i++)
+            if (level[i] > 0 && first[i] == 0) addEvent(n, nodes[i], ORCH_TONE_HOLD, 0, nodes[i], 0);
+
+        if (s_buildWant <= ORCH_SCRIPT_MAX_EVENTS || grains <= safeGrains) break;
+        // Scale by what overflowed, at least one grain fewer, never below the safe count
+        uint32_t fewer = grains * ORCH_SCRIPT_MAX_EVENTS / s_buildWant;
+        if (fewer >= grains) fewer = grains - 1;
+        grains = (fewer < safeGrains) ? safeGrains : fewer;
+    }
+    s_panGrainMs = grainMs;
 
-    s_seqIdx = (s_seqIdx + 1) % s_seqCount;
-    s_lastSeqMs = now;
+    *period_ms = grains * grainMs;
+    return n;
+}
+
+static uint8_t compileScript(uint32_t* period_ms) {
+    uint8_t n = 0;
+    *period_ms = 0;
+    switch (s_mode) {
+        case ORCH_TRAVEL:   n = compileTravel(period_ms);   break;
+        case ORCH_RANDOM:   n = compileRandom(period_ms);   break;
+        case ORCH_SEQUENCE: n = compileSequence(period_ms); break;
+        case ORCH_PAN:      n = compilePan(period_ms);      break;
+        default: break;
+    }
+    if (n > 0 && *period_ms < ORCH_SCRIPT_MIN_PERIOD_MS) *period_ms = ORCH_SCRIPT_MIN_PERIOD_MS;
+    return n;
+}
+
+// Start delays that cancel each node's sound travel time to the listener
+// (s_alignPct = 100), or stretch it into a stagger. The farthest node
+// starts first; a node without a position counts as at the mean distance.
+static void compileAlignment() {
+    memset(s_buildDelay, 0, sizeof(s_buildDelay));
+    s_buildDelayMax = 0;
+    if (s_listenerMode == LISTENER_OFF || s_alignPct == 0) return;
+
+    PeerTable::snapshot(&s_view);
+    if (s_listenerMode == LISTENER_CENTROID) {
+        float sum[3] = {0.0f, 0.0f, 0.0f};
+        uint8_t m = 0;
+        for (uint8_t i = 0; i < s_view.count; i++) {
+            if (!viewAlive(i) || s_view.confidence[i] <= 0.0f) continue;
+            for (uint8_t k = 0; k < 3; k++) sum[k] += s_view.pos[i][k];
+            m++;
+        }
+        if (m == 0) return;
+        for (uint8_t k = 0; k < 3; k++) s_alignAt[k] = sum[k] / m;
+    } else {
+        memcpy(s_alignAt, s_listenerPt, sizeof(s_alignAt));
+    }
+
+    // Travel time of each node's sound to the listener, us
+    float travel[MESH_MAX_NODES];
+    bool known[MESH_MAX_NODES] = {};
+    float sum = 0.0f;
+    uint8_t m = 0;
+    for (uint8_t i = 0; i < s_view.count; i++) {
+        if (!viewAlive(i) || s_view.confidence[i] <= 0.0f) continue;
+        travel[i] = dist3(s_view.pos[i], s_alignAt) * (1e6f / SPEED_OF_SOUND_CM_S);
+        known[i] = true;
+        sum += travel[i];
+        m++;
+    }
+    if (m == 0) return;
+
+    // Shift = -travel × pct; delays are the shifts made non-negative
+    float shift[MESH_MAX_NODES];
+    float lowest = 0.0f;
+    for (uint8_t i = 0; i < s_view.count; i++) {
+        shift[i] = -(known[i] ? travel[i] : sum / m) * s_alignPct / 100.0f;
+        if (i == 0 || shift[i] < lowest) lowest = shift[i];
+    }
+    for (uint8_t i = 0; i < s_view.count; i++) {
+        s_buildDelay[i] = (uint32_t)lroundf(shift[i] - lowest);
+        if (s_buildDelay[i] > s_buildDelayMax) s_buildDelayMax = s_buildDelay[i];
+    }
+}
+
+// A node's alignment moved far enough to be heard (solver drift stays below)
+static bool alignmentChanged() {
+    for (uint8_t i = 0; i < MESH_MAX_NODES; i++) {
+        int32_t d = (int32_t)(s_buildDelay[i] - s_scriptDelay[i]);
+        if (d > ORCH_ALIGN_RESEND_US || d < -ORCH_ALIGN_RESEND_US) return true;
+    }
+    return false;
+}
+
+static void sendScript(uint8_t n, uint32_t period_ms, uint32_t start_ms) {
+    memcpy(s_script, s_build, n * sizeof(ScriptEvent));
+    memcpy(s_scriptSrc, s_buildSrc, n);
+    memcpy(s_scriptDelay, s_buildDelay, sizeof(s_scriptDelay));
+    s_scriptCount = n;
+    s_scriptPeriod = period_ms;
+    s_scriptStartMs = start_ms;
+    s_scriptLive = true;
+    s_scriptId = OrchScript::distribute(s_script, n, period_ms, start_ms, s_scriptDelay);
+    s_scriptsSent++;
+    uint8_t missed = OrchScript::lastUndelivered();
+    s_scriptMisses += missed;
+    s_scriptResend = missed > 0;   // unchanged or not, send it again next loop
+}
+
+// Keep the nodes' script current (gateway, every orch tick). Nodes loop
+// it on their own; this only re-compiles ahead of each loop boundary.
+static void runScript() {
+    uint32_t now = ClockSync::meshTime();
+    uint32_t period;
+
+    if (!s_scriptLive) {
+        uint8_t n = compileScript(&period);
+        compileAlignment();
+        if (n > 0) sendScript(n, period, now + ORCH_SCRIPT_LEAD_MS);
+        return;
+    }
+
+    // First loop boundary at least half a lead away, so a replacement gets
+    // there before the nodes do, retransmits included
+    int32_t ahead = (int32_t)(now + ORCH_SCRIPT_LEAD_MS / 2 - s_scriptStartMs);
+    if (ahead < 0) return;
+    uint32_t boundary = s_scriptStartMs + ((uint32_t)ahead / s_scriptPeriod + 1) * s_scriptPeriod;
+    if ((int32_t)(boundary - now) > ORCH_SCRIPT_LEAD_MS) return;
+
+    uint8_t n = compileScript(&period);
+    if (n == 0) {
+        s_scriptLive = false;   // everyone gone: start afresh when a node is back
+        return;
+    }
+    compileAlignment();
+    if (s_mode == ORCH_RANDOM || n != s_scriptCount || period != s_scriptPeriod
+        || memcmp(s_build, s_script, n * sizeof(ScriptEvent)) != 0 || alignmentChanged()
+        || s_scriptResend) {
+        sendScript(n, period, boundary);
+    } else {
+        s_scriptStartMs = boundary;   // unchanged: the nodes loop on by themselves
+    }
+}
+
+// Travel stop / sequence step the nodes are at, from the mesh clock
+static void trackScriptPosition() {
+    if (!s_scriptLive || s_scriptCount == 0) return;
+    int32_t d = (int32_t)(ClockSync::meshTime() - s_scriptStartMs) % (int32_t)s_scriptPeriod;
+    if (d < 0) d += (int32_t)s_scriptPeriod;
+    uint8_t i = 0;
+    while (i < s_scriptCount && s_script[i].at_ms <= (uint32_t)d) i++;
+    uint8_t src = s_scriptSrc[(i < s_scriptCount) ? i : 0];
+    if (s_mode == ORCH_TRAVEL) s_travelIdx = src;
+    else if (s_mode == ORCH_SEQUENCE) s_seqIdx = src;
+}
+
+static bool isScriptMode(OrchMode m) {
+    return m == ORCH_TRAVEL || m == ORCH_RANDOM || m == ORCH_SEQUENCE || m == ORCH_PAN;
 }
 
 // --- Scheduled trigger ---
@@ -312,6 +720,7 @@ void Orchestrator::loadSequence() {
         size_t expected = 1 + s_seqCount * sizeof(SeqStep);
         if (len >= expected) {
             memcpy(s_seqSteps, &buf[1], s_seqCount * sizeof(SeqStep));
+            memset(s_seqRef, 0, sizeof(s_seqRef));
             SqLog.printf("[orch] Loaded %u sequence steps from NVS\n", s_seqCount);
         } else {
             s_seqCount = 0;
@@ -340,6 +749,7 @@ void Orchestrator::addSequenceStep(uint8_t node_idx, uint8_t tone_idx, uint16_t
     s_seqSteps[s_seqCount].node_index = node_idx;
     s_seqSteps[s_seqCount].tone_index = tone_idx;
     s_seqSteps[s_seqCount].delay_ms   = delay_ms;
+    bindStep(s_seqCount);
     s_seqCount++;
 }
 
@@ -356,6 +766,14 @@ const SeqStep* Orchestrator::sequenceSteps() {
     return s_seqSteps;
 }
 
+uint8_t Orchestrator::sequenceIndex() {
+    return s_seqIdx;
+}
+
+void Orchestrator::setSequenceIndex(uint8_t idx) {
+    s_seqIdx = (s_seqCount > 0) ? (uint8_t)(idx % s_seqCount) : 0;
+}
+
 // --- FreeRTOS task ---
 
 void Orchestrator::orchTask(void*) {
@@ -372,28 +790,27 @@ void Orchestrator::orchTask(void*) {
         if (xQueueReceive(s_queue, &evt, timeout) == pdTRUE) {
             switch (evt) {
                 case EVT_MODE_CHANGE:
-                    // Mode already set by setMode(), just reset state
+                    // Mode already set by setMode(), just reset state.
+                    // A new script replaces the old one at its GO; until
+                    // then the nodes keep looping what they have.
+                    s_scriptLive = false;
                     switch (s_mode) {
                         case ORCH_TRAVEL:
                             buildTravelPath();
                             break;
-                        case ORCH_RANDOM:
-                            s_lastRandomMs = millis();
-                            s_nextRandomMs = randomRange(
-                                (uint32_t)NvsConfigManager::orchRandomMin_ms,
-                                (uint32_t)NvsConfigManager::orchRandomMax_ms);
-                            break;
                         case ORCH_SEQUENCE:
-                            s_seqIdx    = 0;
-                            s_lastSeqMs = 0;
+                            s_seqIdx = 0;
                             break;
                         default:
+                            if (!isScriptMode(s_mode)) OrchScript::stop();
                             break;
                     }
                     break;
 
                 case EVT_STOP:
                     s_mode = ORCH_OFF;
+                    s_scriptLive = false;
+                    OrchScript::stop();
                     break;
 
                 case EVT_SCHED_FIRE:
@@ -408,14 +825,10 @@ void Orchestrator::orchTask(void*) {
             }
         }
 
-        // Step the active mode (gateway only)
-        if (MeshConductor::isGateway()) {
-            switch (s_mode) {
-                case ORCH_TRAVEL:   stepTravel();   break;
-                case ORCH_RANDOM:   stepRandom();   break;
-                case ORCH_SEQUENCE: stepSequence(); break;
-                default: break;
-            }
+        // Keep the script current (gateway only); the nodes play it
+        if (MeshConductor::isGateway() && isScriptMode(s_mode)) {
+            runScript();
+            trackScriptPosition();
         }
     }
 }
@@ -423,6 +836,7 @@ void Orchestrator::orchTask(void*) {
 // --- Public API ---
 
 void Orchestrator::init() {
+    OrchScript::init();
     s_queue = xQueueCreate(4, sizeof(uint8_t));
     xTaskCreate(orchTask, "orch", 4096, nullptr, tskIDLE_PRIORITY + 2, &s_taskHandle);
 
@@ -450,7 +864,7 @@ void Orchestrator::setMode(OrchMode mode) {
         OrchModeMsg msg;
         msg.type = MSG_TYPE_ORCH_MODE;
         msg.mode = mode;
-        MeshConductor::broadcastToAll(&msg, sizeof(msg));
+        MeshConductor::broadcastReliable(&msg, sizeof(msg));
     }
 
     // Notify task
@@ -474,13 +888,70 @@ TravelOrder Orchestrator::getTravelOrder() {
     return s_travelOrder;
 }
 
-void Orchestrator::onPlayCmd(uint8_t tone_index) {
+void Orchestrator::setTravelMetric(PathMetric metric) {
+    s_travelMetric = metric;
+}
+
+void Orchestrator::setListener(ListenerMode mode, float x_cm, float y_cm, float z_cm) {
+    s_listenerPt[0] = x_cm;
+    s_listenerPt[1] = y_cm;
+    s_listenerPt[2] = z_cm;
+    if (mode == LISTENER_POINT) memcpy(s_alignAt, s_listenerPt, sizeof(s_alignAt));
+    s_listenerMode = mode;   // the next loop boundary resends if delays moved
+}
+
+void Orchestrator::setAlignment(int16_t percent) {
+    s_alignPct = percent;
+}
+
+esp_err_t Orchestrator::playOnNode(uint8_t peer_idx, uint8_t tone_index, uint8_t gain) {
+    if (!ToneLibrary::getByIndex(tone_index)) return ESP_ERR_INVALID_ARG;
+    PeerEntry pe;
+    if (!PeerTable::readEntry(peer_idx, &pe) || !(pe.flags & PEER_STATUS_ALIVE)
+        || (pe.flags & PEER_STATUS_DEAD)) return ESP_ERR_NOT_FOUND;
+
+    // Self (slot 0) goes through the loopback, same handler as a peer.
+    // The node starts on the mesh clock, not on arrival: hop count and
+    // queueing then only eat into the lead instead of smearing the onset.
+    PlayCmdMsg msg;
+    msg.type       = MSG_TYPE_PLAY_CMD;
+    msg.tone_index = tone_index;
+    msg.start_ms   = ClockSync::meshTime() + ORCH_PLAY_LEAD_MS;
+    if (msg.start_ms == 0) msg.start_ms = 1;   // 0 means "on receipt"
+    msg.gain       = gain;
+    return MeshConductor::sendReliable(pe.mac, &msg, sizeof(msg));
+}
+
+void Orchestrator::onPlayCmd(uint8_t tone_index, uint32_t start_ms, uint8_t gain) {
     const ToneSequence* seq = ToneLibrary::getByIndex(tone_index);
-    if (seq) AudioEngine::play(seq);
+    if (!seq) return;
+    if (start_ms == 0 || !ClockSync::isSynced()) {
+        AudioEngine::play(seq, gain);
+        return;
+    }
+
+    int64_t at = ClockSync::localUs(start_ms);
+    int64_t lead = at - esp_timer_get_time();
+    if (lead > 10 * (int64_t)ORCH_PLAY_LEAD_MS * 1000) {
+        // Clock jumped (new gateway, missed syncs): don't sit on the tone
+        AudioEngine::play(seq, gain);
+        return;
+    }
+    s_playTimed++;
+    if (lead < 0) {
+        s_playLate++;
+        if (-lead > s_worstLateUs) s_worstLateUs = (int32_t)-lead;
+        SqLog.printf("[orch] PLAY_CMD %ld us late, playing now\n", (long)-lead);
+    } else if (lead < s_minLeadUs) {
+        s_minLeadUs = (int32_t)lead;
+    }
+    AudioEngine::playAt(seq, at, gain);
 }
 
 void Orchestrator::onModeChange(uint8_t mode) {
     s_mode = (OrchMode)mode;
+    if (!isScriptMode(s_mode)) OrchScript::stop();   // else the next GO replaces the script
+    MeshNode::updateCadence();
     SqLog.printf("[orch] Mode changed to %s (from gateway)\n", modeName(s_mode));
 }
 
@@ -509,7 +980,12 @@ void Orchestrator::printStatus(Print& out) {
     if (s_mode == ORCH_TRAVEL) {
         out.printf("  Travel order: %s, path len: %u, current: %u\n",
                    travelOrderName(s_travelOrder), s_travelLen, s_travelIdx);
+        if (isOptimisedOrder()) {
+            out.printf("  Path: %lu cm over %s\n", (unsigned long)TravelPath::lastLength_cm(),
+                       s_travelMetric == PATH_METRIC_POSITIONS ? "positions" : "measured edges");
+        }
     }
+    if (s_mode == ORCH_PAN) out.printf("  Pan grain: %lu ms\n", (unsigned long)s_panGrainMs);
     out.printf("  Tone index: %lu (%s)\n",
                (uint32_t)NvsConfigManager::orchToneIndex,
                ToneLibrary::nameByIndex((uint32_t)NvsConfigManager::orchToneIndex) ?: "?");
@@ -518,5 +994,26 @@ void Orchestrator::printStatus(Print& out) {
                (uint32_t)NvsConfigManager::orchRandomMin_ms,
                (uint32_t)NvsConfigManager::orchRandomMax_ms);
     out.printf("  Sequence steps: %u\n", s_seqCount);
+    if (s_listenerMode == LISTENER_OFF) {
+        out.printf("  Listener: off\n");
+    } else {
+        out.printf("  Listener: %s (%.0f, %.0f, %.0f) cm, alignment %d%%, start offsets up to %lu us\n",
+                   s_listenerMode == LISTENER_CENTROID ? "centroid" : "point",
+                   s_alignAt[0], s_alignAt[1], s_alignAt[2], s_alignPct,
+                   (unsigned long)s_buildDelayMax);
+    }
+    if (MeshConductor::isGateway() && s_scriptLive) {
+        out.printf("  Script %u sent: %u events, period %lu ms (%lu scripts sent, %lu node misses)\n",
+                   s_scriptId, s_scriptCount, (unsigned long)s_scriptPeriod,
+                   (unsigned long)s_scriptsSent, (unsigned long)s_scriptMisses);
+    }
+    OrchScript::printStatus(out);
     out.printf("  Clock synced: %s\n", ClockSync::isSynced() ? "yes" : "no");
+    ClockSync::printStatus(out);
+    if (s_playTimed > 0) {
+        out.printf("  Timed plays: %lu, late %lu (worst %ld us), min lead %ld us, last start error %ld us\n",
+                   (unsigned long)s_playTimed, (unsigned long)s_playLate, (long)s_worstLateUs,
+                   (long)(s_minLeadUs == INT32_MAX ? 0 : s_minLeadUs),
+                   (long)AudioEngine::lastStartErrorUs());
+    }
 }
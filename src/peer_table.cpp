@@ -1,11 +1,18 @@
 #include "peer_table.h"
+#include "mesh_footprint.h"
 #include "mesh_conductor.h"
 #include "nvs_config.h"
 #include "power_manager.h"
+#include "link_stats.h"
+#include "ftm_scheduler.h"
+#include "position_solver.h"
 #include "sq_log.h"
+#include "seqlock.h"
+#include "mac_index.h"
 #include <Arduino.h>
-#include <esp_mac.h>
+#include <esp_random.h>
 #include <string.h>
+#include <new>
 
 static const char* TAG = "ptable";
 
@@ -13,135 +20,483 @@ static const char* TAG = "ptable";
 
 static PeerEntry  s_entries[MESH_MAX_NODES];
 static uint8_t    s_count = 0;   // total slots in use (index 0 = gateway self)
-static TimerHandle_t s_stalenessTimer = nullptr;
-static uint32_t   s_lastBroadcastHash = 0;  // change-detection for broadcastSync
+static uint8_t    s_gen[MESH_MAX_NODES];   // bumped when a dead slot is recycled
+
+// Geometry, structure-of-arrays (solver and orchestrator sweep these by axis)
+static PeerEdge   s_edges[PEER_EDGE_COUNT];
+static_assert(sizeof(s_edges) == FOOTPRINT_EDGE_STORE, "mesh_footprint.h: edge store");
+static_assert(sizeof(PeerSnapshot) == FOOTPRINT_PEER_SNAPSHOT, "mesh_footprint.h: PeerSnapshot");
+static uint8_t    s_edgeDirty[(PEER_EDGE_COUNT + 7) / 8];   // changed since last takeDirtyEdges()
+static float      s_posX[MESH_MAX_NODES];
+static float      s_posY[MESH_MAX_NODES];
+static float      s_posZ[MESH_MAX_NODES];
+static float      s_confidence[MESH_MAX_NODES];
+static TimerHandle_t s_stalenessTimer = nullptr;   // re-election check only
+
+// Liveness deadlines: binary min-heap of slots keyed by s_deadline, with a
+// one-shot timer armed for the earliest one. A peer is declared dead when
+// its own deadline passes, not at the next periodic sweep.
+static uint32_t   s_deadline[MESH_MAX_NODES];   // millis() after which slot is dead
+static uint8_t    s_heap[MESH_MAX_NODES];       // slots, earliest deadline at [0]
+static int8_t     s_heapPos[MESH_MAX_NODES];    // slot → heap index, -1 = not queued
+static uint8_t    s_heapSize = 0;
+static uint8_t    s_period_s[MESH_MAX_NODES];   // peer's announced heartbeat period
+static TimerHandle_t s_livenessTimer = nullptr;
+
+// PEER_SYNC delta state (see broadcastSync)
+static uint8_t    s_syncSentCount = 0;
+static uint8_t    s_syncDirty[(MESH_MAX_NODES + 7) / 8];   // battery/flags changed since last sync
+static uint16_t   s_syncEpoch = 0;                         // bumped by every broadcast
+static uint16_t   s_bindEpoch = 0;                         // epoch of the last FULL broadcast
+static bool       s_syncFullPending = true;
 static uint32_t   s_lastReelectionMs = 0;  // cooldown: millis() of last re-election trigger
 
+// MAC → slot index (mac_index.h). Slots never move: entries are added
+// (slotFor, seedFromShadow), dropped one at a time when a dead slot is
+// recycled, or all at once (init, shutdown).
+static MacIndex<MESH_MAX_NODES> s_macIndex;
+
+// Writers (mesh RX, liveness/FTM timers, solver, election task) serialize
+// on one recursive owner lock. Entry/position writes also bump a seqlock
+// sequence — odd while a write is in progress — so snapshot() readers get
+// a consistent copy without ever taking the lock.
+static SemaphoreHandle_t s_ownerMutex = nullptr;
+static SeqLock           s_seq;
+static uint8_t           s_writeDepth = 0;
+static SemaphoreHandle_t s_syncMutex  = nullptr;   // broadcastSync buffer, held across the send
+
 // --- Helpers ---
 
+static void ownerLock() {
+    if (!s_ownerMutex) s_ownerMutex = xSemaphoreCreateRecursiveMutex();
+    xSemaphoreTakeRecursive(s_ownerMutex, portMAX_DELAY);
+}
+
+static void ownerUnlock() {
+    xSemaphoreGiveRecursive(s_ownerMutex);
+}
+
+static void writeBegin() {
+    ownerLock();
+    if (s_writeDepth++ == 0) s_seq.writeBegin();
+}
+
+static void writeEnd() {
+    if (--s_writeDepth == 0) s_seq.writeEnd();
+    ownerUnlock();
+}
+
+// A reader that finds a write in progress sleeps a tick rather than spins:
+// on the single-core C6 the preempted writer may have lower priority.
+static uint32_t readBegin() {
+    return s_seq.readBegin([] { vTaskDelay(1); });
+}
+
+static bool readRetry(uint32_t seq) {
+    return s_seq.readRetry(seq);
+}
+
+// Lock-free for readers: a slot is published to the index only after its
+// MAC has been written.
 static int8_t findByMac(const uint8_t* mac) {
-    for (uint8_t i = 0; i < s_count; i++) {
-        if (memcmp(s_entries[i].mac, mac, 6) == 0)
-            return (int8_t)i;
-    }
-    return -1;
+    return (int8_t)s_macIndex.find(s_entries, s_count, mac);
 }
 
-static void clearEntry(PeerEntry* e) {
-    memset(e, 0, sizeof(PeerEntry));
-    for (int i = 0; i < MESH_MAX_NODES; i++)
-        e->distances[i] = -1.0f;
-    e->position[0] = 0.0f;
-    e->position[1] = 0.0f;
-    e->position[2] = 0.0f;
-    e->confidence = 0.0f;
+static void macIndexClear() {
+    s_macIndex.clear();
+}
+
+static void macIndexInsert(uint8_t idx) {
+    s_macIndex.add(s_entries, idx);
+}
+
+// Call while the slot still holds the MAC it was indexed under
+static void macIndexRemove(uint8_t idx) {
+    s_macIndex.remove(s_entries, idx);
+}
+
+static inline void markSyncDirty(uint8_t idx) {
+    s_syncDirty[idx >> 3] |= (uint8_t)(1u << (idx & 7));
+}
+
+static void clearEntry(uint8_t idx) {
+    memset(&s_entries[idx], 0, sizeof(PeerEntry));
+    s_posX[idx] = 0.0f;
+    s_posY[idx] = 0.0f;
+    s_posZ[idx] = 0.0f;
+    s_confidence[idx] = 0.0f;
+    for (uint8_t j = 0; j < MESH_MAX_NODES; j++) {
+        if (j == idx) continue;
+        PeerEdge* edge = &s_edges[PeerTable::edgeIndex(idx, j)];
+        edge->distance_cm = PEER_DIST_UNKNOWN;
+        edge->quality = 0;
+    }
 }
 
 static void stalenessTimerCb(TimerHandle_t t) {
     (void)t;
-    PeerTable::scanStaleness();
+    // Battery/flag changes only mark slots dirty; flush them as a delta
+    // here (no-op when nothing changed) rather than one sync per beat
+    PeerTable::broadcastSync();
     PeerTable::checkReelection();
 }
 
+// --- Deadline heap ---
+
+static inline bool heapBefore(uint8_t a, uint8_t b) {
+    return (int32_t)(s_deadline[s_heap[a]] - s_deadline[s_heap[b]]) < 0;
+}
+
+static void heapSwap(uint8_t a, uint8_t b) {
+    uint8_t t = s_heap[a]; s_heap[a] = s_heap[b]; s_heap[b] = t;
+    s_heapPos[s_heap[a]] = a;
+    s_heapPos[s_heap[b]] = b;
+}
+
+static void heapSiftUp(uint8_t i) {
+    while (i > 0) {
+        uint8_t parent = (i - 1) / 2;
+        if (!heapBefore(i, parent)) break;
+        heapSwap(i, parent);
+        i = parent;
+    }
+}
+
+static void heapSiftDown(uint8_t i) {
+    for (;;) {
+        uint8_t l = 2 * i + 1, r = l + 1, m = i;
+        if (l < s_heapSize && heapBefore(l, m)) m = l;
+        if (r < s_heapSize && heapBefore(r, m)) m = r;
+        if (m == i) break;
+        heapSwap(i, m);
+        i = m;
+    }
+}
+
+static void heapRemove(uint8_t slot) {
+    int8_t i = s_heapPos[slot];
+    if (i < 0) return;
+    s_heapPos[slot] = -1;
+    s_heapSize--;
+    if (i == s_heapSize) return;
+    uint8_t moved = s_heap[s_heapSize];
+    s_heap[i] = moved;
+    s_heapPos[moved] = i;
+    heapSiftUp(i);
+    heapSiftDown(s_heapPos[moved]);
+}
+
+static void heapSet(uint8_t slot, uint32_t deadline) {
+    s_deadline[slot] = deadline;
+    int8_t i = s_heapPos[slot];
+    if (i < 0) {
+        i = s_heapSize++;
+        s_heap[i] = slot;
+        s_heapPos[slot] = i;
+    }
+    // Deadlines normally only move later, but re-sift both ways for safety
+    heapSiftUp(i);
+    heapSiftDown(s_heapPos[slot]);
+}
+
+// Arm the liveness timer for the earliest deadline
+static void armLivenessTimer() {
+    if (!s_livenessTimer) return;
+    if (s_heapSize == 0) {
+        xTimerStop(s_livenessTimer, 0);
+        return;
+    }
+    int32_t wait = (int32_t)(s_deadline[s_heap[0]] - millis());
+    TickType_t ticks = (wait > 0) ? pdMS_TO_TICKS(wait) : 0;
+    xTimerChangePeriod(s_livenessTimer, ticks ? ticks : 1, 0);   // also (re)starts it
+}
+
+static void livenessTimerCb(TimerHandle_t t) {
+    (void)t;
+    PeerTable::scanStaleness();
+}
+
 // --- Public API ---
 
 void PeerTable::init() {
+    if (!s_ownerMutex) s_ownerMutex = xSemaphoreCreateRecursiveMutex();
+    if (!s_syncMutex) s_syncMutex = xSemaphoreCreateMutex();
+    writeBegin();
     s_count = 0;
-    for (int i = 0; i < MESH_MAX_NODES; i++)
-        clearEntry(&s_entries[i]);
+    macIndexClear();
+    for (uint8_t i = 0; i < MESH_MAX_NODES; i++) {
+        clearEntry(i);
+        s_heapPos[i] = -1;
+        s_gen[i] = 0;
+    }
+    s_heapSize = 0;
+    memset(s_edgeDirty, 0, sizeof(s_edgeDirty));
+    memset(s_syncDirty, 0, sizeof(s_syncDirty));
+    s_syncEpoch = (uint16_t)esp_random();   // never continues a previous gateway's sequence
+    s_bindEpoch = s_syncEpoch;
 
     // Insert self as slot 0
-    uint8_t own_mac[6];
-    esp_read_mac(own_mac, ESP_MAC_WIFI_STA);
-    memcpy(s_entries[0].mac, own_mac, 6);
-
-    // Derive SoftAP MAC (typically STA + 1 on last byte)
-    uint8_t ap_mac[6];
-    esp_read_mac(ap_mac, ESP_MAC_WIFI_SOFTAP);
-    memcpy(s_entries[0].softap_mac, ap_mac, 6);
+    memcpy(s_entries[0].mac, MeshConductor::staMac(), 6);
+    memcpy(s_entries[0].softap_mac, MeshConductor::softapMac(), 6);
 
     s_entries[0].battery_mv = (uint16_t)PowerManager::batteryMv();
     s_entries[0].last_seen_ms = millis();
     s_entries[0].flags = PEER_STATUS_ALIVE;
     s_count = 1;
+    macIndexInsert(0);
+    s_syncFullPending = true;   // new gateway: receivers must rebind short IDs
+    writeEnd();
 
-    // Start staleness scanner (every 60s)
+    // Re-election check and dirty-slot sync flush (periodic, independent
+    // of heartbeat cadence)
     if (s_stalenessTimer == nullptr) {
-        s_stalenessTimer = xTimerCreate("staleness", pdMS_TO_TICKS(60000),
+        s_stalenessTimer = xTimerCreate("staleness", pdMS_TO_TICKS(PEER_REELECT_CHECK_MS),
                                          pdTRUE, nullptr, stalenessTimerCb);
     }
     xTimerStart(s_stalenessTimer, 0);
 
-    SqLog.printf("[ptable] Initialized, self = slot 0\n");
+    // Liveness: one-shot, re-armed for the earliest peer deadline
+    if (s_livenessTimer == nullptr) {
+        s_livenessTimer = xTimerCreate("liveness", 1, pdFALSE, nullptr, livenessTimerCb);
+    }
+
+    SqLog.printf("[ptable] Initialized, self = slot 0 (%u slots: entries %u B, MAC index %u B, edges %u B, geometry %u B)\n",
+        MESH_MAX_NODES, (unsigned)sizeof(s_entries), (unsigned)sizeof(s_macIndex), (unsigned)sizeof(s_edges),
+        (unsigned)(sizeof(s_posX) + sizeof(s_posY) + sizeof(s_posZ) + sizeof(s_confidence)));
 }
 
 void PeerTable::shutdown() {
     if (s_stalenessTimer) {
         xTimerStop(s_stalenessTimer, 0);
     }
+    if (s_livenessTimer) {
+        xTimerStop(s_livenessTimer, 0);
+    }
+    writeBegin();
+    s_heapSize = 0;
+    for (uint8_t i = 0; i < MESH_MAX_NODES; i++)
+        s_heapPos[i] = -1;
     s_count = 0;
+    macIndexClear();
+    writeEnd();
     SqLog.println("[ptable] Shutdown");
 }
 
-void PeerTable::updateFromHeartbeat(const uint8_t* mac, uint16_t battery_mv,
-                                     uint8_t flags, const uint8_t* softap_mac) {
-    int8_t idx = findByMac(mac);
-    bool newPeer = false;
-    bool wasDeadNowAlive = false;
+// Table full: hand the longest-dead slot past its grace period to a new
+// peer. Its edges, position and solver state are wiped and its generation
+// advances; the scheduler drops work still aimed at the old occupant, and
+// the next PEER_SYNC is FULL so receivers rebind the short ID.
+static int8_t recycleSlot() {
+    uint32_t now = millis();
+    int8_t victim = -1;
+    uint32_t oldest = 0;
+    for (uint8_t i = 1; i < s_count; i++) {
+        if (!(s_entries[i].flags & PEER_STATUS_DEAD)) continue;
+        uint32_t silent = now - s_entries[i].last_seen_ms;
+        if (silent < PEER_RECLAIM_GRACE_MS || silent < oldest) continue;
+        victim = (int8_t)i;
+        oldest = silent;
+    }
+    if (victim < 0) return -1;
+
+    SqLog.printf("[ptable] Recycling slot %d (%02X:%02X:%02X:%02X:%02X:%02X dead, silent %lu s)\n",
+        victim, s_entries[victim].mac[0], s_entries[victim].mac[1], s_entries[victim].mac[2],
+        s_entries[victim].mac[3], s_entries[victim].mac[4], s_entries[victim].mac[5],
+        (unsigned long)(oldest / 1000));
+    macIndexRemove(victim);
+    heapRemove(victim);
+    clearEntry(victim);
+    s_gen[victim]++;
+    for (uint8_t j = 0; j < s_count; j++) {   // replicate the wiped edges as unknown
+        if (j == victim) continue;
+        uint16_t e = PeerTable::edgeIndex(victim, j);
+        s_edgeDirty[e >> 3] |= (uint8_t)(1u << (e & 7));
+    }
+    s_syncFullPending = true;
+    FtmScheduler::onSlotRecycled(victim);
+    PositionSolver::resetNode(victim);
+    return victim;
+}
 
-    if (idx < 0) {
-        // New peer — add to table
-        if (s_count >= MESH_MAX_NODES) {
-            SqLog.println("[ptable] Table full, ignoring new peer");
-            return;
-        }
+// Find, append, or recycle the slot for `mac`; -1 if the table is full
+static int8_t slotFor(const uint8_t* mac, bool* isNew) {
+    int8_t idx = findByMac(mac);
+    *isNew = false;
+    if (idx >= 0) return idx;
+    if (s_count < MESH_MAX_NODES) {
         idx = s_count++;
-        clearEntry(&s_entries[idx]);
-        memcpy(s_entries[idx].mac, mac, 6);
-        newPeer = true;
-        SqLog.printf("[ptable] New peer at slot %d: %02X:%02X:%02X:%02X:%02X:%02X\n",
-            idx, mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
-    } else {
-        wasDeadNowAlive = (s_entries[idx].flags & PEER_STATUS_DEAD) != 0;
+        clearEntry(idx);
+    } else if ((idx = recycleSlot()) < 0) {
+        SqLog.println("[ptable] Table full, ignoring new peer");
+        return -1;
+    }
+    memcpy(s_entries[idx].mac, mac, 6);
+    macIndexInsert(idx);
+    *isNew = true;
+    SqLog.printf("[ptable] New peer at slot %d: %02X:%02X:%02X:%02X:%02X:%02X\n",
+        idx, mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+    return idx;
+}
+
+// Record a heartbeat for slot idx and push its deadline. age_s dates a
+// relayed beat from its source (HB_AGG). Returns true if the peer was dead
+// (its short ID bindings are lost, caller resends a FULL sync).
+static bool touchPeer(uint8_t idx, uint16_t battery_mv, uint8_t flags,
+                      const uint8_t* softap_mac, uint8_t interval_s, uint8_t age_s = 0) {
+    if (interval_s == 0) {
+        // Same clamp as the node's own period (mesh_node.cpp pickHeartbeatPeriod)
+        uint32_t cfg = (uint32_t)NvsConfigManager::heartbeatInterval_s;
+        interval_s = (uint8_t)(cfg == 0 ? 1 : cfg > 255 ? 255 : cfg);
     }
+    // Peer is dead once it misses `stale multiplier` of its own heartbeats
+    uint32_t life_ms = (uint32_t)interval_s * (uint32_t)NvsConfigManager::heartbeatStaleMultiplier * 1000u;
+    uint32_t heard = millis() - (uint32_t)age_s * 1000u;
 
+    bool wasDead = (s_entries[idx].flags & PEER_STATUS_DEAD) != 0;
+    if (wasDead && (uint32_t)age_s * 1000u >= life_ms)
+        return false;   // relayed from before it died: proves nothing
+    uint8_t newFlags = (uint8_t)((flags | PEER_STATUS_ALIVE) & ~PEER_STATUS_DEAD);
+
+    if (s_entries[idx].battery_mv != battery_mv || s_entries[idx].flags != newFlags)
+        markSyncDirty(idx);
     s_entries[idx].battery_mv = battery_mv;
-    s_entries[idx].last_seen_ms = millis();
-    s_entries[idx].flags = flags | PEER_STATUS_ALIVE;
-    s_entries[idx].flags &= ~PEER_STATUS_DEAD;
+    // A late relay never moves the last beat back past a direct one
+    if (wasDead || (int32_t)(heard - s_entries[idx].last_seen_ms) > 0)
+        s_entries[idx].last_seen_ms = heard;
+    s_entries[idx].flags = newFlags;
 
     if (softap_mac) {
         memcpy(s_entries[idx].softap_mac, softap_mac, 6);
     }
 
+    s_period_s[idx] = interval_s;
+    heapSet(idx, s_entries[idx].last_seen_ms + life_ms);
+    return wasDead;
+}
+
+void PeerTable::updateFromHeartbeat(const uint8_t* mac, uint16_t battery_mv,
+                                     uint8_t flags, const uint8_t* softap_mac,
+                                     uint8_t interval_s) {
+    bool newPeer;
+    writeBegin();
+    int8_t idx = slotFor(mac, &newPeer);
+    if (idx < 0) { writeEnd(); return; }
+
+    bool wasDeadNowAlive = touchPeer(idx, battery_mv, flags, softap_mac, interval_s);
+    armLivenessTimer();
+    writeEnd();
+
     if (newPeer || wasDeadNowAlive) {
+        // A rejoining node has lost its short ID bindings — resend in full
+        if (wasDeadNowAlive) s_syncFullPending = true;
+        broadcastSync();
+    }
+}
+
+uint8_t PeerTable::applyHeartbeatBatch(const uint8_t* recs, uint16_t len, uint8_t count,
+                                       uint16_t epoch) {
+    bool anyNew = false, anyRevived = false;
+    uint8_t applied = 0;
+    uint16_t pos = 0;
+
+    writeBegin();
+    // Compact records index our slots as of the sender's shadow: only
+    // trust them if that shadow was bound by our last FULL broadcast or a
+    // delta since, and no renumbering (recycle, revive) is still unsent
+    bool idsMatch = !s_syncFullPending
+        && (uint16_t)(epoch - s_bindEpoch) <= (uint16_t)(s_syncEpoch - s_bindEpoch);
+    for (uint8_t r = 0; r < count && pos < len; r++) {
+        if (recs[pos] == HB_AGG_FULL) {
+            if (pos + sizeof(HbAggFull) > len) break;
+            HbAggFull f;
+            memcpy(&f, recs + pos, sizeof(f));
+            pos += sizeof(f);
+            bool isNew;
+            int8_t idx = slotFor(f.mac, &isNew);
+            if (idx <= 0) continue;   // table full, or our own record
+            anyNew |= isNew;
+            anyRevived |= touchPeer(idx, f.battery_mv, f.flags, f.softap_mac, f.interval_s, f.age_s);
+            LinkStats::onLinkReport(f.mac, f.layer, f.rssi);
+            applied++;
+            continue;
+        }
+
+        if (pos + 2 > len) break;
+        uint8_t idx = recs[pos], mask = recs[pos + 1];
+        pos += 2;
+        // Absent fields keep their last value
+        uint8_t  base = idx < s_count ? idx : 0;
+        uint16_t battery_mv = s_entries[base].battery_mv;
+        uint8_t  flags = s_entries[base].flags & ~(PEER_STATUS_ALIVE | PEER_STATUS_DEAD);
+        uint8_t  interval_s = s_period_s[base];
+        if (mask & HB_AGG_F_BATTERY) {
+            if (pos + 2 > len) break;
+            memcpy(&battery_mv, recs + pos, 2);
+            pos += 2;
+        }
+        if (mask & HB_AGG_F_FLAGS) {
+            if (pos + 1 > len) break;
+            flags = recs[pos++];
+        }
+        if (mask & HB_AGG_F_INTERVAL) {
+            if (pos + 1 > len) break;
+            interval_s = recs[pos++];
+        }
+        uint8_t layer = 0;
+        int8_t  rssi = 0;
+        if (mask & HB_AGG_F_LINK) {
+            if (pos + 2 > len) break;
+            layer = recs[pos];
+            rssi = (int8_t)recs[pos + 1];
+            pos += 2;
+        }
+        uint8_t age_s = 0;
+        if (mask & HB_AGG_F_AGE) {
+            if (pos + 1 > len) break;
+            age_s = recs[pos++];
+        }
+        if (!idsMatch || idx == 0 || idx >= s_count) continue;   // stale short ID
+        anyRevived |= touchPeer(idx, battery_mv, flags, nullptr, interval_s, age_s);
+        if (mask & HB_AGG_F_LINK) LinkStats::onLinkReport(s_entries[idx].mac, layer, rssi);
+        applied++;
+    }
+    armLivenessTimer();
+    writeEnd();
+
+    if (anyNew || anyRevived) {
+        if (anyRevived) s_syncFullPending = true;
         broadcastSync();
     }
+    return applied;
 }
 
 void PeerTable::updateSelf(uint16_t battery_mv) {
+    writeBegin();
+    if (s_entries[0].battery_mv != battery_mv) markSyncDirty(0);
     s_entries[0].battery_mv = battery_mv;
     s_entries[0].last_seen_ms = millis();
+    writeEnd();
 }
 
+// Expire every peer whose deadline has passed (liveness timer callback)
 void PeerTable::scanStaleness() {
     uint32_t now = millis();
-    uint32_t stale_ms = (uint32_t)NvsConfigManager::heartbeatInterval_s
-                      * (uint32_t)NvsConfigManager::heartbeatStaleMultiplier
-                      * 1000;
-
     bool anyChanged = false;
-    for (uint8_t i = 1; i < s_count; i++) {  // skip self (slot 0)
-        if (s_entries[i].flags & PEER_STATUS_DEAD)
-            continue;
 
-        if ((now - s_entries[i].last_seen_ms) > stale_ms) {
-            s_entries[i].flags = PEER_STATUS_DEAD;
-            anyChanged = true;
-            SqLog.printf("[ptable] Peer slot %d DEAD (stale %lu ms)\n",
-                i, now - s_entries[i].last_seen_ms);
-        }
+    writeBegin();
+    while (s_heapSize > 0 && (int32_t)(now - s_deadline[s_heap[0]]) >= 0) {
+        uint8_t i = s_heap[0];
+        heapRemove(i);
+        if (i == 0 || i >= s_count || (s_entries[i].flags & PEER_STATUS_DEAD))
+            continue;   // self, recycled, or already marked (mesh event)
+        s_entries[i].flags = PEER_STATUS_DEAD;
+        markSyncDirty(i);
+        anyChanged = true;
+        SqLog.printf("[ptable] Peer slot %d DEAD (silent %lu ms)\n",
+            i, now - s_entries[i].last_seen_ms);
     }
+    armLivenessTimer();
+    writeEnd();
 
     if (anyChanged) {
         broadcastSync();
@@ -174,13 +529,65 @@ void PeerTable::checkReelection() {
     }
 }
 
-PeerEntry* PeerTable::getEntry(const uint8_t* mac) {
+uint8_t PeerTable::generation(uint8_t idx) {
+    return (idx < MESH_MAX_NODES) ? s_gen[idx] : 0;
+}
+
+bool PeerTable::isCurrent(uint8_t idx, uint8_t gen) {
+    return idx < s_count && s_gen[idx] == gen;
+}
+
+void PeerTable::markDead(const uint8_t* mac) {
+    writeBegin();
     int8_t idx = findByMac(mac);
-    return (idx >= 0) ? &s_entries[idx] : nullptr;
+    if (idx > 0) {
+        s_entries[idx].flags = PEER_STATUS_DEAD;
+        markSyncDirty(idx);
+    }
+    writeEnd();
 }
 
-PeerEntry* PeerTable::getEntryByIndex(uint8_t idx) {
-    return (idx < s_count) ? &s_entries[idx] : nullptr;
+// --- Snapshots (seqlock readers) ---
+
+uint32_t PeerTable::version() {
+    return s_seq.value();
+}
+
+bool PeerTable::readEntry(uint8_t idx, PeerEntry* out) {
+    for (;;) {
+        uint32_t seq = readBegin();
+        bool ok = idx < s_count;
+        if (ok) memcpy(out, &s_entries[idx], sizeof(PeerEntry));
+        if (!readRetry(seq)) return ok;
+    }
+}
+
+bool PeerTable::readEntry(const uint8_t* mac, PeerEntry* out) {
+    for (;;) {
+        uint32_t seq = readBegin();
+        int8_t idx = findByMac(mac);
+        if (idx >= 0) memcpy(out, &s_entries[idx], sizeof(PeerEntry));
+        if (!readRetry(seq)) return idx >= 0;
+    }
+}
+
+void PeerTable::snapshot(PeerSnapshot* out) {
+    for (;;) {
+        uint32_t seq = readBegin();
+        uint8_t n = s_count;
+        if (n > MESH_MAX_NODES) n = MESH_MAX_NODES;
+        memcpy(out->entries, s_entries, n * sizeof(PeerEntry));
+        for (uint8_t i = 0; i < n; i++) {
+            out->pos[i][0] = s_posX[i];
+            out->pos[i][1] = s_posY[i];
+            out->pos[i][2] = s_posZ[i];
+            out->confidence[i] = s_confidence[i];
+        }
+        if (readRetry(seq)) continue;
+        out->count = n;
+        out->version = seq;
+        return;
+    }
 }
 
 int8_t PeerTable::getIndex(const uint8_t* mac) {
@@ -200,25 +607,111 @@ uint8_t PeerTable::alivePeerCount() {
     return alive;
 }
 
-void PeerTable::setDistance(uint8_t idxA, uint8_t idxB, float distance_cm) {
-    if (idxA < s_count && idxB < s_count) {
-        s_entries[idxA].distances[idxB] = distance_cm;
-        s_entries[idxB].distances[idxA] = distance_cm;
+void PeerTable::setDistance(uint8_t idxA, uint8_t idxB, float distance_cm, uint8_t quality) {
+    ownerLock();
+    if (idxA < s_count && idxB < s_count && idxA != idxB) {
+        uint16_t e = edgeIndex(idxA, idxB);
+        PeerEdge* edge = &s_edges[e];
+        s_edgeDirty[e >> 3] |= (uint8_t)(1u << (e & 7));
+        if (distance_cm < 0) {
+            edge->distance_cm = PEER_DIST_UNKNOWN;
+            edge->quality = 0;
+        } else {
+            float cm = distance_cm + 0.5f;
+            edge->distance_cm = (cm >= PEER_DIST_MAX_CM) ? PEER_DIST_MAX_CM : (uint16_t)cm;
+            edge->quality = quality;
+        }
     }
+    ownerUnlock();
 }
 
 float PeerTable::getDistance(uint8_t idxA, uint8_t idxB) {
-    if (idxA < s_count && idxB < s_count)
-        return s_entries[idxA].distances[idxB];
-    return -1.0f;
+    if (idxA == idxB) return idxA < s_count ? 0.0f : -1.0f;
+    // Seqlock read: a slot recycled mid-read wipes its edges
+    for (;;) {
+        uint32_t seq = readBegin();
+        uint16_t cm = PEER_DIST_UNKNOWN;
+        if (idxA < s_count && idxB < s_count) cm = s_edges[edgeIndex(idxA, idxB)].distance_cm;
+        if (readRetry(seq)) continue;
+        return cm != PEER_DIST_UNKNOWN ? (float)cm : -1.0f;
+    }
+}
+
+PeerEdge PeerTable::getEdge(uint16_t e) {
+    if (e < PEER_EDGE_COUNT) return s_edges[e];
+    return PeerEdge{ PEER_DIST_UNKNOWN, 0 };
+}
+
+uint16_t PeerTable::takeDirtyEdges(uint16_t* out, uint16_t max) {
+    ownerLock();
+    uint16_t n = 0;
+    for (uint16_t b = 0; b < sizeof(s_edgeDirty) && n < max; b++) {
+        if (!s_edgeDirty[b]) continue;
+        for (uint8_t bit = 0; bit < 8 && n < max; bit++) {
+            if (!(s_edgeDirty[b] & (1u << bit))) continue;
+            s_edgeDirty[b] &= (uint8_t)~(1u << bit);
+            out[n++] = (uint16_t)(b * 8 + bit);
+        }
+    }
+    ownerUnlock();
+    return n;
+}
+
+void PeerTable::markAllEdgesDirty() {
+    ownerLock();
+    memset(s_edgeDirty, 0, sizeof(s_edgeDirty));
+    for (uint16_t e = 0; e < PEER_EDGE_COUNT; e++) {
+        if (s_edges[e].distance_cm != PEER_DIST_UNKNOWN)
+            s_edgeDirty[e >> 3] |= (uint8_t)(1u << (e & 7));
+    }
+    ownerUnlock();
+}
+
+void PeerTable::markEdgesDirty(const uint16_t* edges, uint16_t n) {
+    ownerLock();
+    for (uint16_t i = 0; i < n; i++) {
+        uint16_t e = edges[i];
+        if (e < PEER_EDGE_COUNT) s_edgeDirty[e >> 3] |= (uint8_t)(1u << (e & 7));
+    }
+    ownerUnlock();
+}
+
+uint8_t PeerTable::getDistanceQuality(uint8_t idxA, uint8_t idxB) {
+    if (idxA < s_count && idxB < s_count && idxA != idxB)
+        return s_edges[edgeIndex(idxA, idxB)].quality;
+    return 0;
 }
 
 void PeerTable::setPosition(uint8_t idx, float x, float y, float z, float confidence) {
+    writeBegin();
     if (idx < s_count) {
-        s_entries[idx].position[0] = x;
-        s_entries[idx].position[1] = y;
-        s_entries[idx].position[2] = z;
-        s_entries[idx].confidence = confidence;
+        s_posX[idx] = x;
+        s_posY[idx] = y;
+        s_posZ[idx] = z;
+        s_confidence[idx] = confidence;
+    }
+    writeEnd();
+}
+
+void PeerTable::getPosition(uint8_t idx, float out[3]) {
+    for (;;) {
+        uint32_t seq = readBegin();
+        if (idx < s_count) {
+            out[0] = s_posX[idx];
+            out[1] = s_posY[idx];
+            out[2] = s_posZ[idx];
+        } else {
+            out[0] = out[1] = out[2] = 0.0f;
+        }
+        if (!readRetry(seq)) return;
+    }
+}
+
+float PeerTable::getConfidence(uint8_t idx) {
+    for (;;) {
+        uint32_t seq = readBegin();
+        float c = (idx < s_count) ? s_confidence[idx] : 0.0f;
+        if (!readRetry(seq)) return c;
     }
 }
 
@@ -234,9 +727,9 @@ uint8_t PeerTable::getDimension() {
 void PeerTable::seedFromShadow(const PeerSyncEntry* entries, uint8_t count) {
     // PeerTable::init() was already called by Gateway::begin() and created slot 0 = self.
     // Now populate remaining slots from the shadow data (skipping our own MAC).
-    uint8_t own_mac[6];
-    esp_read_mac(own_mac, ESP_MAC_WIFI_STA);
+    const uint8_t* own_mac = MeshConductor::staMac();
 
+    writeBegin();
     for (uint8_t i = 0; i < count && s_count < MESH_MAX_NODES; i++) {
         if (memcmp(entries[i].mac, own_mac, 6) == 0) continue;  // skip self
         if (entries[i].flags & PEER_STATUS_DEAD) continue;       // skip dead
@@ -245,59 +738,143 @@ void PeerTable::seedFromShadow(const PeerSyncEntry* entries, uint8_t count) {
         if (idx >= 0) continue;  // already present
 
         idx = s_count++;
-        clearEntry(&s_entries[idx]);
+        clearEntry(idx);
         memcpy(s_entries[idx].mac, entries[i].mac, 6);
+        macIndexInsert(idx);
         memcpy(s_entries[idx].softap_mac, entries[i].softap_mac, 6);
         s_entries[idx].battery_mv = entries[i].battery_mv;
         s_entries[idx].last_seen_ms = millis();
         s_entries[idx].flags = PEER_STATUS_ALIVE;
+        // No heartbeat yet: give it one idle-period deadline to check in
+        heapSet(idx, s_entries[idx].last_seen_ms
+                     + (uint32_t)NvsConfigManager::heartbeatInterval_s
+                     * (uint32_t)NvsConfigManager::heartbeatStaleMultiplier * 1000u);
 
         SqLog.printf("[ptable] Seeded slot %d from shadow: %02X:%02X:%02X:%02X:%02X:%02X\n",
             idx, entries[i].mac[0], entries[i].mac[1], entries[i].mac[2],
             entries[i].mac[3], entries[i].mac[4], entries[i].mac[5]);
     }
 
+    armLivenessTimer();
+    writeEnd();
     SqLog.printf("[ptable] Seeded %u total entries from shadow\n", s_count);
     broadcastSync();
 }
 
-// --- Sync broadcast ---
-
-static uint32_t computeSyncHash() {
-    uint32_t h = (uint32_t)s_count;
-    for (uint8_t i = 0; i < s_count; i++) {
-        h ^= ((uint32_t)s_entries[i].flags << (i & 0x1F));
+int8_t PeerTable::seedCached(const uint8_t* mac, const uint8_t* softap_mac) {
+    bool isNew;
+    writeBegin();
+    int8_t idx = slotFor(mac, &isNew);
+    if (idx > 0 && isNew) {
+        memcpy(s_entries[idx].softap_mac, softap_mac, 6);
+        s_entries[idx].last_seen_ms = millis();   // recycle grace runs from the load
+        s_entries[idx].flags = PEER_STATUS_DEAD;
     }
-    return h;
+    writeEnd();
+    return idx;
 }
 
-void PeerTable::broadcastSync() {
-    uint32_t hash = computeSyncHash();
-    if (hash == s_lastBroadcastHash) return;
-    s_lastBroadcastHash = hash;
+// --- Sync broadcast ---
+//
+// A FULL sync (MACs + short ID bindings) goes out whenever membership
+// changes or a peer rejoins; otherwise only slots whose battery or flags
+// changed since the last sync are sent as 4-byte deltas. Every broadcast
+// bumps the table epoch: a receiver whose epoch is not the one just before
+// a delta has missed something and asks for a FULL (sendFullSync).
+
+// Shared frame buffer (static: too large for the timer task stack), guarded by s_syncMutex
+static uint8_t s_syncBuf[sizeof(PeerSyncMsg) + MESH_MAX_NODES * sizeof(PeerSyncEntry)];
+
+static void syncLock() {
+    if (!s_syncMutex) s_syncMutex = xSemaphoreCreateMutex();
+    xSemaphoreTake(s_syncMutex, portMAX_DELAY);
+}
 
-    // Build PeerSyncMsg + entries into a stack buffer
-    uint8_t buf[2 + MESH_MAX_NODES * sizeof(PeerSyncEntry)];
-    PeerSyncMsg* msg = (PeerSyncMsg*)buf;
+// Caller holds s_syncMutex and the owner lock
+static uint16_t buildFullSync() {
+    PeerSyncMsg* msg = (PeerSyncMsg*)s_syncBuf;
     msg->type = MSG_TYPE_PEER_SYNC;
-    msg->count = s_count;
-
-    PeerSyncEntry* entries = (PeerSyncEntry*)(buf + sizeof(PeerSyncMsg));
+    msg->version = MESH_WIRE_VERSION;
+    msg->sync_flags = SYNC_FLAG_FULL;
+    msg->epoch = s_syncEpoch;
+    PeerSyncEntry* entries = (PeerSyncEntry*)(s_syncBuf + sizeof(PeerSyncMsg));
     for (uint8_t i = 0; i < s_count; i++) {
         memcpy(entries[i].mac, s_entries[i].mac, 6);
         memcpy(entries[i].softap_mac, s_entries[i].softap_mac, 6);
         entries[i].battery_mv = s_entries[i].battery_mv;
         entries[i].flags = s_entries[i].flags;
     }
+    msg->count = s_count;
+    return (uint16_t)(sizeof(PeerSyncMsg) + s_count * sizeof(PeerSyncEntry));
+}
+
+void PeerTable::broadcastSync() {
+    // One sync at a time (shared buffer); the table itself is only locked
+    // while the frame is built, never across the mesh send
+    syncLock();
+    ownerLock();
+    bool full = s_syncFullPending || s_count != s_syncSentCount;
+    PeerSyncMsg* msg = (PeerSyncMsg*)s_syncBuf;
+    uint8_t n = 0;
+    uint16_t totalLen;
+
+    if (full) {
+        s_bindEpoch = ++s_syncEpoch;
+        totalLen = buildFullSync();
+        n = msg->count;
+    } else {
+        PeerSyncDelta* deltas = (PeerSyncDelta*)(s_syncBuf + sizeof(PeerSyncMsg));
+        for (uint8_t i = 0; i < s_count; i++) {
+            if (!(s_syncDirty[i >> 3] & (1u << (i & 7)))) continue;
+            deltas[n].short_id = i;
+            deltas[n].battery_mv = s_entries[i].battery_mv;
+            deltas[n].flags = s_entries[i].flags;
+            n++;
+        }
+        if (n == 0) {   // nothing changed since the last sync
+            ownerUnlock();
+            xSemaphoreGive(s_syncMutex);
+            return;
+        }
+        msg->type = MSG_TYPE_PEER_SYNC;
+        msg->version = MESH_WIRE_VERSION;
+        msg->sync_flags = 0;
+        msg->epoch = ++s_syncEpoch;
+        msg->count = n;
+        totalLen = (uint16_t)(sizeof(PeerSyncMsg) + n * sizeof(PeerSyncDelta));
+    }
 
-    uint16_t totalLen = (uint16_t)(sizeof(PeerSyncMsg) + s_count * sizeof(PeerSyncEntry));
-    MeshConductor::broadcastToAll(buf, totalLen);
-    SqLog.printf("[ptable] Broadcast peer sync (%u entries)\n", s_count);
+    memset(s_syncDirty, 0, sizeof(s_syncDirty));
+    s_syncSentCount = s_count;
+    s_syncFullPending = false;
+    uint16_t epoch = s_syncEpoch;
+
+    ownerUnlock();
+
+    MeshConductor::broadcastToAll(s_syncBuf, totalLen);
+    xSemaphoreGive(s_syncMutex);
+    SqLog.printf("[ptable] Broadcast peer sync (%s, epoch %u, %u entries, %u B)\n",
+        full ? "full" : "delta", epoch, n, totalLen);
+}
+
+void PeerTable::sendFullSync(const uint8_t* to) {
+    // Current contents at the current epoch: anything newer than the last
+    // broadcast is still dirty and rides in the next delta as well
+    syncLock();
+    ownerLock();
+    uint16_t totalLen = buildFullSync();
+    uint8_t n = ((PeerSyncMsg*)s_syncBuf)->count;
+    uint16_t epoch = s_syncEpoch;
+    ownerUnlock();
+
+    MeshConductor::sendToNode(to, s_syncBuf, totalLen);
+    xSemaphoreGive(s_syncMutex);
+    SqLog.printf("[ptable] Full peer sync to %02X:%02X:%02X:%02X:%02X:%02X (epoch %u, %u entries)\n",
+        to[0], to[1], to[2], to[3], to[4], to[5], epoch, n);
 }
 
 void PeerTable::print() {
-    uint8_t own_mac[6];
-    esp_read_mac(own_mac, ESP_MAC_WIFI_STA);
+    const uint8_t* own_mac = MeshConductor::staMac();
 
     Serial.println("=== Peer Table ===");
     Serial.printf("Entries: %u, Alive: %u, Dimension: %uD\n",
@@ -314,7 +891,91 @@ void PeerTable::print() {
                              isSelf           ? " <-- this" : "";
         Serial.printf("  [%u] %02X:%02X:%02X:%02X:%02X:%02X  bat=%umV  %s  pos=(%6.0f,%6.0f,%6.0f) conf=%.2f%s\n",
             i, e->mac[0], e->mac[1], e->mac[2], e->mac[3], e->mac[4], e->mac[5],
-            e->battery_mv, status, e->position[0], e->position[1], e->position[2],
-            e->confidence, suffix);
+            e->battery_mv, status, s_posX[i], s_posY[i], s_posZ[i],
+            s_confidence[i], suffix);
     }
 }
+
+// `peers bench`: MAC lookup and heartbeat-update cost on a private n-slot
+// table, hash index vs the linear scan it replaced. Nothing live is
+// touched: updates bracket their writes with a private SeqLock, so the
+// seqlock cost is in the figure but the live version never moves and no
+// reader or writer of the real table is held up.
+static int8_t benchScan(const PeerEntry* entries, uint8_t count, const uint8_t* mac) {
+    for (uint8_t i = 0; i < count; i++)
+        if (memcmp(entries[i].mac, mac, 6) == 0) return (int8_t)i;
+    return -1;
+}
+
+static void benchRandomMac(uint8_t* mac, const PeerEntry* entries, uint8_t count) {
+    do {
+        uint32_t r = esp_random();
+        mac[0] = 0x54; mac[1] = 0x32; mac[2] = 0x04;   // Espressif OUI, as in a real flotilla
+        mac[3] = (uint8_t)(r >> 16); mac[4] = (uint8_t)(r >> 8); mac[5] = (uint8_t)r;
+    } while (benchScan(entries, count, mac) >= 0);
+}
+
+void PeerTable::bench(uint8_t n, uint32_t iters) {
+    if (n < 2 || n > MESH_MAX_NODES) n = MESH_MAX_NODES;
+    if (iters == 0) iters = 1000;
+
+    typedef MacIndex<MESH_MAX_NODES> Index;
+    PeerEntry* entries = (PeerEntry*)calloc(n, sizeof(PeerEntry));
+    Index*     index   = new (std::nothrow) Index();
+    uint8_t (*known)[6]   = (uint8_t (*)[6])malloc((size_t)n * 6);
+    uint8_t (*unknown)[6] = (uint8_t (*)[6])malloc((size_t)n * 6);
+    if (!entries || !index || !known || !unknown) {
+        Serial.println("peers bench: out of memory");
+        free(entries); delete index; free(known); free(unknown);
+        return;
+    }
+    for (uint8_t i = 0; i < n; i++) {
+        benchRandomMac(entries[i].mac, entries, i);
+        index->add(entries, i);
+        memcpy(known[i], entries[i].mac, 6);   // lookups key on frame buffers, not the slot
+    }
+    for (uint8_t i = 0; i < n; i++)
+        benchRandomMac(unknown[i], entries, n);
+
+    uint32_t ops = iters * n;
+    volatile int32_t sink = 0;
+    SeqLock seq;
+    uint32_t us[2][3];   // [hash, scan][hit, miss, update]
+    for (uint8_t scan = 0; scan < 2; scan++) {
+        uint32_t t0 = micros();
+        for (uint32_t k = 0; k < iters; k++)
+            for (uint8_t i = 0; i < n; i++)
+                sink += scan ? benchScan(entries, n, known[i]) : index->find(entries, n, known[i]);
+        us[scan][0] = micros() - t0;
+
+        t0 = micros();
+        for (uint32_t k = 0; k < iters; k++)
+            for (uint8_t i = 0; i < n; i++)
+                sink += scan ? benchScan(entries, n, unknown[i]) : index->find(entries, n, unknown[i]);
+        us[scan][1] = micros() - t0;
+
+        t0 = micros();
+        for (uint32_t k = 0; k < iters; k++) {
+            for (uint8_t i = 0; i < n; i++) {
+                seq.writeBegin();
+                int16_t idx = scan ? benchScan(entries, n, known[i]) : index->find(entries, n, known[i]);
+                if (idx >= 0) {
+                    entries[idx].battery_mv = (uint16_t)(3700 + (k & 0xFF));
+                    entries[idx].last_seen_ms = millis();
+                    entries[idx].flags = PEER_STATUS_ALIVE;
+                }
+                seq.writeEnd();
+            }
+        }
+        us[scan][2] = micros() - t0;
+    }
+    (void)sink;
+
+    Serial.printf("peers bench: %u peers, %lu ops per column (ns/op)\n", n, (unsigned long)ops);
+    Serial.printf("           %10s %10s %10s\n", "hit", "miss", "update");
+    for (uint8_t scan = 0; scan < 2; scan++)
+        Serial.printf("  %-8s %10.0f %10.0f %10.0f\n", scan ? "scan" : "hash",
+            1000.0f * us[scan][0] / ops, 1000.0f * us[scan][1] / ops, 1000.0f * us[scan][2] / ops);
+
+    free(entries); delete index; free(known); free(unknown);
+}
@@ -1,5 +1,6 @@
 #include "position_solver.h"
 #include "peer_table.h"
+#include "mesh_footprint.h"
 #include "nvs_config.h"
 #include "bsp.hpp"
 #include "sq_log.h"
@@ -23,26 +24,49 @@ static KalmanState s_kalman[MESH_MAX_NODES];
 // Simplified classical MDS for embedded use (no full eigendecomposition library).
 // Uses power iteration to extract top eigenvectors from the double-centered
 // squared-distance matrix.
+//
+// Squared distances are read straight from the PeerTable edge store, so the
+// only N×N state is B, kept as a packed symmetric matrix (upper triangle
+// including the diagonal): N(N+1)/2 floats instead of two full N×N arrays.
 
-// Squared distance matrix (only upper triangle, symmetric)
-static float s_D2[MESH_MAX_NODES][MESH_MAX_NODES];
+#define SOLVER_B_SIZE  ((MESH_MAX_NODES * (MESH_MAX_NODES + 1)) / 2)
 
-// Double-centered matrix B
-static float s_B[MESH_MAX_NODES][MESH_MAX_NODES];
+// Double-centered matrix B (packed symmetric)
+static float s_B[SOLVER_B_SIZE];
 
-// Eigenvectors (columns) and eigenvalues
-static float s_eigvec[MESH_MAX_NODES][3];  // up to 3 dimensions
-static float s_eigval[3];
+// Eigenvectors (one row per dimension) and per-node scratch
+static float s_eigvec[3][MESH_MAX_NODES];
+static float s_rowMean[MESH_MAX_NODES];
+static float s_coords[3][MESH_MAX_NODES];
 
-// Temp vectors for power iteration
+// Temp vector for power iteration
 static float s_tempVec[MESH_MAX_NODES];
-static float s_tempVec2[MESH_MAX_NODES];
 
-static void matVecMul(const float B[][MESH_MAX_NODES], const float* v, float* out, int n) {
+static_assert(sizeof(s_kalman) + sizeof(s_B) + sizeof(s_eigvec) + sizeof(s_rowMean)
+              + sizeof(s_coords) + sizeof(s_tempVec) == FOOTPRINT_SOLVER,
+              "mesh_footprint.h: solver state");
+
+static inline int symIndex(int i, int j) {
+    if (i > j) { int t = i; i = j; j = t; }
+    return i * (2 * MESH_MAX_NODES - i + 1) / 2 + (j - i);
+}
+
+// Squared distance with missing edges imputed to `fill`
+static inline float dist2(uint8_t i, uint8_t j, float fill) {
+    if (i == j) return 0.0f;
+    float d = PeerTable::getDistance(i, j);
+    return (d >= 0) ? d * d : fill;
+}
+
+static void matVecMul(const float* B, const float* v, float* out, int n) {
+    for (int i = 0; i < n; i++) out[i] = 0;
     for (int i = 0; i < n; i++) {
-        out[i] = 0;
-        for (int j = 0; j < n; j++) {
-            out[i] += B[i][j] * v[j];
+        const float* row = &B[symIndex(i, i)];
+        out[i] += row[0] * v[i];
+        for (int j = i + 1; j < n; j++) {
+            float b = row[j - i];
+            out[i] += b * v[j];
+            out[j] += b * v[i];
         }
     }
 }
@@ -53,15 +77,9 @@ static float vecNorm(const float* v, int n) {
     return sqrtf(sum);
 }
 
-static float vecDot(const float* a, const float* b, int n) {
-    float sum = 0;
-    for (int i = 0; i < n; i++) sum += a[i] * b[i];
-    return sum;
-}
-
 // Power iteration to find top eigenvector of symmetric matrix B (n×n).
 // Returns eigenvalue. Eigenvector stored in out[].
-static float powerIteration(float B[][MESH_MAX_NODES], int n, float* out, int maxIter = 100) {
+static float powerIteration(const float* B, int n, float* out, int maxIter = 100) {
     // Initialize with random-ish vector
     for (int i = 0; i < n; i++) out[i] = 1.0f + 0.1f * i;
 
@@ -77,10 +95,11 @@ static float powerIteration(float B[][MESH_MAX_NODES], int n, float* out, int ma
 }
 
 // Deflate: B = B - eigenvalue * v * v^T
-static void deflate(float B[][MESH_MAX_NODES], int n, float eigenvalue, const float* v) {
+static void deflate(float* B, int n, float eigenvalue, const float* v) {
     for (int i = 0; i < n; i++) {
-        for (int j = 0; j < n; j++) {
-            B[i][j] -= eigenvalue * v[i] * v[j];
+        float* row = &B[symIndex(i, i)];
+        for (int j = i; j < n; j++) {
+            row[j - i] -= eigenvalue * v[i] * v[j];
         }
     }
 }
@@ -97,7 +116,9 @@ void PositionSolver::init() {
         s_kalman[i].P[1] = 1000.0f;
         s_kalman[i].P[2] = 1000.0f;
     }
-    SqLog.println("[solver] Initialized");
+    SqLog.printf("[solver] Initialized (%u slots, %u B working set)\n", MESH_MAX_NODES,
+        (unsigned)(sizeof(s_kalman) + sizeof(s_B) + sizeof(s_eigvec) + sizeof(s_rowMean)
+                 + sizeof(s_coords) + sizeof(s_tempVec)));
 }
 
 void PositionSolver::solve() {
@@ -123,20 +144,15 @@ void PositionSolver::solve() {
         return;
     }
 
-    // Build squared distance matrix
+    // Count measured pairs and average squared distance (for imputation)
     int validPairs = 0;
+    float avgD2 = 0;
     for (uint8_t i = 0; i < n; i++) {
-        s_D2[i][i] = 0;
         for (uint8_t j = i + 1; j < n; j++) {
             float d = PeerTable::getDistance(i, j);
             if (d >= 0) {
-                s_D2[i][j] = d * d;
-                s_D2[j][i] = d * d;
+                avgD2 += d * d;
                 validPairs++;
-            } else {
-                // Missing distance — use large value as placeholder
-                s_D2[i][j] = -1;
-                s_D2[j][i] = -1;
             }
         }
     }
@@ -148,154 +164,68 @@ void PositionSolver::solve() {
     }
 
     // Fill missing distances with average of known distances (simple imputation)
-    float avgD2 = 0;
-    int avgCount = 0;
-    for (uint8_t i = 0; i < n; i++) {
-        for (uint8_t j = i + 1; j < n; j++) {
-            if (s_D2[i][j] >= 0) {
-                avgD2 += s_D2[i][j];
-                avgCount++;
-            }
-        }
-    }
-    if (avgCount > 0) avgD2 /= avgCount;
-
-    for (uint8_t i = 0; i < n; i++) {
-        for (uint8_t j = i + 1; j < n; j++) {
-            if (s_D2[i][j] < 0) {
-                s_D2[i][j] = avgD2;
-                s_D2[j][i] = avgD2;
-            }
-        }
-    }
+    avgD2 /= validPairs;
 
     // Double centering: B = -0.5 * J * D² * J, where J = I - (1/n)*11^T
-    // Row means, column means, grand mean of D²
-    float rowMean[MESH_MAX_NODES];
+    // Row means, column means, grand mean of D² (D² is symmetric)
     float grandMean = 0;
     for (uint8_t i = 0; i < n; i++) {
-        rowMean[i] = 0;
+        s_rowMean[i] = 0;
         for (uint8_t j = 0; j < n; j++) {
-            rowMean[i] += s_D2[i][j];
+            s_rowMean[i] += dist2(i, j, avgD2);
         }
-        rowMean[i] /= n;
-        grandMean += rowMean[i];
+        s_rowMean[i] /= n;
+        grandMean += s_rowMean[i];
     }
     grandMean /= n;
 
     for (uint8_t i = 0; i < n; i++) {
-        for (uint8_t j = 0; j < n; j++) {
-            s_B[i][j] = -0.5f * (s_D2[i][j] - rowMean[i] - rowMean[j] + grandMean);
+        for (uint8_t j = i; j < n; j++) {
+            s_B[symIndex(i, j)] =
+                -0.5f * (dist2(i, j, avgD2) - s_rowMean[i] - s_rowMean[j] + grandMean);
         }
     }
 
-    // Extract top eigenvectors via power iteration
+    // Extract top eigenvectors via power iteration + deflation
     uint8_t numDim = (dim > 3) ? 3 : dim;
-    for (uint8_t d = 0; d < numDim; d++) {
-        s_eigval[d] = powerIteration(s_B, n, s_eigvec[d] /* reuse column */, 200);
-
-        // Store eigenvector as column d of per-node data
-        // (s_eigvec layout: s_eigvec[node][dim] — but powerIteration outputs s_eigvec[d] as a flat array)
-        // We need a different layout. Let me use s_tempVec2 as temp and copy.
-        // Actually, powerIteration stores into the provided float* which is s_eigvec[d] — an array of MESH_MAX_NODES.
-        // But we want s_eigvec[node][dim]. Let me just use separate storage.
-
-        // Actually the layout s_eigvec[dim][node] works fine for power iteration.
-        // We'll read it as: coordinate d for node i = s_eigvec[d][i] * sqrt(eigenvalue_d)
-
-        deflate(s_B, n, s_eigval[d], s_eigvec[d] /* temp used the flat array */);
-    }
-
-    // Hmm, the above used s_eigvec[d] as float[MESH_MAX_NODES] per dimension. Let me restructure.
-    // s_eigvec is declared as [MESH_MAX_NODES][3] but I'm using [d] as the first index
-    // where d < 3 and the second index goes up to n < MESH_MAX_NODES.
-    // This is a layout mismatch. Let me use separate storage.
-
-    // Actually s_eigvec[MESH_MAX_NODES][3] — I passed &s_eigvec[d][0]... no, that's s_eigvec[d]
-    // which is a float[3]. That's wrong — we need float[MESH_MAX_NODES] per dimension.
-
-    // Let me fix: use s_D2 rows as temp storage for eigenvectors since D2 is no longer needed.
-    // s_D2[d] is float[MESH_MAX_NODES] — perfect.
-
-    // Redo the eigenvector extraction using s_D2 rows as storage:
-
-    // Re-build B (it was deflated)
-    for (uint8_t i = 0; i < n; i++) {
-        for (uint8_t j = 0; j < n; j++) {
-            // Need original D2 back... we overwrote it. This approach is getting messy.
-            // Let me just rebuild from PeerTable distances.
-        }
-    }
-
-    // --- REDO: cleaner approach using s_D2 rows for eigenvectors ---
-    // Rebuild D2
-    for (uint8_t i = 0; i < n; i++) {
-        s_D2[i][i] = 0;
-        for (uint8_t j = i + 1; j < n; j++) {
-            float d = PeerTable::getDistance(i, j);
-            float d2 = (d >= 0) ? d * d : avgD2;
-            s_D2[i][j] = d2;
-            s_D2[j][i] = d2;
-        }
-    }
-
-    // Rebuild B
-    for (uint8_t i = 0; i < n; i++) {
-        rowMean[i] = 0;
-        for (uint8_t j = 0; j < n; j++) rowMean[i] += s_D2[i][j];
-        rowMean[i] /= n;
-    }
-    grandMean = 0;
-    for (uint8_t i = 0; i < n; i++) grandMean += rowMean[i];
-    grandMean /= n;
-    for (uint8_t i = 0; i < n; i++) {
-        for (uint8_t j = 0; j < n; j++) {
-            s_B[i][j] = -0.5f * (s_D2[i][j] - rowMean[i] - rowMean[j] + grandMean);
-        }
-    }
-
-    // Use first 3 rows of s_D2 as eigenvector storage (each row = MESH_MAX_NODES floats)
-    float* evec[3] = { s_D2[0], s_D2[1], s_D2[2] };
     float evals[3] = {0, 0, 0};
-
     for (uint8_t d = 0; d < numDim; d++) {
-        evals[d] = powerIteration(s_B, n, evec[d], 200);
-        deflate(s_B, n, evals[d], evec[d]);
+        evals[d] = powerIteration(s_B, n, s_eigvec[d], 200);
+        deflate(s_B, n, evals[d], s_eigvec[d]);
     }
 
-    // Compute coordinates: coord[node][d] = evec[d][node] * sqrt(eigenvalue[d])
-    float coords[MESH_MAX_NODES][3];
-    memset(coords, 0, sizeof(coords));
+    // Compute coordinates: coord[d][node] = evec[d][node] * sqrt(eigenvalue[d])
+    memset(s_coords, 0, sizeof(s_coords));
     for (uint8_t d = 0; d < numDim; d++) {
         float scale = (evals[d] > 0) ? sqrtf(evals[d]) : 0;
         for (uint8_t i = 0; i < n; i++) {
-            coords[i][d] = evec[d][i] * scale;
+            s_coords[d][i] = s_eigvec[d][i] * scale;
         }
     }
 
     // Anchor: gateway (node 0) at origin, first peer along +X
     // Translate so node 0 is at origin
-    float offset[3] = { coords[0][0], coords[0][1], coords[0][2] };
+    float offset[3] = { s_coords[0][0], s_coords[1][0], s_coords[2][0] };
     for (uint8_t i = 0; i < n; i++) {
         for (uint8_t d = 0; d < numDim; d++) {
-            coords[i][d] -= offset[d];
+            s_coords[d][i] -= offset[d];
         }
     }
 
     // Rotate so node 1 is along +X (if more than 1 node)
     if (n >= 2 && numDim >= 2) {
-        float dx = coords[1][0];
-        float dy = coords[1][1];
+        float dx = s_coords[0][1];
+        float dy = s_coords[1][1];
         float r = sqrtf(dx * dx + dy * dy);
         if (r > 1e-6f) {
             float cosA = dx / r;
             float sinA = dy / r;
             // Apply rotation to all nodes
             for (uint8_t i = 0; i < n; i++) {
-                float x = coords[i][0];
-                float y = coords[i][1];
-                coords[i][0] = x * cosA + y * sinA;
-                coords[i][1] = -x * sinA + y * cosA;
+                float x = s_coords[0][i];
+                float y = s_coords[1][i];
+                s_coords[0][i] = x * cosA + y * sinA;
+                s_coords[1][i] = -x * sinA + y * cosA;
             }
         }
     }
@@ -309,7 +239,7 @@ void PositionSolver::solve() {
         if (!k->initialized) {
             // First measurement — initialize directly
             for (int d = 0; d < 3; d++) {
-                k->x[d] = coords[i][d];
+                k->x[d] = s_coords[d][i];
                 k->P[d] = 100.0f;  // initial uncertainty
             }
             k->initialized = true;
@@ -324,7 +254,7 @@ void PositionSolver::solve() {
 
                 // Update
                 float K = k->P[d] / (k->P[d] + R);
-                float innovation = coords[i][d] - k->x[d];
+                float innovation = s_coords[d][i] - k->x[d];
                 k->x[d] += K * innovation;
                 k->P[d] *= (1.0f - K);
             }
@@ -344,3 +274,7 @@ void PositionSolver::reset() {
     }
     SqLog.println("[solver] Kalman state reset");
 }
+
+void PositionSolver::resetNode(uint8_t idx) {
+    if (idx < MESH_MAX_NODES) s_kalman[idx].initialized = false;
+}
@@ -58,6 +58,13 @@ void RtcMap::print() {
         mesh_map.gateway_mac[3], mesh_map.gateway_mac[4], mesh_map.gateway_mac[5]);
     Serial.printf("Channel: %u  Peers: %u  Generation: %lu\n",
         mesh_map.mesh_channel, mesh_map.peer_count, mesh_map.mesh_generation);
+    Serial.printf("Layer: %u  Parent: %02X:%02X:%02X:%02X:%02X:%02X \"%.*s\"\n",
+        mesh_map.own_layer,
+        mesh_map.parent_bssid[0], mesh_map.parent_bssid[1], mesh_map.parent_bssid[2],
+        mesh_map.parent_bssid[3], mesh_map.parent_bssid[4], mesh_map.parent_bssid[5],
+        (int)mesh_map.parent_ssid_len, (const char*)mesh_map.parent_ssid);
+    Serial.printf("Last join: cold %lu ms, warm %lu ms\n",
+        (unsigned long)mesh_map.join_cold_ms, (unsigned long)mesh_map.join_warm_ms);
 
     for (uint8_t i = 0; i < mesh_map.peer_count && i < MESH_MAX_NODES; i++) {
         const rtc_peer_entry_t& p = mesh_map.peers[i];
@@ -0,0 +1,174 @@
+#include "travel_path.h"
+#ifndef MESH_MAX_NODES
+#include "bsp.hpp"
+#endif
+#include <string.h>
+
+// TravelPath optimiser: pure functions on a cost matrix, no Arduino or
+// PeerTable dependency (test/test_native_travel_path builds it on the
+// host). build() and its cache live in travel_path_build.cpp.
+
+// --- File-scope state ---
+
+static uint32_t s_lastEvals   = 0;
+static bool     s_lastBudgetHit = false;
+
+// --- Helpers ---
+
+static inline uint32_t hop(const uint16_t* cost, uint8_t n, uint8_t a, uint8_t b) {
+    return cost[a * n + b];
+}
+
+// Cost of the link between tour positions i and j (-1 / n = no stop: open end)
+static inline int32_t link(const uint16_t* cost, uint8_t n, const uint8_t* order, int i, int j) {
+    if (i < 0 || j < 0 || i >= n || j >= n) return 0;
+    return (int32_t)hop(cost, n, order[i], order[j]);
+}
+
+static void reverse(uint8_t* order, int i, int j) {
+    while (i < j) {
+        uint8_t t = order[i];
+        order[i++] = order[j];
+        order[j--] = t;
+    }
+}
+
+// Reverse order[i..j] wherever that shortens the path. Returns true on a move.
+static bool twoOptPass(const uint16_t* cost, uint8_t n, bool loop, uint8_t* order,
+                       uint32_t& evals, uint32_t budget) {
+    for (int i = 0; i < n - 1; i++) {
+        for (int j = i + 1; j < n; j++) {
+            if (evals >= budget) return false;
+            evals++;
+            int prev = (i > 0) ? i - 1 : (loop ? n - 1 : -1);
+            int next = (j < n - 1) ? j + 1 : (loop ? 0 : -1);
+            if (loop && prev == j) continue;   // whole tour: no change
+            int32_t delta = link(cost, n, order, prev, j) + link(cost, n, order, i, next)
+                          - link(cost, n, order, prev, i) - link(cost, n, order, j, next);
+            if (delta < 0) {
+                reverse(order, i, j);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// Move a run of 1-3 stops to the cheapest other gap, either way round.
+// Returns true on a move.
+static bool orOptPass(const uint16_t* cost, uint8_t n, bool loop, uint8_t* order,
+                      uint32_t& evals, uint32_t budget) {
+    uint8_t rest[MESH_MAX_NODES];
+    for (uint8_t len = 1; len <= 3 && len < n - 1; len++) {
+        for (uint8_t i = 0; i + len <= n; i++) {
+            uint8_t s0 = order[i], s1 = order[i + len - 1];
+            int prev = (i > 0) ? i - 1 : (loop ? n - 1 : -1);
+            int next = (i + len < n) ? i + len : (loop ? 0 : -1);
+            if (loop && prev >= i && prev < i + len) continue;
+            int32_t gain = link(cost, n, order, prev, i) + link(cost, n, order, i + len - 1, next);
+            if (prev >= 0 && next >= 0) gain -= link(cost, n, order, prev, next);
+
+            // Tour without the run
+            uint8_t m = 0;
+            for (uint8_t k = 0; k < n; k++)
+                if (k < i || k >= i + len) rest[m++] = order[k];
+
+            // Gap g sits before rest[g]; an open path also has the gap after the end
+            uint8_t gaps = loop ? m : m + 1;
+            for (uint8_t g = 0; g < gaps; g++) {
+                if (evals >= budget) return false;
+                evals++;
+                if (g == i) continue;   // where the run came from
+                int u = (g > 0) ? rest[g - 1] : (loop ? rest[m - 1] : -1);
+                int v = (g < m) ? rest[g] : -1;
+                int32_t base = (u >= 0 && v >= 0) ? (int32_t)hop(cost, n, u, v) : 0;
+                int32_t fwd = (u >= 0 ? (int32_t)hop(cost, n, u, s0) : 0)
+                            + (v >= 0 ? (int32_t)hop(cost, n, s1, v) : 0) - base;
+                int32_t rev = (u >= 0 ? (int32_t)hop(cost, n, u, s1) : 0)
+                            + (v >= 0 ? (int32_t)hop(cost, n, s0, v) : 0) - base;
+                bool flip = rev < fwd;
+                if ((flip ? rev : fwd) - gain >= 0) continue;
+
+                uint8_t run[3];
+                for (uint8_t k = 0; k < len; k++)
+                    run[k] = flip ? order[i + len - 1 - k] : order[i + k];
+                uint8_t w = 0;
+                for (uint8_t k = 0; k < g; k++) order[w++] = rest[k];
+                for (uint8_t k = 0; k < len; k++) order[w++] = run[k];
+                for (uint8_t k = g; k < m; k++) order[w++] = rest[k];
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// --- Public API ---
+
+uint32_t TravelPath::length(const uint16_t* cost, uint8_t n, const uint8_t* order, bool loop) {
+    uint32_t total = 0;
+    for (uint8_t i = 1; i < n; i++) total += hop(cost, n, order[i - 1], order[i]);
+    if (loop && n > 2) total += hop(cost, n, order[n - 1], order[0]);
+    return total;
+}
+
+uint32_t TravelPath::greedy(const uint16_t* cost, uint8_t n, uint8_t start, bool loop,
+                            uint8_t* order) {
+    if (n == 0) return 0;
+    bool visited[MESH_MAX_NODES] = {};
+    uint8_t cur = start;
+    order[0] = cur;
+    visited[cur] = true;
+    for (uint8_t k = 1; k < n; k++) {
+        uint8_t best = 0;
+        uint32_t bestCost = UINT32_MAX;
+        for (uint8_t j = 0; j < n; j++) {
+            if (visited[j]) continue;
+            uint32_t c = hop(cost, n, cur, j);
+            if (c < bestCost) { bestCost = c; best = j; }
+        }
+        order[k] = cur = best;
+        visited[best] = true;
+    }
+    return length(cost, n, order, loop);
+}
+
+uint32_t TravelPath::optimise(const uint16_t* cost, uint8_t n, bool loop, uint8_t* order,
+                              uint32_t budget) {
+    s_lastEvals = 0;
+    s_lastBudgetHit = false;
+    for (uint8_t i = 0; i < n; i++) order[i] = i;
+    if (n < 3) return length(cost, n, order, loop);
+
+    // Seed: the best nearest-neighbour walk over all starts (a loop has no
+    // start, but the walk still depends on it)
+    uint8_t trial[MESH_MAX_NODES];
+    uint32_t best = UINT32_MAX;
+    for (uint8_t s = 0; s < n; s++) {
+        uint32_t len = greedy(cost, n, s, loop, trial);
+        if (len < best) {
+            best = len;
+            memcpy(order, trial, n);
+        }
+    }
+
+    // Refine until neither move gains anything (the budget bounds this
+    // part only: seeding is a fixed n³)
+    uint32_t evals = 0;
+    for (;;) {
+        bool moved = twoOptPass(cost, n, loop, order, evals, budget);
+        if (!moved) moved = orOptPass(cost, n, loop, order, evals, budget);
+        if (evals >= budget) { s_lastBudgetHit = true; break; }
+        if (!moved) break;
+    }
+    s_lastEvals = evals;
+    return length(cost, n, order, loop);
+}
+
+uint32_t TravelPath::lastEvaluations() {
+    return s_lastEvals;
+}
+
+bool TravelPath::lastHitBudget() {
+    return s_lastBudgetHit;
+}
@@ -0,0 +1,89 @@
+#include "travel_path.h"
+#include "peer_table.h"
+#include "mesh_footprint.h"
+#include "bsp.hpp"
+#include <math.h>
+#include <string.h>
+
+// TravelPath::build(): hop costs from the live geometry, and the cache.
+// The optimiser itself (travel_path.cpp) is pure and builds on the host.
+
+// --- File-scope state ---
+
+// Hop costs for build(), n×n row-major (8 KB at 64 nodes: static, not stack)
+static uint16_t s_cost[MESH_MAX_NODES * MESH_MAX_NODES];
+static_assert(sizeof(s_cost) == FOOTPRINT_TRAVEL_COST, "mesh_footprint.h: hop costs");
+
+// Cached result of the last build()
+static uint32_t s_cacheKey   = 0;
+static bool     s_cacheValid = false;
+static uint8_t  s_cacheLen   = 0;
+static uint8_t  s_cachePath[MESH_MAX_NODES];
+static uint32_t s_cacheLength = 0;   // cm
+
+// --- Helpers ---
+
+static uint16_t metricCost(const PeerSnapshot& view, uint8_t a, uint8_t b, PathMetric metric) {
+    float measured = PeerTable::getDistance(a, b);
+    float solved = -1.0f;
+    if (view.confidence[a] > 0.0f && view.confidence[b] > 0.0f) {
+        float dx = view.pos[a][0] - view.pos[b][0];
+        float dy = view.pos[a][1] - view.pos[b][1];
+        float dz = view.pos[a][2] - view.pos[b][2];
+        solved = sqrtf(dx * dx + dy * dy + dz * dz);
+    }
+    float d = (metric == PATH_METRIC_POSITIONS)
+            ? (solved >= 0.0f ? solved : measured)
+            : (measured >= 0.0f ? measured : solved);
+    if (d < 0.0f) return PATH_COST_UNKNOWN;
+    return (d >= PATH_COST_UNKNOWN - 1) ? PATH_COST_UNKNOWN - 1 : (uint16_t)lroundf(d);
+}
+
+static uint32_t fnv1a(uint32_t h, const void* data, size_t len) {
+    const uint8_t* p = (const uint8_t*)data;
+    for (size_t i = 0; i < len; i++) {
+        h ^= p[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+uint8_t TravelPath::build(const PeerSnapshot& view, bool loop, PathMetric metric,
+                          uint8_t* out, bool* fresh) {
+    uint8_t nodes[MESH_MAX_NODES];
+    uint8_t n = 0;
+    for (uint8_t i = 0; i < view.count; i++)
+        if ((view.entries[i].flags & PEER_STATUS_ALIVE) && !(view.entries[i].flags & PEER_STATUS_DEAD))
+            nodes[n++] = i;
+
+    for (uint8_t a = 0; a < n; a++) {
+        s_cost[a * n + a] = 0;
+        for (uint8_t b = a + 1; b < n; b++)
+            s_cost[a * n + b] = s_cost[b * n + a] = metricCost(view, nodes[a], nodes[b], metric);
+    }
+
+    // The path depends only on who takes part and what each hop costs
+    uint32_t key = fnv1a(2166136261u, &n, 1);
+    uint8_t flags = (uint8_t)((loop ? 1 : 0) | (metric << 1));
+    key = fnv1a(key, &flags, 1);
+    key = fnv1a(key, nodes, n);
+    key = fnv1a(key, s_cost, (size_t)n * n * sizeof(uint16_t));
+
+    bool recompute = !s_cacheValid || key != s_cacheKey || s_cacheLen != n;
+    if (recompute) {
+        uint8_t order[MESH_MAX_NODES];
+        s_cacheLength = optimise(s_cost, n, loop, order, TRAVEL_PATH_BUDGET);
+        for (uint8_t k = 0; k < n; k++) s_cachePath[k] = nodes[order[k]];
+        s_cacheLen = n;
+        s_cacheKey = key;
+        s_cacheValid = true;
+    }
+    memcpy(out, s_cachePath, n);
+    if (fresh) *fresh = recompute;
+    return n;
+}
+
+uint32_t TravelPath::lastLength_cm() {
+    return s_cacheLength;
+}
+
@@ -1,6 +1,7 @@
 #include "web_server.h"
 #include "storage_manager.h"
 #include "property_value.h"
+#include "link_stats.h"
 
 #include <ESPAsyncWebServer.h>
 #include <AsyncWebSocket.h>
@@ -238,6 +239,13 @@ void SqWebServer::registerRoutes() {
         }
     });
 
+    // Per-peer mesh link telemetry (same data as the `link` CLI command)
+    s_server->on("/api/links", HTTP_GET, [](AsyncWebServerRequest* request) {
+        AsyncResponseStream* response = request->beginResponseStream("application/json");
+        LinkStats::printJson(*response);
+        request->send(response);
+    });
+
     // Catch-all: try to serve from LittleFS, else 404
     s_server->onNotFound([](AsyncWebServerRequest* request) {
         if (!StorageManager::serveFile(request, request->url().c_str())) {
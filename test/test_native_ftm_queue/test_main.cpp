@@ -0,0 +1,120 @@
+// FtmQueue host test — pio test -e native
+//
+// Built with MESH_MAX_NODES=64 (platformio.ini [env:native]): checks the
+// queue's ordering, one-entry-per-edge rule and capacity at full size, and
+// reports and bounds the RAM of every node-scaled static (mesh_footprint.h).
+
+#include <unity.h>
+#include <stdio.h>
+#include "ftm_queue.h"
+#include "mesh_footprint.h"
+
+static FtmQueue s_q;   // ~24 KB at 64 nodes: not on the stack
+
+static FtmQueueItem item(FtmPriority prio, uint8_t flags = 0) {
+    FtmQueueItem it = {};
+    it.priority = prio;
+    it.flags = flags;
+    return it;
+}
+
+void setUp() { s_q.clear(); }
+void tearDown() {}
+
+void test_pops_by_priority_then_fifo() {
+    s_q.push(10, item(FTM_PRIO_SWEEP));
+    s_q.push(11, item(FTM_PRIO_STALE));
+    s_q.push(12, item(FTM_PRIO_SWEEP));
+    s_q.push(13, item(FTM_PRIO_NEW_NODE));
+    TEST_ASSERT_EQUAL_UINT16(4, s_q.size());
+
+    const uint16_t want[] = {13, 11, 10, 12};
+    FtmQueueItem out;
+    uint16_t edge;
+    for (uint16_t e : want) {
+        TEST_ASSERT_TRUE(s_q.pop(&out, &edge));
+        TEST_ASSERT_EQUAL_UINT16(e, edge);
+    }
+    TEST_ASSERT_FALSE(s_q.pop(&out, &edge));
+    TEST_ASSERT_EQUAL_UINT16(0, s_q.size());
+}
+
+void test_one_entry_per_edge() {
+    s_q.push(7, item(FTM_PRIO_STALE));
+    TEST_ASSERT_NOT_NULL(s_q.find(7));
+    TEST_ASSERT_NULL(s_q.find(8));
+
+    // Re-pushing the edge replaces the entry and moves it to the new
+    // priority's tail instead of queuing a second copy
+    s_q.push(3, item(FTM_PRIO_NEW_NODE));
+    s_q.push(7, item(FTM_PRIO_NEW_NODE, FTM_ITEM_SWAPPED));
+    TEST_ASSERT_EQUAL_UINT16(2, s_q.size());
+
+    FtmQueueItem out;
+    uint16_t edge;
+    TEST_ASSERT_TRUE(s_q.pop(&out, &edge));
+    TEST_ASSERT_EQUAL_UINT16(3, edge);
+    TEST_ASSERT_TRUE(s_q.pop(&out, &edge));
+    TEST_ASSERT_EQUAL_UINT16(7, edge);
+    TEST_ASSERT_EQUAL_UINT8(FTM_ITEM_SWAPPED, out.flags);
+    TEST_ASSERT_FALSE(s_q.pop(&out, &edge));
+    TEST_ASSERT_NULL(s_q.find(7));
+}
+
+void test_holds_every_edge() {
+    for (uint16_t e = 0; e < FtmQueue::CAPACITY; e++)
+        TEST_ASSERT_TRUE(s_q.push(e, item((FtmPriority)(e % FTM_PRIO_COUNT))));
+    TEST_ASSERT_EQUAL_UINT16(FtmQueue::CAPACITY, s_q.size());
+    TEST_ASSERT_FALSE(s_q.push(FtmQueue::CAPACITY, item(FTM_PRIO_SWEEP)));
+
+    // Requeue everything again: still one entry per edge
+    for (uint16_t e = 0; e < FtmQueue::CAPACITY; e++)
+        s_q.push(e, item(FTM_PRIO_STALE));
+    TEST_ASSERT_EQUAL_UINT16(FtmQueue::CAPACITY, s_q.size());
+
+    FtmQueueItem out;
+    uint16_t edge;
+    uint16_t popped = 0;
+    while (s_q.pop(&out, &edge)) popped++;
+    TEST_ASSERT_EQUAL_UINT16(FtmQueue::CAPACITY, popped);
+}
+
+static void report(const char* name, size_t bytes, size_t budget) {
+    char msg[96];
+    snprintf(msg, sizeof(msg), "  %-18s %6u B (budget %u B)", name, (unsigned)bytes, (unsigned)budget);
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_LESS_OR_EQUAL(budget, bytes);
+}
+
+void test_footprint() {
+    char msg[96];
+    snprintf(msg, sizeof(msg), "MESH_MAX_NODES=%u: %u edges, FtmQueue item %u B",
+        (unsigned)MESH_MAX_NODES, (unsigned)FtmQueue::CAPACITY, (unsigned)sizeof(FtmQueueItem));
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_EQUAL_UINT16(2016, FtmQueue::CAPACITY);
+    TEST_ASSERT_LESS_OR_EQUAL(8u, sizeof(FtmQueueItem));
+
+    // Budgets sit a little above today's figures: growth shows up here
+    // before it shows up as a failed allocation on the board
+    size_t total = sizeof(FtmQueue) + FOOTPRINT_EDGE_STORE + 2 * FOOTPRINT_PEER_SNAPSHOT
+                 + FOOTPRINT_SOLVER + FOOTPRINT_EDGE_AGES + FOOTPRINT_STANDBY_REPLICA
+                 + FOOTPRINT_MERGE_BUFFERS + FOOTPRINT_TRAVEL_COST;
+    report("FtmQueue",          sizeof(FtmQueue),          25u * 1024u);
+    report("edge store",        FOOTPRINT_EDGE_STORE,      6u * 1024u);
+    report("PeerSnapshot",      FOOTPRINT_PEER_SNAPSHOT,   3u * 1024u);
+    report("solver",            FOOTPRINT_SOLVER,          12u * 1024u);
+    report("edge ages",         FOOTPRINT_EDGE_AGES,       8u * 1024u);
+    report("standby replica",   FOOTPRINT_STANDBY_REPLICA, 6u * 1024u);
+    report("merge buffers",     FOOTPRINT_MERGE_BUFFERS,   11u * 1024u);
+    report("travel-path costs", FOOTPRINT_TRAVEL_COST,     9u * 1024u);
+    report("total",             total,                     84u * 1024u);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_pops_by_priority_then_fifo);
+    RUN_TEST(test_one_entry_per_edge);
+    RUN_TEST(test_holds_every_edge);
+    RUN_TEST(test_footprint);
+    return UNITY_END();
+}
@@ -0,0 +1,114 @@
+// MAC index host test and benchmark — pio test -e native
+//
+// The PeerTable MAC index (mac_index.h) against the linear scan it
+// replaced, at 16, 64 and 128 slots. The standalone index is not bound by
+// PeerTable's 127-slot limit, so this is where larger flotillas are
+// measured. Checks lookups and backward-shift removal, and reports ns per
+// lookup for both methods (timings are reported, not asserted: host load
+// makes them noisy).
+
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include "mac_index.h"
+
+static constexpr uint32_t BENCH_ITERS = 2000;
+
+struct Entry {
+    uint8_t mac[6];
+};
+
+static uint32_t s_rng = 0x5EEC1234u;
+
+static uint32_t nextRandom() {   // xorshift32: same MACs every run
+    s_rng ^= s_rng << 13;
+    s_rng ^= s_rng >> 17;
+    s_rng ^= s_rng << 5;
+    return s_rng;
+}
+
+static int16_t scan(const Entry* entries, uint16_t count, const uint8_t* mac) {
+    for (uint16_t i = 0; i < count; i++)
+        if (memcmp(entries[i].mac, mac, 6) == 0) return (int16_t)i;
+    return -1;
+}
+
+static void randomMac(uint8_t* mac, const Entry* entries, uint16_t count) {
+    do {
+        uint32_t r = nextRandom();
+        mac[0] = 0x54; mac[1] = 0x32; mac[2] = 0x04;   // Espressif OUI, as in a real flotilla
+        mac[3] = (uint8_t)(r >> 16); mac[4] = (uint8_t)(r >> 8); mac[5] = (uint8_t)r;
+    } while (scan(entries, count, mac) >= 0);
+}
+
+static double nsPerOp(std::chrono::steady_clock::time_point t0, uint32_t ops) {
+    auto dt = std::chrono::steady_clock::now() - t0;
+    return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(dt).count() / ops;
+}
+
+template <uint16_t N>
+static void runIndex() {
+    static Entry   entries[N];
+    static uint8_t unknown[N][6];
+    static MacIndex<N> index;
+    index.clear();
+    for (uint16_t i = 0; i < N; i++) {
+        randomMac(entries[i].mac, entries, i);
+        index.add(entries, (uint8_t)i);
+    }
+    for (uint16_t i = 0; i < N; i++)
+        randomMac(unknown[i], entries, N);
+
+    // Every slot found where it is, no unknown MAC found
+    for (uint16_t i = 0; i < N; i++) {
+        TEST_ASSERT_EQUAL_INT(i, index.find(entries, N, entries[i].mac));
+        TEST_ASSERT_EQUAL_INT(-1, index.find(entries, N, unknown[i]));
+    }
+
+    // Timing: hash vs scan, hits then misses
+    volatile int32_t sink = 0;
+    uint32_t ops = BENCH_ITERS * N;
+    double ns[2][2];   // [hash, scan][hit, miss]
+    for (int s = 0; s < 2; s++) {
+        auto t0 = std::chrono::steady_clock::now();
+        for (uint32_t k = 0; k < BENCH_ITERS; k++)
+            for (uint16_t i = 0; i < N; i++)
+                sink += s ? scan(entries, N, entries[i].mac) : index.find(entries, N, entries[i].mac);
+        ns[s][0] = nsPerOp(t0, ops);
+
+        t0 = std::chrono::steady_clock::now();
+        for (uint32_t k = 0; k < BENCH_ITERS; k++)
+            for (uint16_t i = 0; i < N; i++)
+                sink += s ? scan(entries, N, unknown[i]) : index.find(entries, N, unknown[i]);
+        ns[s][1] = nsPerOp(t0, ops);
+    }
+    (void)sink;
+
+    char msg[128];
+    snprintf(msg, sizeof(msg), "%3u slots (index %u B): hash hit %6.1f miss %6.1f | scan hit %6.1f miss %6.1f ns/op",
+        (unsigned)N, (unsigned)sizeof(index), ns[0][0], ns[0][1], ns[1][0], ns[1][1]);
+    TEST_MESSAGE(msg);
+
+    // Remove every other slot: the rest must still be found (backward
+    // shift kept their chains intact), the removed ones not
+    for (uint16_t i = 0; i < N; i += 2)
+        index.remove(entries, (uint8_t)i);
+    for (uint16_t i = 0; i < N; i++)
+        TEST_ASSERT_EQUAL_INT((i & 1) ? (int)i : -1, index.find(entries, N, entries[i].mac));
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_index_16()  { runIndex<16>(); }
+void test_index_64()  { runIndex<64>(); }
+void test_index_128() { runIndex<128>(); }
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_index_16);
+    RUN_TEST(test_index_64);
+    RUN_TEST(test_index_128);
+    return UNITY_END();
+}
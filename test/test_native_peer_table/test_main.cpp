@@ -0,0 +1,167 @@
+// PeerTable seqlock stress test, host side — pio test -e native
+//
+// The same protocol PeerTable uses (seqlock.h), on a table laid out like
+// PeerTable's: one writer thread rewrites every slot as fast as it can
+// while several reader threads take single-slot reads and full snapshots.
+// Each write keeps invariants that a torn copy would break:
+//   entry:    battery_mv == 1000 + v  and every softap_mac byte == v
+//   position: x == y == z == confidence == v
+// test/test_peer_table runs the real PeerTable on the board.
+
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include "seqlock.h"
+
+static constexpr uint8_t  TEST_PEERS   = MESH_MAX_NODES;
+static constexpr uint8_t  TEST_READERS = 3;
+static constexpr uint32_t TEST_RUN_MS  = 1000;
+
+struct Entry {
+    uint8_t  mac[6];
+    uint8_t  softap_mac[6];
+    uint16_t battery_mv;
+    uint32_t last_seen_ms;
+    uint8_t  flags;
+};
+
+// Live table: written by one thread, read by the others
+static SeqLock s_seq;
+static Entry   s_entries[TEST_PEERS];
+static float   s_posX[TEST_PEERS], s_posY[TEST_PEERS], s_posZ[TEST_PEERS];
+static float   s_confidence[TEST_PEERS];
+
+struct Snapshot {
+    Entry    entries[TEST_PEERS];
+    float    pos[TEST_PEERS][3];
+    float    confidence[TEST_PEERS];
+    uint32_t version;
+};
+
+static std::atomic<bool>     s_stop{false};
+static std::atomic<uint32_t> s_torn{0};
+static std::atomic<uint32_t> s_reads{0};
+static std::atomic<uint32_t> s_snaps{0};
+static std::atomic<uint32_t> s_retries{0};
+
+static uint32_t readBegin() {
+    return s_seq.readBegin([] { std::this_thread::yield(); });
+}
+
+static bool entryConsistent(const Entry& e) {
+    uint8_t v = e.softap_mac[0];
+    for (int b = 1; b < 6; b++)
+        if (e.softap_mac[b] != v) return false;
+    return e.battery_mv == 1000 + v;
+}
+
+static void writePass(uint8_t v) {
+    for (uint8_t i = 0; i < TEST_PEERS; i++) {
+        // Entry and position in separate writes, as updateFromHeartbeat()
+        // and setPosition() do
+        s_seq.writeBegin();
+        memset(s_entries[i].softap_mac, v, 6);
+        s_entries[i].battery_mv = 1000 + v;
+        s_entries[i].last_seen_ms = v;
+        s_seq.writeEnd();
+
+        s_seq.writeBegin();
+        s_posX[i] = s_posY[i] = s_posZ[i] = v;
+        s_confidence[i] = v;
+        s_seq.writeEnd();
+    }
+}
+
+static void readEntry(uint8_t idx, Entry* out) {
+    for (;;) {
+        uint32_t seq = readBegin();
+        memcpy(out, &s_entries[idx], sizeof(Entry));
+        if (!s_seq.readRetry(seq)) return;
+        s_retries++;
+    }
+}
+
+static void snapshot(Snapshot* out) {
+    for (;;) {
+        uint32_t seq = readBegin();
+        memcpy(out->entries, s_entries, sizeof(s_entries));
+        for (uint8_t i = 0; i < TEST_PEERS; i++) {
+            out->pos[i][0] = s_posX[i];
+            out->pos[i][1] = s_posY[i];
+            out->pos[i][2] = s_posZ[i];
+            out->confidence[i] = s_confidence[i];
+        }
+        if (s_seq.readRetry(seq)) { s_retries++; continue; }
+        out->version = seq;
+        return;
+    }
+}
+
+static void readerThread() {
+    Snapshot snap;   // ~2.6 KB at 64 nodes; threads have room
+    while (!s_stop) {
+        for (uint8_t i = 0; i < TEST_PEERS; i++) {
+            Entry e;
+            readEntry(i, &e);
+            if (!entryConsistent(e)) s_torn++;
+            s_reads++;
+        }
+        snapshot(&snap);
+        if (snap.version & 1u) s_torn++;
+        for (uint8_t i = 0; i < TEST_PEERS; i++) {
+            if (!entryConsistent(snap.entries[i])) s_torn++;
+            float c = snap.confidence[i];
+            if (snap.pos[i][0] != c || snap.pos[i][1] != c || snap.pos[i][2] != c) s_torn++;
+            // The whole snapshot comes from one write pass boundary: no
+            // slot may lag its neighbours by more than one pass
+            if (i > 0) {
+                uint8_t prev = snap.entries[i - 1].softap_mac[0];
+                uint8_t cur = snap.entries[i].softap_mac[0];
+                if (prev != cur && (uint8_t)(prev - 1) != cur) s_torn++;
+            }
+        }
+        s_snaps++;
+    }
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_concurrent_reads_never_tear() {
+    writePass(0);   // every slot valid before the race starts
+
+    uint32_t writes = 0;
+    std::thread writer([&writes] {
+        uint8_t v = 0;
+        while (!s_stop) {
+            writePass(++v);
+            writes++;
+        }
+    });
+    std::thread readers[TEST_READERS];
+    for (auto& r : readers) r = std::thread(readerThread);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(TEST_RUN_MS));
+    s_stop = true;
+    writer.join();
+    for (auto& r : readers) r.join();
+
+    char msg[128];
+    snprintf(msg, sizeof(msg), "%u readers: writes=%lu reads=%lu snapshots=%lu retries=%lu",
+        (unsigned)TEST_READERS, (unsigned long)writes, (unsigned long)s_reads.load(),
+        (unsigned long)s_snaps.load(), (unsigned long)s_retries.load());
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_EQUAL_UINT32(0, s_torn.load());
+    TEST_ASSERT_EQUAL_UINT32(0, s_seq.value() & 1u);
+    TEST_ASSERT_GREATER_THAN_UINT32(100, writes);
+    TEST_ASSERT_GREATER_THAN_UINT32(100, s_snaps.load());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_concurrent_reads_never_tear);
+    return UNITY_END();
+}
@@ -0,0 +1,116 @@
+// TravelPath optimiser host test — pio test -e native
+//
+// greedy()/optimise() are pure functions on a cost matrix. On random
+// layouts at 8, 32 and 64 nodes, open and closed: the result must visit
+// every node once and never be longer than the best greedy seed that
+// 2-opt/Or-opt started from. Reports both lengths and the time taken.
+
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+#include "travel_path.h"
+
+static constexpr uint32_t BUDGET  = 200000;   // TRAVEL_PATH_BUDGET
+static constexpr uint8_t  LAYOUTS = 8;        // random layouts per size
+
+static uint16_t s_cost[MESH_MAX_NODES * MESH_MAX_NODES];
+static uint32_t s_rng = 0x7A5E11u;
+
+static uint32_t nextRandom() {   // xorshift32: same layouts every run
+    s_rng ^= s_rng << 13;
+    s_rng ^= s_rng >> 17;
+    s_rng ^= s_rng << 5;
+    return s_rng;
+}
+
+// n nodes scattered over a 20 m × 20 m floor, Euclidean hop costs in cm
+static void randomLayout(uint8_t n) {
+    float x[MESH_MAX_NODES], y[MESH_MAX_NODES];
+    for (uint8_t i = 0; i < n; i++) {
+        x[i] = (float)(nextRandom() % 2000);
+        y[i] = (float)(nextRandom() % 2000);
+    }
+    for (uint8_t a = 0; a < n; a++)
+        for (uint8_t b = 0; b < n; b++)
+            s_cost[a * n + b] = (uint16_t)lroundf(hypotf(x[a] - x[b], y[a] - y[b]));
+}
+
+static bool isPermutation(const uint8_t* order, uint8_t n) {
+    bool seen[MESH_MAX_NODES] = {};
+    for (uint8_t i = 0; i < n; i++) {
+        if (order[i] >= n || seen[order[i]]) return false;
+        seen[order[i]] = true;
+    }
+    return true;
+}
+
+static void checkSize(uint8_t n, bool loop) {
+    uint64_t seedSum = 0, optSum = 0;
+    double us = 0;
+    bool budgetHit = false;
+    for (uint8_t l = 0; l < LAYOUTS; l++) {
+        randomLayout(n);
+
+        // The seed optimise() refines: best greedy walk over all starts
+        uint8_t order[MESH_MAX_NODES];
+        uint32_t seed = UINT32_MAX;
+        for (uint8_t s = 0; s < n; s++) {
+            uint32_t len = TravelPath::greedy(s_cost, n, s, loop, order);
+            TEST_ASSERT_TRUE(isPermutation(order, n));
+            if (len < seed) seed = len;
+        }
+
+        auto t0 = std::chrono::steady_clock::now();
+        uint32_t opt = TravelPath::optimise(s_cost, n, loop, order, BUDGET);
+        us += std::chrono::duration_cast<std::chrono::microseconds>(
+                  std::chrono::steady_clock::now() - t0).count();
+        budgetHit |= TravelPath::lastHitBudget();
+
+        TEST_ASSERT_TRUE(isPermutation(order, n));
+        TEST_ASSERT_EQUAL_UINT32(TravelPath::length(s_cost, n, order, loop), opt);
+        TEST_ASSERT_LESS_OR_EQUAL_UINT32(seed, opt);
+        seedSum += seed;
+        optSum += opt;
+    }
+
+    char msg[128];
+    snprintf(msg, sizeof(msg), "%2u nodes %-4s: greedy %7.0f cm, optimised %7.0f cm (%4.1f%% shorter), %6.0f us%s",
+        n, loop ? "loop" : "open", (double)seedSum / LAYOUTS, (double)optSum / LAYOUTS,
+        100.0 * (double)(seedSum - optSum) / (double)seedSum, us / LAYOUTS,
+        budgetHit ? ", budget hit" : "");
+    TEST_MESSAGE(msg);
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_open_never_longer_than_seed() {
+    checkSize(8, false);
+    checkSize(32, false);
+    checkSize(MESH_MAX_NODES, false);
+}
+
+void test_loop_never_longer_than_seed() {
+    checkSize(8, true);
+    checkSize(32, true);
+    checkSize(MESH_MAX_NODES, true);
+}
+
+void test_small_paths() {
+    // Below three stops there is nothing to optimise: identity order
+    uint8_t order[2];
+    randomLayout(2);
+    TEST_ASSERT_EQUAL_UINT32(s_cost[1], TravelPath::optimise(s_cost, 2, false, order, BUDGET));
+    TEST_ASSERT_EQUAL_UINT8(0, order[0]);
+    TEST_ASSERT_EQUAL_UINT8(1, order[1]);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_open_never_longer_than_seed);
+    RUN_TEST(test_loop_never_longer_than_seed);
+    RUN_TEST(test_small_paths);
+    return UNITY_END();
+}
@@ -0,0 +1,119 @@
+// PeerTable seqlock stress test — runs on the board: pio test -f test_peer_table
+//
+// A writer task rewrites every peer as fast as it can while the test task
+// reads through readEntry() (by index and by MAC) and snapshot(). Each write
+// keeps an invariant that a torn copy would break:
+//   entry:    battery_mv == 1000 + v  and every softap_mac byte == v
+//   position: x == y == z == confidence
+// The two are written separately, so they are checked separately.
+
+#include <Arduino.h>
+#include <unity.h>
+#include "nvs_config.h"
+#include "power_manager.h"
+#include "peer_table.h"
+
+static constexpr uint8_t  TEST_PEERS  = 16;
+static constexpr uint32_t TEST_RUN_MS = 3000;
+
+static volatile bool     s_stop   = false;
+static volatile bool     s_done   = false;
+static volatile uint32_t s_writes = 0;
+
+static PeerSnapshot s_snap;   // ~2.6 KB: keep off the stack
+
+static void peerMac(uint8_t i, uint8_t* mac) {
+    const uint8_t m[6] = {0x02, 0x5E, 0x7E, 0x57, 0x00, (uint8_t)(0x10 + i)};
+    memcpy(mac, m, 6);
+}
+
+static bool entryConsistent(const PeerEntry& e) {
+    uint8_t v = e.softap_mac[0];
+    for (int b = 1; b < 6; b++)
+        if (e.softap_mac[b] != v) return false;
+    return e.battery_mv == 1000 + v;
+}
+
+static void writePass(uint8_t v) {
+    for (uint8_t i = 0; i < TEST_PEERS; i++) {
+        uint8_t mac[6], ap[6];
+        peerMac(i, mac);
+        memset(ap, v, sizeof(ap));
+        PeerTable::updateFromHeartbeat(mac, 1000 + v, 0, ap, 60);
+        int8_t idx = PeerTable::getIndex(mac);
+        if (idx >= 0) PeerTable::setPosition(idx, v, v, v, v);
+    }
+}
+
+static void writerTask(void*) {
+    uint8_t v = 0;
+    while (!s_stop) {
+        writePass(++v);
+        s_writes++;
+    }
+    s_done = true;
+    vTaskDelete(nullptr);
+}
+
+void test_concurrent_reads_never_tear() {
+    writePass(0);   // register every peer before the race starts
+    TEST_ASSERT_GREATER_OR_EQUAL(TEST_PEERS, PeerTable::peerCount());
+
+    // Same priority as the reader: the scheduler time-slices them, so
+    // writes land in the middle of reads.
+    xTaskCreate(writerTask, "pt_writer", 4096, nullptr, uxTaskPriorityGet(nullptr), nullptr);
+
+    uint32_t reads = 0, snaps = 0, torn = 0;
+    uint32_t start = millis();
+    while (millis() - start < TEST_RUN_MS) {
+        PeerEntry e;
+        for (uint8_t i = 0; i < PeerTable::peerCount(); i++) {
+            if (!PeerTable::readEntry(i, &e)) continue;
+            if (memcmp(e.mac, "\x02\x5E\x7E\x57", 4) != 0) continue;   // self/other slots
+            if (!entryConsistent(e)) torn++;
+            reads++;
+        }
+        for (uint8_t i = 0; i < TEST_PEERS; i++) {
+            uint8_t mac[6];
+            peerMac(i, mac);
+            if (!PeerTable::readEntry(mac, &e)) torn++;   // registered peers never vanish
+            else if (!entryConsistent(e)) torn++;
+            reads++;
+        }
+
+        PeerTable::snapshot(&s_snap);
+        if (s_snap.version & 1) torn++;
+        for (uint8_t i = 0; i < s_snap.count; i++) {
+            const PeerEntry& s = s_snap.entries[i];
+            if (memcmp(s.mac, "\x02\x5E\x7E\x57", 4) != 0) continue;
+            if (!entryConsistent(s)) torn++;
+            float c = s_snap.confidence[i];
+            if (s_snap.pos[i][0] != c || s_snap.pos[i][1] != c || s_snap.pos[i][2] != c) torn++;
+        }
+        snaps++;
+    }
+
+    s_stop = true;
+    while (!s_done) vTaskDelay(1);
+
+    char msg[64];
+    snprintf(msg, sizeof(msg), "writes=%lu reads=%lu snapshots=%lu",
+             (unsigned long)s_writes, (unsigned long)reads, (unsigned long)snaps);
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_EQUAL_UINT32(0, torn);
+    TEST_ASSERT_GREATER_THAN_UINT32(100, s_writes);
+    TEST_ASSERT_GREATER_THAN_UINT32(100, snaps);
+}
+
+void setup() {
+    delay(2000);   // let the serial monitor attach
+    NvsConfigManager::begin();
+    PowerManager::init();
+    PeerTable::init();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_concurrent_reads_never_tear);
+    UNITY_END();
+}
+
+void loop() {}